@@ -2,6 +2,7 @@
 // SPDX-License-Identifier: Apache-2.0
 #include "compute.hpp"
 
+#include <algorithm>
 #include <atomic>
 #include <cassert>
 #include <string>
@@ -13,35 +14,114 @@
 #include "nvvk/images_vk.hpp"
 #include "nvvk/pipeline_vk.hpp"
 
+#include "equation.hpp"
+#include "mcubes_bake.hpp"
+#include "mcubes_brick.hpp"
 #include "mcubes_chunk.hpp"
+#include "mcubes_cpu_batch.hpp"
 #include "timeline_semaphore_main.hpp"
 
+#include "shaders/mcubes_bake.h"
 #include "shaders/mcubes_geometry.h"
 #include "shaders/mcubes_params.h"
+#include "shaders/mcubes_upload.h"
 
 bool g_computeReadyFlag = false;
 
-// Shared pipeline layout for two pipelines.
+// Shared pipeline layout for three pipelines.
 static VkPipelineLayout s_mcubesPipelineLayout;
 static VkPipeline       s_mcubesImagePipeline;
 static VkPipeline       s_mcubesGeometryPipeline;
+static VkPipeline       s_mcubesDecimatePipeline;
+
+// McubesBakeParams push constant, McubesChunk and keyframe cache descriptor sets.
+static VkPipelineLayout s_mcubesBakePipelineLayout;
+static VkPipeline       s_mcubesBakePipeline;
+
+// McubesUploadParams push constant, McubesChunk and staging ring descriptor sets.
+static VkPipelineLayout s_mcubesUploadPipelineLayout;
+static VkPipeline       s_mcubesUploadPipeline;
+
+// mcubes_image.comp dispatch width; smaller if the equation's separable terms are tabulated.
+static uint32_t s_mcubesImageDispatchX = MCUBES_CHUNK_EDGE_LENGTH_TEXELS;
 
 static void setupMcubesPipelineLayout();
-static bool setupMcubesImagePipeline(std::string prepend);
-static void setupMcubesGeometryPipeline();
+static bool setupMcubesImagePipeline(const char* pEquation, bool useTables);
+static bool setupMcubesGeometryPipeline(const char* pEquation);
+static void setupMcubesDecimatePipeline();
+static void setupMcubesBakePipeline();
+static void setupMcubesUploadPipeline();
+
+
+// Make the text prepended to mcubes_image.comp for the given equation: optimized GLSL statements if the
+// CPU-side parser understands it, otherwise the equation spliced verbatim (to support arbitrary GLSL).
+// If useTables is set and the equation has separable terms, they are tabulated (see mcubes_image.comp),
+// which changes the dispatch width returned in *pDispatchX.
+static std::string makeEquationPrepend(const char* pEquation, bool useTables, uint32_t* pDispatchX)
+{
+  *pDispatchX = MCUBES_CHUNK_EDGE_LENGTH_TEXELS;
+  Equation equation;
+  if(equationParse(pEquation, &equation, nullptr))
+  {
+    equationOptimize(&equation);
+    EquationSeparableGlsl separable;
+    if(useTables && equationEmitSeparableGlsl(equation, &separable))
+    {
+      std::string prepend = "#define EQUATION_SEPARABLE 1\n";
+      for(uint32_t axis = 0; axis < 3; ++axis)
+      {
+        std::string axisName   = std::string(1, "XYZ"[axis]);
+        uint32_t    tableCount = std::max(separable.tableCounts[axis], 1u);  // No zero-length arrays in GLSL
+        prepend += "#define EQUATION_TABLES_" + axisName + " " + std::to_string(tableCount) + "\n";
+        prepend += "#define EQUATION_FILL_" + axisName + " " + separable.fillStatements[axis] + "\n";
+      }
+      *pDispatchX = MCUBES_CHUNK_EDGE_LENGTH_TEXELS / MCUBES_IMAGE_ROWS_PER_WORKGROUP;
+      return prepend + "#define EQUATION_STATEMENTS " + separable.statements + "\n";
+    }
+    return "#define EQUATION_STATEMENTS " + equationEmitGlsl(equation) + "\n";
+  }
 
+  // As in the emitted statements, 1/2 is 0.5.
+  std::string prepend = "#define EQUATION(x, y, z, t) " + equationGlslFloatLiterals(pEquation);
+  for(char& c : prepend)
+  {
+    if(c == '\n')
+      c = ' ';
+  }
+  return prepend + "\n";
+}
 
-void setupCompute(const char* pEquation)
+// Make the text prepended to mcubes_geometry.comp for the given equation: its dual number (value and gradient)
+// GLSL if the CPU-side parser understands it, for refining vertices, otherwise nothing.
+static std::string makeEquationDualPrepend(const char* pEquation)
+{
+  Equation equation;
+  if(!equationParse(pEquation, &equation, nullptr))
+  {
+    return "";
+  }
+  equationOptimize(&equation);
+  return "#define EQUATION_DUAL_STATEMENTS " + equationEmitDualGlsl(equation) + "\n";
+}
+
+void setupCompute(const char* pEquation, bool useTables)
 {
-  std::string prepend = std::string("#define EQUATION(x, y, z, t) ") + pEquation;
   setupMcubesPipelineLayout();
-  bool success = setupMcubesImagePipeline(std::move(prepend));
+  bool success = setupMcubesImagePipeline(pEquation, useTables);
+  success &= setupMcubesGeometryPipeline(pEquation);
   assert(success);
-  setupMcubesGeometryPipeline();
+  setupMcubesDecimatePipeline();
+  setupMcubesBakePipeline();
+  setupMcubesUploadPipeline();
 }
 
 void shutdownCompute()
 {
+  vkDestroyPipeline(g_ctx, s_mcubesUploadPipeline, nullptr);
+  vkDestroyPipelineLayout(g_ctx, s_mcubesUploadPipelineLayout, nullptr);
+  vkDestroyPipeline(g_ctx, s_mcubesBakePipeline, nullptr);
+  vkDestroyPipelineLayout(g_ctx, s_mcubesBakePipelineLayout, nullptr);
+  vkDestroyPipeline(g_ctx, s_mcubesDecimatePipeline, nullptr);
   vkDestroyPipeline(g_ctx, s_mcubesGeometryPipeline, nullptr);
   vkDestroyPipeline(g_ctx, s_mcubesImagePipeline, nullptr);
   vkDestroyPipelineLayout(g_ctx, s_mcubesPipelineLayout, nullptr);
@@ -106,16 +186,12 @@ static void setupMcubesPipelineLayout()
   NVVK_CHECK(vkCreatePipelineLayout(g_ctx, &info, nullptr, &s_mcubesPipelineLayout));
 }
 
-static bool setupMcubesImagePipeline(std::string prepend)
+static bool setupMcubesImagePipeline(const char* pEquation, bool useTables)
 {
-  for(char& c : prepend)
-  {
-    if(c == '\n')
-      c = ' ';
-  }
-  prepend.push_back('\n');
-  auto module_id = g_pShaderCompiler->createShaderModule(VK_SHADER_STAGE_COMPUTE_BIT, "./shaders/mcubes_image.comp",
-                                                         std::move(prepend));
+  uint32_t    dispatchX;
+  std::string prepend   = makeEquationPrepend(pEquation, useTables, &dispatchX);
+  auto        module_id = g_pShaderCompiler->createShaderModule(VK_SHADER_STAGE_COMPUTE_BIT,
+                                                                "./shaders/mcubes_image.comp", std::move(prepend));
   VkShaderModule module = g_pShaderCompiler->get(module_id);
   if(!module)
   {
@@ -123,56 +199,168 @@ static bool setupMcubesImagePipeline(std::string prepend)
   }
   vkDestroyPipeline(g_ctx, s_mcubesImagePipeline, nullptr);
   makeComputePipeline(module, false, s_mcubesPipelineLayout, &s_mcubesImagePipeline, "mcubes_image.comp");
+  s_mcubesImageDispatchX = dispatchX;
   return true;
 }
 
-static void setupMcubesGeometryPipeline()
+static bool setupMcubesGeometryPipeline(const char* pEquation)
 {
-  auto module_id = g_pShaderCompiler->createShaderModule(VK_SHADER_STAGE_COMPUTE_BIT, "./shaders/mcubes_geometry.comp");
-  makeComputePipeline(g_pShaderCompiler->get(module_id), false, s_mcubesPipelineLayout, &s_mcubesGeometryPipeline,
-                      "mcubes_geometry.comp");
+  auto           module_id = g_pShaderCompiler->createShaderModule(VK_SHADER_STAGE_COMPUTE_BIT,
+                                                                   "./shaders/mcubes_geometry.comp",
+                                                                   makeEquationDualPrepend(pEquation));
+  VkShaderModule module    = g_pShaderCompiler->get(module_id);
+  if(!module)
+  {
+    return false;
+  }
+  vkDestroyPipeline(g_ctx, s_mcubesGeometryPipeline, nullptr);
+  makeComputePipeline(module, false, s_mcubesPipelineLayout, &s_mcubesGeometryPipeline, "mcubes_geometry.comp");
+  return true;
+}
+
+static void setupMcubesDecimatePipeline()
+{
+  auto module_id =
+      g_pShaderCompiler->createShaderModule(VK_SHADER_STAGE_COMPUTE_BIT, "./shaders/mcubes_decimate.comp");
+  makeComputePipeline(g_pShaderCompiler->get(module_id), false, s_mcubesPipelineLayout, &s_mcubesDecimatePipeline,
+                      "mcubes_decimate.comp");
+}
+
+static void setupMcubesBakePipeline()
+{
+  VkDescriptorSetLayout      layouts[2] = {g_mcubesChunkDescriptorSetLayout, g_mcubesBakeDescriptorSetLayout};
+  VkPushConstantRange        pushConstant{VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(McubesBakeParams)};
+  VkPipelineLayoutCreateInfo info{VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+                                  nullptr,
+                                  0,
+                                  2,
+                                  layouts,
+                                  1,
+                                  &pushConstant};
+  NVVK_CHECK(vkCreatePipelineLayout(g_ctx, &info, nullptr, &s_mcubesBakePipelineLayout));
+
+  auto module_id = g_pShaderCompiler->createShaderModule(VK_SHADER_STAGE_COMPUTE_BIT, "./shaders/mcubes_bake.comp");
+  makeComputePipeline(g_pShaderCompiler->get(module_id), false, s_mcubesBakePipelineLayout, &s_mcubesBakePipeline,
+                      "mcubes_bake.comp");
+}
+
+static void setupMcubesUploadPipeline()
+{
+  VkDescriptorSetLayout      layouts[2] = {g_mcubesChunkDescriptorSetLayout, g_mcubesUploadDescriptorSetLayout};
+  VkPushConstantRange        pushConstant{VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(McubesUploadParams)};
+  VkPipelineLayoutCreateInfo info{VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+                                  nullptr,
+                                  0,
+                                  2,
+                                  layouts,
+                                  1,
+                                  &pushConstant};
+  NVVK_CHECK(vkCreatePipelineLayout(g_ctx, &info, nullptr, &s_mcubesUploadPipelineLayout));
+
+  auto module_id = g_pShaderCompiler->createShaderModule(VK_SHADER_STAGE_COMPUTE_BIT, "./shaders/mcubes_upload.comp");
+  makeComputePipeline(g_pShaderCompiler->get(module_id), false, s_mcubesUploadPipelineLayout, &s_mcubesUploadPipeline,
+                      "mcubes_upload.comp");
 }
 
 void computeCmdFillChunkBatch(VkCommandBuffer           cmdBuf,
                               uint32_t                  count,
                               const McubesChunk* const* ppChunks,
-                              const McubesParams*       pParams)
+                              const McubesParams*       pParams,
+                              bool                      fillGeometry,
+                              const uint32_t*           pBrickRegions)
 {
-  // Transition images to general layout, without inserting any execution dependency.
-  VkImageMemoryBarrier toGeneralBarriers[MCUBES_MAX_CHUNKS_PER_BATCH];
   assert(count <= MCUBES_MAX_CHUNKS_PER_BATCH);
+  for(uint32_t i = 1; i < count; ++i)
+  {
+    // Chunks of a batch must not share an image pool slot (see MCUBES_IMAGE_POOL_SIZE).
+    assert(uint32_t(ppChunks[i] - ppChunks[0] + MCUBES_CHUNK_COUNT) % MCUBES_IMAGE_POOL_SIZE == i);
+  }
+
+  // Bricks (see mcubes_brick.hpp) are copied from their ring instead of computed from the equation.
+  const bool                 bricks      = pBrickRegions != nullptr;
+  const VkAccessFlags        imageAccess = bricks ? VK_ACCESS_TRANSFER_WRITE_BIT : VK_ACCESS_SHADER_WRITE_BIT;
+  const VkPipelineStageFlags imageStage  =
+      bricks ? VK_PIPELINE_STAGE_TRANSFER_BIT : VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+
+  // Upload the mask of McubesGeometry blocks to skip, and clear (or copy) the block signatures. Wait for any
+  // earlier fill on this queue that used these buffers (WAR hazard on the mask, WAW on the signatures). The
+  // bricks may have been written by the host after submission, so their writes must be made visible too.
+  VkMemoryBarrier reuseBarrier{VK_STRUCTURE_TYPE_MEMORY_BARRIER, nullptr,
+                               VK_ACCESS_SHADER_WRITE_BIT | (bricks ? VK_ACCESS_HOST_WRITE_BIT : 0u),
+                               VK_ACCESS_TRANSFER_WRITE_BIT | (bricks ? VK_ACCESS_TRANSFER_READ_BIT : 0u)};
+  vkCmdPipelineBarrier(cmdBuf, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | (bricks ? VK_PIPELINE_STAGE_HOST_BIT : 0u),
+                       VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &reuseBarrier, 0, nullptr, 0, nullptr);
+  for(uint32_t i = 0; i < count; ++i)
+  {
+    vkCmdUpdateBuffer(cmdBuf, ppChunks[i]->emptyBlockMaskBuffer.buffer, 0, sizeof ppChunks[i]->emptyBlockMask,
+                      ppChunks[i]->emptyBlockMask);
+    if(bricks)
+    {
+      VkBufferCopy copy{mcubesBrickSignatureOffset(pBrickRegions[i]), 0,
+                        MCUBES_GEOMETRIES_PER_CHUNK * sizeof(uint32_t)};
+      vkCmdCopyBuffer(cmdBuf, mcubesBrickBuffer(), ppChunks[i]->blockSignatureBuffer.buffer, 1, &copy);
+    }
+    else
+    {
+      vkCmdFillBuffer(cmdBuf, ppChunks[i]->blockSignatureBuffer.buffer, 0, VK_WHOLE_SIZE, 0);
+    }
+  }
+  VkMemoryBarrier maskBarrier{VK_STRUCTURE_TYPE_MEMORY_BARRIER, nullptr, VK_ACCESS_TRANSFER_WRITE_BIT,
+                              VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT};
+
+  // Transition images to general layout, without inserting any execution dependency (other than
+  // on the above mask upload). The old contents, possibly of another chunk aliasing the memory, are discarded.
+  // Without geometry, the image is instead the one drawn by the ray marching render mode.
+  VkImageMemoryBarrier toGeneralBarriers[MCUBES_MAX_CHUNKS_PER_BATCH];
   for(uint32_t i = 0; i < count; ++i)
   {
     toGeneralBarriers[i].sType               = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
     toGeneralBarriers[i].pNext               = nullptr;
     toGeneralBarriers[i].srcAccessMask       = 0;
-    toGeneralBarriers[i].dstAccessMask       = VK_ACCESS_SHADER_WRITE_BIT;
+    toGeneralBarriers[i].dstAccessMask       = imageAccess;
     toGeneralBarriers[i].oldLayout           = VK_IMAGE_LAYOUT_UNDEFINED;
     toGeneralBarriers[i].newLayout           = VK_IMAGE_LAYOUT_GENERAL;
     toGeneralBarriers[i].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
     toGeneralBarriers[i].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-    toGeneralBarriers[i].image               = ppChunks[i]->image.image;
+    toGeneralBarriers[i].image               = fillGeometry ? ppChunks[i]->image : ppChunks[i]->rayMarchImage;
     toGeneralBarriers[i].subresourceRange    = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
   }
-  vkCmdPipelineBarrier(cmdBuf, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, 0, 0, 0,
-                       count, toGeneralBarriers);
+  vkCmdPipelineBarrier(cmdBuf, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | imageStage, 0,
+                       1, &maskBarrier, 0, 0, count, toGeneralBarriers);
 
-  // Dispatch fill image shaders.
-  for(uint32_t i = 0; i < count; ++i)
+  // Copy the bricks, or dispatch fill image shaders.
+  for(uint32_t i = 0; i < count && bricks; ++i)
   {
-    const McubesChunk&  chunk  = *ppChunks[i];
-    const McubesParams& params = pParams[i];
-    vkCmdBindDescriptorSets(cmdBuf, VK_PIPELINE_BIND_POINT_COMPUTE, s_mcubesPipelineLayout, 0, 1, &chunk.set, 0, 0);
+    VkBufferImageCopy copy{mcubesBrickImageOffset(pBrickRegions[i]),
+                           0,
+                           0,
+                           {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1},
+                           {0, 0, 0},
+                           {MCUBES_CHUNK_EDGE_LENGTH_TEXELS, MCUBES_CHUNK_EDGE_LENGTH_TEXELS,
+                            MCUBES_CHUNK_EDGE_LENGTH_TEXELS}};
+    VkImage           image = fillGeometry ? ppChunks[i]->image : ppChunks[i]->rayMarchImage;
+    vkCmdCopyBufferToImage(cmdBuf, mcubesBrickBuffer(), image, VK_IMAGE_LAYOUT_GENERAL, 1, &copy);
+  }
+  for(uint32_t i = 0; i < count && !bricks; ++i)
+  {
+    const McubesChunk&     chunk  = *ppChunks[i];
+    const McubesParams&    params = pParams[i];
+    const VkDescriptorSet* pSet   = fillGeometry ? &chunk.set : &chunk.rayMarchSet;
+    vkCmdBindDescriptorSets(cmdBuf, VK_PIPELINE_BIND_POINT_COMPUTE, s_mcubesPipelineLayout, 0, 1, pSet, 0, 0);
     vkCmdPushConstants(cmdBuf, s_mcubesPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof params, &params);
     vkCmdBindPipeline(cmdBuf, VK_PIPELINE_BIND_POINT_COMPUTE, s_mcubesImagePipeline);
-    vkCmdDispatch(cmdBuf, MCUBES_CHUNK_EDGE_LENGTH_TEXELS, MCUBES_CHUNK_EDGE_LENGTH_TEXELS, 1);
+    vkCmdDispatch(cmdBuf, s_mcubesImageDispatchX, MCUBES_CHUNK_EDGE_LENGTH_TEXELS, 1);
   }
+  if(!fillGeometry && !bricks)
+    return;
 
-  // Wait for images to be filled.
-  VkMemoryBarrier barrier{VK_STRUCTURE_TYPE_MEMORY_BARRIER, nullptr, VK_ACCESS_SHADER_WRITE_BIT,
-                          VK_ACCESS_SHADER_READ_BIT};
-  vkCmdPipelineBarrier(cmdBuf, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,  //
+  // Wait for images to be filled. Without geometry, this instead lets the barriers recorded after the copies,
+  // which expect shader writes, cover them.
+  VkMemoryBarrier barrier{VK_STRUCTURE_TYPE_MEMORY_BARRIER, nullptr, imageAccess, VK_ACCESS_SHADER_READ_BIT};
+  vkCmdPipelineBarrier(cmdBuf, imageStage, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,  //
                        1, &barrier, 0, nullptr, 0, nullptr);
+  if(!fillGeometry)
+    return;
 
   // Dispatch fill McubesGeometry shaders.
   for(uint32_t i = 0; i < count; ++i)
@@ -184,10 +372,102 @@ void computeCmdFillChunkBatch(VkCommandBuffer           cmdBuf,
     vkCmdBindPipeline(cmdBuf, VK_PIPELINE_BIND_POINT_COMPUTE, s_mcubesGeometryPipeline);
     vkCmdDispatch(cmdBuf, MCUBES_GEOMETRIES_PER_CHUNK, 1, 1);
   }
+
+  // Optionally decimate flat regions of the McubesGeometry arrays just filled.
+  bool decimate = false;
+  for(uint32_t i = 0; i < count; ++i)
+  {
+    decimate |= pParams[i].decimateTolerance > 0.0f;
+  }
+  if(decimate)
+  {
+    VkMemoryBarrier geometryBarrier{VK_STRUCTURE_TYPE_MEMORY_BARRIER, nullptr, VK_ACCESS_SHADER_WRITE_BIT,
+                                    VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT};
+    vkCmdPipelineBarrier(cmdBuf, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,  //
+                         1, &geometryBarrier, 0, nullptr, 0, nullptr);
+    vkCmdBindPipeline(cmdBuf, VK_PIPELINE_BIND_POINT_COMPUTE, s_mcubesDecimatePipeline);
+    for(uint32_t i = 0; i < count; ++i)
+    {
+      const McubesChunk&  chunk  = *ppChunks[i];
+      const McubesParams& params = pParams[i];
+      if(params.decimateTolerance <= 0.0f)
+        continue;
+      vkCmdBindDescriptorSets(cmdBuf, VK_PIPELINE_BIND_POINT_COMPUTE, s_mcubesPipelineLayout, 0, 1, &chunk.set, 0, 0);
+      vkCmdPushConstants(cmdBuf, s_mcubesPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof params, &params);
+      vkCmdDispatch(cmdBuf, MCUBES_GEOMETRIES_PER_CHUNK, 1, 1);
+    }
+  }
+
+  // Make the McubesBlockStats counts visible to mcubesCollectBlockStats.
+  VkMemoryBarrier statsBarrier{VK_STRUCTURE_TYPE_MEMORY_BARRIER, nullptr, VK_ACCESS_SHADER_WRITE_BIT,
+                               VK_ACCESS_HOST_READ_BIT};
+  vkCmdPipelineBarrier(cmdBuf, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0,  //
+                       1, &statsBarrier, 0, nullptr, 0, nullptr);
+}
+
+void computeCmdBakeChunkBatch(VkCommandBuffer           cmdBuf,
+                              uint32_t                  count,
+                              const McubesChunk* const* ppChunks,
+                              uint32_t                  firstDraw,
+                              uint32_t                  statsSlot)
+{
+  assert(count <= MCUBES_MAX_CHUNKS_PER_BATCH);
+
+  // Wait for the McubesGeometry arrays to be filled.
+  VkMemoryBarrier barrier{VK_STRUCTURE_TYPE_MEMORY_BARRIER, nullptr, VK_ACCESS_SHADER_WRITE_BIT,
+                          VK_ACCESS_SHADER_READ_BIT};
+  vkCmdPipelineBarrier(cmdBuf, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,  //
+                       1, &barrier, 0, nullptr, 0, nullptr);
+
+  vkCmdBindPipeline(cmdBuf, VK_PIPELINE_BIND_POINT_COMPUTE, s_mcubesBakePipeline);
+  vkCmdBindDescriptorSets(cmdBuf, VK_PIPELINE_BIND_POINT_COMPUTE, s_mcubesBakePipelineLayout, 1, 1,
+                          &g_mcubesBakeDescriptorSet, 0, 0);
+  for(uint32_t i = 0; i < count; ++i)
+  {
+    McubesBakeParams params{firstDraw + i * MCUBES_GEOMETRIES_PER_CHUNK, statsSlot};
+    vkCmdBindDescriptorSets(cmdBuf, VK_PIPELINE_BIND_POINT_COMPUTE, s_mcubesBakePipelineLayout, 0, 1,
+                            &ppChunks[i]->set, 0, 0);
+    vkCmdPushConstants(cmdBuf, s_mcubesBakePipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof params, &params);
+    vkCmdDispatch(cmdBuf, MCUBES_GEOMETRIES_PER_CHUNK, 1, 1);
+  }
+
+  // Make the cache available to the host domain: the host reads the McubesBakeHeader, and the keyframe
+  // is only drawn in a later submission (see mcubesBakeCollect), which makes host-available writes visible.
+  VkMemoryBarrier hostBarrier{VK_STRUCTURE_TYPE_MEMORY_BARRIER, nullptr, VK_ACCESS_SHADER_WRITE_BIT,
+                              VK_ACCESS_HOST_READ_BIT};
+  vkCmdPipelineBarrier(cmdBuf, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0,  //
+                       1, &hostBarrier, 0, nullptr, 0, nullptr);
+}
+
+void computeCmdUploadChunkBatch(VkCommandBuffer           cmdBuf,
+                                uint32_t                  count,
+                                const McubesChunk* const* ppChunks,
+                                uint32_t                  firstRegion)
+{
+  assert(count <= MCUBES_MAX_CHUNKS_PER_BATCH);
+
+  // The host writes the staging ring after this command buffer is submitted (before signaling the semaphore that
+  // the submission waits for), so the submission does not make those writes visible by itself.
+  VkMemoryBarrier barrier{VK_STRUCTURE_TYPE_MEMORY_BARRIER, nullptr, VK_ACCESS_HOST_WRITE_BIT,
+                          VK_ACCESS_SHADER_READ_BIT};
+  vkCmdPipelineBarrier(cmdBuf, VK_PIPELINE_STAGE_HOST_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,  //
+                       1, &barrier, 0, nullptr, 0, nullptr);
+
+  vkCmdBindPipeline(cmdBuf, VK_PIPELINE_BIND_POINT_COMPUTE, s_mcubesUploadPipeline);
+  vkCmdBindDescriptorSets(cmdBuf, VK_PIPELINE_BIND_POINT_COMPUTE, s_mcubesUploadPipelineLayout, 1, 1,
+                          &g_mcubesUploadDescriptorSet, 0, 0);
+  for(uint32_t i = 0; i < count; ++i)
+  {
+    McubesUploadParams params{firstRegion + i};
+    vkCmdBindDescriptorSets(cmdBuf, VK_PIPELINE_BIND_POINT_COMPUTE, s_mcubesUploadPipelineLayout, 0, 1,
+                            &ppChunks[i]->set, 0, 0);
+    vkCmdPushConstants(cmdBuf, s_mcubesUploadPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof params, &params);
+    vkCmdDispatch(cmdBuf, MCUBES_GEOMETRIES_PER_CHUNK, 1, 1);
+  }
 }
 
-bool computeReplaceEquation(const char* pEquation)
+bool computeReplaceEquation(const char* pEquation, bool useTables)
 {
   printf("\x1b[34m\x1b[1mEquation:\x1b[0m '%s'\n", pEquation);
-  return setupMcubesImagePipeline(std::string("#define EQUATION(x, y, z, t) ") + pEquation);
+  return setupMcubesImagePipeline(pEquation, useTables) && setupMcubesGeometryPipeline(pEquation);
 }
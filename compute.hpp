@@ -5,21 +5,48 @@
 #include <vulkan/vulkan.h>
 
 // Initialize and de-initialize compute state.
-void setupCompute(const char* pEquation);
+// If useTables is set, separable terms of the equation are tabulated per-axis (see mcubes_image.comp).
+void setupCompute(const char* pEquation, bool useTables);
 void shutdownCompute();
 
 extern bool g_computeReadyFlag;
 bool        computeUpdateComputeReadyFlag();
 
 // Record commands to fill the given array of McubesChunk (image and geometry array buffer),
-// using the corresponding array of parameters. No implied barriers before or after.
+// using the corresponding array of parameters. McubesGeometry blocks marked in each
+// McubesChunk::emptyBlockMask are filled as empty without analyzing the image. Flat regions are then
+// decimated for chunks with positive McubesParams::decimateTolerance.
+// If fillGeometry is false, only the image and block signatures are filled (for the ray marching render mode).
+// If pBrickRegions is not null, the image and block signatures of chunk i are instead copied from brick region
+// pBrickRegions[i] of the brick ring (see mcubes_brick.hpp), including a barrier making host writes visible.
+// No implied barriers before or after.
 struct McubesChunk;
 struct McubesParams;
 void computeCmdFillChunkBatch(VkCommandBuffer           cmdBuf,
                               uint32_t                  count,
                               const McubesChunk* const* pChunks,
-                              const McubesParams*       pParams);
+                              const McubesParams*       pParams,
+                              bool                      fillGeometry,
+                              const uint32_t*           pBrickRegions);
 
-// Replace the equation being used to generate the marching cubes 3D input image. Returns success flag.
+// Record commands to compact the McubesGeometry arrays of the given McubesChunk, just filled by
+// computeCmdFillChunkBatch in the same command buffer, into the animation keyframe cache (see mcubes_bake.hpp),
+// chunk i at McubesBakedDraw index firstDraw + i * MCUBES_GEOMETRIES_PER_CHUNK. Includes a barrier before.
+void computeCmdBakeChunkBatch(VkCommandBuffer           cmdBuf,
+                              uint32_t                  count,
+                              const McubesChunk* const* ppChunks,
+                              uint32_t                  firstDraw,
+                              uint32_t                  statsSlot);
+
+// Record commands to fill the McubesGeometry arrays of the given McubesChunk from consecutive regions of the
+// staging ring, starting at firstRegion, written by the CPU mesher (see mcubes_cpu_batch.hpp). Includes a barrier
+// making the host writes visible before; no implied barriers after, as for computeCmdFillChunkBatch.
+void computeCmdUploadChunkBatch(VkCommandBuffer           cmdBuf,
+                                uint32_t                  count,
+                                const McubesChunk* const* ppChunks,
+                                uint32_t                  firstRegion);
+
+// Replace the equation being used to generate the marching cubes 3D input image (and to refine vertices on).
+// Returns success flag.
 // Ensure that no computeCmdFillChunk commands are running when this function is called.
-bool computeReplaceEquation(const char* pEquation);
+bool computeReplaceEquation(const char* pEquation, bool useTables);
@@ -0,0 +1,1587 @@
+// Copyright 2021 NVIDIA CORPORATION
+// SPDX-License-Identifier: Apache-2.0
+#include "equation.hpp"
+
+#include <cassert>
+#include <ctype.h>
+#include <map>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <tuple>
+
+// Table of function calls understood by the parser. atan is special-cased (1 or 2 arguments).
+struct EquationFunction
+{
+  const char* pName;
+  EquationOp  op;
+  uint32_t    argCount;
+};
+
+static const EquationFunction equationFunctionNames[] = {
+    {"sin", equationOpSin, 1},     {"cos", equationOpCos, 1},     {"tan", equationOpTan, 1},
+    {"atan", equationOpAtan, 1},   {"sqrt", equationOpSqrt, 1},   {"pow", equationOpPow, 2},
+    {"exp", equationOpExp, 1},     {"log", equationOpLog, 1},     {"abs", equationOpAbs, 1},
+    {"sign", equationOpSign, 1},   {"floor", equationOpFloor, 1}, {"fract", equationOpFract, 1},
+    {"mod", equationOpMod, 2},     {"min", equationOpMin, 2},     {"max", equationOpMax, 2},
+    {"clamp", equationOpClamp, 3}, {"square", equationOpSquare, 1},
+    {"csgUnion", equationOpCsgUnion, 2},             {"csgIntersect", equationOpCsgIntersect, 2},
+    {"csgSubtract", equationOpCsgSubtract, 2},       {"csgSmoothUnion", equationOpCsgSmoothUnion, 3},
+    {"csgSmoothIntersect", equationOpCsgSmoothIntersect, 3},
+    {"csgSmoothSubtract", equationOpCsgSmoothSubtract, 3},
+};
+
+const EquationExample equationExamples[] = {
+    {"rings",
+     "sqrt(square(fract(y) - 0.5) + square(abs(r - 1))) - 0.15 - 0.25*square(cos(t+(floor(y) + 3)*theta))"},
+    {"sphere", "x*x + y*y + z*z - 1.0 - 0.5*a*sin(t)"},
+    {"gyroid", "sin(4.0*x)*cos(4.0*y) + sin(4.0*y)*cos(4.0*z) + sin(4.0*z)*cos(4.0*x) + 0.5*sin(t)"},
+    {"twisted torus", "square(r - 1.5) + y*y - square(0.4 + 0.2*sin(3.0*theta + t))"},
+    {"smooth CSG", "csgSmoothSubtract(csgSmoothUnion(sqrt(x*x + y*y + z*z) - 1.2, max(abs(x), max(abs(y), abs(z))) - 1.0,"
+                   " 0.2), sqrt(y*y + z*z) - 0.5 - 0.2*sin(t), 0.1)"},
+};
+const uint32_t equationExampleCount = uint32_t(sizeof(equationExamples) / sizeof(equationExamples[0]));
+
+// Simple recursive descent parser; appends nodes in post-order.
+class EquationParser
+{
+  const char*  m_pText;
+  const char*  m_pCursor;
+  Equation*    m_pOut;
+  std::string* m_pError;
+  bool         m_failed = false;
+
+public:
+  EquationParser(const char* pText, Equation* pOut, std::string* pError)
+      : m_pText(pText)
+      , m_pCursor(pText)
+      , m_pOut(pOut)
+      , m_pError(pError)
+  {
+  }
+
+  bool parse()
+  {
+    m_pOut->nodes.clear();
+    parseExpression();
+    skipSpace();
+    if(!m_failed && *m_pCursor != '\0')
+    {
+      fail("unexpected '%c'", *m_pCursor);
+    }
+    if(m_failed)
+    {
+      m_pOut->nodes.clear();
+    }
+    return !m_failed;
+  }
+
+private:
+  void fail(const char* pFormat, char c = 0)
+  {
+    if(m_failed)
+      return;  // Only report the first error.
+    m_failed = true;
+    if(m_pError != nullptr)
+    {
+      char buffer[128];
+      snprintf(buffer, sizeof buffer, pFormat, c);
+      *m_pError = "column " + std::to_string(m_pCursor - m_pText + 1) + ": " + buffer;
+    }
+  }
+
+  void skipSpace()
+  {
+    while(isspace(static_cast<unsigned char>(*m_pCursor)))
+      ++m_pCursor;
+  }
+
+  bool accept(char c)
+  {
+    skipSpace();
+    if(*m_pCursor == c)
+    {
+      ++m_pCursor;
+      return true;
+    }
+    return false;
+  }
+
+  void expect(char c)
+  {
+    if(!accept(c))
+    {
+      fail(*m_pCursor == '\0' ? "expected '%c' before end of equation" : "expected '%c'", c);
+    }
+  }
+
+  uint32_t addNode(EquationOp op, uint32_t argCount = 0, const uint32_t* pArgs = nullptr, double value = 0)
+  {
+    EquationNode node;
+    node.op       = op;
+    node.argCount = argCount;
+    node.value    = value;
+    for(uint32_t i = 0; i < argCount; ++i)
+    {
+      node.args[i] = pArgs[i];
+    }
+    m_pOut->nodes.push_back(node);
+    return uint32_t(m_pOut->nodes.size() - 1u);
+  }
+
+  uint32_t addBinary(EquationOp op, uint32_t lhs, uint32_t rhs)
+  {
+    uint32_t args[2] = {lhs, rhs};
+    return addNode(op, 2, args);
+  }
+
+  // expression := term (('+' | '-') term)*
+  uint32_t parseExpression()
+  {
+    uint32_t lhs = parseTerm();
+    while(!m_failed)
+    {
+      if(accept('+'))
+        lhs = addBinary(equationOpAdd, lhs, parseTerm());
+      else if(accept('-'))
+        lhs = addBinary(equationOpSub, lhs, parseTerm());
+      else
+        break;
+    }
+    return lhs;
+  }
+
+  // term := unary (('*' | '/') unary)*
+  uint32_t parseTerm()
+  {
+    uint32_t lhs = parseUnary();
+    while(!m_failed)
+    {
+      if(accept('*'))
+        lhs = addBinary(equationOpMul, lhs, parseUnary());
+      else if(accept('/'))
+        lhs = addBinary(equationOpDiv, lhs, parseUnary());
+      else
+        break;
+    }
+    return lhs;
+  }
+
+  // unary := ('-' | '+') unary | primary
+  uint32_t parseUnary()
+  {
+    if(accept('-'))
+    {
+      uint32_t arg = parseUnary();
+      return addNode(equationOpNeg, 1, &arg);
+    }
+    if(accept('+'))
+    {
+      return parseUnary();
+    }
+    return parsePrimary();
+  }
+
+  // primary := number | variable | function '(' arguments ')' | '(' expression ')'
+  uint32_t parsePrimary()
+  {
+    skipSpace();
+    if(m_failed)
+      return 0;
+    if(accept('('))
+    {
+      uint32_t result = parseExpression();
+      expect(')');
+      return result;
+    }
+    if(isdigit(static_cast<unsigned char>(*m_pCursor)) || *m_pCursor == '.')
+    {
+      return parseNumber();
+    }
+    if(isalpha(static_cast<unsigned char>(*m_pCursor)) || *m_pCursor == '_')
+    {
+      return parseIdentifier();
+    }
+    fail(*m_pCursor == '\0' ? "unexpected end of equation" : "unexpected '%c'", *m_pCursor);
+    return 0;
+  }
+
+  uint32_t parseNumber()
+  {
+    char*  pEnd;
+    double value = strtod(m_pCursor, &pEnd);
+    if(pEnd == m_pCursor)
+    {
+      fail("malformed number");
+      return 0;
+    }
+    m_pCursor = pEnd;
+    if(*m_pCursor == 'f' || *m_pCursor == 'F')
+      ++m_pCursor;  // GLSL float suffix
+    return addNode(equationOpConstant, 0, nullptr, value);
+  }
+
+  uint32_t parseIdentifier()
+  {
+    const char* pStart = m_pCursor;
+    while(isalnum(static_cast<unsigned char>(*m_pCursor)) || *m_pCursor == '_')
+      ++m_pCursor;
+    std::string name(pStart, m_pCursor);
+
+    // Variables
+    if(name == "x")
+      return addNode(equationOpX);
+    if(name == "y")
+      return addNode(equationOpY);
+    if(name == "z")
+      return addNode(equationOpZ);
+    if(name == "t")
+      return addNode(equationOpT);
+    if(name == "r")
+      return addNode(equationOpR);
+    if(name == "theta")
+      return addNode(equationOpTheta);
+    if(name.size() == 1 && name[0] >= 'a' && uint32_t(name[0] - 'a') < equationParamCount)
+      return addNode(equationOpParam, 0, nullptr, name[0] - 'a');
+
+    // Function calls
+    for(const EquationFunction& function : equationFunctionNames)
+    {
+      if(name == function.pName)
+      {
+        uint32_t args[3]  = {};
+        uint32_t argCount = 0;
+        expect('(');
+        do
+        {
+          if(argCount == 3)
+          {
+            fail("too many arguments");
+            return 0;
+          }
+          args[argCount++] = parseExpression();
+        } while(!m_failed && accept(','));
+        expect(')');
+        if(m_failed)
+          return 0;
+
+        EquationOp op = function.op;
+        if(op == equationOpAtan && argCount == 2)
+        {
+          op = equationOpAtan2;
+        }
+        else if(argCount != function.argCount)
+        {
+          m_pCursor = pStart;
+          fail("wrong number of arguments");
+          return 0;
+        }
+        return addNode(op, argCount, args);
+      }
+    }
+
+    m_pCursor = pStart;
+    fail("unknown identifier");
+    return 0;
+  }
+};
+
+bool equationParse(const char* pText, Equation* pOut, std::string* pError)
+{
+  assert(pText != nullptr && pOut != nullptr);
+  return EquationParser(pText, pOut, pError).parse();
+}
+
+// Polynomial smooth minimum with blend radius k, as csgSmoothUnion in mcubes_image.comp.
+static double smoothMin(double a, double b, double k)
+{
+  double h = fmin(fmax(0.5 + 0.5 * (b - a) / k, 0.0), 1.0);
+  return b + (a - b) * h - k * h * (1.0 - h);
+}
+
+// Evaluate a non-leaf operation on the given argument values.
+static double evaluateOp(EquationOp op, double a, double b, double c)
+{
+  // clang-format off
+  switch(op)
+  {
+    case equationOpNeg:    return -a;
+    case equationOpAdd:    return a + b;
+    case equationOpSub:    return a - b;
+    case equationOpMul:    return a * b;
+    case equationOpDiv:    return a / b;
+    case equationOpSin:    return sin(a);
+    case equationOpCos:    return cos(a);
+    case equationOpTan:    return tan(a);
+    case equationOpAtan:   return atan(a);
+    case equationOpAtan2:  return atan2(a, b);
+    case equationOpSqrt:   return sqrt(a);
+    case equationOpPow:    return pow(a, b);
+    case equationOpExp:    return exp(a);
+    case equationOpLog:    return log(a);
+    case equationOpAbs:    return fabs(a);
+    case equationOpSign:   return a > 0 ? 1.0 : a < 0 ? -1.0 : 0.0;
+    case equationOpFloor:  return floor(a);
+    case equationOpFract:  return a - floor(a);
+    case equationOpMod:    return a - b * floor(a / b);  // GLSL definition, not fmod.
+    case equationOpMin:    return b < a ? b : a;
+    case equationOpMax:    return a < b ? b : a;
+    case equationOpClamp:  return a < b ? b : (c < a ? c : a);
+    case equationOpSquare: return a * a;
+    case equationOpCsgUnion:           return b < a ? b : a;
+    case equationOpCsgIntersect:       return a < b ? b : a;
+    case equationOpCsgSubtract:        return a < -b ? -b : a;
+    case equationOpCsgSmoothUnion:     return smoothMin(a, b, c);
+    case equationOpCsgSmoothIntersect: return -smoothMin(-a, -b, c);
+    case equationOpCsgSmoothSubtract:  return -smoothMin(-a, b, c);
+    default:               assert(0); return 0;
+  }
+  // clang-format on
+}
+
+// Whether the CSG operation is a subtraction, max(a, -b): with its first operand skipped, it equals -b, not b.
+static bool isCsgSubtract(EquationOp op)
+{
+  return op == equationOpCsgSubtract || op == equationOpCsgSmoothSubtract;
+}
+
+// Evaluate the equation at a single point. If pCsgIndices is not null, CSG nodes with an operand skipped in
+// csgSkipMask (bit pair pCsgIndices[i], see equationCsgSkipMask) take the value that equationEmitGlsl selects.
+static double evaluatePoint(const Equation& equation,
+                            double          x,
+                            double          y,
+                            double          z,
+                            double          t,
+                            const float*    pParams,
+                            const uint32_t* pCsgIndices,
+                            uint32_t        csgSkipMask)
+{
+  assert(!equation.empty());
+  std::vector<double> values(equation.nodes.size());
+  for(size_t i = 0; i < equation.nodes.size(); ++i)
+  {
+    const EquationNode& node = equation.nodes[i];
+    double              a    = node.argCount > 0 ? values[node.args[0]] : 0.0;
+    double              b    = node.argCount > 1 ? values[node.args[1]] : 0.0;
+    double              c    = node.argCount > 2 ? values[node.args[2]] : 0.0;
+    double&             v    = values[i];
+    // clang-format off
+    switch(node.op)
+    {
+      case equationOpConstant: v = node.value; break;
+      case equationOpX:        v = x; break;
+      case equationOpY:        v = y; break;
+      case equationOpZ:        v = z; break;
+      case equationOpT:        v = t; break;
+      case equationOpParam:    v = pParams[uint32_t(node.value)]; break;
+      case equationOpR:        v = sqrt(x * x + z * z); break;
+      case equationOpTheta:    v = atan2(z, x); break;
+      default:                 v = evaluateOp(node.op, a, b, c); break;
+    }
+    // clang-format on
+    uint32_t skipBits = 0;
+    if(pCsgIndices != nullptr && pCsgIndices[i] != ~0u)
+      skipBits = csgSkipMask >> 2u * pCsgIndices[i] & 3u;
+    if(skipBits & 1u)
+      v = isCsgSubtract(node.op) ? -b : b;
+    else if(skipBits & 2u)
+      v = a;
+  }
+  return values.back();
+}
+
+double equationEvaluate(const Equation& equation, double x, double y, double z, double t, const float* pParams)
+{
+  return evaluatePoint(equation, x, y, z, t, pParams, nullptr, 0);
+}
+
+static const double           pi        = 3.14159265358979323846;
+static const EquationInterval unbounded = {-INFINITY, INFINITY};
+
+// Interval spanning the given values; NaN (e.g. inf - inf) conservatively becomes unbounded.
+static EquationInterval hull(double a, double b)
+{
+  if(isnan(a) || isnan(b))
+    return unbounded;
+  return {fmin(a, b), fmax(a, b)};
+}
+
+static EquationInterval hull(double a, double b, double c, double d)
+{
+  EquationInterval ab = hull(a, b), cd = hull(c, d);
+  if(isinf(ab.lo) && isinf(ab.hi))
+    return unbounded;
+  if(isinf(cd.lo) && isinf(cd.hi))
+    return unbounded;
+  return {fmin(ab.lo, cd.lo), fmax(ab.hi, cd.hi)};
+}
+
+static bool isFinite(EquationInterval a)
+{
+  return isfinite(a.lo) && isfinite(a.hi);
+}
+
+static EquationInterval intervalAdd(EquationInterval a, EquationInterval b)
+{
+  return hull(a.lo + b.lo, a.hi + b.hi);
+}
+
+static EquationInterval intervalMul(EquationInterval a, EquationInterval b)
+{
+  return hull(a.lo * b.lo, a.lo * b.hi, a.hi * b.lo, a.hi * b.hi);
+}
+
+static EquationInterval intervalDiv(EquationInterval a, EquationInterval b)
+{
+  if(b.lo <= 0.0 && b.hi >= 0.0)
+    return unbounded;
+  return intervalMul(a, {1.0 / b.hi, 1.0 / b.lo});
+}
+
+static EquationInterval intervalSquare(EquationInterval a)
+{
+  if(a.lo >= 0.0)
+    return {a.lo * a.lo, a.hi * a.hi};
+  if(a.hi <= 0.0)
+    return {a.hi * a.hi, a.lo * a.lo};
+  return {0.0, fmax(a.lo * a.lo, a.hi * a.hi)};
+}
+
+static EquationInterval intervalAbs(EquationInterval a)
+{
+  if(a.lo >= 0.0)
+    return a;
+  if(a.hi <= 0.0)
+    return {-a.hi, -a.lo};
+  return {0.0, fmax(-a.lo, a.hi)};
+}
+
+static EquationInterval intervalSqrt(EquationInterval a)
+{
+  if(a.lo < 0.0)
+    return unbounded;  // NaN possible.
+  return {sqrt(a.lo), sqrt(a.hi)};
+}
+
+// Returns whether phase + period * k is in a for some integer k.
+static bool containsPeriodic(EquationInterval a, double phase, double period)
+{
+  double k = ceil((a.lo - phase) / period);
+  return phase + period * k <= a.hi;
+}
+
+static EquationInterval intervalSin(EquationInterval a)
+{
+  if(!isFinite(a) || a.hi - a.lo >= 2.0 * pi)
+    return {-1.0, 1.0};
+  EquationInterval result = hull(sin(a.lo), sin(a.hi));
+  result.hi               = containsPeriodic(a, 0.5 * pi, 2.0 * pi) ? 1.0 : result.hi;
+  result.lo               = containsPeriodic(a, -0.5 * pi, 2.0 * pi) ? -1.0 : result.lo;
+  return result;
+}
+
+static EquationInterval intervalCos(EquationInterval a)
+{
+  if(!isFinite(a) || a.hi - a.lo >= 2.0 * pi)
+    return {-1.0, 1.0};
+  EquationInterval result = hull(cos(a.lo), cos(a.hi));
+  result.hi               = containsPeriodic(a, 0.0, 2.0 * pi) ? 1.0 : result.hi;
+  result.lo               = containsPeriodic(a, pi, 2.0 * pi) ? -1.0 : result.lo;
+  return result;
+}
+
+static EquationInterval intervalTan(EquationInterval a)
+{
+  if(!isFinite(a) || a.hi - a.lo >= pi || containsPeriodic(a, 0.5 * pi, pi))
+    return unbounded;
+  return {tan(a.lo), tan(a.hi)};
+}
+
+// GLSL atan(y, x), branch cut along the negative x axis.
+static EquationInterval intervalAtan2(EquationInterval y, EquationInterval x)
+{
+  bool containsOrigin = x.lo <= 0.0 && x.hi >= 0.0 && y.lo <= 0.0 && y.hi >= 0.0;
+  bool crossesCut     = x.lo < 0.0 && y.lo < 0.0 && y.hi >= 0.0;
+  if(containsOrigin || crossesCut || !isFinite(x) || !isFinite(y))
+    return {-pi, pi};
+  // Box does not wrap around the origin, so the extreme angles are at its corners.
+  return hull(atan2(y.lo, x.lo), atan2(y.lo, x.hi), atan2(y.hi, x.lo), atan2(y.hi, x.hi));
+}
+
+static EquationInterval intervalPow(EquationInterval a, EquationInterval b)
+{
+  // GLSL pow is undefined for x < 0, or x == 0 and y <= 0.
+  if(a.lo < 0.0 || (a.lo == 0.0 && b.lo <= 0.0))
+    return unbounded;
+  // Monotonic in each argument separately, so extremes are at the corners.
+  return hull(pow(a.lo, b.lo), pow(a.lo, b.hi), pow(a.hi, b.lo), pow(a.hi, b.hi));
+}
+
+static EquationInterval intervalFract(EquationInterval a)
+{
+  if(isFinite(a) && floor(a.lo) == floor(a.hi))
+    return {a.lo - floor(a.lo), a.hi - floor(a.lo)};
+  return {0.0, 1.0};
+}
+
+static EquationInterval intervalMod(EquationInterval a, EquationInterval b)
+{
+  // a - b * floor(a / b)
+  EquationInterval quotient = intervalDiv(a, b);
+  quotient                  = {floor(quotient.lo), floor(quotient.hi)};
+  EquationInterval product  = intervalMul(b, quotient);
+  EquationInterval result   = hull(a.lo - product.hi, a.hi - product.lo);
+  // Result has the sign of b, and magnitude less than |b|.
+  if(b.lo > 0.0)
+    result = {fmax(result.lo, 0.0), fmin(result.hi, b.hi)};
+  else if(b.hi < 0.0)
+    result = {fmax(result.lo, b.lo), fmin(result.hi, 0.0)};
+  return result;
+}
+
+// Smooth minimum lies between min(a, b) - k / 4 and min(a, b), for k > 0.
+static EquationInterval intervalSmoothMin(EquationInterval a, EquationInterval b, EquationInterval k)
+{
+  if(k.lo <= 0.0)
+    return unbounded;
+  return hull(fmin(a.lo, b.lo) - 0.25 * k.hi, fmin(a.hi, b.hi));
+}
+
+static EquationInterval intervalNeg(EquationInterval a)
+{
+  return {-a.hi, -a.lo};
+}
+
+// Bounds of every node's value, see equationEvaluateInterval.
+static void evaluateIntervals(const Equation&                equation,
+                              EquationInterval               x,
+                              EquationInterval               y,
+                              EquationInterval               z,
+                              double                         t,
+                              const float*                   pParams,
+                              std::vector<EquationInterval>* pValues)
+{
+  assert(!equation.empty());
+  std::vector<EquationInterval>& values = *pValues;
+  values.resize(equation.nodes.size());
+  for(size_t i = 0; i < equation.nodes.size(); ++i)
+  {
+    const EquationNode& node = equation.nodes[i];
+    EquationInterval    a    = node.argCount > 0 ? values[node.args[0]] : EquationInterval{};
+    EquationInterval    b    = node.argCount > 1 ? values[node.args[1]] : EquationInterval{};
+    EquationInterval    c    = node.argCount > 2 ? values[node.args[2]] : EquationInterval{};
+    EquationInterval&   v    = values[i];
+    // clang-format off
+    switch(node.op)
+    {
+      case equationOpConstant: v = {node.value, node.value}; break;
+      case equationOpX:        v = x; break;
+      case equationOpY:        v = y; break;
+      case equationOpZ:        v = z; break;
+      case equationOpT:        v = {t, t}; break;
+      case equationOpParam:    v = {pParams[uint32_t(node.value)], pParams[uint32_t(node.value)]}; break;
+      case equationOpR:        v = intervalSqrt(intervalAdd(intervalSquare(x), intervalSquare(z))); break;
+      case equationOpTheta:    v = intervalAtan2(z, x); break;
+      case equationOpNeg:      v = intervalNeg(a); break;
+      case equationOpAdd:      v = intervalAdd(a, b); break;
+      case equationOpSub:      v = hull(a.lo - b.hi, a.hi - b.lo); break;
+      case equationOpMul:      v = intervalMul(a, b); break;
+      case equationOpDiv:      v = intervalDiv(a, b); break;
+      case equationOpSin:      v = intervalSin(a); break;
+      case equationOpCos:      v = intervalCos(a); break;
+      case equationOpTan:      v = intervalTan(a); break;
+      case equationOpAtan:     v = {atan(a.lo), atan(a.hi)}; break;
+      case equationOpAtan2:    v = intervalAtan2(a, b); break;
+      case equationOpSqrt:     v = intervalSqrt(a); break;
+      case equationOpPow:      v = intervalPow(a, b); break;
+      case equationOpExp:      v = {exp(a.lo), exp(a.hi)}; break;
+      case equationOpLog:      v = a.lo <= 0.0 ? unbounded : EquationInterval{log(a.lo), log(a.hi)}; break;
+      case equationOpAbs:      v = intervalAbs(a); break;
+      case equationOpSign:     v = {a.lo > 0 ? 1.0 : a.lo < 0 ? -1.0 : 0.0,
+                                    a.hi > 0 ? 1.0 : a.hi < 0 ? -1.0 : 0.0}; break;
+      case equationOpFloor:    v = {floor(a.lo), floor(a.hi)}; break;
+      case equationOpFract:    v = intervalFract(a); break;
+      case equationOpMod:      v = intervalMod(a, b); break;
+      case equationOpMin:      v = {fmin(a.lo, b.lo), fmin(a.hi, b.hi)}; break;
+      case equationOpMax:      v = {fmax(a.lo, b.lo), fmax(a.hi, b.hi)}; break;
+      case equationOpClamp:    v = {fmin(fmax(a.lo, b.lo), c.lo), fmin(fmax(a.hi, b.hi), c.hi)}; break;
+      case equationOpSquare:   v = intervalSquare(a); break;
+      case equationOpCsgUnion:     v = {fmin(a.lo, b.lo), fmin(a.hi, b.hi)}; break;
+      case equationOpCsgIntersect: v = {fmax(a.lo, b.lo), fmax(a.hi, b.hi)}; break;
+      case equationOpCsgSubtract:  v = {fmax(a.lo, -b.hi), fmax(a.hi, -b.lo)}; break;
+      case equationOpCsgSmoothUnion:     v = intervalSmoothMin(a, b, c); break;
+      case equationOpCsgSmoothIntersect: v = intervalNeg(intervalSmoothMin(intervalNeg(a), intervalNeg(b), c)); break;
+      case equationOpCsgSmoothSubtract:  v = intervalNeg(intervalSmoothMin(intervalNeg(a), b, c)); break;
+      default:                 assert(0); v = unbounded; break;
+    }
+    // clang-format on
+  }
+}
+
+EquationInterval equationEvaluateInterval(const Equation&  equation,
+                                          EquationInterval x,
+                                          EquationInterval y,
+                                          EquationInterval z,
+                                          double           t,
+                                          const float*     pParams)
+{
+  std::vector<EquationInterval> values;
+  evaluateIntervals(equation, x, y, z, t, pParams, &values);
+  return values.back();
+}
+
+static bool isCsgOp(EquationOp op)
+{
+  return op >= equationOpCsgUnion && op <= equationOpCsgSmoothSubtract;
+}
+
+// Index k of each node's skip mask bit pair (see equationCsgSkipMask), or ~0u if it has none.
+static std::vector<uint32_t> csgNodeIndices(const Equation& equation)
+{
+  std::vector<uint32_t> result(equation.nodes.size(), ~0u);
+  uint32_t              csgNodeCount = 0;
+  for(size_t i = 0; i < equation.nodes.size() && csgNodeCount < equationMaxCsgNodes; ++i)
+  {
+    if(isCsgOp(equation.nodes[i].op))
+      result[i] = csgNodeCount++;
+  }
+  return result;
+}
+
+uint32_t equationCountCsgNodes(const Equation& equation)
+{
+  uint32_t result = 0;
+  for(const EquationNode& node : equation.nodes)
+  {
+    result += isCsgOp(node.op);
+  }
+  return result < equationMaxCsgNodes ? result : equationMaxCsgNodes;
+}
+
+// Skip bits (1: first operand, 2: second operand) for a CSG operation with the given operand bounds.
+// An operand is skipped only if the result then equals the other operand exactly; never both.
+static uint32_t csgSkipBits(EquationOp op, EquationInterval a, EquationInterval b, EquationInterval k)
+{
+  // Smooth variants equal their sharp counterparts once the operands are at least the blend radius apart.
+  double blend = 0.0;
+  if(op == equationOpCsgSmoothUnion || op == equationOpCsgSmoothIntersect || op == equationOpCsgSmoothSubtract)
+  {
+    if(!(k.lo > 0.0))
+      return 0;
+    blend = k.hi;
+    op    = EquationOp(op - (equationOpCsgSmoothUnion - equationOpCsgUnion));
+  }
+  if(isCsgSubtract(op))  // max(a, -b)
+  {
+    b  = intervalNeg(b);
+    op = equationOpCsgIntersect;
+  }
+
+  // Comparisons are false for NaN (inf - inf), so unbounded operands are never skipped.
+  bool aLarger  = a.lo - b.hi >= blend;
+  bool bLarger  = b.lo - a.hi >= blend;
+  bool keepLess = op == equationOpCsgUnion;
+  if(keepLess ? aLarger : bLarger)
+    return 1;
+  if(keepLess ? bLarger : aLarger)
+    return 2;
+  return 0;
+}
+
+uint32_t equationCsgSkipMask(const Equation&  equation,
+                             EquationInterval x,
+                             EquationInterval y,
+                             EquationInterval z,
+                             double           t,
+                             const float*     pParams)
+{
+  if(equationCountCsgNodes(equation) == 0)
+    return 0;
+  std::vector<uint32_t>         csgIndices = csgNodeIndices(equation);
+  std::vector<EquationInterval> values;
+  evaluateIntervals(equation, x, y, z, t, pParams, &values);
+
+  uint32_t result = 0;
+  for(size_t i = 0; i < equation.nodes.size(); ++i)
+  {
+    const EquationNode& node = equation.nodes[i];
+    if(csgIndices[i] != ~0u)
+    {
+      EquationInterval k = node.argCount > 2 ? values[node.args[2]] : EquationInterval{0.0, 0.0};
+      result |= csgSkipBits(node.op, values[node.args[0]], values[node.args[1]], k) << 2u * csgIndices[i];
+    }
+  }
+  return result;
+}
+
+bool equationCheckCsgSkipMasks()
+{
+  // The CSG examples, and subtractions whose first operand is skipped somewhere in the bounding box.
+  std::vector<const char*> texts = {"csgSubtract(x - 10.0, y)", "csgSmoothSubtract(x - 10.0, y, 0.5)",
+                                    "csgSubtract(csgUnion(x - 3.0, z), csgIntersect(y, x + 3.0))"};
+  for(uint32_t example = 0; example < equationExampleCount; ++example)
+  {
+    texts.push_back(equationExamples[example].pText);
+  }
+  const float params[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+  static_assert(equationParamCount == 4, "Update params");
+
+  // Compare at a few points of each of 8^3 boxes over the default bounding box.
+  bool ok = true;
+  printf("%-60.60s %8s %8s\n", "CSG skip mask check", "boxes", "skipped");
+  for(const char* pText : texts)
+  {
+    Equation    equation;
+    std::string error;
+    if(!equationParse(pText, &equation, &error))
+    {
+      printf("%-60.60s %s\n", pText, error.c_str());
+      ok = false;
+      continue;
+    }
+    equationOptimize(&equation);
+    std::vector<uint32_t> csgIndices = csgNodeIndices(equation);
+    uint32_t              skippedBoxCount = 0, mismatchCount = 0;
+    const uint32_t        boxesPerEdge = 8, pointsPerEdge = 3;
+    const double          boxSize = 4.0 / boxesPerEdge;
+    for(uint32_t box = 0; box < boxesPerEdge * boxesPerEdge * boxesPerEdge; ++box)
+    {
+      double   lo[3] = {-2.0 + boxSize * (box % boxesPerEdge), -2.0 + boxSize * (box / boxesPerEdge % boxesPerEdge),
+                        -2.0 + boxSize * (box / (boxesPerEdge * boxesPerEdge))};
+      uint32_t mask  = equationCsgSkipMask(equation, {lo[0], lo[0] + boxSize}, {lo[1], lo[1] + boxSize},
+                                           {lo[2], lo[2] + boxSize}, 0.5, params);
+      skippedBoxCount += mask != 0;
+      for(uint32_t point = 0; point < pointsPerEdge * pointsPerEdge * pointsPerEdge && mask != 0; ++point)
+      {
+        double x        = lo[0] + boxSize * (point % pointsPerEdge) / (pointsPerEdge - 1);
+        double y        = lo[1] + boxSize * (point / pointsPerEdge % pointsPerEdge) / (pointsPerEdge - 1);
+        double z        = lo[2] + boxSize * (point / (pointsPerEdge * pointsPerEdge)) / (pointsPerEdge - 1);
+        double expected = equationEvaluate(equation, x, y, z, 0.5, params);
+        double skipped  = evaluatePoint(equation, x, y, z, 0.5, params, csgIndices.data(), mask);
+        if(!(fabs(skipped - expected) <= 1e-9 * fmax(1.0, fabs(expected))))
+        {
+          if(mismatchCount++ == 0)
+            printf("  mask %#x at (%g, %g, %g): %g, not %g\n", mask, x, y, z, skipped, expected);
+        }
+      }
+    }
+    printf("%-60.60s %8u %8u%s\n", pText, boxesPerEdge * boxesPerEdge * boxesPerEdge, skippedBoxCount,
+           mismatchCount != 0 ? " MISMATCH" : "");
+    ok &= mismatchCount == 0;
+  }
+  return ok;
+}
+
+// Builds the optimized copy of an equation one node at a time; see equationOptimize.
+class EquationOptimizer
+{
+  std::vector<EquationNode> m_nodes;
+  // Index of each distinct (op, args, value) already in m_nodes, for merging common subexpressions.
+  std::map<std::tuple<uint32_t, uint32_t, uint32_t, uint32_t, double>, uint32_t> m_nodeIndices;
+
+public:
+  void run(Equation* pEquation)
+  {
+    std::vector<uint32_t> newIndices(pEquation->nodes.size());
+    for(size_t i = 0; i < pEquation->nodes.size(); ++i)
+    {
+      const EquationNode& node = pEquation->nodes[i];
+      uint32_t            args[3];
+      for(uint32_t a = 0; a < node.argCount; ++a)
+      {
+        args[a] = newIndices[node.args[a]];
+      }
+      switch(node.op)
+      {
+        case equationOpR:  // sqrt(x * x + z * z), as in mcubes_image.comp
+          newIndices[i] = unary(equationOpSqrt, binary(equationOpAdd, unary(equationOpSquare, leaf(equationOpX)),
+                                                       unary(equationOpSquare, leaf(equationOpZ))));
+          break;
+        case equationOpTheta:  // atan(z, x)
+          newIndices[i] = binary(equationOpAtan2, leaf(equationOpZ), leaf(equationOpX));
+          break;
+        default:
+          newIndices[i] = make(node.op, node.argCount, args, node.value);
+          break;
+      }
+    }
+    removeUnreferenced(newIndices.back(), &pEquation->nodes);
+  }
+
+private:
+  bool isConstant(uint32_t index, double value) const
+  {
+    return m_nodes[index].op == equationOpConstant && m_nodes[index].value == value;
+  }
+
+  uint32_t leaf(EquationOp op) { return make(op, 0, nullptr, 0); }
+  uint32_t unary(EquationOp op, uint32_t a) { return make(op, 1, &a, 0); }
+  uint32_t binary(EquationOp op, uint32_t a, uint32_t b)
+  {
+    uint32_t args[2] = {a, b};
+    return make(op, 2, args, 0);
+  }
+
+  // Returns the index of a node equivalent to the given one, adding nodes as needed.
+  uint32_t make(EquationOp op, uint32_t argCount, const uint32_t* pArgs, double value)
+  {
+    uint32_t args[3]         = {};
+    bool     allArgsConstant = true;
+    double   argValues[3]    = {};
+    for(uint32_t a = 0; a < argCount; ++a)
+    {
+      args[a]      = pArgs[a];
+      argValues[a] = m_nodes[args[a]].value;
+      allArgsConstant &= m_nodes[args[a]].op == equationOpConstant;
+    }
+
+    // Constant folding; leave infinities and NaN for the GPU to produce, they have no GLSL literal.
+    if(argCount > 0 && allArgsConstant)
+    {
+      double folded = evaluateOp(op, argValues[0], argValues[1], argValues[2]);
+      if(isfinite(folded))
+        return make(equationOpConstant, 0, nullptr, folded);
+    }
+
+    // Trivial identities.
+    switch(op)
+    {
+      case equationOpNeg:
+        if(m_nodes[args[0]].op == equationOpNeg)
+          return m_nodes[args[0]].args[0];
+        break;
+      case equationOpAdd:
+        if(isConstant(args[0], 0.0))
+          return args[1];
+        if(isConstant(args[1], 0.0))
+          return args[0];
+        break;
+      case equationOpSub:
+        if(isConstant(args[1], 0.0))
+          return args[0];
+        if(isConstant(args[0], 0.0))
+          return unary(equationOpNeg, args[1]);
+        break;
+      case equationOpMul:
+        for(int i = 0; i < 2; ++i)
+        {
+          if(isConstant(args[i], 1.0))
+            return args[1 - i];
+          if(isConstant(args[i], -1.0))
+            return unary(equationOpNeg, args[1 - i]);
+        }
+        break;
+      case equationOpDiv:
+        if(m_nodes[args[1]].op == equationOpConstant && isfinite(1.0 / argValues[1]))
+          return binary(equationOpMul, args[0], make(equationOpConstant, 0, nullptr, 1.0 / argValues[1]));
+        break;
+      case equationOpPow:  // Also makes these well-defined for negative bases, unlike GLSL pow.
+        if(isConstant(args[1], 1.0))
+          return args[0];
+        if(isConstant(args[1], 2.0))
+          return unary(equationOpSquare, args[0]);
+        if(isConstant(args[1], 0.5))
+          return unary(equationOpSqrt, args[0]);
+        break;
+      case equationOpAbs:
+      case equationOpSquare:
+        if(m_nodes[args[0]].op == equationOpNeg || m_nodes[args[0]].op == equationOpAbs)
+          return unary(op, m_nodes[args[0]].args[0]);
+        break;
+      default:
+        break;
+    }
+
+    // Canonical argument order for commutative operations, so that a + b and b + a are merged.
+    bool commutative = op == equationOpAdd || op == equationOpMul || op == equationOpMin || op == equationOpMax
+                       || op == equationOpCsgUnion || op == equationOpCsgIntersect || op == equationOpCsgSmoothUnion
+                       || op == equationOpCsgSmoothIntersect;
+    if(commutative && args[0] > args[1])
+    {
+      std::swap(args[0], args[1]);
+    }
+
+    auto key      = std::make_tuple(uint32_t(op), args[0], args[1], args[2], value);
+    auto inserted = m_nodeIndices.insert({key, uint32_t(m_nodes.size())});
+    if(inserted.second)
+    {
+      EquationNode node;
+      node.op       = op;
+      node.argCount = argCount;
+      node.value    = value;
+      for(uint32_t a = 0; a < argCount; ++a)
+      {
+        node.args[a] = args[a];
+      }
+      m_nodes.push_back(node);
+    }
+    return inserted.first->second;
+  }
+
+  // Copy the nodes the root depends on to *pOut, keeping post-order.
+  void removeUnreferenced(uint32_t root, std::vector<EquationNode>* pOut) const
+  {
+    std::vector<bool> referenced(m_nodes.size());
+    referenced[root] = true;
+    for(uint32_t i = root + 1; i-- > 0;)
+    {
+      for(uint32_t a = 0; referenced[i] && a < m_nodes[i].argCount; ++a)
+      {
+        referenced[m_nodes[i].args[a]] = true;
+      }
+    }
+
+    std::vector<uint32_t> newIndices(m_nodes.size());
+    pOut->clear();
+    for(uint32_t i = 0; i <= root; ++i)
+    {
+      if(referenced[i])
+      {
+        EquationNode node = m_nodes[i];
+        for(uint32_t a = 0; a < node.argCount; ++a)
+        {
+          node.args[a] = newIndices[node.args[a]];
+        }
+        newIndices[i] = uint32_t(pOut->size());
+        pOut->push_back(node);
+      }
+    }
+  }
+};
+
+void equationOptimize(Equation* pEquation)
+{
+  assert(pEquation != nullptr && !pEquation->empty());
+  EquationOptimizer().run(pEquation);
+}
+
+// Very rough cost of each operation, in units of one float add.
+static uint32_t opCost(EquationOp op)
+{
+  // clang-format off
+  switch(op)
+  {
+    case equationOpConstant: case equationOpX: case equationOpY: case equationOpZ: case equationOpT:
+    case equationOpParam:
+      return 0;
+    case equationOpSign: case equationOpClamp: case equationOpCsgUnion: case equationOpCsgIntersect:
+    case equationOpCsgSubtract:
+      return 2;
+    case equationOpCsgSmoothUnion: case equationOpCsgSmoothIntersect: case equationOpCsgSmoothSubtract:
+      return 10;
+    case equationOpDiv: case equationOpSin: case equationOpCos: case equationOpSqrt: case equationOpExp:
+    case equationOpLog:
+      return 4;
+    case equationOpR:
+      return 7;
+    case equationOpTan: case equationOpPow: case equationOpMod:
+      return 8;
+    case equationOpAtan:
+      return 12;
+    case equationOpTheta: case equationOpAtan2:
+      return 16;
+    default:
+      return 1;
+  }
+  // clang-format on
+}
+
+EquationCost equationEstimateCost(const Equation& equation)
+{
+  EquationCost result = {0, 0};
+  for(const EquationNode& node : equation.nodes)
+  {
+    uint32_t cost = opCost(node.op);
+    result.opCount += cost != 0;
+    result.cost += cost;
+  }
+  return result;
+}
+
+// GLSL float literal for the given value, parenthesized if negative.
+static std::string glslFloat(double value)
+{
+  if(isnan(value))
+    return "(0.0 / 0.0)";
+  if(isinf(value))
+    return value > 0 ? "(1.0 / 0.0)" : "(-1.0 / 0.0)";
+  char buffer[32];
+  snprintf(buffer, sizeof buffer, "%.9g", value);
+  std::string result = buffer;
+  if(result.find_first_of(".e") == std::string::npos)
+    result += ".0";
+  return signbit(value) ? "(" + result + ")" : result;
+}
+
+static std::string glslUint(uint32_t value)
+{
+  char buffer[16];
+  snprintf(buffer, sizeof buffer, "0x%xu", value);
+  return buffer;
+}
+
+// Calls whose arguments keep their integer literals: integer-only built-ins and integer constructors.
+static bool isIntegerCall(const std::string& name)
+{
+  static const char* const names[] = {"int", "uint", "ivec2", "ivec3", "ivec4", "uvec2", "uvec3", "uvec4",
+                                      "bitCount", "bitfieldExtract", "bitfieldInsert", "bitfieldReverse",
+                                      "findLSB", "findMSB"};
+  for(const char* pName : names)
+  {
+    if(name == pName)
+      return true;
+  }
+  return false;
+}
+
+static bool isIntegerLiteral(const std::string& token)
+{
+  return !token.empty() && token.find_first_not_of("0123456789") == std::string::npos;
+}
+
+std::string equationGlslFloatLiterals(const char* pText)
+{
+  // Split into identifiers, numbers and single other characters, noting which tokens are in brackets or in
+  // the arguments of an integer call (a plain parenthesis keeps the enclosing context).
+  std::vector<std::string> tokens;
+  std::vector<bool>        integerContexts;
+  std::vector<size_t>      significant;  // Indices of non-space tokens.
+  std::vector<bool>        contextStack = {false};
+  const char*              p            = pText;
+  while(*p != '\0')
+  {
+    const char* pStart = p;
+    if(isalpha(*p) || *p == '_')
+    {
+      while(isalnum(*p) || *p == '_')
+        ++p;
+    }
+    else if(isdigit(*p) || (*p == '.' && isdigit(p[1])))
+    {
+      // Digits, letters (hex digits, exponent, suffix), points and exponent signs.
+      while(isalnum(*p) || *p == '.' || *p == '_' || ((*p == '+' || *p == '-') && (p[-1] == 'e' || p[-1] == 'E')))
+        ++p;
+    }
+    else
+    {
+      ++p;
+    }
+    std::string token(pStart, p);
+    if(token == "(")
+    {
+      const std::string* pPrevious = significant.empty() ? nullptr : &tokens[significant.back()];
+      bool               call      = pPrevious != nullptr && (isalpha((*pPrevious)[0]) || (*pPrevious)[0] == '_');
+      contextStack.push_back(call ? isIntegerCall(*pPrevious) : contextStack.back());
+    }
+    else if(token == "[")
+    {
+      contextStack.push_back(true);
+    }
+    else if((token == ")" || token == "]") && contextStack.size() > 1)
+    {
+      contextStack.pop_back();
+    }
+    if(!isspace(token[0]))
+      significant.push_back(tokens.size());
+    integerContexts.push_back(contextStack.back());
+    tokens.push_back(token);
+  }
+
+  // Only a literal divided by a literal means something else with integers. Skip it if the left literal is
+  // the right operand of *, / or %, as then the division's left operand is that product or quotient.
+  for(size_t k = 1; k + 1 < significant.size(); ++k)
+  {
+    size_t left = significant[k - 1], right = significant[k + 1];
+    if(tokens[significant[k]] != "/" || !isIntegerLiteral(tokens[left]) || !isIntegerLiteral(tokens[right])
+       || integerContexts[left])
+      continue;
+    const std::string* pBefore = k >= 2 ? &tokens[significant[k - 2]] : nullptr;
+    if(pBefore != nullptr && (*pBefore == "*" || *pBefore == "/" || *pBefore == "%"))
+      continue;
+    for(size_t index : {left, right})
+    {
+      // Leading zeros make an octal GLSL literal.
+      std::string& number = tokens[index];
+      number = std::to_string(strtoull(number.c_str(), nullptr, number[0] == '0' ? 8 : 10)) + ".0";
+    }
+  }
+
+  std::string result;
+  for(const std::string& token : tokens)
+  {
+    result += token;
+  }
+  return result;
+}
+
+bool equationCheckGlslFloatLiterals()
+{
+  // Raw GLSL equations and their expected rewrites.
+  const char* const cases[][2] = {
+      {"1/2 + x", "1.0/2.0 + x"},
+      {"x - 010/4", "x - 8.0/4.0"},
+      {"float(int(sin(1/2) * 4.0)) - y", "float(int(sin(1.0/2.0) * 4.0)) - y"},
+      {"float(bitfieldExtract(int(x * 8.0), 0, 4/2)) - 1.0", nullptr},
+      {"float(int(x * 4.0) / 2) - y", nullptr},
+      {"float(int(x * 4.0) * 3/2) - y", nullptr},
+      {"float(ivec2(3/2, 1).x) - x", nullptr},
+      {"float(7 % 4/2) - x", nullptr},
+      {"x * 1.5/2 + float(0x10/2u)", nullptr},
+  };
+  bool ok = true;
+  printf("%-60.60s\n", "GLSL float literal check");
+  for(const auto& testCase : cases)
+  {
+    std::string result   = equationGlslFloatLiterals(testCase[0]);
+    const char* expected = testCase[1] != nullptr ? testCase[1] : testCase[0];
+    bool        match    = result == expected;
+    printf("%-60.60s %s\n", testCase[0], match ? "ok" : ("MISMATCH: " + result).c_str());
+    ok &= match;
+  }
+  return ok;
+}
+
+// For each node, the skip mask bits any of which leave the node's value unused, because every use of
+// it is through a skipped CSG operand.
+static std::vector<uint32_t> csgGuards(const Equation& equation)
+{
+  std::vector<uint32_t> csgIndices = csgNodeIndices(equation);
+  std::vector<uint32_t> guards(equation.nodes.size(), ~0u);
+  guards.back() = 0;
+  for(size_t i = equation.nodes.size(); i-- > 0;)
+  {
+    const EquationNode& node = equation.nodes[i];
+    for(uint32_t a = 0; a < node.argCount; ++a)
+    {
+      uint32_t guard = guards[i];
+      if(csgIndices[i] != ~0u && a < 2)
+        guard |= 1u << (2u * csgIndices[i] + a);
+      guards[node.args[a]] &= guard;
+    }
+  }
+  return guards;
+}
+
+// Append a "float vN = ...;" statement to *pResult for each non-leaf node flagged in emit, in order,
+// recording its name in *pNames. Unflagged non-leaf nodes must already be named if they are used.
+// Nodes only used by skippable CSG operands are computed inside "if((csgSkipMask & ...) == 0u)" blocks.
+static void emitStatements(const Equation&           equation,
+                           const std::vector<bool>&  emit,
+                           std::vector<std::string>* pNames,
+                           std::string*              pResult)
+{
+  std::vector<std::string>& names         = *pNames;
+  uint32_t                  variableCount = 0;
+  std::vector<uint32_t>     csgIndices    = csgNodeIndices(equation);
+  std::vector<uint32_t>     guards        = csgGuards(equation);
+  std::string               declarations;  // Of guarded variables, hoisted out of their blocks.
+  std::string               body;
+  uint32_t                  openGuard = 0;
+  for(size_t i = 0; i < equation.nodes.size(); ++i)
+  {
+    const EquationNode& node = equation.nodes[i];
+    std::string         args[3];
+    for(uint32_t a = 0; a < node.argCount; ++a)
+    {
+      args[a] = names[node.args[a]];
+    }
+
+    // Leaves are used inline; all other nodes get their own variable.
+    std::string expression;
+    // clang-format off
+    switch(node.op)
+    {
+      case equationOpConstant: names[i] = glslFloat(node.value); continue;
+      case equationOpX:        names[i] = "x"; continue;
+      case equationOpY:        names[i] = "y"; continue;
+      case equationOpZ:        names[i] = "z"; continue;
+      case equationOpT:        names[i] = "t"; continue;
+      case equationOpParam:    names[i] = std::string(1, char('a' + node.value)); continue;
+      default:                 if(!emit[i]) continue; break;
+    }
+    switch(node.op)
+    {
+      case equationOpR:        expression = "sqrt(x * x + z * z)"; break;
+      case equationOpTheta:    expression = "atan(z, x)"; break;
+      case equationOpNeg:      expression = "-" + args[0]; break;
+      case equationOpAdd:      expression = args[0] + " + " + args[1]; break;
+      case equationOpSub:      expression = args[0] + " - " + args[1]; break;
+      case equationOpMul:      expression = args[0] + " * " + args[1]; break;
+      case equationOpDiv:      expression = args[0] + " / " + args[1]; break;
+      case equationOpSquare:   expression = args[0] + " * " + args[0]; break;
+      case equationOpAtan2:    expression = "atan(" + args[0] + ", " + args[1] + ")"; break;
+      default:
+        for(const EquationFunction& function : equationFunctionNames)
+        {
+          if(function.op == node.op)
+          {
+            expression = std::string(function.pName) + "(" + args[0];
+            for(uint32_t a = 1; a < node.argCount; ++a)
+            {
+              expression += ", " + args[a];
+            }
+            expression += ")";
+          }
+        }
+        assert(!expression.empty());
+        break;
+    }
+    // clang-format on
+    if(csgIndices[i] != ~0u)
+    {
+      // Select the other operand if one is skipped (and so possibly not computed), as evaluatePoint does.
+      uint32_t    bits   = 1u << 2u * csgIndices[i];
+      std::string second = isCsgSubtract(node.op) ? "-(" + args[1] + ")" : args[1];
+      expression         = "(csgSkipMask & " + glslUint(bits) + ") != 0u ? " + second + " : (csgSkipMask & "
+                        + glslUint(bits << 1u) + ") != 0u ? " + args[0] + " : " + expression;
+    }
+
+    names[i] = "v" + std::to_string(variableCount++);
+    if(guards[i] != openGuard)
+    {
+      body += openGuard != 0 ? "} " : "";
+      body += guards[i] != 0 ? "if((csgSkipMask & " + glslUint(guards[i]) + ") == 0u) { " : "";
+      openGuard = guards[i];
+    }
+    if(openGuard != 0)
+    {
+      declarations += "float " + names[i] + " = 0.0; ";
+      body += names[i] + " = " + expression + "; ";
+    }
+    else
+    {
+      body += "float " + names[i] + " = " + expression + "; ";
+    }
+  }
+  body += openGuard != 0 ? "} " : "";
+  *pResult += declarations + body;
+}
+
+std::string equationEmitGlsl(const Equation& equation)
+{
+  assert(!equation.empty());
+  std::vector<std::string> names(equation.nodes.size());  // How each node's value is referred to.
+  std::string              result;
+  emitStatements(equation, std::vector<bool>(equation.nodes.size(), true), &names, &result);
+  result += "return " + names.back() + ";";
+  return result;
+}
+
+// GLSL dual number (see equationEmitDualGlsl) of the given expression, with zero derivatives.
+static std::string glslDualConstant(const std::string& value)
+{
+  return "vec4(" + value + ", 0.0, 0.0, 0.0)";
+}
+
+std::string equationEmitDualGlsl(const Equation& equation)
+{
+  assert(!equation.empty());
+  std::vector<std::string> names(equation.nodes.size());
+  std::string              result;
+  uint32_t                 variableCount = 0;
+  for(size_t i = 0; i < equation.nodes.size(); ++i)
+  {
+    const EquationNode& node = equation.nodes[i];
+    std::string         args[3];
+    for(uint32_t a = 0; a < node.argCount; ++a)
+    {
+      args[a] = names[node.args[a]];
+    }
+
+    // Leaves are used inline, as dual numbers with the derivative of x, y or z being 1 along its own axis.
+    std::string expression;
+    // clang-format off
+    switch(node.op)
+    {
+      case equationOpConstant: names[i] = glslDualConstant(glslFloat(node.value)); continue;
+      case equationOpX:        names[i] = "vec4(x, 1.0, 0.0, 0.0)"; continue;
+      case equationOpY:        names[i] = "vec4(y, 0.0, 1.0, 0.0)"; continue;
+      case equationOpZ:        names[i] = "vec4(z, 0.0, 0.0, 1.0)"; continue;
+      case equationOpT:        names[i] = glslDualConstant("t"); continue;
+      case equationOpParam:    names[i] = glslDualConstant(std::string(1, char('a' + node.value))); continue;
+      case equationOpR:        expression = "dualSqrt(vec4(x * x + z * z, 2.0 * x, 0.0, 2.0 * z))"; break;
+      case equationOpTheta:    expression = "dualAtan2(vec4(z, 0.0, 0.0, 1.0), vec4(x, 1.0, 0.0, 0.0))"; break;
+      case equationOpNeg:      expression = "-" + args[0]; break;
+      case equationOpAdd:      expression = args[0] + " + " + args[1]; break;
+      case equationOpSub:      expression = args[0] + " - " + args[1]; break;
+      case equationOpMul:      expression = "dualMul(" + args[0] + ", " + args[1] + ")"; break;
+      case equationOpDiv:      expression = "dualDiv(" + args[0] + ", " + args[1] + ")"; break;
+      case equationOpSquare:   expression = "dualMul(" + args[0] + ", " + args[0] + ")"; break;
+      case equationOpAtan2:    expression = "dualAtan2(" + args[0] + ", " + args[1] + ")"; break;
+      default:
+        // dualSin for sin, dualCsgUnion for csgUnion, etc.
+        for(const EquationFunction& function : equationFunctionNames)
+        {
+          if(function.op == node.op)
+          {
+            expression = std::string("dual") + char(toupper(function.pName[0])) + (function.pName + 1) + "(" + args[0];
+            for(uint32_t a = 1; a < node.argCount; ++a)
+            {
+              expression += ", " + args[a];
+            }
+            expression += ")";
+          }
+        }
+        assert(!expression.empty());
+        break;
+    }
+    // clang-format on
+    names[i] = "v" + std::to_string(variableCount++);
+    result += "vec4 " + names[i] + " = " + expression + "; ";
+  }
+  result += "return " + names.back() + ";";
+  return result;
+}
+
+// Flag the nodes that node depends on (including itself), not looking past nodes flagged in stop; if node
+// itself is flagged in stop, only node is marked.
+static void markDependencies(const Equation&          equation,
+                             uint32_t                 node,
+                             const std::vector<bool>& stop,
+                             std::vector<bool>*       pMark)
+{
+  std::vector<bool>& mark = *pMark;
+  mark[node]              = true;
+  for(uint32_t i = node + 1; i-- > 0;)
+  {
+    if(mark[i] && !stop[i])
+    {
+      for(uint32_t a = 0; a < equation.nodes[i].argCount; ++a)
+      {
+        mark[equation.nodes[i].args[a]] = true;
+      }
+    }
+  }
+}
+
+bool equationEmitSeparableGlsl(const Equation& equation, EquationSeparableGlsl* pOut)
+{
+  assert(!equation.empty());
+  const size_t nodeCount = equation.nodes.size();
+  const char*  axisNames = "XYZ";
+
+  // Which of x, y, z (bits 0, 1, 2) each node depends on.
+  std::vector<uint32_t> axisMasks(nodeCount);
+  std::vector<bool>     usedByOtherMask(nodeCount);
+  for(size_t i = 0; i < nodeCount; ++i)
+  {
+    const EquationNode& node = equation.nodes[i];
+    switch(node.op)
+    {
+      case equationOpX:
+        axisMasks[i] = 1;
+        break;
+      case equationOpY:
+        axisMasks[i] = 2;
+        break;
+      case equationOpZ:
+        axisMasks[i] = 4;
+        break;
+      case equationOpR:
+      case equationOpTheta:
+        axisMasks[i] = 1 | 4;
+        break;
+      default:
+        for(uint32_t a = 0; a < node.argCount; ++a)
+        {
+          axisMasks[i] |= axisMasks[node.args[a]];
+        }
+        break;
+    }
+    for(uint32_t a = 0; a < node.argCount; ++a)
+    {
+      usedByOtherMask[node.args[a]] = usedByOtherMask[node.args[a]] || axisMasks[node.args[a]] != axisMasks[i];
+    }
+  }
+  usedByOtherMask.back() = true;
+
+  // Tabulate the largest single-axis subexpressions (non-leaf nodes depending on one axis, used by a
+  // node that depends on more), up to equationMaxTablesPerAxis per axis.
+  std::vector<bool>        tabulated(nodeCount);
+  std::vector<std::string> names(nodeCount);
+  bool                     anyTables = false;
+  for(uint32_t axis = 0; axis < 3; ++axis)
+  {
+    const char  axisName   = axisNames[axis];
+    const char  coordName  = char('x' + axis);
+    std::string tableName  = std::string("table") + axisName;
+    uint32_t&   tableCount = pOut->tableCounts[axis];
+    tableCount             = 0;
+    std::vector<bool>     fill(nodeCount);
+    std::vector<uint32_t> tableNodes;
+    for(uint32_t i = 0; i < nodeCount; ++i)
+    {
+      if(axisMasks[i] == 1u << axis && equation.nodes[i].argCount > 0 && usedByOtherMask[i]
+         && tableCount < equationMaxTablesPerAxis)
+      {
+        markDependencies(equation, i, std::vector<bool>(nodeCount), &fill);
+        names[i]     = tableName + "[" + std::to_string(tableCount) + "][i" + coordName + "]";
+        tabulated[i] = true;
+        tableNodes.push_back(i);
+        ++tableCount;
+      }
+    }
+
+    // Statements filling this axis' tables; only the nodes tabulated for this axis are needed.
+    std::vector<std::string> fillNames(nodeCount);
+    std::string&             fillStatements = pOut->fillStatements[axis];
+    fillStatements.clear();
+    emitStatements(equation, fill, &fillNames, &fillStatements);
+    for(uint32_t k = 0; k < tableCount; ++k)
+    {
+      fillStatements += tableName + "[" + std::to_string(k) + "][i] = " + fillNames[tableNodes[k]] + "; ";
+    }
+    anyTables |= tableCount != 0;
+  }
+
+  // Per-texel statements, reading tabulated nodes from the tables.
+  std::vector<bool> perTexel(nodeCount);
+  markDependencies(equation, uint32_t(nodeCount - 1u), tabulated, &perTexel);
+  for(size_t i = 0; i < nodeCount; ++i)
+  {
+    perTexel[i] = perTexel[i] && !tabulated[i];
+  }
+  pOut->statements.clear();
+  emitStatements(equation, perTexel, &names, &pOut->statements);
+  pOut->statements += "return " + names.back() + ";";
+  return anyTables;
+}
+
+// Whether every variable (v0, v1, ...) assigned in the GLSL statements is read after its assignment.
+static bool allVariablesUsed(const std::string& statements)
+{
+  for(size_t pos = 0; (pos = statements.find(" = ", pos)) != std::string::npos; pos += 3)
+  {
+    size_t      nameStart = statements.find_last_of(' ', pos - 1) + 1;
+    std::string name      = statements.substr(nameStart, pos - nameStart);
+    if(name[0] != 'v')  // Not a variable, but a table store.
+      continue;
+    bool used = false;
+    for(size_t use = statements.find(name, statements.find(';', pos)); use != std::string::npos && !used;
+        use        = statements.find(name, use + 1))
+    {
+      size_t end = use + name.size();
+      used       = !isalnum(statements[use - 1]) && (end == statements.size() || !isalnum(statements[end]));
+    }
+    if(!used)
+      return false;
+  }
+  return true;
+}
+
+bool equationCheckSeparableGlsl()
+{
+  // The examples, and equations whose root is a single-axis term.
+  std::vector<const char*> texts = {"sqrt(x*x) - 1.0", "sin(y) * cos(y) - 0.25", "sin(x) + sin(y) + sin(z)"};
+  for(uint32_t example = 0; example < equationExampleCount; ++example)
+  {
+    texts.push_back(equationExamples[example].pText);
+  }
+
+  bool ok = true;
+  printf("%-60.60s %8s\n", "Separable GLSL check", "tables");
+  for(const char* pText : texts)
+  {
+    Equation    equation;
+    std::string error;
+    if(!equationParse(pText, &equation, &error))
+    {
+      printf("%-60.60s %s\n", pText, error.c_str());
+      ok = false;
+      continue;
+    }
+    equationOptimize(&equation);
+    EquationSeparableGlsl separable;
+    if(!equationEmitSeparableGlsl(equation, &separable))
+    {
+      printf("%-60.60s %8u\n", pText, 0u);
+      continue;
+    }
+    // Per-texel statements must not compute anything a table read replaces.
+    bool used = allVariablesUsed(separable.statements);
+    for(const std::string& fillStatements : separable.fillStatements)
+    {
+      used &= allVariablesUsed(fillStatements);
+    }
+    printf("%-60.60s %8u%s\n", pText,
+           separable.tableCounts[0] + separable.tableCounts[1] + separable.tableCounts[2], used ? "" : " DEAD CODE");
+    ok &= used;
+  }
+  return ok;
+}
+
+// Behavior of a node's value under a mirror transform.
+enum EquationParity : uint8_t
+{
+  equationParityNone,
+  equationParityEven,
+  equationParityOdd,
+};
+
+static EquationParity parityOfNode(const EquationNode& node, uint32_t mask, const std::vector<EquationParity>& parities)
+{
+  EquationParity a = node.argCount > 0 ? parities[node.args[0]] : equationParityNone;
+  EquationParity b = node.argCount > 1 ? parities[node.args[1]] : equationParityNone;
+
+  bool allEven = true;
+  for(uint32_t i = 0; i < node.argCount; ++i)
+  {
+    allEven &= parities[node.args[i]] == equationParityEven;
+  }
+
+  switch(node.op)
+  {
+    case equationOpConstant:
+    case equationOpT:
+    case equationOpParam:
+    case equationOpR:  // sqrt(x * x + z * z)
+      return equationParityEven;
+    case equationOpX:
+      return mask & 1u ? equationParityOdd : equationParityEven;
+    case equationOpY:
+      return mask & 2u ? equationParityOdd : equationParityEven;
+    case equationOpZ:
+      return mask & 4u ? equationParityOdd : equationParityEven;
+    case equationOpTheta:
+      return mask & 5u ? equationParityNone : equationParityEven;
+    // Odd functions
+    case equationOpNeg:
+    case equationOpSin:
+    case equationOpTan:
+    case equationOpAtan:
+    case equationOpSign:
+      return a;
+    // Even functions
+    case equationOpCos:
+    case equationOpAbs:
+    case equationOpSquare:
+      return a == equationParityNone ? equationParityNone : equationParityEven;
+    case equationOpAdd:
+    case equationOpSub:
+      return a == b ? a : equationParityNone;
+    case equationOpMul:
+    case equationOpDiv:
+      if(a == equationParityNone || b == equationParityNone)
+        return equationParityNone;
+      return a == b ? equationParityEven : equationParityOdd;
+    default:
+      return allEven ? equationParityEven : equationParityNone;
+  }
+}
+
+EquationSymmetry equationFindSymmetry(const Equation& equation)
+{
+  assert(!equation.empty());
+  EquationSymmetry            result = {0, 0};
+  std::vector<EquationParity> parities(equation.nodes.size());
+  for(uint32_t mask = 1; mask < 8; ++mask)
+  {
+    for(size_t i = 0; i < equation.nodes.size(); ++i)
+    {
+      parities[i] = parityOfNode(equation.nodes[i], mask, parities);
+    }
+    result.evenMasks |= parities.back() == equationParityEven ? 1u << mask : 0u;
+    result.oddMasks |= parities.back() == equationParityOdd ? 1u << mask : 0u;
+  }
+  return result;
+}
@@ -0,0 +1,213 @@
+// Copyright 2021 NVIDIA CORPORATION
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// CPU-side representation of the EQUATION(x, y, z, t) string that is otherwise spliced
+// verbatim into mcubes_image.comp. Only the scalar subset of GLSL used by equations is
+// understood: + - * / and unary minus, parentheses, float literals, the variables x y z t
+// (plus r and theta, which mcubes_image.comp defines in terms of x and z), the user parameters
+// a b c d (set at runtime, like t), and the function calls listed in equationFunctionNames
+// (see equation.cpp), including the square() helper and the csg*() helpers of mcubes_image.comp.
+// All numeric literals are treated as float, so 1/2 is 0.5 here even though it is 0 in GLSL.
+
+enum EquationOp : uint32_t
+{
+  // Leaves
+  equationOpConstant,
+  equationOpX,
+  equationOpY,
+  equationOpZ,
+  equationOpT,
+  equationOpR,      // sqrt(x*x + z*z)
+  equationOpTheta,  // atan(z, x)
+  equationOpParam,  // User parameter a, b, c or d, indexed by EquationNode::value
+
+  // Operators
+  equationOpNeg,
+  equationOpAdd,
+  equationOpSub,
+  equationOpMul,
+  equationOpDiv,
+
+  // Function calls; keep in sync with equationFunctionNames.
+  equationOpSin,
+  equationOpCos,
+  equationOpTan,
+  equationOpAtan,   // 1 argument
+  equationOpAtan2,  // atan(y, x) in GLSL
+  equationOpSqrt,
+  equationOpPow,
+  equationOpExp,
+  equationOpLog,
+  equationOpAbs,
+  equationOpSign,
+  equationOpFloor,
+  equationOpFract,
+  equationOpMod,
+  equationOpMin,
+  equationOpMax,
+  equationOpClamp,
+  equationOpSquare,
+  // CSG composition of fields (negative inside), see csgUnion etc. in mcubes_image.comp.
+  // Smooth variants take a blend radius as third argument.
+  equationOpCsgUnion,      // min(a, b)
+  equationOpCsgIntersect,  // max(a, b)
+  equationOpCsgSubtract,   // max(a, -b)
+  equationOpCsgSmoothUnion,
+  equationOpCsgSmoothIntersect,
+  equationOpCsgSmoothSubtract,
+
+  equationOpCount
+};
+
+struct EquationNode
+{
+  EquationOp op       = equationOpConstant;
+  uint32_t   argCount = 0;
+  uint32_t   args[3]  = {};  // Indices into Equation::nodes; always less than this node's index.
+  double     value    = 0;   // Only for equationOpConstant and equationOpParam
+};
+
+// Expression tree stored in post-order; the root is the last node.
+struct Equation
+{
+  std::vector<EquationNode> nodes;
+
+  bool     empty() const { return nodes.empty(); }
+  uint32_t root() const { return uint32_t(nodes.size() - 1u); }
+};
+
+// Parse the given equation text. Returns success flag; on failure, *pError (if not null)
+// describes the problem, including the character offset where it was found.
+bool equationParse(const char* pText, Equation* pOut, std::string* pError);
+
+// Built-in example equations, valid for both equationParse and mcubes_image.comp; the first is the default.
+struct EquationExample
+{
+  const char* pName;
+  const char* pText;
+};
+extern const EquationExample equationExamples[];
+extern const uint32_t        equationExampleCount;
+
+// Number of user parameters (a, b, c, d), see McubesParams::userParams.
+static const uint32_t equationParamCount = 4;
+
+// Closed interval [lo, hi]; endpoints may be infinite.
+struct EquationInterval
+{
+  double lo, hi;
+};
+
+// Evaluate the equation at a single point, matching mcubes_image.comp up to float rounding.
+double equationEvaluate(const Equation& equation, double x, double y, double z, double t, const float* pParams);
+
+// Conservatively bound the equation's value over the box x * y * z, with t and the
+// equationParamCount user parameters in pParams fixed (interval arithmetic).
+// Any operation that may be undefined over its input interval (e.g. sqrt of negatives, division by
+// an interval containing 0) yields the unbounded interval, so the result never excludes a value
+// that mcubes_image.comp could produce, other than by float rounding.
+EquationInterval equationEvaluateInterval(const Equation&  equation,
+                                          EquationInterval x,
+                                          EquationInterval y,
+                                          EquationInterval z,
+                                          double           t,
+                                          const float*     pParams);
+
+// CSG operation nodes (in node order, at most equationMaxCsgNodes of them) own a pair of bits of a skip mask:
+// bit 2k (2k + 1) set means that over some box the first (second) operand of the k-th CSG node provably does
+// not change the node's value, so mcubes_image.comp neither evaluates nor uses that operand there.
+static const uint32_t equationMaxCsgNodes = 16;
+
+// Number of CSG nodes owning skip mask bits.
+uint32_t equationCountCsgNodes(const Equation& equation);
+
+// Skip mask (see above) for the box x * y * z, found by interval arithmetic as for equationEvaluateInterval.
+uint32_t equationCsgSkipMask(const Equation&  equation,
+                             EquationInterval x,
+                             EquationInterval y,
+                             EquationInterval z,
+                             double           t,
+                             const float*     pParams);
+
+// Self-check of the skip masks: over boxes of the default bounding box, evaluate CSG equations (the examples and a
+// few more) with each box's skip mask, selecting operands as equationEmitGlsl does, and compare with
+// equationEvaluate at points of the box. Prints a line per equation; returns false on any mismatch.
+bool equationCheckCsgSkipMasks();
+
+// Optimize the equation in place: lower r and theta to expressions of x and z, fold constant
+// subexpressions, simplify trivial identities (a + 0, a * 1, pow(a, 2), ...), merge common
+// subexpressions, and drop nodes not referenced by the root. The result is a DAG rather than a tree.
+void equationOptimize(Equation* pEquation);
+
+// Rough evaluation cost of the equation, counting each distinct node once (so CSE pays off).
+// Costs are in units of one float add, e.g. a division is 4, atan(y, x) is 16.
+struct EquationCost
+{
+  uint32_t opCount;  // Number of non-leaf nodes.
+  uint32_t cost;
+};
+EquationCost equationEstimateCost(const Equation& equation);
+
+// Emit GLSL statements evaluating the equation from float variables x, y, z, t and a, b, c, d, ending in a
+// return statement; one statement per non-leaf node. The output is a single line, for use as the
+// body of a #define. Only square() helpers and r, theta are expanded inline, so the output needs
+// no GLSL function other than built-ins and the csg*() helpers. Operands of CSG nodes are only evaluated
+// if not flagged in the uint csgSkipMask variable.
+std::string equationEmitGlsl(const Equation& equation);
+
+// Emit GLSL statements evaluating the equation and its gradient by forward-mode automatic differentiation:
+// each node is a dual number vec4(value, d/dx, d/dy, d/dz) computed with the dual*() helpers of
+// shaders/equation_dual.glsl, from the same variables as equationEmitGlsl. Ends in a return statement of the
+// root's dual number; a single line. All CSG operands are evaluated (skipping would not change the result).
+std::string equationEmitDualGlsl(const Equation& equation);
+
+// Maximum number of tables of single-axis terms per axis, see equationEmitSeparableGlsl.
+static const uint32_t equationMaxTablesPerAxis = 4;
+
+// GLSL for evaluating the equation with its single-axis subexpressions (e.g. sin(x) in
+// sin(x) + sin(y) + sin(z)) precomputed into per-axis tables, rather than once per texel.
+struct EquationSeparableGlsl
+{
+  // Number of tables for each axis, at most equationMaxTablesPerAxis.
+  uint32_t tableCounts[3];
+  // For each axis, statements computing that axis' tables at coordinate index i from float x (or y,
+  // z), t and a, b, c, d, storing the results to tableX[k][i] (or tableY, tableZ).
+  std::string fillStatements[3];
+  // Statements computing the equation from x, y, z, t, a, b, c, d and the tables, indexed by uint ix, iy, iz;
+  // ending in a return statement.
+  std::string statements;
+};
+
+// Fill *pOut for the (optimized) equation. Returns false if there is nothing worth tabulating.
+// All output strings are single lines, as for equationEmitGlsl.
+bool equationEmitSeparableGlsl(const Equation& equation, EquationSeparableGlsl* pOut);
+
+// Self-check of equationEmitSeparableGlsl: for the examples and a few equations whose root is itself a
+// single-axis term, check that every variable the emitted statements compute is used. Prints a line per
+// equation; returns false on any unused variable.
+bool equationCheckSeparableGlsl();
+
+// Copy of GLSL expression text where decimal and octal integer literals divided by one another are made float
+// literals, so that e.g. 1/2 is 0.5 as in equationEmitGlsl. Literals in array indices, in arguments of integer
+// built-ins and constructors (int, ivec2, bitfieldExtract, ...) and in other expressions are kept.
+std::string equationGlslFloatLiterals(const char* pText);
+
+// Self-check of equationGlslFloatLiterals on a few raw GLSL equations. Prints a line per equation; returns false
+// on any mismatch.
+bool equationCheckGlslFloatLiterals();
+
+// Mirror symmetries of the equation. Masks are 3-bit sets of axes (bit 0 = x, 1 = y, 2 = z); bit m of
+// evenMasks (oddMasks) is set if negating the coordinates in mask m is shown to leave the equation
+// unchanged (negate the equation). Either way, the surface where the equation is 0 is mirror symmetric.
+// The analysis is symbolic and conservative, e.g. symmetries of theta are not detected.
+struct EquationSymmetry
+{
+  uint8_t evenMasks;
+  uint8_t oddMasks;
+};
+EquationSymmetry equationFindSymmetry(const Equation& equation);
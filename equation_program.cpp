@@ -0,0 +1,275 @@
+// Copyright 2021 NVIDIA CORPORATION
+// SPDX-License-Identifier: Apache-2.0
+#include "equation_program.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <map>
+#include <math.h>
+#include <stdio.h>
+
+// Values of one register for a block of points.
+struct alignas(64) EquationLanes
+{
+  float v[equationProgramLanes];
+};
+
+// Leaves other than r and theta are read from fixed registers, without an instruction.
+static bool isRegisterLeaf(EquationOp op)
+{
+  return op <= equationOpParam && op != equationOpR && op != equationOpTheta;
+}
+
+void equationCompileProgram(const Equation& equation, EquationProgram* pOut)
+{
+  assert(!equation.empty());
+  Equation optimized = equation;
+  equationOptimize(&optimized);
+  const std::vector<EquationNode>& nodes = optimized.nodes;
+  *pOut                                  = EquationProgram();
+
+  // Last node using each node's value (0 if unused); the root's value is used by the caller.
+  std::vector<uint32_t> lastUse(nodes.size(), 0);
+  for(uint32_t i = 0; i < nodes.size(); ++i)
+  {
+    for(uint32_t arg = 0; arg < nodes[i].argCount; ++arg)
+    {
+      lastUse[nodes[i].args[arg]] = i;
+    }
+  }
+  lastUse.back() = UINT32_MAX;
+
+  // Leaves get fixed registers, distinct constants one each.
+  std::vector<uint16_t>   registers(nodes.size());
+  std::map<float, size_t> constantIndices;
+  for(uint32_t i = 0; i < nodes.size(); ++i)
+  {
+    const EquationNode& node = nodes[i];
+    if(node.op == equationOpConstant)
+    {
+      auto inserted = constantIndices.insert({float(node.value), pOut->constants.size()});
+      if(inserted.second)
+        pOut->constants.push_back(float(node.value));
+      registers[i] = uint16_t(equationProgramFirstConstant + inserted.first->second);
+    }
+    else if(isRegisterLeaf(node.op))
+    {
+      registers[i] = uint16_t(node.op == equationOpParam ? 4 + uint32_t(node.value) : node.op - equationOpX);
+    }
+  }
+
+  // Other nodes get an instruction, writing a temporary register that is reused after the node's last use.
+  uint32_t              firstTemporary = equationProgramFirstConstant + uint32_t(pOut->constants.size());
+  uint32_t              registerCount  = firstTemporary;
+  std::vector<uint16_t> freeRegisters;
+  for(uint32_t i = 0; i < nodes.size(); ++i)
+  {
+    const EquationNode& node = nodes[i];
+    if(isRegisterLeaf(node.op) || lastUse[i] == 0)
+      continue;
+
+    EquationInstruction instruction{node.op, 0, {0, 0, 0}};
+    if(node.op == equationOpR || node.op == equationOpTheta)
+    {
+      instruction.args[0] = 0;  // x
+      instruction.args[1] = 2;  // z
+    }
+    for(uint32_t arg = 0; arg < node.argCount; ++arg)
+    {
+      instruction.args[arg] = registers[node.args[arg]];
+    }
+
+    // Free the arguments first: instructions read each lane of their arguments before writing it to dst.
+    for(uint32_t arg = 0; arg < node.argCount; ++arg)
+    {
+      uint16_t argRegister = instruction.args[arg];
+      bool     lastArg = std::find(instruction.args + arg + 1, instruction.args + node.argCount, argRegister)
+                     == instruction.args + node.argCount;
+      if(argRegister >= firstTemporary && lastUse[node.args[arg]] == i && lastArg)
+        freeRegisters.push_back(argRegister);
+    }
+    if(freeRegisters.empty())
+    {
+      assert(registerCount <= UINT16_MAX);
+      instruction.dst = uint16_t(registerCount++);
+    }
+    else
+    {
+      instruction.dst = freeRegisters.back();
+      freeRegisters.pop_back();
+    }
+    registers[i] = instruction.dst;
+    pOut->instructions.push_back(instruction);
+  }
+  pOut->registerCount  = registerCount;
+  pOut->resultRegister = registers.back();
+}
+
+// Polynomial smooth minimum with blend radius k, as csgSmoothUnion in mcubes_image.comp.
+static float smoothMin(float a, float b, float k)
+{
+  float h = fminf(fmaxf(0.5f + 0.5f * (b - a) / k, 0.0f), 1.0f);
+  return b + (a - b) * h - k * h * (1.0f - h);
+}
+
+static void runInstruction(const EquationInstruction& instruction, EquationLanes* pRegisters)
+{
+  float*       d = pRegisters[instruction.dst].v;
+  const float* a = pRegisters[instruction.args[0]].v;
+  const float* b = pRegisters[instruction.args[1]].v;
+  const float* c = pRegisters[instruction.args[2]].v;
+
+  // Same operations as evaluateOp in equation.cpp.
+#define EQUATION_LANES(expression)                                                                                     \
+  for(uint32_t i = 0; i < equationProgramLanes; ++i)                                                                   \
+  {                                                                                                                    \
+    d[i] = (expression);                                                                                               \
+  }                                                                                                                    \
+  break
+  // clang-format off
+  switch(instruction.op)
+  {
+    case equationOpR:      EQUATION_LANES(sqrtf(a[i] * a[i] + b[i] * b[i]));
+    case equationOpTheta:  EQUATION_LANES(atan2f(b[i], a[i]));
+    case equationOpNeg:    EQUATION_LANES(-a[i]);
+    case equationOpAdd:    EQUATION_LANES(a[i] + b[i]);
+    case equationOpSub:    EQUATION_LANES(a[i] - b[i]);
+    case equationOpMul:    EQUATION_LANES(a[i] * b[i]);
+    case equationOpDiv:    EQUATION_LANES(a[i] / b[i]);
+    case equationOpSin:    EQUATION_LANES(sinf(a[i]));
+    case equationOpCos:    EQUATION_LANES(cosf(a[i]));
+    case equationOpTan:    EQUATION_LANES(tanf(a[i]));
+    case equationOpAtan:   EQUATION_LANES(atanf(a[i]));
+    case equationOpAtan2:  EQUATION_LANES(atan2f(a[i], b[i]));
+    case equationOpSqrt:   EQUATION_LANES(sqrtf(a[i]));
+    case equationOpPow:    EQUATION_LANES(powf(a[i], b[i]));
+    case equationOpExp:    EQUATION_LANES(expf(a[i]));
+    case equationOpLog:    EQUATION_LANES(logf(a[i]));
+    case equationOpAbs:    EQUATION_LANES(fabsf(a[i]));
+    case equationOpSign:   EQUATION_LANES(a[i] > 0.0f ? 1.0f : a[i] < 0.0f ? -1.0f : 0.0f);
+    case equationOpFloor:  EQUATION_LANES(floorf(a[i]));
+    case equationOpFract:  EQUATION_LANES(a[i] - floorf(a[i]));
+    case equationOpMod:    EQUATION_LANES(a[i] - b[i] * floorf(a[i] / b[i]));
+    case equationOpMin:    EQUATION_LANES(b[i] < a[i] ? b[i] : a[i]);
+    case equationOpMax:    EQUATION_LANES(a[i] < b[i] ? b[i] : a[i]);
+    case equationOpClamp:  EQUATION_LANES(a[i] < b[i] ? b[i] : (c[i] < a[i] ? c[i] : a[i]));
+    case equationOpSquare: EQUATION_LANES(a[i] * a[i]);
+    case equationOpCsgUnion:           EQUATION_LANES(b[i] < a[i] ? b[i] : a[i]);
+    case equationOpCsgIntersect:       EQUATION_LANES(a[i] < b[i] ? b[i] : a[i]);
+    case equationOpCsgSubtract:        EQUATION_LANES(a[i] < -b[i] ? -b[i] : a[i]);
+    case equationOpCsgSmoothUnion:     EQUATION_LANES(smoothMin(a[i], b[i], c[i]));
+    case equationOpCsgSmoothIntersect: EQUATION_LANES(-smoothMin(-a[i], -b[i], c[i]));
+    case equationOpCsgSmoothSubtract:  EQUATION_LANES(-smoothMin(-a[i], b[i], c[i]));
+    default:               assert(0); break;
+  }
+  // clang-format on
+#undef EQUATION_LANES
+}
+
+void equationEvaluateProgram(const EquationProgram& program,
+                             uint32_t               count,
+                             const float*           pX,
+                             const float*           pY,
+                             const float*           pZ,
+                             float                  t,
+                             const float*           pParams,
+                             float*                 pOut)
+{
+  thread_local std::vector<EquationLanes> registers;
+  registers.resize(program.registerCount);
+  for(uint32_t lane = 0; lane < equationProgramLanes; ++lane)
+  {
+    registers[3].v[lane] = t;
+    for(uint32_t param = 0; param < equationParamCount; ++param)
+    {
+      registers[4 + param].v[lane] = pParams[param];
+    }
+    for(size_t constant = 0; constant < program.constants.size(); ++constant)
+    {
+      registers[equationProgramFirstConstant + constant].v[lane] = program.constants[constant];
+    }
+  }
+
+  for(uint32_t begin = 0; begin < count; begin += equationProgramLanes)
+  {
+    // Pad the last block with zeros, evaluated but not stored.
+    uint32_t blockCount = std::min(equationProgramLanes, count - begin);
+    for(uint32_t lane = 0; lane < equationProgramLanes; ++lane)
+    {
+      bool inside          = lane < blockCount;
+      registers[0].v[lane] = inside ? pX[begin + lane] : 0.0f;
+      registers[1].v[lane] = inside ? pY[begin + lane] : 0.0f;
+      registers[2].v[lane] = inside ? pZ[begin + lane] : 0.0f;
+    }
+    for(const EquationInstruction& instruction : program.instructions)
+    {
+      runInstruction(instruction, registers.data());
+    }
+    std::copy(registers[program.resultRegister].v, registers[program.resultRegister].v + blockCount, pOut + begin);
+  }
+}
+
+void equationBenchmarkPrograms()
+{
+  // 64^3 points spread over the default bounding box.
+  const uint32_t     gridLength = 64, pointCount = gridLength * gridLength * gridLength;
+  std::vector<float> x(pointCount), y(pointCount), z(pointCount);
+  for(uint32_t i = 0; i < pointCount; ++i)
+  {
+    x[i] = -2.0f + 4.0f * float(i % gridLength) / float(gridLength - 1);
+    y[i] = -2.0f + 4.0f * float(i / gridLength % gridLength) / float(gridLength - 1);
+    z[i] = -2.0f + 4.0f * float(i / (gridLength * gridLength)) / float(gridLength - 1);
+  }
+  const float t         = 0.5f;
+  const float params[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+  static_assert(equationParamCount == 4, "Update params");
+
+  // Best time of a few runs of the given function, in seconds.
+  auto bestTime = [](const auto& function) {
+    double best = INFINITY;
+    for(int run = 0; run < 3; ++run)
+    {
+      auto start = std::chrono::steady_clock::now();
+      function();
+      best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    }
+    return best;
+  };
+
+  printf("Equation evaluation, single thread, %u points:\n", pointCount);
+  printf("%-16s %10s %10s %8s %12s\n", "equation", "tree Mp/s", "prog Mp/s", "speedup", "max rel diff");
+  for(uint32_t example = 0; example < equationExampleCount; ++example)
+  {
+    Equation    equation;
+    std::string error;
+    if(!equationParse(equationExamples[example].pText, &equation, &error))
+    {
+      printf("%-16s %s\n", equationExamples[example].pName, error.c_str());
+      continue;
+    }
+    equationOptimize(&equation);
+    EquationProgram program;
+    equationCompileProgram(equation, &program);
+
+    std::vector<float> treeValues(pointCount), programValues(pointCount);
+    double             treeTime = bestTime([&] {
+      for(uint32_t i = 0; i < pointCount; ++i)
+      {
+        treeValues[i] = float(equationEvaluate(equation, x[i], y[i], z[i], t, params));
+      }
+    });
+    double programTime = bestTime([&] {
+      equationEvaluateProgram(program, pointCount, x.data(), y.data(), z.data(), t, params, programValues.data());
+    });
+
+    double maxDifference = 0;
+    for(uint32_t i = 0; i < pointCount; ++i)
+    {
+      double difference = fabs(double(treeValues[i]) - double(programValues[i]));
+      maxDifference     = std::max(maxDifference, difference / std::max(1.0, fabs(double(treeValues[i]))));
+    }
+    printf("%-16s %10.1f %10.1f %7.1fx %12.2g\n", equationExamples[example].pName, pointCount / treeTime * 1e-6,
+           pointCount / programTime * 1e-6, treeTime / programTime, maxDifference);
+  }
+}
@@ -0,0 +1,52 @@
+// Copyright 2021 NVIDIA CORPORATION
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+#include "equation.hpp"
+
+// Register bytecode compiled from an Equation, for evaluating it on the CPU at many points (e.g. the CPU mesher,
+// see mcubes_cpu.hpp) much faster than equationEvaluate. Instructions run on blocks of equationProgramLanes
+// points, each as a fixed-length loop over the lanes that the compiler vectorizes. Arithmetic is in float,
+// as in mcubes_image.comp.
+
+static const uint32_t equationProgramLanes = 16;
+
+struct EquationInstruction
+{
+  EquationOp op;  // Non-leaf operation, or equationOpR or equationOpTheta.
+  uint16_t   dst;
+  uint16_t   args[3];
+};
+
+// Registers 0 .. equationProgramFirstConstant - 1 hold x, y, z, t and the user parameters a, b, c, d; then
+// come the constants, then the temporaries, which are reused once their value is dead.
+static const uint32_t equationProgramFirstConstant = 4 + equationParamCount;
+
+struct EquationProgram
+{
+  std::vector<EquationInstruction> instructions;
+  std::vector<float>               constants;
+  uint32_t                         registerCount  = 0;
+  uint32_t                         resultRegister = 0;
+};
+
+// Compile the equation, optimizing a copy of it first (see equationOptimize).
+void equationCompileProgram(const Equation& equation, EquationProgram* pOut);
+
+// Evaluate the program at count points (pX[i], pY[i], pZ[i]), with t and the equationParamCount user parameters
+// in pParams fixed, into pOut[i]. Thread safe.
+void equationEvaluateProgram(const EquationProgram& program,
+                             uint32_t               count,
+                             const float*           pX,
+                             const float*           pY,
+                             const float*           pZ,
+                             float                  t,
+                             const float*           pParams,
+                             float*                 pOut);
+
+// Print, for each of equationExamples, how many points per second one thread evaluates with equationEvaluate
+// and with an EquationProgram, and the largest difference between their results.
+void equationBenchmarkPrograms();
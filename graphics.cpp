@@ -2,7 +2,9 @@
 // SPDX-License-Identifier: Apache-2.0
 #include "graphics.hpp"
 
+#include <algorithm>
 #include <cassert>
+#include <vector>
 
 #include "backends/imgui_impl_vulkan.h"
 
@@ -11,10 +13,13 @@
 #include "nvvk/images_vk.hpp"
 #include "nvvk/pipeline_vk.hpp"
 
+#include "mcubes_bake.hpp"
 #include "mcubes_chunk.hpp"
+#include "mcubes_symmetry.hpp"
 #include "timeline_semaphore_main.hpp"
 
 #include "shaders/camera_transforms.h"
+#include "shaders/mcubes_bake.h"
 #include "shaders/mcubes_debug_view_push_constant.h"
 #include "shaders/mcubes_geometry.h"
 #include "shaders/mcubes_params.h"
@@ -22,20 +27,39 @@
 VkImage g_drawImage;
 
 static VkRenderPass                 s_renderPass;
-static nvvk::Buffer                 s_cameraTransformsBufferObject;
-static nvvk::DescriptorSetContainer s_cameraTransformsDescriptorSetContainer;
+static nvvk::Buffer                 s_cameraTransformsBufferObjects[2];  // Indexed by g_frameNumber & 1
+static CameraTransforms*            s_pMappedCameraTransforms[2];
+static nvvk::DescriptorSetContainer s_cameraTransformsDescriptorSetContainer;  // Set i uses buffer i
 static VkPipelineLayout             s_backgroundPipelineLayout;
 static VkPipeline                   s_backgroundPipeline;
 static VkPipelineLayout             s_mcubesGeometryPipelineLayout;
 static VkPipeline                   s_mcubesGeometryPipeline;
+static VkPipelineLayout             s_mcubesBakedPipelineLayout;  // Same, drawing from the keyframe cache
+static VkPipeline                   s_mcubesBakedPipeline;
 static VkPipelineLayout             s_mcubesChunkBoundsPipelineLayout;
 static VkPipeline                   s_mcubesChunkBoundsPipeline;
+static VkPipelineLayout             s_mcubesRayMarchPipelineLayout;
+static VkPipeline                   s_mcubesRayMarchPipeline;
 
 static nvvk::Image   s_colorImageObject;  // Always set g_drawImage to s_colorImageObject.image
 static nvvk::Image   s_depthImageObject;
 static VkImageView   s_framebufferAttachments[2];
 static VkFramebuffer s_framebuffer;
-static uint32_t      s_framebufferWidth, s_framebufferHeight;
+static uint32_t      s_framebufferWidth, s_framebufferHeight;  // Allocated size, a multiple of framebufferSizeStep
+static uint32_t      s_renderWidth, s_renderHeight;            // Size drawn to (that of the window), within it
+
+// The framebuffer is allocated in coarse steps, so that resizing the window mostly just changes the render area.
+static const uint32_t framebufferSizeStep = 256;
+
+// Framebuffers replaced by graphicsResizeFramebufferIfNeeded, destroyed once the last frame using them retired.
+struct RetiredFramebuffer
+{
+  nvvk::Image   colorImageObject, depthImageObject;
+  VkImageView   attachments[2];
+  VkFramebuffer framebuffer;
+  uint64_t      lastFrameNumber;  // Value of g_frameNumber of the last frame that used the framebuffer
+};
+static std::vector<RetiredFramebuffer> s_retiredFramebuffers;
 
 static const VkFormat colorFormat = VK_FORMAT_B8G8R8A8_SRGB;
 static const VkFormat depthFormat = VK_FORMAT_D32_SFLOAT;
@@ -90,20 +114,33 @@ static void setupRenderPass()
 
 static void setupCameraTransformsBuffer()
 {
-  // Allocate UBO for holding CameraTransforms struct.
-  const auto         usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
+  // Allocate UBOs for holding CameraTransforms struct, one per frame in flight. They are written by the host, in
+  // plain host-visible memory: they are tiny, and device-local host-visible memory may be a small BAR heap.
+  const auto         usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
+  const auto         props = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
   VkBufferCreateInfo bufferInfo{VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO, nullptr, 0, sizeof(CameraTransforms), usage};
-  s_cameraTransformsBufferObject = g_allocator.createBuffer(bufferInfo);
 
-  // Create 1-binding descriptor set that always points to this buffer.
+  // Create 1-binding descriptor sets, each always pointing to one of these buffers.
   s_cameraTransformsDescriptorSetContainer.init(g_ctx);
   s_cameraTransformsDescriptorSetContainer.addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1,
                                                       VK_SHADER_STAGE_ALL_GRAPHICS, nullptr);
   s_cameraTransformsDescriptorSetContainer.initLayout();
-  s_cameraTransformsDescriptorSetContainer.initPool(1);
-  VkDescriptorBufferInfo descriptorInfo{s_cameraTransformsBufferObject.buffer, 0, sizeof(CameraTransforms)};
-  VkWriteDescriptorSet   write = s_cameraTransformsDescriptorSetContainer.makeWrite(0, 0, &descriptorInfo, 0);
-  vkUpdateDescriptorSets(g_ctx, 1, &write, 0, nullptr);
+  s_cameraTransformsDescriptorSetContainer.initPool(2);
+  for(uint32_t i = 0; i < 2; ++i)
+  {
+    nvvk::Buffer& bufferObject   = s_cameraTransformsBufferObjects[i];
+    bufferObject                 = g_allocator.createBuffer(bufferInfo, props);
+    s_pMappedCameraTransforms[i] = static_cast<CameraTransforms*>(g_allocator.map(bufferObject));
+    VkDescriptorBufferInfo descriptorInfo{bufferObject.buffer, 0, sizeof(CameraTransforms)};
+    VkWriteDescriptorSet   write = s_cameraTransformsDescriptorSetContainer.makeWrite(i, 0, &descriptorInfo, 0);
+    vkUpdateDescriptorSets(g_ctx, 1, &write, 0, nullptr);
+  }
+}
+
+// Descriptor set of the CameraTransforms UBO of this frame.
+static VkDescriptorSet getCameraTransformsDescriptorSet()
+{
+  return s_cameraTransformsDescriptorSetContainer.getSet(uint32_t(g_frameNumber & 1u));
 }
 
 static void setupBackgroundPipeline()
@@ -134,21 +171,24 @@ static void setupBackgroundPipeline()
   s_backgroundPipeline = generator.createPipeline();
 }
 
-static void setupMcubesGeometryPipeline()
+// If baked, draw from the animation keyframe cache instead of a McubesChunk (see mcubes_bake.hpp).
+static void setupMcubesGeometryPipeline(bool baked, VkPipelineLayout* pLayout, VkPipeline* pPipeline)
 {
-  // Set up pipeline layout, McubesDebugViewPushConstant push constant,
-  // one CameraTransforms UBO input, one McubesGeometry buffer input.
+  // Set up pipeline layout, McubesDebugViewPushConstant push constant followed by MCUBES_MIRROR_* flags
+  // (and, if baked, the first McubesBakedDraw index), one CameraTransforms UBO input, one McubesGeometry
+  // buffer input (or keyframe cache descriptor set, if baked).
   VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
   pipelineLayoutInfo.sType          = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
   VkDescriptorSetLayout layouts[2]  = {s_cameraTransformsDescriptorSetContainer.getLayout(),
-                                      g_mcubesChunkDescriptorSetLayout};
+                                      baked ? g_mcubesBakeDescriptorSetLayout : g_mcubesChunkDescriptorSetLayout};
   pipelineLayoutInfo.setLayoutCount = 2;
   pipelineLayoutInfo.pSetLayouts    = layouts;
 
-  VkPushConstantRange pushConstantRange     = {VK_SHADER_STAGE_ALL, 0, sizeof(McubesDebugViewPushConstant)};
+  uint32_t            pushConstantSize      = sizeof(McubesDebugViewPushConstant) + (baked ? 2 : 1) * sizeof(uint32_t);
+  VkPushConstantRange pushConstantRange     = {VK_SHADER_STAGE_ALL, 0, pushConstantSize};
   pipelineLayoutInfo.pushConstantRangeCount = 1;
   pipelineLayoutInfo.pPushConstantRanges    = &pushConstantRange;
-  NVVK_CHECK(vkCreatePipelineLayout(g_ctx, &pipelineLayoutInfo, nullptr, &s_mcubesGeometryPipelineLayout));
+  NVVK_CHECK(vkCreatePipelineLayout(g_ctx, &pipelineLayoutInfo, nullptr, pLayout));
 
   // Hides all the graphics pipeline boilerplate (in particular enabling dynamic viewport and scissor).
   nvvk::GraphicsPipelineState pipelineState;
@@ -157,16 +197,16 @@ static void setupMcubesGeometryPipeline()
   // No vertex input bindings (manual fetch from storage buffer).
 
   // Compile and load shaders.
-  VkShaderModule vs_module = g_pShaderCompiler->get(
-      g_pShaderCompiler->createShaderModule(VK_SHADER_STAGE_VERTEX_BIT, "./shaders/mcubes_geometry.vert"));
+  VkShaderModule vs_module = g_pShaderCompiler->get(g_pShaderCompiler->createShaderModule(
+      VK_SHADER_STAGE_VERTEX_BIT, "./shaders/mcubes_geometry.vert", baked ? "#define MCUBES_BAKED 1\n" : ""));
   VkShaderModule fs_module = g_pShaderCompiler->get(
       g_pShaderCompiler->createShaderModule(VK_SHADER_STAGE_FRAGMENT_BIT, "./shaders/mcubes_geometry.frag"));
 
   // Create pipeline.
-  nvvk::GraphicsPipelineGenerator generator(g_ctx, s_mcubesGeometryPipelineLayout, s_renderPass, pipelineState);
+  nvvk::GraphicsPipelineGenerator generator(g_ctx, *pLayout, s_renderPass, pipelineState);
   generator.addShader(vs_module, VK_SHADER_STAGE_VERTEX_BIT);
   generator.addShader(fs_module, VK_SHADER_STAGE_FRAGMENT_BIT);
-  s_mcubesGeometryPipeline = generator.createPipeline();
+  *pPipeline = generator.createPipeline();
 }
 
 static void setupMcubesChunkBoundsPipeline()
@@ -200,13 +240,53 @@ static void setupMcubesChunkBoundsPipeline()
   s_mcubesChunkBoundsPipeline = generator.createPipeline();
 }
 
+static void setupMcubesRayMarchPipeline()
+{
+  // Set up pipeline layout, McubesParams push constant followed by McubesDebugViewPushConstant and
+  // MCUBES_MIRROR_* flags, one CameraTransforms UBO input, one McubesChunk descriptor set input.
+  VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+  pipelineLayoutInfo.sType          = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+  VkDescriptorSetLayout layouts[2]  = {s_cameraTransformsDescriptorSetContainer.getLayout(),
+                                      g_mcubesChunkDescriptorSetLayout};
+  pipelineLayoutInfo.setLayoutCount = 2;
+  pipelineLayoutInfo.pSetLayouts    = layouts;
+
+  constexpr uint32_t pushConstantSize = sizeof(McubesParams) + sizeof(McubesDebugViewPushConstant) + sizeof(uint32_t);
+  static_assert(pushConstantSize <= 128, "Exceeds guaranteed maxPushConstantsSize");
+  VkPushConstantRange pushConstantRange     = {VK_SHADER_STAGE_ALL, 0, pushConstantSize};
+  pipelineLayoutInfo.pushConstantRangeCount = 1;
+  pipelineLayoutInfo.pPushConstantRanges    = &pushConstantRange;
+  NVVK_CHECK(vkCreatePipelineLayout(g_ctx, &pipelineLayoutInfo, nullptr, &s_mcubesRayMarchPipelineLayout));
+
+  // Hides all the graphics pipeline boilerplate (in particular enabling dynamic viewport and scissor).
+  // The chunk box is drawn without culling, and the fragment shader picks one of the faces covering
+  // each pixel (so the camera may be inside the box, and reflections don't need a winding swap).
+  nvvk::GraphicsPipelineState pipelineState;
+  pipelineState.depthStencilState.depthCompareOp = VK_COMPARE_OP_GREATER;  // Reversed Z
+  pipelineState.rasterizationState.cullMode      = VK_CULL_MODE_NONE;
+
+  // Compile and load shaders.
+  VkShaderModule vs_module = g_pShaderCompiler->get(
+      g_pShaderCompiler->createShaderModule(VK_SHADER_STAGE_VERTEX_BIT, "./shaders/mcubes_ray_march.vert"));
+  VkShaderModule fs_module = g_pShaderCompiler->get(
+      g_pShaderCompiler->createShaderModule(VK_SHADER_STAGE_FRAGMENT_BIT, "./shaders/mcubes_ray_march.frag"));
+
+  // Create pipeline.
+  nvvk::GraphicsPipelineGenerator generator(g_ctx, s_mcubesRayMarchPipelineLayout, s_renderPass, pipelineState);
+  generator.addShader(vs_module, VK_SHADER_STAGE_VERTEX_BIT);
+  generator.addShader(fs_module, VK_SHADER_STAGE_FRAGMENT_BIT);
+  s_mcubesRayMarchPipeline = generator.createPipeline();
+}
+
 void setupGraphics()
 {
   setupRenderPass();
   setupCameraTransformsBuffer();
   setupBackgroundPipeline();
-  setupMcubesGeometryPipeline();
+  setupMcubesGeometryPipeline(false, &s_mcubesGeometryPipelineLayout, &s_mcubesGeometryPipeline);
+  setupMcubesGeometryPipeline(true, &s_mcubesBakedPipelineLayout, &s_mcubesBakedPipeline);
   setupMcubesChunkBoundsPipeline();
+  setupMcubesRayMarchPipeline();
 }
 
 void graphicsCmdGuiFirstTimeSetup(VkCommandBuffer cmdBuf, Gui* pGui)
@@ -223,20 +303,58 @@ void shutdownGraphics()
   vkDestroyPipelineLayout(g_ctx, s_backgroundPipelineLayout, nullptr);
   vkDestroyPipeline(g_ctx, s_mcubesGeometryPipeline, nullptr);
   vkDestroyPipelineLayout(g_ctx, s_mcubesGeometryPipelineLayout, nullptr);
+  vkDestroyPipeline(g_ctx, s_mcubesBakedPipeline, nullptr);
+  vkDestroyPipelineLayout(g_ctx, s_mcubesBakedPipelineLayout, nullptr);
   vkDestroyPipeline(g_ctx, s_mcubesChunkBoundsPipeline, nullptr);
   vkDestroyPipelineLayout(g_ctx, s_mcubesChunkBoundsPipelineLayout, nullptr);
+  vkDestroyPipeline(g_ctx, s_mcubesRayMarchPipeline, nullptr);
+  vkDestroyPipelineLayout(g_ctx, s_mcubesRayMarchPipelineLayout, nullptr);
   s_cameraTransformsDescriptorSetContainer.deinit();
-  g_allocator.destroy(s_cameraTransformsBufferObject);
+  for(uint32_t i = 0; i < 2; ++i)
+  {
+    g_allocator.unmap(s_cameraTransformsBufferObjects[i]);
+    g_allocator.destroy(s_cameraTransformsBufferObjects[i]);
+  }
   vkDestroyRenderPass(g_ctx, s_renderPass, nullptr);
 }
 
-void graphicsWaitResizeFramebufferIfNeeded(uint32_t width, uint32_t height)
+static uint32_t roundUpFramebufferSize(uint32_t size)
+{
+  return std::max((size + framebufferSizeStep - 1) / framebufferSizeStep, 1u) * framebufferSizeStep;
+}
+
+static void destroyRetiredFramebuffers(uint64_t completedFrameNumber);
+
+void graphicsResizeFramebufferIfNeeded(uint32_t width, uint32_t height, uint64_t completedFrameNumber)
 {
   assert(g_drawImage == s_colorImageObject.image);
-  if(!s_framebuffer || s_framebufferWidth != width || s_framebufferHeight != height)
+  destroyRetiredFramebuffers(completedFrameNumber);
+  s_renderWidth  = width;
+  s_renderHeight = height;
+
+  // Grow to fit the window, or shrink if that frees more than a step (so that a window resized back and forth
+  // around a step boundary does not reallocate every time).
+  uint32_t allocWidth  = roundUpFramebufferSize(width);
+  uint32_t allocHeight = roundUpFramebufferSize(height);
+  bool     grow        = width > s_framebufferWidth || height > s_framebufferHeight;
+  bool     shrink      = s_framebufferWidth > allocWidth + framebufferSizeStep
+                        || s_framebufferHeight > allocHeight + framebufferSizeStep;
+  if(!s_framebuffer || grow || shrink)
   {
-    vkQueueWaitIdle(g_gctQueue);
-    shutdownFramebuffer();
+    // The previous frame may still be using the framebuffer; destroy it later instead of waiting for it.
+    if(s_framebuffer)
+    {
+      RetiredFramebuffer retired;
+      retired.colorImageObject = s_colorImageObject;
+      retired.depthImageObject = s_depthImageObject;
+      retired.attachments[0]   = s_framebufferAttachments[0];
+      retired.attachments[1]   = s_framebufferAttachments[1];
+      retired.framebuffer      = s_framebuffer;
+      retired.lastFrameNumber  = g_frameNumber - 1u;
+      s_retiredFramebuffers.push_back(retired);
+    }
+    width  = allocWidth;
+    height = allocHeight;
 
     // Create new color image.
     VkImageCreateInfo colorImageInfo{VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
@@ -310,8 +428,25 @@ void graphicsWaitResizeFramebufferIfNeeded(uint32_t width, uint32_t height)
   }
 }
 
+static void destroyRetiredFramebuffers(uint64_t completedFrameNumber)
+{
+  for(size_t i = s_retiredFramebuffers.size(); i-- > 0;)
+  {
+    RetiredFramebuffer& retired = s_retiredFramebuffers[i];
+    if(retired.lastFrameNumber > completedFrameNumber)
+      continue;
+    g_allocator.destroy(retired.colorImageObject);
+    g_allocator.destroy(retired.depthImageObject);
+    vkDestroyImageView(g_ctx, retired.attachments[0], nullptr);
+    vkDestroyImageView(g_ctx, retired.attachments[1], nullptr);
+    vkDestroyFramebuffer(g_ctx, retired.framebuffer, nullptr);
+    s_retiredFramebuffers.erase(s_retiredFramebuffers.begin() + i);
+  }
+}
+
 static void shutdownFramebuffer()
 {
+  destroyRetiredFramebuffers(~uint64_t(0));
   if(s_colorImageObject.image)
   {
     g_allocator.destroy(s_colorImageObject);
@@ -341,7 +476,7 @@ static void cmdBeginDynamicViewportScissorRenderPass(VkCommandBuffer cmdBuf)
                                      nullptr,
                                      s_renderPass,
                                      s_framebuffer,
-                                     {{0, 0}, {s_framebufferWidth, s_framebufferHeight}},
+                                     {{0, 0}, {s_renderWidth, s_renderHeight}},
                                      0,
                                      nullptr};
   vkCmdBeginRenderPass(cmdBuf, &beginInfo, VK_SUBPASS_CONTENTS_INLINE);
@@ -352,8 +487,8 @@ static void cmdBeginDynamicViewportScissorRenderPass(VkCommandBuffer cmdBuf)
   viewport.y        = 0.0f;
   viewport.minDepth = 0.0f;
   viewport.maxDepth = 1.0f;
-  viewport.width    = s_framebufferWidth;
-  viewport.height   = s_framebufferHeight;
+  viewport.width    = s_renderWidth;
+  viewport.height   = s_renderHeight;
   auto     ix       = int32_t(viewport.x);
   auto     iy       = int32_t(viewport.y);
   auto     iw       = uint32_t(viewport.width);
@@ -363,24 +498,19 @@ static void cmdBeginDynamicViewportScissorRenderPass(VkCommandBuffer cmdBuf)
   vkCmdSetScissor(cmdBuf, 0, 1, &scissor);
 }
 
-void graphicsCmdPrepareFrame(VkCommandBuffer cmdBuf, const CameraTransforms* pCameraTransforms)
+void graphicsSetCameraTransforms(const CameraTransforms& cameraTransforms)
+{
+  // No barrier needed: vkQueueSubmit makes host-coherent writes visible to the commands it submits.
+  *s_pMappedCameraTransforms[g_frameNumber & 1u] = cameraTransforms;
+}
+
+void graphicsCmdPrepareFrame(VkCommandBuffer cmdBuf)
 {
   // Transition framebuffer attachments to defined layout.
   nvvk::cmdBarrierImageLayout(cmdBuf, g_drawImage, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL,
                               VK_IMAGE_ASPECT_COLOR_BIT);
   nvvk::cmdBarrierImageLayout(cmdBuf, s_depthImageObject.image, VK_IMAGE_LAYOUT_UNDEFINED,
                               VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, VK_IMAGE_ASPECT_DEPTH_BIT);
-  // Update UBO data.
-  VkMemoryBarrier uboBarrier = {VK_STRUCTURE_TYPE_MEMORY_BARRIER};
-  uboBarrier.srcAccessMask   = VK_ACCESS_UNIFORM_READ_BIT;
-  uboBarrier.dstAccessMask   = VK_ACCESS_TRANSFER_WRITE_BIT;
-  vkCmdPipelineBarrier(cmdBuf, VK_PIPELINE_STAGE_ALL_GRAPHICS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &uboBarrier, 0,
-                       nullptr, 0, nullptr);
-  vkCmdUpdateBuffer(cmdBuf, s_cameraTransformsBufferObject.buffer, 0, sizeof(CameraTransforms), pCameraTransforms);
-  uboBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-  uboBarrier.dstAccessMask = VK_ACCESS_UNIFORM_READ_BIT;
-  vkCmdPipelineBarrier(cmdBuf, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_GRAPHICS_BIT, 0, 1, &uboBarrier, 0,
-                       nullptr, 0, nullptr);
 
   cmdBeginDynamicViewportScissorRenderPass(cmdBuf);
 
@@ -388,11 +518,11 @@ void graphicsCmdPrepareFrame(VkCommandBuffer cmdBuf, const CameraTransforms* pCa
   VkClearValue clearDepthValue;
   clearDepthValue.depthStencil.depth = 0.0;  // Reversed Z
   VkClearAttachment clearDepth       = {VK_IMAGE_ASPECT_DEPTH_BIT, 1, clearDepthValue};
-  VkClearRect       clearRect        = {{{0u, 0u}, {s_framebufferWidth, s_framebufferHeight}}, 0, 1};
+  VkClearRect       clearRect        = {{{0u, 0u}, {s_renderWidth, s_renderHeight}}, 0, 1};
   vkCmdClearAttachments(cmdBuf, 1, &clearDepth, 1, &clearRect);
 
   // Draw background.
-  VkDescriptorSet cameraTransformsDescriptorSet = s_cameraTransformsDescriptorSetContainer.getSet(0);
+  VkDescriptorSet cameraTransformsDescriptorSet = getCameraTransformsDescriptorSet();
   vkCmdBindDescriptorSets(cmdBuf, VK_PIPELINE_BIND_POINT_GRAPHICS, s_backgroundPipelineLayout, 0,  //
                           1, &cameraTransformsDescriptorSet, 0, 0);
   vkCmdBindPipeline(cmdBuf, VK_PIPELINE_BIND_POINT_GRAPHICS, s_backgroundPipeline);
@@ -404,6 +534,7 @@ void graphicsCmdPrepareFrame(VkCommandBuffer cmdBuf, const CameraTransforms* pCa
 void graphicsCmdDrawMcubesGeometryBatch(VkCommandBuffer                    cmdBuf,
                                         uint32_t                           count,
                                         const McubesChunk* const*          ppChunks,
+                                        const McubesSymmetry&              symmetry,
                                         const McubesParams*                pDebugChunkBounds,
                                         const McubesDebugViewPushConstant* pDebugViewColors)
 {
@@ -413,7 +544,7 @@ void graphicsCmdDrawMcubesGeometryBatch(VkCommandBuffer                    cmdBu
   vkCmdBindPipeline(cmdBuf, VK_PIPELINE_BIND_POINT_GRAPHICS, s_mcubesGeometryPipeline);
 
   // Bind camera UBO descriptor set (0).
-  VkDescriptorSet uboSet = s_cameraTransformsDescriptorSetContainer.getSet(0);
+  VkDescriptorSet uboSet = getCameraTransformsDescriptorSet();
   vkCmdBindDescriptorSets(cmdBuf, VK_PIPELINE_BIND_POINT_GRAPHICS, s_mcubesGeometryPipelineLayout, 0, 1, &uboSet, 0, 0);
 
   for(uint32_t i = 0; i < count; ++i)
@@ -427,18 +558,26 @@ void graphicsCmdDrawMcubesGeometryBatch(VkCommandBuffer                    cmdBu
     vkCmdPushConstants(cmdBuf, s_mcubesGeometryPipelineLayout, VK_SHADER_STAGE_ALL, 0, sizeof disabledDebugColor,
                        pDebugViewColors != nullptr ? &pDebugViewColors[i] : &disabledDebugColor);
 
-    // Draw
-    vkCmdDrawIndirect(cmdBuf, ppChunks[i]->geometryArrayBuffer.buffer, 0, MCUBES_GEOMETRIES_PER_CHUNK,
-                      sizeof(McubesGeometry));
+    // Draw, once per reflection of the chunk.
+    for(uint32_t m = 0; m < symmetry.mirrorCount; ++m)
+    {
+      vkCmdPushConstants(cmdBuf, s_mcubesGeometryPipelineLayout, VK_SHADER_STAGE_ALL,
+                         sizeof(McubesDebugViewPushConstant), sizeof(uint32_t), &symmetry.mirrorFlags[m]);
+      vkCmdDrawIndirect(cmdBuf, ppChunks[i]->geometryArrayBuffer.buffer, 0, MCUBES_GEOMETRIES_PER_CHUNK,
+                        sizeof(McubesGeometry));
+    }
 
     if(pDebugChunkBounds != nullptr)
     {
       vkCmdBindPipeline(cmdBuf, VK_PIPELINE_BIND_POINT_GRAPHICS, s_mcubesChunkBoundsPipeline);
       vkCmdBindDescriptorSets(cmdBuf, VK_PIPELINE_BIND_POINT_GRAPHICS, s_mcubesChunkBoundsPipelineLayout, 0, 1, &uboSet,
                               0, 0);
-      vkCmdPushConstants(cmdBuf, s_mcubesChunkBoundsPipelineLayout, VK_SHADER_STAGE_ALL, 0, sizeof pDebugChunkBounds[i],
-                         &pDebugChunkBounds[i]);
-      vkCmdDraw(cmdBuf, 24, 1, 0, 0);
+      for(uint32_t m = 0; m < symmetry.mirrorCount; ++m)
+      {
+        McubesParams bounds = symmetryMirrorBox(pDebugChunkBounds[i], symmetry.mirrorFlags[m]);
+        vkCmdPushConstants(cmdBuf, s_mcubesChunkBoundsPipelineLayout, VK_SHADER_STAGE_ALL, 0, sizeof bounds, &bounds);
+        vkCmdDraw(cmdBuf, 24, 1, 0, 0);
+      }
       vkCmdBindPipeline(cmdBuf, VK_PIPELINE_BIND_POINT_GRAPHICS, s_mcubesGeometryPipeline);
       vkCmdBindDescriptorSets(cmdBuf, VK_PIPELINE_BIND_POINT_GRAPHICS, s_mcubesGeometryPipelineLayout, 0, 1, &uboSet, 0,
                               0);
@@ -447,6 +586,76 @@ void graphicsCmdDrawMcubesGeometryBatch(VkCommandBuffer                    cmdBu
   vkCmdEndRenderPass(cmdBuf);
 }
 
+void graphicsCmdRayMarchMcubesImageBatch(VkCommandBuffer                    cmdBuf,
+                                         uint32_t                           count,
+                                         const McubesChunk* const*          ppChunks,
+                                         const McubesParams*                pParams,
+                                         const McubesSymmetry&              symmetry,
+                                         const McubesDebugViewPushConstant* pDebugViewColors)
+{
+  cmdBeginDynamicViewportScissorRenderPass(cmdBuf);
+
+  // Bind pipeline and camera UBO descriptor set (0).
+  vkCmdBindPipeline(cmdBuf, VK_PIPELINE_BIND_POINT_GRAPHICS, s_mcubesRayMarchPipeline);
+  VkDescriptorSet uboSet = getCameraTransformsDescriptorSet();
+  vkCmdBindDescriptorSets(cmdBuf, VK_PIPELINE_BIND_POINT_GRAPHICS, s_mcubesRayMarchPipelineLayout, 0, 1, &uboSet, 0, 0);
+
+  for(uint32_t i = 0; i < count; ++i)
+  {
+    // Bind McubesChunk descriptor set (1), for the image and block signatures.
+    vkCmdBindDescriptorSets(cmdBuf, VK_PIPELINE_BIND_POINT_GRAPHICS, s_mcubesRayMarchPipelineLayout,  //
+                            1, 1, &ppChunks[i]->rayMarchSet, 0, 0);
+
+    // Set chunk parameters and debug override color.
+    static McubesDebugViewPushConstant disabledDebugColor{};
+    vkCmdPushConstants(cmdBuf, s_mcubesRayMarchPipelineLayout, VK_SHADER_STAGE_ALL, 0, sizeof(McubesParams),
+                       &pParams[i]);
+    vkCmdPushConstants(cmdBuf, s_mcubesRayMarchPipelineLayout, VK_SHADER_STAGE_ALL, sizeof(McubesParams),
+                       sizeof disabledDebugColor,
+                       pDebugViewColors != nullptr ? &pDebugViewColors[i] : &disabledDebugColor);
+
+    // Draw the chunk box, once per reflection of the chunk.
+    for(uint32_t m = 0; m < symmetry.mirrorCount; ++m)
+    {
+      vkCmdPushConstants(cmdBuf, s_mcubesRayMarchPipelineLayout, VK_SHADER_STAGE_ALL,
+                         sizeof(McubesParams) + sizeof(McubesDebugViewPushConstant), sizeof(uint32_t),
+                         &symmetry.mirrorFlags[m]);
+      vkCmdDraw(cmdBuf, 36, 1, 0, 0);
+    }
+  }
+  vkCmdEndRenderPass(cmdBuf);
+}
+
+void graphicsCmdDrawMcubesBakedKeyframe(VkCommandBuffer cmdBuf, const McubesBakeKeyframe& keyframe)
+{
+  cmdBeginDynamicViewportScissorRenderPass(cmdBuf);
+
+  // Bind pipeline, camera UBO descriptor set (0), and keyframe cache descriptor set (1).
+  vkCmdBindPipeline(cmdBuf, VK_PIPELINE_BIND_POINT_GRAPHICS, s_mcubesBakedPipeline);
+  VkDescriptorSet sets[2] = {getCameraTransformsDescriptorSet(), g_mcubesBakeDescriptorSet};
+  vkCmdBindDescriptorSets(cmdBuf, VK_PIPELINE_BIND_POINT_GRAPHICS, s_mcubesBakedPipelineLayout, 0, 2, sets, 0, 0);
+
+  McubesDebugViewPushConstant disabledDebugColor{};
+  vkCmdPushConstants(cmdBuf, s_mcubesBakedPipelineLayout, VK_SHADER_STAGE_ALL, 0, sizeof disabledDebugColor,
+                     &disabledDebugColor);
+
+  // Draw each chunk's McubesBakedDraw records, once per reflection of the chunk.
+  for(uint32_t i = 0; i < keyframe.chunkCount; ++i)
+  {
+    uint32_t firstDraw = keyframe.firstDraw + i * MCUBES_GEOMETRIES_PER_CHUNK;
+    vkCmdPushConstants(cmdBuf, s_mcubesBakedPipelineLayout, VK_SHADER_STAGE_ALL,
+                       sizeof(McubesDebugViewPushConstant) + sizeof(uint32_t), sizeof firstDraw, &firstDraw);
+    for(uint32_t m = 0; m < keyframe.symmetry.mirrorCount; ++m)
+    {
+      vkCmdPushConstants(cmdBuf, s_mcubesBakedPipelineLayout, VK_SHADER_STAGE_ALL,
+                         sizeof(McubesDebugViewPushConstant), sizeof(uint32_t), &keyframe.symmetry.mirrorFlags[m]);
+      vkCmdDrawIndirect(cmdBuf, g_mcubesBakeDrawBuffer.buffer, firstDraw * sizeof(McubesBakedDraw),
+                        MCUBES_GEOMETRIES_PER_CHUNK, sizeof(McubesBakedDraw));
+    }
+  }
+  vkCmdEndRenderPass(cmdBuf);
+}
+
 void graphicsCmdDrawImGui(VkCommandBuffer cmdBuf)
 {
   cmdBeginDynamicViewportScissorRenderPass(cmdBuf);
@@ -15,25 +15,48 @@ void setupGraphics();
 void graphicsCmdGuiFirstTimeSetup(VkCommandBuffer cmdBuf, Gui* p_gui);
 void shutdownGraphics();
 
-// Deallocate and resize the framebuffer if needed to match.
-// If resizing is needed, we wait for g_gctQueue to idle first.
-void graphicsWaitResizeFramebufferIfNeeded(uint32_t width, uint32_t height);
+// Set the size drawn to, reallocating the framebuffer (in coarse steps) if needed to fit.
+// Instead of waiting for g_gctQueue to idle, the old framebuffer is destroyed by a later call, once
+// completedFrameNumber shows that all frames (values of g_frameNumber) that used it have retired.
+void graphicsResizeFramebufferIfNeeded(uint32_t width, uint32_t height, uint64_t completedFrameNumber);
+
+// Write the CameraTransforms UBO read by this frame's graphics commands (one UBO per frame in flight, indexed by
+// g_frameNumber & 1, persistently mapped). Call as late as possible, but before submitting those commands, and
+// after the commands of the frame before last have retired.
+struct CameraTransforms;
+void graphicsSetCameraTransforms(const CameraTransforms& cameraTransforms);
 
 // First command for drawing new frame.
-struct CameraTransforms;
-void graphicsCmdPrepareFrame(VkCommandBuffer cmdBuf, const CameraTransforms* pCameraTransforms);
+void graphicsCmdPrepareFrame(VkCommandBuffer cmdBuf);
 
-// Record commands to draw the McubesGeometry instances in the array of McubesChunk to g_drawImage.
+// Record commands to draw the McubesGeometry instances in the array of McubesChunk to g_drawImage,
+// once for each reflection listed in symmetry.
 // Debug features: if pDebugChunkBounds != nullptr, we also draw the bounding boxes for each chunk drawn,
 //   if pDebugViewColors != nullptr, selectively (with `enabled` attribute) override the color used to draw each chunk.
 struct McubesChunk;
 struct McubesParams;
 struct McubesDebugViewPushConstant;
+struct McubesSymmetry;
 void graphicsCmdDrawMcubesGeometryBatch(VkCommandBuffer                    cmdBuf,
                                         uint32_t                           count,
                                         const McubesChunk* const*          ppChunks,
+                                        const McubesSymmetry&              symmetry,
                                         const McubesParams*                pDebugChunkBounds,
                                         const McubesDebugViewPushConstant* pDebugViewColors = nullptr);
 
+// Record commands to draw the array of McubesChunk to g_drawImage by ray marching their images (filled by
+// computeCmdFillChunkBatch with the corresponding array of parameters), once for each reflection listed in
+// symmetry. No McubesGeometry is read. pDebugViewColors is as for graphicsCmdDrawMcubesGeometryBatch.
+void graphicsCmdRayMarchMcubesImageBatch(VkCommandBuffer                    cmdBuf,
+                                         uint32_t                           count,
+                                         const McubesChunk* const*          ppChunks,
+                                         const McubesParams*                pParams,
+                                         const McubesSymmetry&              symmetry,
+                                         const McubesDebugViewPushConstant* pDebugViewColors = nullptr);
+
+// Record commands to draw a ready keyframe of the animation keyframe cache to g_drawImage.
+struct McubesBakeKeyframe;
+void graphicsCmdDrawMcubesBakedKeyframe(VkCommandBuffer cmdBuf, const McubesBakeKeyframe& keyframe);
+
 // Wrapper around ImGui Vulkan commands, draw to g_drawImage.
 void graphicsCmdDrawImGui(VkCommandBuffer cmdBuf);
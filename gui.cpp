@@ -10,13 +10,16 @@
 #include "nvmath/nvmath.h"
 #include "nvvk/error_vk.hpp"
 
+#include "mcubes_bake.hpp"
+#include "mcubes_brick.hpp"
 #include "mcubes_chunk.hpp"
+#include "mcubes_cpu_batch.hpp"
+#include "mcubes_cull.hpp"
 #include "timeline_semaphore_main.hpp"
 
-static const float nearPlane = 65536.0f, farPlane = 1.0f / 65536.0f;  // Reversed Z
+#include "shaders/mcubes_geometry.h"
 
-static const char* const pDefaultEquation =
-    "sqrt(square(fract(y) - 0.5) + square(abs(r - 1))) - 0.15 - 0.25*square(cos(t+(floor(y) + 3)*theta))";
+static const float nearPlane = 65536.0f, farPlane = 1.0f / 65536.0f;  // Reversed Z
 
 static const int tModeManual = 0, tModeSawtooth = 1, tModeTriangle = 2, tModeSin = 3, tMode_0_to_2pi = 4,
                  tModeCount = 5;
@@ -26,10 +29,17 @@ const char* tModeLabels[tModeCount] = {"manual", "sawtooth", "triangle", "sine",
 static const char* chunkDebugViewLabels[chunkDebugViewModeCount] = {"off", "draw bounds", "color by batch",
                                                                     "color by McubesChunk used"};
 
+static const char* symmetryModeLabels[symmetryModeCount] = {"off", "auto-detect", "declared"};
+
+static const char* renderModeLabels[renderModeCount] = {"mesh", "ray march images"};
+
+static const char* mesherLabels[] = {"marching cubes", "surface nets"};  // Indexed by MCUBES_MESHER_*
+
 Gui::Gui()
     : m_cameraManipulator(CameraManip)
 {
   m_tMode = tMode_0_to_2pi;
+  const char* pDefaultEquation = equationExamples[0].pText;
   m_equationInput.resize(strlen(pDefaultEquation) + 1u);
   strcpy(m_equationInput.data(), pDefaultEquation);
   m_batchSize = MCUBES_MAX_CHUNKS_PER_BATCH;
@@ -141,9 +151,87 @@ void Gui::doFrame()
     ImGui::Text("Max Frame Time: %7.4f ms", m_displayedFrameTime * 1000.);
     ImGui::Checkbox("vsync [v] (may reduce timing accuracy)", &m_vsync);
     ImGui::Checkbox("Use compute-only queue [c]", &m_wantComputeQueue);
+    m_sharingModeToggled |= ImGui::Checkbox("Exclusive sharing (ownership transfers)", &m_exclusiveSharing);
+    ImGui::Text("Mean frame time: %.4f ms concurrent, %.4f ms exclusive", m_sharingModeFrameTimes[0] * 1000.,
+                m_sharingModeFrameTimes[1] * 1000.);
+    ImGui::Checkbox("Mesh a share of chunks on the CPU", &m_cpuMeshing);
+    if(m_cpuMeshing)
+    {
+      // The CPU mesher only does linearly interpolated marching cubes, and needs compute queue timestamps.
+      if(!m_wantComputeQueue || m_renderMode != renderModeMesh || m_mesher != MCUBES_MESHER_MARCHING_CUBES
+         || m_newtonSteps != 0 || m_decimateTolerance > 0.0f || !mcubesCpuBatchSupported())
+      {
+        ImGui::Text("CPU needs compute queue, marching cubes, no Newton steps or decimation");
+      }
+      else
+      {
+        const McubesCpuBatchStats& stats = g_mcubesCpuBatchStats;
+        ImGui::Text("CPU meshed %u/%u chunks (%.2f ms/chunk, GPU %.2f)", stats.chunkCount, stats.jobCount,
+                    stats.cpuSecondsPerChunk * 1000., stats.gpuSecondsPerChunk * 1000.);
+        ImGui::Text("CPU drew %u cells, %u blocks did not fit", stats.blockStats.cellCount, stats.droppedBlockCount);
+      }
+    }
+    ImGui::Checkbox("Sample the field on CPU threads (bricks)", &m_cpuBricks);
+    if(m_hasVolume)
+      ImGui::Checkbox("Mesh the volume file (bricks)", &m_meshVolume);
+    if(m_cpuBricks || (m_hasVolume && m_meshVolume))
+    {
+      if(!m_wantComputeQueue)
+      {
+        ImGui::Text("Bricks need the compute queue");
+      }
+      else
+      {
+        const McubesBrickStats& stats = g_mcubesBrickStats;
+        ImGui::Text("CPU: %.2f ms/brick, %.2f ms/brick waiting for staging", stats.sourceSecondsPerBrick * 1000.,
+                    stats.stallSecondsPerBrick * 1000.);
+        ImGui::Text("Uploaded by the %s queue", mcubesBrickUsesTransferQueue() ? "transfer" : "compute");
+      }
+    }
     ImGui::SliderFloat("Color by normal [n]", &m_colorByNormalAmount, 0.0f, 1.0f);
     ImGui::SliderInt("Chunks/Batch [-+]", &m_batchSize, 1, MCUBES_MAX_CHUNKS_PER_BATCH);
     ImGui::Combo("Chunk debug view [d]", &m_chunkDebugViewMode, chunkDebugViewLabels, chunkDebugViewModeCount);
+    ImGui::Combo("Render mode", &m_renderMode, renderModeLabels, renderModeCount);
+    ImGui::Checkbox("Cull empty chunks", &m_cullChunks);
+    ImGui::Checkbox("Cull empty blocks (CPU heavy)", &m_cullBlocks);
+    ImGui::Checkbox("Skip CSG operands outside bounds", &m_skipCsgOperands);
+    ImGui::Combo("Mirror symmetry", &m_symmetryMode, symmetryModeLabels, symmetryModeCount);
+    if(m_symmetryMode == symmetryModeDeclared)
+    {
+      ImGui::Checkbox("x##mirror", &m_declaredMirror[0]);
+      ImGui::SameLine();
+      ImGui::Checkbox("y##mirror", &m_declaredMirror[1]);
+      ImGui::SameLine();
+      ImGui::Checkbox("z##mirror", &m_declaredMirror[2]);
+    }
+    ImGui::Text("Culled %u/%u chunks, %u blocks", g_mcubesCullStats.culledChunkCount, g_mcubesCullStats.jobCount,
+                g_mcubesCullStats.culledBlockCount);
+    ImGui::Text("Mirrored %u chunks", g_mcubesCullStats.mirroredChunkCount);
+    ImGui::Text("Skipped %u/%u CSG operands", g_mcubesCullStats.csgSkippedCount, g_mcubesCullStats.csgOperandCount);
+    ImGui::Text("Skipped %u/%u blocks with uniform signs", g_mcubesBlockStats.uniformBlockCount,
+                g_mcubesBlockStats.blockCount);
+    uint32_t triangleCount = g_mcubesBlockStats.packedVertCount / 3u - g_mcubesBlockStats.decimatedTriangleCount;
+    ImGui::Text("Drew %u cells, %u triangles (%u decimated away)", g_mcubesBlockStats.cellCount, triangleCount,
+                g_mcubesBlockStats.decimatedTriangleCount);
+    if(g_mcubesBlockStats.droppedCellCount != 0 || g_mcubesBlockStats.droppedVertCount != 0)
+      ImGui::Text("Dropped %u cells, %u vertices (blocks full)", g_mcubesBlockStats.droppedCellCount,
+                  g_mcubesBlockStats.droppedVertCount);
+    // Bytes of cell headers, packed vertices and normals read by mcubes_geometry.vert, vs. the 64-byte cells
+    // formerly used.
+    ImGui::Text("%.1f MiB read (%.1f MiB at 64 B/cell)",
+                4.0 * (g_mcubesBlockStats.cellCount + 2 * g_mcubesBlockStats.packedVertCount) / double(1u << 20),
+                64.0 * g_mcubesBlockStats.cellCount / double(1u << 20));
+    // Images are pooled (see MCUBES_IMAGE_POOL_SIZE); the ray marching render mode keeps each chunk's image
+    // in the memory of its (unused) geometry buffer instead.
+    ImGui::Text("Image pool %.0f MiB, geometry buffer %.0f MiB per chunk",
+                4.0 * pow(MCUBES_CHUNK_EDGE_LENGTH_TEXELS, 3) * MCUBES_IMAGE_POOL_SIZE / double(1u << 20),
+                double(MCUBES_GEOMETRIES_PER_CHUNK * sizeof(McubesGeometry)) / double(1u << 20));
+    MemAllocatorStats memStats = g_memAllocator.getStats();
+    ImGui::Text("%u allocations in %u VkDeviceMemory, %.0f / %.0f MiB used, %.0f%% fragmented",
+                memStats.allocationCount, memStats.deviceMemoryCount, memStats.usedBytes / double(1u << 20),
+                memStats.allocatedBytes / double(1u << 20), 100.0 * memStats.fragmentation);
+    if(ImGui::Button("Release empty memory blocks"))
+      g_memAllocator.releaseEmptyBlocks();
     if(ImGui::Button("Reset camera [r]"))
       resetCamera();
     ImGui::End();
@@ -210,11 +298,18 @@ std::vector<McubesParams> Gui::getMcubesJobs() const
       for(int x = 0; x < xJobs; ++x)
       {
         McubesParams  params;
-        nvmath::vec3f low  = m_bboxLow + wholeSize * (nvmath::vec3f(x, y, z) / jobCounts);
-        nvmath::vec3f high = m_bboxLow + wholeSize * (nvmath::vec3f(x + 1, y + 1, z + 1) / jobCounts);
-        params.offset      = low;
-        params.t           = m_t;
-        params.size        = high - low;
+        nvmath::vec3f low        = m_bboxLow + wholeSize * (nvmath::vec3f(x, y, z) / jobCounts);
+        nvmath::vec3f high       = m_bboxLow + wholeSize * (nvmath::vec3f(x + 1, y + 1, z + 1) / jobCounts);
+        params.offset            = low;
+        params.t                 = m_t;
+        params.size              = high - low;
+        params.userParams        = m_userParams;
+        params.csgSkipMask       = 0;
+        params.isoLevels         = m_isoLevels;
+        params.isoLevelCount     = uint32_t(m_isoLevelCount);
+        params.newtonSteps       = uint32_t(m_newtonSteps);
+        params.mesher            = uint32_t(m_mesher);
+        params.decimateTolerance = m_decimateTolerance;
         jobs.push_back(params);
       }
     }
@@ -222,6 +317,37 @@ std::vector<McubesParams> Gui::getMcubesJobs() const
   return jobs;
 }
 
+void Gui::getBoundingBox(nvmath::vec3f* pLow, nvmath::vec3f* pHigh) const
+{
+  *pLow  = m_bboxLow;
+  *pHigh = m_bboxHigh;
+}
+
+void Gui::setVolume(float isoLevel)
+{
+  m_hasVolume     = true;
+  m_meshVolume    = true;
+  m_isoLevels.x   = isoLevel;
+  m_isoLevelCount = 1;
+}
+
+bool Gui::getBakeKeyframe(McubesBakeKey* pKey, uint32_t* pKeyframe) const
+{
+  if(m_bakeKeyframe < 0)
+    return false;
+  pKey->jobs = getMcubesJobs();
+  for(McubesParams& job : pKey->jobs)
+  {
+    job.t         = 0.0f;
+    job.statsSlot = 0;
+    memset(job._pad, 0, sizeof job._pad);
+  }
+  pKey->tMode         = m_tMode;
+  pKey->keyframeCount = uint32_t(m_bakeKeyframeCount);
+  *pKeyframe          = uint32_t(m_bakeKeyframe);
+  return true;
+}
+
 void Gui::resetCamera()
 {
   m_cameraManipulator.setLookat(m_bboxHigh, (m_bboxLow + m_bboxHigh) * 0.5f, {0, 1, 0});
@@ -248,8 +374,26 @@ void Gui::doEquationUI()
   }
   ImGui::PopItemWidth();
 
+  validateEquation();
+  if(!m_equationError.empty())
+    ImGui::TextWrapped("Not optimized or culled (raw GLSL), %s", m_equationError.c_str());
+  else
+    ImGui::Text("Cost ~%u (%u ops), unoptimized ~%u (%u ops)", m_equationCost.cost, m_equationCost.opCount,
+                m_unoptimizedEquationCost.cost, m_unoptimizedEquationCost.opCount);
+
   if(ImGui::Button("Paste Equation [p]"))
     setEquation(glfwGetClipboardString(m_pWindow));
+  ImGui::SameLine();
+  if(ImGui::BeginCombo("##examples", "Examples", ImGuiComboFlags_NoArrowButton))
+  {
+    for(uint32_t i = 0; i < equationExampleCount; ++i)
+    {
+      if(ImGui::Selectable(equationExamples[i].pName))
+        setEquation(equationExamples[i].pText);
+    }
+    ImGui::EndCombo();
+  }
+  m_wantSetEquation |= ImGui::Checkbox("Tabulate separable terms", &m_separableTables);
 
   ImGui::Combo("t mode [m]", &m_tMode, tModeLabels, tModeCount);
   focusIfFlag(&m_wantFocusT);
@@ -257,6 +401,25 @@ void Gui::doEquationUI()
   ImGui::SliderFloat("t [t]", &m_t, m_tSliderMin, m_tSliderMax);  // It's fine if user exceeds bounds
   if(m_t != oldTValue)
     m_tMode = tModeManual;
+  ImGui::Checkbox("Bake keyframes", &m_bakeKeyframes);  // Only for periodic t modes
+  ImGui::SameLine();
+  ImGui::SliderInt("##keyframes", &m_bakeKeyframeCount, 4, mcubesBakeMaxKeyframes);
+  if(g_mcubesBakeStats.keyframeCount != 0)
+  {
+    uint64_t frameCount = g_mcubesBakeStats.hitCount + g_mcubesBakeStats.missCount;
+    ImGui::Text("Baked %u/%u keyframes (%u failed), %.0f%% hits, %.1f/%.0f MiB", g_mcubesBakeStats.readyCount,
+                g_mcubesBakeStats.keyframeCount, g_mcubesBakeStats.failedCount,
+                frameCount == 0 ? 0.0 : 100.0 * double(g_mcubesBakeStats.hitCount) / double(frameCount),
+                double(g_mcubesBakeStats.usedBytes) / double(1u << 20),
+                double(g_mcubesBakeStats.capacityBytes) / double(1u << 20));
+  }
+  ImGui::SliderFloat4("a b c d", &m_userParams.x, -4.0f, 4.0f);  // Runtime values, no recompile needed
+  ImGui::SliderInt("Iso-levels", &m_isoLevelCount, 1, MCUBES_MAX_ISO_LEVELS);
+  ImGui::InputFloat4("##isoLevels", &m_isoLevels.x);  // Extracted in one pass over the image
+  if(m_equationError.empty())  // Refining needs the CPU-side parser's automatic differentiation
+    ImGui::SliderInt("Newton steps", &m_newtonSteps, 0, 3);
+  ImGui::Combo("Mesher", &m_mesher, mesherLabels, IM_ARRAYSIZE(mesherLabels));
+  ImGui::SliderFloat("Decimation tolerance", &m_decimateTolerance, 0.0f, 0.25f, "%.3f cells");
 
   ImGui::PushItemWidth(ImGui::GetWindowWidth() * 1.0f);
   focusIfFlag(&m_wantFocusBoundingBox);
@@ -270,6 +433,22 @@ void Gui::doEquationUI()
   ImGui::Separator();
 }
 
+void Gui::validateEquation()
+{
+  if(m_validatedEquation == m_equationInput.data())
+    return;
+  m_validatedEquation = m_equationInput.data();
+  m_equationError.clear();
+
+  Equation equation;
+  if(equationParse(m_validatedEquation.c_str(), &equation, &m_equationError))
+  {
+    m_unoptimizedEquationCost = equationEstimateCost(equation);
+    equationOptimize(&equation);
+    m_equationCost = equationEstimateCost(equation);
+  }
+}
+
 void Gui::setEquation(const char* pEquation)
 {
   size_t bytes = strlen(pEquation) + 1;
@@ -295,28 +474,37 @@ void Gui::equationPastePrimarySelection()
 
 void Gui::updateT()
 {
-  double time = glfwGetTime();
+  // All automatic modes have a period of 1 second. When baking keyframes, snap to the start of the current one.
+  // The keyframe cache holds McubesGeometry, so it is not used in the ray marching render mode.
+  double phase   = fmod(glfwGetTime(), 1.0);
+  m_bakeKeyframe = -1;
+  if(m_bakeKeyframes && m_tMode != tModeManual && m_renderMode == renderModeMesh)
+  {
+    m_bakeKeyframeCount = nvmath::nv_clamp<int>(m_bakeKeyframeCount, 1, int(mcubesBakeMaxKeyframes));
+    m_bakeKeyframe      = std::min(int(phase * m_bakeKeyframeCount), m_bakeKeyframeCount - 1);
+    phase               = double(m_bakeKeyframe) / m_bakeKeyframeCount;
+  }
   switch(m_tMode)
   {
     case tModeSawtooth:
       m_tSliderMin = 0.0f;
       m_tSliderMax = 1.0f;
-      m_t          = float(fmod(time, 1.0));
+      m_t          = float(phase);
       break;
     case tModeTriangle:
       m_tSliderMin = 0.0f;
       m_tSliderMax = 1.0f;
-      m_t          = fabsf(1.0f - 2.0f * float(fmod(time, 1.0)));
+      m_t          = fabsf(1.0f - 2.0f * float(phase));
       break;
     case tModeSin:
       m_tSliderMin = -1.0f;
       m_tSliderMax = 1.0f;
-      m_t          = float(sin(time * 6.283185307179586));
+      m_t          = float(sin(phase * 6.283185307179586));
       break;
     case tMode_0_to_2pi:
       m_tSliderMin = 0.0f;
       m_tSliderMax = 6.283185307179586f;
-      m_t          = float(fmod(time, 1.0) * 6.283185307179586);
+      m_t          = float(phase * 6.283185307179586);
       break;
   }
 }
@@ -342,6 +530,9 @@ void Gui::updateFpsSample()
   {
     m_displayedFPS       = m_frameCountThisSecond;
     m_displayedFrameTime = m_frameTimeThisSecond;
+    if(!m_sharingModeToggled)
+      m_sharingModeFrameTimes[m_exclusiveSharing] = 1.0f / m_frameCountThisSecond;
+    m_sharingModeToggled = false;
 
     m_thisSecond           = int64_t(now);
     m_frameCountThisSecond = 1;
@@ -17,9 +17,13 @@
 #include "backends/imgui_impl_vulkan.h"
 #include "imgui_helper.h"
 
+#include "equation.hpp"
+
 #include "shaders/camera_transforms.h"
 #include "shaders/mcubes_params.h"
 
+struct McubesBakeKey;
+
 // This is the data stored behind the GLFW window's user pointer.
 // Simple container for ImGui stuff, useful only for my basic needs.
 // Unfortunately I couldn't initialize everything in a constructor for
@@ -42,11 +46,38 @@ class Gui
   int64_t m_thisSecond           = 0;
   double  m_lastUpdateTime       = 0;
 
+  // Mean frame time of the last full second spent in concurrent [0] and exclusive [1] sharing mode (see
+  // m_exclusiveSharing), for comparing them; a second in which the mode was toggled is not counted.
+  float m_sharingModeFrameTimes[2] = {};
+  bool  m_sharingModeToggled       = false;
+
   float m_colorByNormalAmount = 0.5f;
   float m_t                   = 0.0f;
   float m_tSliderMin          = 0.0f;
   float m_tSliderMax          = 1.0f;
   int   m_tMode;
+  int   m_bakeKeyframe = -1;  // Keyframe that m_t was snapped to by updateT, -1 if none.
+
+  // Values of the equation's user parameters a, b, c, d (McubesParams::userParams).
+  nvmath::vec4f m_userParams{1, 1, 1, 1};
+
+  // Values of the equation at which to extract surfaces (McubesParams::isoLevels), the first m_isoLevelCount used.
+  nvmath::vec4f m_isoLevels{0.0f, 0.1f, 0.2f, 0.3f};
+  int           m_isoLevelCount = 1;
+
+  // Newton steps refining vertices on the equation (McubesParams::newtonSteps); 0 for linear interpolation.
+  int m_newtonSteps = 1;
+
+  // Algorithm generating triangles from the image (McubesParams::mesher).
+  int m_mesher = MCUBES_MESHER_MARCHING_CUBES;
+
+  // Error bound, in cells, for decimating flat regions (McubesParams::decimateTolerance); 0 disables it.
+  float m_decimateTolerance = 0.0f;
+
+  // Instant CPU-side validation of the equation being typed; updated whenever the text changes.
+  std::string  m_validatedEquation;
+  std::string  m_equationError;  // Empty if the CPU-side parser understands the equation.
+  EquationCost m_equationCost{}, m_unoptimizedEquationCost{};
 
   bool m_wantOpenEquationHeader = false;
   bool m_wantFocusEquation      = false;
@@ -77,11 +108,25 @@ public:
   bool              m_vsync            = false;
   bool              m_guiVisible       = true;
   bool              m_wantComputeQueue = true;
+  bool              m_exclusiveSharing = false;  // See g_mcubesExclusiveSharing
+  bool              m_cpuMeshing       = false;  // Mesh a share of the chunks on the CPU, see mcubes_cpu_batch.hpp
+  bool              m_cpuBricks        = false;  // Sample the chunk images on the CPU, see mcubes_brick.hpp
+  bool              m_hasVolume        = false;  // A volume file was given on the command line, see volume_file.hpp
+  bool              m_meshVolume       = true;   // Mesh it instead of the equation
   bool              m_compileFailure   = false;
   bool              m_wantSetEquation  = false;
   std::vector<char> m_equationInput;
   int               m_batchSize;
   int               m_chunkDebugViewMode = 0;
+  int               m_renderMode         = 0;      // renderModeMesh; see renderModeLabels[] in gui.cpp
+  bool              m_cullChunks         = true;   // Skip chunks proven empty by interval arithmetic
+  bool              m_cullBlocks         = false;  // Same, for McubesGeometry blocks within each chunk
+  bool              m_skipCsgOperands    = true;   // Skip CSG operands proven not to affect a chunk
+  bool              m_separableTables    = true;   // Tabulate single-axis terms of the equation
+  int               m_symmetryMode       = 1;      // symmetryModeAuto; see mcubes_symmetry.hpp
+  bool              m_declaredMirror[3]  = {};     // For symmetryModeDeclared: mirror symmetric in x, y, z
+  bool              m_bakeKeyframes      = false;  // Replay periodic t modes from a keyframe cache
+  int               m_bakeKeyframeCount  = 32;     // Keyframes per period, see mcubes_bake.hpp
 
   // Do initialization that cannot be done in constructor, especially
   // recording commands for later execution.
@@ -103,12 +148,23 @@ public:
   // Get list of marching cubes jobs to run.
   std::vector<McubesParams> getMcubesJobs() const;
 
+  // Get the box in which the equation (or volume) is meshed.
+  void getBoundingBox(nvmath::vec3f* pLow, nvmath::vec3f* pHigh) const;
+
+  // Mesh the volume file by default, extracting the surface at the given iso-level first.
+  void setVolume(float isoLevel);
+
+  // If t is snapped to an animation keyframe this frame (see mcubes_bake.hpp), return true and
+  // the key and index of that keyframe.
+  bool getBakeKeyframe(McubesBakeKey* pKey, uint32_t* pKeyframe) const;
+
   // Reset camera position to defaults, sized for current bbox.
   void resetCamera();
 
 private:
   void focusIfFlag(bool* pFlag);
   void doEquationUI();
+  void validateEquation();
   void setEquation(const char* pEquation);
 #ifdef __linux__
   void equationPastePrimarySelection();
@@ -135,3 +191,14 @@ static constexpr int chunkDebugViewBounds = 1;
 static constexpr int chunkDebugViewBatch = 2;
 static constexpr int chunkDebugViewChunkIndex = 3;
 static constexpr int chunkDebugViewModeCount = 4;
+
+// Values for m_symmetryMode. See also symmetryModeLabels[] in gui.cpp
+static constexpr int symmetryModeOff      = 0;
+static constexpr int symmetryModeAuto     = 1;
+static constexpr int symmetryModeDeclared = 2;
+static constexpr int symmetryModeCount    = 3;
+
+// Values for m_renderMode. See also renderModeLabels[] in gui.cpp
+static constexpr int renderModeMesh     = 0;  // Extract and draw McubesGeometry
+static constexpr int renderModeRayMarch = 1;  // Ray march the chunk images directly (mcubes_ray_march.frag)
+static constexpr int renderModeCount    = 2;
@@ -0,0 +1,225 @@
+// Copyright 2021 NVIDIA CORPORATION
+// SPDX-License-Identifier: Apache-2.0
+#include "mcubes_bake.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <string.h>
+
+#include "nvvk/descriptorsets_vk.hpp"
+#include "nvvk/error_vk.hpp"
+
+#include "mcubes_brick.hpp"
+#include "timeline_semaphore_main.hpp"
+
+#include "shaders/mcubes_bake.h"
+
+McubesBakeStats       g_mcubesBakeStats;
+VkDescriptorSetLayout g_mcubesBakeDescriptorSetLayout;
+VkDescriptorSet       g_mcubesBakeDescriptorSet;
+nvvk::Buffer          g_mcubesBakeDrawBuffer;
+
+// Cache capacity: 64 MiB of cell headers, 96 MiB each of packed vertices and normals, and enough draws for
+// 64 keyframes of 32 chunks each.
+static const uint32_t bakeCellCapacity = (64u << 20) / sizeof(uint32_t);
+static const uint32_t bakeVertCapacity = (96u << 20) / sizeof(uint32_t);
+static const uint32_t bakeDrawCapacity = 2048u * MCUBES_GEOMETRIES_PER_CHUNK;
+
+static nvvk::Buffer      s_headerBuffer;  // Host-visible McubesBakeHeader
+static McubesBakeHeader* s_pMappedHeader;
+static nvvk::Buffer      s_cellBuffer;
+static nvvk::Buffer      s_vertBuffer;
+static nvvk::Buffer      s_normalBuffer;
+
+static nvvk::DescriptorSetContainer s_descriptorSetContainer;
+static uint32_t                     s_queueFamilies[2];  // To be filled in.
+
+static McubesBakeKey      s_key;
+static McubesBakeKeyframe s_keyframes[mcubesBakeMaxKeyframes];
+static uint32_t           s_drawCount = 0;  // McubesBakedDraw records allocated to keyframes so far.
+
+bool McubesBakeKey::operator==(const McubesBakeKey& other) const
+{
+  return tMode == other.tMode && keyframeCount == other.keyframeCount && jobs.size() == other.jobs.size()
+         && memcmp(jobs.data(), other.jobs.data(), jobs.size() * sizeof(McubesParams)) == 0;
+}
+
+void setupMcubesBake()
+{
+  // Set up descriptor set layout; written by mcubes_bake.comp, read by mcubes_geometry.vert.
+  s_descriptorSetContainer.init(g_ctx);
+  s_descriptorSetContainer.addBinding(MCUBES_BAKE_HEADER_BINDING, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1,
+                                      VK_SHADER_STAGE_ALL);
+  s_descriptorSetContainer.addBinding(MCUBES_BAKE_DRAWS_BINDING, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1,
+                                      VK_SHADER_STAGE_ALL);
+  s_descriptorSetContainer.addBinding(MCUBES_BAKE_CELLS_BINDING, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1,
+                                      VK_SHADER_STAGE_ALL);
+  s_descriptorSetContainer.addBinding(MCUBES_BAKE_VERTS_BINDING, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1,
+                                      VK_SHADER_STAGE_ALL);
+  s_descriptorSetContainer.addBinding(MCUBES_BAKE_NORMALS_BINDING, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1,
+                                      VK_SHADER_STAGE_ALL);
+  s_descriptorSetContainer.initLayout();
+  g_mcubesBakeDescriptorSetLayout = s_descriptorSetContainer.getLayout();
+
+  // Allocate buffers, shared between graphics and compute queues.
+  s_queueFamilies[0] = g_ctx.m_queueGCT.familyIndex;
+  s_queueFamilies[1] = g_ctx.m_queueC.familyIndex;
+  VkBufferCreateInfo bufferInfo{VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+                                nullptr,
+                                0,
+                                sizeof(McubesBakeHeader),
+                                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                VK_SHARING_MODE_CONCURRENT,
+                                2,
+                                s_queueFamilies};
+  s_headerBuffer =
+      g_allocator.createBuffer(bufferInfo, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+  s_pMappedHeader = static_cast<McubesBakeHeader*>(g_allocator.map(s_headerBuffer));
+  bufferInfo.size = VkDeviceSize(bakeDrawCapacity) * sizeof(McubesBakedDraw);
+  bufferInfo.usage |= VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT;  // Harmless for the other buffers
+  g_mcubesBakeDrawBuffer = g_allocator.createBuffer(bufferInfo);
+  bufferInfo.size        = VkDeviceSize(bakeCellCapacity) * sizeof(uint32_t);
+  s_cellBuffer           = g_allocator.createBuffer(bufferInfo);
+  bufferInfo.size        = VkDeviceSize(bakeVertCapacity) * sizeof(uint32_t);
+  s_vertBuffer           = g_allocator.createBuffer(bufferInfo);
+  s_normalBuffer         = g_allocator.createBuffer(bufferInfo);
+  mcubesBakeReset();
+
+  // Allocate and write the descriptor set.
+  s_descriptorSetContainer.initPool(1);
+  VkDescriptorBufferInfo headerRef{s_headerBuffer.buffer, 0, VK_WHOLE_SIZE};
+  VkDescriptorBufferInfo drawsRef{g_mcubesBakeDrawBuffer.buffer, 0, VK_WHOLE_SIZE};
+  VkDescriptorBufferInfo cellsRef{s_cellBuffer.buffer, 0, VK_WHOLE_SIZE};
+  VkDescriptorBufferInfo vertsRef{s_vertBuffer.buffer, 0, VK_WHOLE_SIZE};
+  VkDescriptorBufferInfo normalsRef{s_normalBuffer.buffer, 0, VK_WHOLE_SIZE};
+  VkWriteDescriptorSet   writes[5];
+  writes[0] = s_descriptorSetContainer.makeWrite(0, MCUBES_BAKE_HEADER_BINDING, &headerRef);
+  writes[1] = s_descriptorSetContainer.makeWrite(0, MCUBES_BAKE_DRAWS_BINDING, &drawsRef);
+  writes[2] = s_descriptorSetContainer.makeWrite(0, MCUBES_BAKE_CELLS_BINDING, &cellsRef);
+  writes[3] = s_descriptorSetContainer.makeWrite(0, MCUBES_BAKE_VERTS_BINDING, &vertsRef);
+  writes[4] = s_descriptorSetContainer.makeWrite(0, MCUBES_BAKE_NORMALS_BINDING, &normalsRef);
+  vkUpdateDescriptorSets(g_ctx, 5, writes, 0, nullptr);
+  g_mcubesBakeDescriptorSet = s_descriptorSetContainer.getSet(0);
+  assert(g_mcubesBakeDescriptorSet);
+}
+
+void shutdownMcubesBake()
+{
+  g_allocator.unmap(s_headerBuffer);
+  g_allocator.destroy(s_headerBuffer);
+  g_allocator.destroy(g_mcubesBakeDrawBuffer);
+  g_allocator.destroy(s_cellBuffer);
+  g_allocator.destroy(s_vertBuffer);
+  g_allocator.destroy(s_normalBuffer);
+  s_descriptorSetContainer.deinit();
+}
+
+static void updateBakeStats()
+{
+  g_mcubesBakeStats.readyCount  = 0;
+  g_mcubesBakeStats.failedCount = 0;
+  for(const McubesBakeKeyframe& keyframe : s_keyframes)
+  {
+    g_mcubesBakeStats.readyCount += keyframe.state == McubesBakeKeyframe::stateReady ? 1u : 0u;
+    g_mcubesBakeStats.failedCount += keyframe.state == McubesBakeKeyframe::stateFailed ? 1u : 0u;
+  }
+  uint32_t cellCount              = std::min(s_pMappedHeader->cellCount, bakeCellCapacity);
+  uint32_t vertCount              = std::min(s_pMappedHeader->vertCount, bakeVertCapacity);
+  g_mcubesBakeStats.usedBytes     = VkDeviceSize(cellCount + 2 * vertCount) * sizeof(uint32_t)
+                                    + VkDeviceSize(s_drawCount) * sizeof(McubesBakedDraw);
+  g_mcubesBakeStats.capacityBytes = VkDeviceSize(bakeCellCapacity + 2 * bakeVertCapacity) * sizeof(uint32_t)
+                                    + VkDeviceSize(bakeDrawCapacity) * sizeof(McubesBakedDraw);
+}
+
+McubesBakeFrame mcubesBakeUpdate(const McubesBakeKey&  key,
+                                 uint32_t              keyframe,
+                                 uint32_t              jobCount,
+                                 const McubesSymmetry& symmetry,
+                                 uint32_t              statsSlot)
+{
+  McubesBakeFrame result;
+  if(keyframe == ~0u)
+  {
+    g_mcubesBakeStats.keyframeCount = 0;
+    return result;
+  }
+  assert(keyframe < key.keyframeCount && key.keyframeCount <= mcubesBakeMaxKeyframes);
+
+  if(key != s_key)
+  {
+    if(s_drawCount != 0)
+    {
+      mcubesBrickWaitIdle();
+      vkDeviceWaitIdle(g_ctx);  // Commands reading or writing the cache may be in flight.
+    }
+    mcubesBakeReset();
+    s_key = key;
+    g_mcubesBakeStats.keyframeCount = key.keyframeCount;
+    g_mcubesBakeStats.missCount     = 1;
+    return result;
+  }
+
+  McubesBakeKeyframe& entry = s_keyframes[keyframe];
+  if(entry.state == McubesBakeKeyframe::stateReady)
+  {
+    ++g_mcubesBakeStats.hitCount;
+    result.pReplay = &entry;
+    return result;
+  }
+
+  ++g_mcubesBakeStats.missCount;
+  uint32_t drawCount = jobCount * MCUBES_GEOMETRIES_PER_CHUNK;
+  if(entry.state == McubesBakeKeyframe::stateEmpty)
+  {
+    if(s_drawCount + drawCount > bakeDrawCapacity)
+    {
+      entry.state = McubesBakeKeyframe::stateFailed;
+    }
+    else
+    {
+      entry.state      = McubesBakeKeyframe::statePending;
+      entry.firstDraw  = s_drawCount;
+      entry.chunkCount = jobCount;
+      entry.statsSlot  = statsSlot;
+      entry.symmetry   = symmetry;
+      s_drawCount += drawCount;
+      result.bake      = true;
+      result.firstDraw = entry.firstDraw;
+    }
+  }
+  updateBakeStats();
+  return result;
+}
+
+void mcubesBakeCollect(uint32_t statsSlot)
+{
+  assert(statsSlot < 2);
+  bool overflowed = s_pMappedHeader->overflowCount[statsSlot] != 0;
+  for(McubesBakeKeyframe& keyframe : s_keyframes)
+  {
+    if(keyframe.state == McubesBakeKeyframe::statePending && keyframe.statsSlot == statsSlot)
+    {
+      keyframe.state = overflowed ? McubesBakeKeyframe::stateFailed : McubesBakeKeyframe::stateReady;
+    }
+  }
+  s_pMappedHeader->overflowCount[statsSlot] = 0;
+  updateBakeStats();
+}
+
+void mcubesBakeReset()
+{
+  for(McubesBakeKeyframe& keyframe : s_keyframes)
+  {
+    keyframe = McubesBakeKeyframe{};
+  }
+  s_drawCount                   = 0;
+  s_key                         = McubesBakeKey{};
+  s_pMappedHeader->cellCount    = 0;
+  s_pMappedHeader->cellCapacity = bakeCellCapacity;
+  s_pMappedHeader->vertCount    = 0;
+  s_pMappedHeader->vertCapacity = bakeVertCapacity;
+  memset(s_pMappedHeader->overflowCount, 0, sizeof s_pMappedHeader->overflowCount);
+  g_mcubesBakeStats.hitCount  = 0;
+  g_mcubesBakeStats.missCount = 0;
+  updateBakeStats();
+}
@@ -0,0 +1,96 @@
+// Copyright 2021 NVIDIA CORPORATION
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+#include "nvvk/resourceallocator_vk.hpp"
+
+#include "mcubes_symmetry.hpp"
+
+#include "shaders/mcubes_params.h"
+
+// Animation keyframe cache: in the periodic t modes, t is snapped to one of N keyframes per period
+// (see Gui::getBakeKeyframe). The first time each keyframe is computed, mcubes_bake.comp compacts the
+// chunks' McubesGeometry arrays into a VRAM cache; afterwards the keyframe is drawn from the cache with
+// no compute at all. Any change of the jobs (other than t) or of the keyframe schedule empties the cache.
+
+// What the cached geometry depends on.
+struct McubesBakeKey
+{
+  std::vector<McubesParams> jobs;  // Unculled jobs, with McubesParams::t and statsSlot zeroed.
+  int                       tMode         = 0;
+  uint32_t                  keyframeCount = 0;
+
+  bool operator==(const McubesBakeKey& other) const;
+  bool operator!=(const McubesBakeKey& other) const { return !(*this == other); }
+};
+
+static const uint32_t mcubesBakeMaxKeyframes = 64;
+
+// One keyframe of the cache: chunkCount runs of MCUBES_GEOMETRIES_PER_CHUNK McubesBakedDraw records
+// starting at firstDraw, each drawn once per reflection listed in symmetry.
+struct McubesBakeKeyframe
+{
+  enum State
+  {
+    stateEmpty,
+    statePending,  // Compaction commands submitted with McubesParams::statsSlot == statsSlot.
+    stateReady,
+    stateFailed,  // Did not fit; always computed live until the cache is emptied.
+  };
+  State          state      = stateEmpty;
+  uint32_t       firstDraw  = 0;
+  uint32_t       chunkCount = 0;
+  uint32_t       statsSlot  = 0;
+  McubesSymmetry symmetry;
+};
+
+// What to do this frame, see mcubesBakeUpdate.
+struct McubesBakeFrame
+{
+  const McubesBakeKeyframe* pReplay   = nullptr;  // If not null, draw this instead of computing any chunk.
+  bool                      bake      = false;    // Otherwise, if set, compact the computed chunks into the cache:
+  uint32_t                  firstDraw = 0;        // job i at firstDraw + i * MCUBES_GEOMETRIES_PER_CHUNK.
+};
+
+struct McubesBakeStats
+{
+  uint32_t     keyframeCount;  // 0 if not baking.
+  uint32_t     readyCount;
+  uint32_t     failedCount;
+  uint64_t     hitCount;  // Frames drawn from the cache since it was last emptied.
+  uint64_t     missCount;
+  VkDeviceSize usedBytes;
+  VkDeviceSize capacityBytes;
+};
+extern McubesBakeStats g_mcubesBakeStats;
+
+// binding = MCUBES_BAKE_*_BINDING refer to the cache buffers (see shaders/mcubes_bake.h).
+extern VkDescriptorSetLayout g_mcubesBakeDescriptorSetLayout;
+extern VkDescriptorSet       g_mcubesBakeDescriptorSet;
+
+// The array of McubesBakedDraw, also bound at MCUBES_BAKE_DRAWS_BINDING; used as indirect draw buffer.
+extern nvvk::Buffer g_mcubesBakeDrawBuffer;
+
+void setupMcubesBake();
+void shutdownMcubesBake();
+
+// Decide whether to replay or bake the given keyframe, for the given key and (culled) number of jobs to
+// be computed, drawn with the given symmetry. Pass keyframe = ~0u when not baking.
+// Empties the cache (idling the device if it was in use) if the key changed since the previous call;
+// nothing is baked on such frames, so that dragging a GUI control does not stall every frame.
+McubesBakeFrame mcubesBakeUpdate(const McubesBakeKey&  key,
+                                 uint32_t              keyframe,
+                                 uint32_t              jobCount,
+                                 const McubesSymmetry& symmetry,
+                                 uint32_t              statsSlot);
+
+// Mark the keyframes baked with the given McubesParams::statsSlot as ready (or failed, if they overflowed).
+// Ensure that no commands baking with that statsSlot are pending, as for mcubesCollectBlockStats.
+void mcubesBakeCollect(uint32_t statsSlot);
+
+// Empty the cache. Ensure that no commands using it are pending.
+void mcubesBakeReset();
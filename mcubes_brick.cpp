@@ -0,0 +1,329 @@
+// Copyright 2021 NVIDIA CORPORATION
+// SPDX-License-Identifier: Apache-2.0
+#include "mcubes_brick.hpp"
+
+#include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+#include "nvvk/error_vk.hpp"
+
+#include "mcubes_cpu.hpp"
+#include "timeline_semaphore_main.hpp"
+
+McubesBrickStats g_mcubesBrickStats;
+
+// Each region holds the samples of one brick, then its block signatures.
+static const VkDeviceSize regionImageSize =
+    VkDeviceSize(MCUBES_CHUNK_EDGE_LENGTH_TEXELS) * MCUBES_CHUNK_EDGE_LENGTH_TEXELS * MCUBES_CHUNK_EDGE_LENGTH_TEXELS
+    * sizeof(float);
+static const VkDeviceSize regionSize = regionImageSize + MCUBES_GEOMETRIES_PER_CHUNK * sizeof(uint32_t);
+
+static nvvk::Buffer s_stagingBuffer;  // Host-visible, written by the brick thread. Null until the first launch.
+static char*        s_pMappedStaging;
+
+// With a transfer queue, the brick thread uploads each batch into a device-local copy of the ring, which the
+// compute queue then copies from. Each half has a command buffer, reused once the half's previous upload is done.
+static VkQueue         s_transferQueue;  // Null if none.
+static nvvk::Buffer    s_deviceBuffer;
+static VkCommandPool   s_transferPool;
+static VkCommandBuffer s_transferCmdBufs[2];
+
+// Batch of bricks for the brick thread.
+struct BrickBatch
+{
+  McubesBrickSource source;
+  uint32_t          count;
+  McubesParams      jobs[MCUBES_MAX_CHUNKS_PER_BATCH];
+  uint32_t          firstRegion;
+  VkSemaphore       readySemaphore;
+  uint64_t          readyValue;
+  VkSemaphore       reuseSemaphore;  // Wait for reuseSemaphore >= reuseValue before writing the regions.
+  uint64_t          reuseValue;
+  uint64_t          uploadedValue;  // With a transfer queue, readyValue of the previous batch in the same half.
+};
+
+// The batches are consumed in order, alternating between the two halves of the ring.
+static uint32_t    s_nextHalf;
+static VkSemaphore s_halfConsumedSemaphores[2];
+static uint64_t    s_halfConsumedValues[2];
+static uint64_t    s_halfReadyValues[2];
+
+// Protected by s_mutex.
+static std::mutex              s_mutex;
+static std::condition_variable s_wake;
+static std::condition_variable s_idle;  // Notified when the brick thread is done with a batch.
+static std::deque<BrickBatch>  s_batches;
+static bool                    s_busy;  // Brick thread running a batch taken off s_batches.
+static bool                    s_stop;
+static uint32_t                s_timedBrickCount;  // Bricks done since the last mcubesBrickCollectStats,
+static double                  s_sourceSeconds;    // and the time they took.
+static double                  s_stallSeconds;
+
+static std::thread s_brickThread;
+
+// Copy the batch's regions from the staging ring to the device-local one on the transfer queue, once the compute
+// queue is done with the latter, then signal the batch ready.
+static void submitUpload(const BrickBatch& batch)
+{
+  VkCommandBuffer          cmdBuf = s_transferCmdBufs[batch.firstRegion / MCUBES_MAX_CHUNKS_PER_BATCH];
+  VkCommandBufferBeginInfo beginInfo{VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO, nullptr,
+                                     VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT};
+  NVVK_CHECK(vkBeginCommandBuffer(cmdBuf, &beginInfo));
+  VkBufferCopy copy{batch.firstRegion * regionSize, batch.firstRegion * regionSize, batch.count * regionSize};
+  vkCmdCopyBuffer(cmdBuf, s_stagingBuffer.buffer, s_deviceBuffer.buffer, 1, &copy);
+  NVVK_CHECK(vkEndCommandBuffer(cmdBuf));
+
+  uint32_t                      waitCount    = batch.reuseSemaphore != VK_NULL_HANDLE ? 1u : 0u;
+  VkPipelineStageFlags          waitStage    = VK_PIPELINE_STAGE_TRANSFER_BIT;
+  VkTimelineSemaphoreSubmitInfo timelineInfo = {
+      VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO,
+      nullptr,
+      waitCount,
+      &batch.reuseValue,  // Compute queue done copying from the regions (semaphore set below).
+      1,
+      &batch.readyValue};
+  VkSubmitInfo submitInfo = {VK_STRUCTURE_TYPE_SUBMIT_INFO,
+                             &timelineInfo,  // Extension struct
+                             waitCount,
+                             &batch.reuseSemaphore,
+                             &waitStage,
+                             1,
+                             &cmdBuf,
+                             1,
+                             &batch.readySemaphore};
+  NVVK_CHECK(vkQueueSubmit(s_transferQueue, 1, &submitInfo, VkFence{}));
+}
+
+// Produce one batch of bricks and signal it.
+static void runBatch(const BrickBatch& batch)
+{
+  // Without a transfer queue, the compute queue copies straight from the staging regions, so wait for it to be
+  // done with them; otherwise, only the upload of the previous batch in this half needs to be done.
+  auto                start = std::chrono::steady_clock::now();
+  VkSemaphoreWaitInfo waitInfo{VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO, nullptr, 0, 1, &batch.reuseSemaphore,
+                               &batch.reuseValue};
+  if(s_transferQueue)
+  {
+    waitInfo.pSemaphores = &batch.readySemaphore;
+    waitInfo.pValues     = &batch.uploadedValue;
+  }
+  if(*waitInfo.pSemaphores != VK_NULL_HANDLE)
+  {
+    NVVK_CHECK(vkWaitSemaphoresKHR(g_ctx, &waitInfo, ~uint64_t(0)));  // or vkWaitSemaphores in Vulkan 1.2
+  }
+  auto stalled = std::chrono::steady_clock::now();
+
+  float*         ppImages[MCUBES_MAX_CHUNKS_PER_BATCH];
+  uint32_t*      ppSignatures[MCUBES_MAX_CHUNKS_PER_BATCH];
+  McubesCpuChunk chunks[MCUBES_MAX_CHUNKS_PER_BATCH];
+  for(uint32_t i = 0; i < batch.count; ++i)
+  {
+    char* pRegion   = s_pMappedStaging + (batch.firstRegion + i) * regionSize;
+    ppImages[i]     = reinterpret_cast<float*>(pRegion);
+    ppSignatures[i] = reinterpret_cast<uint32_t*>(pRegion + regionImageSize);
+    chunks[i]       = {batch.jobs[i], nullptr, ppImages[i], nullptr};
+  }
+  batch.source(batch.count, batch.jobs, ppImages);
+  mcubesCpuFillBlockSignatures(batch.count, chunks, ppSignatures);
+
+  if(s_transferQueue)
+  {
+    submitUpload(batch);
+  }
+  else
+  {
+    // Timeline semaphores, unlike binary ones, can be signaled from the host.
+    VkSemaphoreSignalInfo signalInfo{VK_STRUCTURE_TYPE_SEMAPHORE_SIGNAL_INFO, nullptr, batch.readySemaphore,
+                                     batch.readyValue};
+    NVVK_CHECK(vkSignalSemaphoreKHR(g_ctx, &signalInfo));  // or vkSignalSemaphore in Vulkan 1.2
+  }
+  auto done = std::chrono::steady_clock::now();
+
+  std::lock_guard<std::mutex> lock(s_mutex);
+  s_timedBrickCount += batch.count;
+  s_sourceSeconds += std::chrono::duration<double>(done - stalled).count();
+  s_stallSeconds += std::chrono::duration<double>(stalled - start).count();
+}
+
+static void brickThreadLoop()
+{
+  for(;;)
+  {
+    BrickBatch batch;
+    {
+      std::unique_lock<std::mutex> lock(s_mutex);
+      s_wake.wait(lock, [] { return s_stop || !s_batches.empty(); });
+      if(s_batches.empty())
+        return;  // Stopping, with all batches done.
+      batch = std::move(s_batches.front());
+      s_batches.pop_front();
+      s_busy = true;
+    }
+    runBatch(batch);
+    {
+      std::lock_guard<std::mutex> lock(s_mutex);
+      s_busy = false;
+    }
+    s_idle.notify_all();
+  }
+}
+
+void setupMcubesBricks()
+{
+  // The brick thread submits on its own, so it needs a transfer queue that no other thread uses.
+  s_transferQueue = g_ctx.m_queueT.queue;
+  if(s_transferQueue == g_computeQueue || s_transferQueue == g_gctQueue)
+    s_transferQueue = VK_NULL_HANDLE;
+}
+
+// Allocate the rings and start the brick thread, on the first launch: bricks are off by default.
+static void startBricks()
+{
+  // Allocate the staging ring, only used by the queue copying from it.
+  VkBufferCreateInfo bufferInfo{VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+                                nullptr,
+                                0,
+                                mcubesBrickRegionCount * regionSize,
+                                VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                                VK_SHARING_MODE_EXCLUSIVE,
+                                0,
+                                nullptr};
+  s_stagingBuffer =
+      g_allocator.createBuffer(bufferInfo, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+  s_pMappedStaging = static_cast<char*>(g_allocator.map(s_stagingBuffer));
+
+  if(s_transferQueue)
+  {
+    // The device-local ring is written by the transfer queue and read by the compute queue.
+    const uint32_t queueFamilies[2] = {g_ctx.m_queueT.familyIndex, g_ctx.m_queueC.familyIndex};
+    bufferInfo.usage                = VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    if(queueFamilies[0] != queueFamilies[1])
+    {
+      bufferInfo.sharingMode           = VK_SHARING_MODE_CONCURRENT;
+      bufferInfo.queueFamilyIndexCount = 2;
+      bufferInfo.pQueueFamilyIndices   = queueFamilies;
+    }
+    s_deviceBuffer = g_allocator.createBuffer(bufferInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+    VkCommandPoolCreateInfo poolInfo{VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO, nullptr,
+                                     VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT, g_ctx.m_queueT.familyIndex};
+    NVVK_CHECK(vkCreateCommandPool(g_ctx, &poolInfo, nullptr, &s_transferPool));
+    VkCommandBufferAllocateInfo cmdBufInfo{VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO, nullptr, s_transferPool,
+                                           VK_COMMAND_BUFFER_LEVEL_PRIMARY, 2};
+    NVVK_CHECK(vkAllocateCommandBuffers(g_ctx, &cmdBufInfo, s_transferCmdBufs));
+  }
+
+  s_stop        = false;
+  s_brickThread = std::thread(brickThreadLoop);
+}
+
+void shutdownMcubesBricks()
+{
+  if(!s_brickThread.joinable())
+    return;  // Never started.
+  {
+    std::lock_guard<std::mutex> lock(s_mutex);
+    s_stop = true;
+  }
+  s_wake.notify_all();
+  s_brickThread.join();
+  if(s_transferQueue)
+  {
+    NVVK_CHECK(vkQueueWaitIdle(s_transferQueue));
+    vkDestroyCommandPool(g_ctx, s_transferPool, nullptr);
+    g_allocator.destroy(s_deviceBuffer);
+  }
+  g_allocator.unmap(s_stagingBuffer);
+  g_allocator.destroy(s_stagingBuffer);
+}
+
+void mcubesBrickWaitIdle()
+{
+  std::unique_lock<std::mutex> lock(s_mutex);
+  s_idle.wait(lock, [] { return s_batches.empty() && !s_busy; });
+}
+
+bool mcubesBrickUsesTransferQueue()
+{
+  return s_transferQueue != VK_NULL_HANDLE;
+}
+
+VkBuffer mcubesBrickBuffer()
+{
+  return s_transferQueue ? s_deviceBuffer.buffer : s_stagingBuffer.buffer;
+}
+
+VkDeviceSize mcubesBrickImageOffset(uint32_t region)
+{
+  assert(region < mcubesBrickRegionCount);
+  return region * regionSize;
+}
+
+VkDeviceSize mcubesBrickSignatureOffset(uint32_t region)
+{
+  return mcubesBrickImageOffset(region) + regionImageSize;
+}
+
+void mcubesBrickLaunch(const McubesBrickSource& source,
+                       uint32_t                 count,
+                       const McubesParams*      pJobs,
+                       VkSemaphore              readySemaphore,
+                       uint64_t                 readyValue,
+                       VkSemaphore              consumedSemaphore,
+                       uint64_t                 consumedValue,
+                       uint32_t*                pRegions)
+{
+  assert(count != 0 && count <= MCUBES_MAX_CHUNKS_PER_BATCH);
+  if(!s_brickThread.joinable())
+    startBricks();
+
+  // The previous batch in this half of the ring was submitted before the caller got here, so the brick thread
+  // waits for a value that is already bound to be signaled.
+  BrickBatch batch;
+  batch.source         = source;
+  batch.count          = count;
+  batch.firstRegion    = s_nextHalf * MCUBES_MAX_CHUNKS_PER_BATCH;
+  batch.readySemaphore = readySemaphore;
+  batch.readyValue     = readyValue;
+  batch.reuseSemaphore = s_halfConsumedSemaphores[s_nextHalf];
+  batch.reuseValue     = s_halfConsumedValues[s_nextHalf];
+  batch.uploadedValue  = s_halfReadyValues[s_nextHalf];
+  for(uint32_t i = 0; i < count; ++i)
+  {
+    batch.jobs[i] = pJobs[i];
+    pRegions[i]   = batch.firstRegion + i;
+  }
+  s_halfConsumedSemaphores[s_nextHalf] = consumedSemaphore;
+  s_halfConsumedValues[s_nextHalf]     = consumedValue;
+  s_halfReadyValues[s_nextHalf]        = readyValue;
+  s_nextHalf ^= 1u;
+
+  {
+    std::lock_guard<std::mutex> lock(s_mutex);
+    s_batches.push_back(std::move(batch));
+  }
+  s_wake.notify_one();
+}
+
+// Fold total seconds over count bricks into a moving average.
+static void updateAverage(float* pAverage, double seconds, uint32_t count)
+{
+  float perBrick = float(seconds / count);
+  *pAverage      = *pAverage == 0.0f ? perBrick : *pAverage + 0.125f * (perBrick - *pAverage);
+}
+
+void mcubesBrickCollectStats()
+{
+  std::lock_guard<std::mutex> lock(s_mutex);
+  if(s_timedBrickCount == 0)
+    return;
+  updateAverage(&g_mcubesBrickStats.sourceSecondsPerBrick, s_sourceSeconds, s_timedBrickCount);
+  updateAverage(&g_mcubesBrickStats.stallSecondsPerBrick, s_stallSeconds, s_timedBrickCount);
+  s_timedBrickCount = 0;
+  s_sourceSeconds   = 0.0;
+  s_stallSeconds    = 0.0;
+}
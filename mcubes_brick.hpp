@@ -0,0 +1,73 @@
+// Copyright 2021 NVIDIA CORPORATION
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <functional>
+#include <stdint.h>
+#include <vulkan/vulkan.h>
+
+#include "mcubes_chunk.hpp"
+
+#include "shaders/mcubes_params.h"
+
+// Bricks: McubesChunk images produced on the CPU (simulation output, decoded volumes, ...) instead of by
+// mcubes_image.comp. A brick thread runs the source of each batch of bricks, which writes the samples straight
+// into a persistently mapped staging ring; the block signatures are computed from them into the same region.
+// The brick thread then signals a timeline semaphore from the host with vkSignalSemaphore, and the compute queue,
+// which waits for that value, copies the bricks into the McubesChunk images before meshing them (see
+// computeCmdFillChunkBatch). Commands can thus be submitted before their bricks exist, with no fence or queue
+// idle; the only host-side wait is the brick thread's, for the compute queue to be done with a staging region.
+//
+// If the device has a transfer queue of its own, the brick thread instead submits a copy of each batch to a
+// device-local ring on it, which signals the semaphore, and the compute queue copies from that ring. Uploads then
+// overlap meshing and drawing, and the brick thread only waits for the upload of the batch before last.
+
+// Fill ppImages[i] (MCUBES_CHUNK_EDGE_LENGTH_TEXELS^3 samples, x fastest, then y, then z) with the brick of
+// pJobs[i], for i < count. Runs on the brick thread.
+using McubesBrickSource = std::function<void(uint32_t count, const McubesParams* pJobs, float* const* ppImages)>;
+
+// The staging ring holds two batches of bricks.
+static const uint32_t mcubesBrickRegionCount = 2 * MCUBES_MAX_CHUNKS_PER_BATCH;
+
+// Moving averages for display, 0 until measured.
+struct McubesBrickStats
+{
+  float sourceSecondsPerBrick;  // In the source and computing the block signatures.
+  float stallSecondsPerBrick;   // Waiting for the staging region to be free.
+};
+extern McubesBrickStats g_mcubesBrickStats;
+
+// The rings are allocated and the brick thread started by the first mcubesBrickLaunch.
+void setupMcubesBricks();
+void shutdownMcubesBricks();  // Waits for the brick thread to finish its batches, which needs their waits satisfied.
+
+// Wait for the brick thread to finish the batches launched so far, leaving it parked until the next launch. Call
+// before vkDeviceWaitIdle, which must not run while the brick thread submits uploads to the transfer queue. Like
+// shutdownMcubesBricks, needs the waits of those batches satisfied, i.e. their previous commands submitted.
+void mcubesBrickWaitIdle();
+
+// Whether uploads run (or would run) on the transfer queue.
+bool mcubesBrickUsesTransferQueue();
+
+// Location of brick region's samples and block signatures (MCUBES_GEOMETRIES_PER_CHUNK uints) in the ring that the
+// compute queue copies from: the staging ring, or the device-local one. Only valid after mcubesBrickLaunch.
+VkBuffer     mcubesBrickBuffer();
+VkDeviceSize mcubesBrickImageOffset(uint32_t region);
+VkDeviceSize mcubesBrickSignatureOffset(uint32_t region);
+
+// Queue a batch of count bricks (at most MCUBES_MAX_CHUNKS_PER_BATCH), of the given jobs, for the brick thread,
+// writing the staging region of brick i to pRegions[i]. Their commands must signal
+// consumedSemaphore := consumedValue once done copying the bricks: the brick thread (or its upload) waits for that
+// before overwriting the regions with the next batch but one. It signals readySemaphore := readyValue (greater than for
+// the previous batch) once the bricks are staged. Call after submitting the commands of the previous batch.
+void mcubesBrickLaunch(const McubesBrickSource& source,
+                       uint32_t                 count,
+                       const McubesParams*      pJobs,
+                       VkSemaphore              readySemaphore,
+                       uint64_t                 readyValue,
+                       VkSemaphore              consumedSemaphore,
+                       uint64_t                 consumedValue,
+                       uint32_t*                pRegions);
+
+// Fold the brick thread's latest timings into g_mcubesBrickStats.
+void mcubesBrickCollectStats();
@@ -2,7 +2,10 @@
 // SPDX-License-Identifier: Apache-2.0
 #include "mcubes_chunk.hpp"
 
+#include <algorithm>
 #include <cassert>
+#include <stdio.h>
+#include <string.h>
 
 #include "nvvk/descriptorsets_vk.hpp"
 #include "nvvk/error_vk.hpp"
@@ -14,11 +17,25 @@
 
 McubesChunk           g_mcubesChunkArray[MCUBES_CHUNK_COUNT];
 VkDescriptorSetLayout g_mcubesChunkDescriptorSetLayout;
+McubesBlockStats      g_mcubesBlockStats;
+bool                  g_mcubesExclusiveSharing = false;
+
+// Host-visible array of 2 McubesBlockStats, shared by all McubesChunk.
+static nvvk::Buffer      s_blockStatsBuffer;
+static McubesBlockStats* s_pMappedBlockStats;
 
 static nvvk::DescriptorSetContainer s_descriptorSetContainer;
 static uint32_t                     s_queueFamilies[2];  // To be filled in.
 
-// Structs used to create McubesChunk::image and McubesChunk::geometryArrayBuffer.
+// Memory of the image pool, MCUBES_IMAGE_POOL_SIZE slots of s_imagePoolSlotSize bytes. Null if the images
+// cannot alias; each McubesChunk::image then has its own McubesChunk::imageMemory.
+static nvvk::MemHandle s_imagePoolMemory;
+static VkDeviceSize    s_imagePoolSlotSize;
+
+// Structs used to create McubesChunk::image and McubesChunk::geometryArrayBuffer. The image is only used
+// by the queue doing compute; McubesChunk::rayMarchImage is the same, but shared with the graphics queue.
+// The buffer is shared too, concurrently unless g_mcubesExclusiveSharing (see sharedBufferInfo).
+// Images are copied to when filled from bricks produced on the CPU (see mcubes_brick.hpp).
 static const VkImageCreateInfo  mcubesImageInfo{VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
                                                nullptr,
                                                0,
@@ -30,10 +47,10 @@ static const VkImageCreateInfo  mcubesImageInfo{VK_STRUCTURE_TYPE_IMAGE_CREATE_I
                                                1,
                                                VK_SAMPLE_COUNT_1_BIT,
                                                VK_IMAGE_TILING_OPTIMAL,
-                                               VK_IMAGE_USAGE_STORAGE_BIT,
+                                               VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
                                                VK_SHARING_MODE_EXCLUSIVE,
                                                0,
-                                               0,
+                                               nullptr,
                                                VK_IMAGE_LAYOUT_UNDEFINED};
 static const VkBufferCreateInfo mcubesBufferInfo{VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
                                                  nullptr,
@@ -44,6 +61,234 @@ static const VkBufferCreateInfo mcubesBufferInfo{VK_STRUCTURE_TYPE_BUFFER_CREATE
                                                  VK_SHARING_MODE_CONCURRENT,
                                                  2,
                                                  s_queueFamilies};
+// Only used by the queue doing compute, and fully overwritten each time the McubesChunk is filled.
+static const VkBufferCreateInfo emptyBlockMaskBufferInfo{VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+                                                         nullptr,
+                                                         0,
+                                                         MCUBES_BLOCK_MASK_WORDS * sizeof(uint32_t),
+                                                         VK_BUFFER_USAGE_STORAGE_BUFFER_BIT
+                                                             | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                                         VK_SHARING_MODE_EXCLUSIVE,
+                                                         0,
+                                                         nullptr};
+// Cleared each time the McubesChunk is filled; also read by the graphics queue when ray marching.
+static const VkBufferCreateInfo blockSignatureBufferInfo{VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+                                                         nullptr,
+                                                         0,
+                                                         MCUBES_GEOMETRIES_PER_CHUNK * sizeof(uint32_t),
+                                                         VK_BUFFER_USAGE_STORAGE_BUFFER_BIT
+                                                             | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                                         VK_SHARING_MODE_CONCURRENT,
+                                                         2,
+                                                         s_queueFamilies};
+// Written by whichever queue does compute; read and reset by the host.
+static const VkBufferCreateInfo blockStatsBufferInfo{VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+                                                     nullptr,
+                                                     0,
+                                                     2 * sizeof(McubesBlockStats),
+                                                     VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                                     VK_SHARING_MODE_CONCURRENT,
+                                                     2,
+                                                     s_queueFamilies};
+
+// Returns the create info of a buffer shared by the compute and graphics queues, in the current sharing mode.
+static VkBufferCreateInfo sharedBufferInfo(VkBufferCreateInfo bufferInfo)
+{
+  if(g_mcubesExclusiveSharing)
+  {
+    bufferInfo.sharingMode           = VK_SHARING_MODE_EXCLUSIVE;
+    bufferInfo.queueFamilyIndexCount = 0;
+    bufferInfo.pQueueFamilyIndices   = nullptr;
+  }
+  return bufferInfo;
+}
+
+// Memory requirements of a resource, and whether the driver prefers or requires it to have memory of its own.
+// Resources requiring that cannot alias memory with other resources.
+struct ResourceRequirements
+{
+  VkMemoryRequirements memory;
+  bool                 prefersDedicated;
+  bool                 requiresDedicated;
+};
+
+static ResourceRequirements getBufferRequirements(VkBuffer buffer)
+{
+  VkMemoryDedicatedRequirements   dedicated{VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS};
+  VkMemoryRequirements2           requirements{VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2, &dedicated};
+  VkBufferMemoryRequirementsInfo2 info{VK_STRUCTURE_TYPE_BUFFER_MEMORY_REQUIREMENTS_INFO_2, nullptr, buffer};
+  vkGetBufferMemoryRequirements2(g_ctx, &info, &requirements);
+  return {requirements.memoryRequirements, dedicated.prefersDedicatedAllocation == VK_TRUE,
+          dedicated.requiresDedicatedAllocation == VK_TRUE};
+}
+
+static ResourceRequirements getImageRequirements(VkImage image)
+{
+  VkMemoryDedicatedRequirements  dedicated{VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS};
+  VkMemoryRequirements2          requirements{VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2, &dedicated};
+  VkImageMemoryRequirementsInfo2 info{VK_STRUCTURE_TYPE_IMAGE_MEMORY_REQUIREMENTS_INFO_2, nullptr, image};
+  vkGetImageMemoryRequirements2(g_ctx, &info, &requirements);
+  return {requirements.memoryRequirements, dedicated.prefersDedicatedAllocation == VK_TRUE,
+          dedicated.requiresDedicatedAllocation == VK_TRUE};
+}
+
+// Allocate device-local memory satisfying all the given requirements, so that the resources can alias it.
+// Returns a null handle if they cannot: if any of them requires dedicated memory, if no memory type suits all
+// of them, or if the allocation fails. The caller then allocates memory per resource (see allocOwnMemory).
+// The reason is printed once per *pDidWarning.
+static nvvk::MemHandle allocAliasedMemory(uint32_t                    count,
+                                          const ResourceRequirements* pRequirements,
+                                          const char*                 pWhat,
+                                          bool*                       pDidWarning)
+{
+  const char* pReason = nullptr;
+
+  VkMemoryRequirements combined{0, 1, ~0u};
+  for(uint32_t i = 0; i < count; ++i)
+  {
+    const VkMemoryRequirements& memory = pRequirements[i].memory;
+    combined.size                      = std::max(combined.size, memory.size);
+    combined.alignment                 = std::max(combined.alignment, memory.alignment);
+    combined.memoryTypeBits &= memory.memoryTypeBits;
+    if(pRequirements[i].requiresDedicated)
+      pReason = "the driver requires dedicated memory";
+  }
+  if(pReason == nullptr && combined.memoryTypeBits == 0)
+    pReason = "no memory type suits all of them";
+
+  nvvk::MemHandle handle = nullptr;
+  if(pReason == nullptr)
+  {
+    nvvk::MemAllocateInfo allocInfo(combined, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, true);
+    handle = g_allocator.getMemoryAllocator()->allocMemory(allocInfo);
+    if(!handle)
+      pReason = "allocation failed";
+  }
+  if(pReason != nullptr && !*pDidWarning)
+  {
+    fprintf(stderr, "%s:%i \x1b[35m\x1b[1mWARNING:\x1b[0m Not aliasing the memory of %s, %s\n", __FILE__,
+            __LINE__, pWhat, pReason);
+    *pDidWarning = true;
+  }
+  return handle;
+}
+
+// Allocate device-local memory for the buffer or the image only, dedicated if the driver prefers that.
+// Failure is fatal, as for the resources that g_allocator creates.
+static nvvk::MemHandle allocOwnMemory(const ResourceRequirements& requirements, VkBuffer buffer, VkImage image)
+{
+  nvvk::MemAllocateInfo allocInfo(requirements.memory, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, image != VK_NULL_HANDLE);
+  if(requirements.prefersDedicated || requirements.requiresDedicated)
+  {
+    if(buffer != VK_NULL_HANDLE)
+      allocInfo.setDedicatedBuffer(buffer);
+    else
+      allocInfo.setDedicatedImage(image);
+  }
+  VkResult        result = VK_SUCCESS;
+  nvvk::MemHandle handle = g_allocator.getMemoryAllocator()->allocMemory(allocInfo, &result);
+  if(!handle && result == VK_SUCCESS)
+    result = VK_ERROR_OUT_OF_DEVICE_MEMORY;
+  NVVK_CHECK(result);
+  return handle;
+}
+
+// Bind the image to the given memory (not owned by the image).
+static void bindImage(VkImage image, nvvk::MemHandle memory, VkDeviceSize offset)
+{
+  nvvk::MemAllocator::MemInfo memInfo = g_allocator.getMemoryAllocator()->getMemoryInfo(memory);
+  NVVK_CHECK(vkBindImageMemory(g_ctx, image, memInfo.memory, memInfo.offset + offset));
+}
+
+static const VkImageViewCreateInfo mcubesImageViewInfo{VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+                                                      nullptr,
+                                                      0,
+                                                      VK_NULL_HANDLE,
+                                                      VK_IMAGE_VIEW_TYPE_3D,
+                                                      mcubesImageInfo.format,
+                                                      {},  // Identity rgba swizzle
+                                                      {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1}};
+
+// Create the resources of the chunk that the graphics queue reads, which depend on g_mcubesExclusiveSharing.
+static void createSharedChunkResources(McubesChunk& chunk)
+{
+  VkImageCreateInfo rayMarchImageInfo     = mcubesImageInfo;
+  rayMarchImageInfo.sharingMode           = VK_SHARING_MODE_CONCURRENT;
+  rayMarchImageInfo.queueFamilyIndexCount = 2;
+  rayMarchImageInfo.pQueueFamilyIndices   = s_queueFamilies;
+  VkBufferCreateInfo geometryBufferInfo   = sharedBufferInfo(mcubesBufferInfo);
+
+  // The geometry buffer owns the memory it shares with the ray marching image, if they can alias.
+  NVVK_CHECK(vkCreateBuffer(g_ctx, &geometryBufferInfo, nullptr, &chunk.geometryArrayBuffer.buffer));
+  NVVK_CHECK(vkCreateImage(g_ctx, &rayMarchImageInfo, nullptr, &chunk.rayMarchImage));
+  ResourceRequirements geometryRequirements[2] = {getBufferRequirements(chunk.geometryArrayBuffer.buffer),
+                                                  getImageRequirements(chunk.rayMarchImage)};
+  static bool     didWarning     = false;
+  nvvk::MemHandle geometryMemory = allocAliasedMemory(2, geometryRequirements, "geometry buffers and images",
+                                                      &didWarning);
+  chunk.rayMarchImageMemory = nullptr;
+  if(!geometryMemory)
+  {
+    geometryMemory = allocOwnMemory(geometryRequirements[0], chunk.geometryArrayBuffer.buffer, VK_NULL_HANDLE);
+    chunk.rayMarchImageMemory = allocOwnMemory(geometryRequirements[1], VK_NULL_HANDLE, chunk.rayMarchImage);
+  }
+  nvvk::MemAllocator::MemInfo memInfo = g_allocator.getMemoryAllocator()->getMemoryInfo(geometryMemory);
+  NVVK_CHECK(vkBindBufferMemory(g_ctx, chunk.geometryArrayBuffer.buffer, memInfo.memory, memInfo.offset));
+  chunk.geometryArrayBuffer.memHandle = geometryMemory;  // Freed by g_allocator.destroy
+  bindImage(chunk.rayMarchImage, chunk.rayMarchImageMemory ? chunk.rayMarchImageMemory : geometryMemory, 0);
+
+  VkImageViewCreateInfo viewInfo = mcubesImageViewInfo;
+  viewInfo.image                 = chunk.rayMarchImage;
+  NVVK_CHECK(vkCreateImageView(g_ctx, &viewInfo, nullptr, &chunk.rayMarchImageView));
+
+  chunk.blockSignatureBuffer = g_allocator.createBuffer(sharedBufferInfo(blockSignatureBufferInfo));
+}
+
+static void destroySharedChunkResources(McubesChunk& chunk)
+{
+  vkDestroyImageView(g_ctx, chunk.rayMarchImageView, nullptr);
+  vkDestroyImage(g_ctx, chunk.rayMarchImage, nullptr);
+  g_allocator.destroy(chunk.geometryArrayBuffer);  // Also frees the memory of rayMarchImage if aliased
+  if(chunk.rayMarchImageMemory)
+  {
+    g_allocator.getMemoryAllocator()->freeMemory(chunk.rayMarchImageMemory);
+    chunk.rayMarchImageMemory = nullptr;
+  }
+  g_allocator.destroy(chunk.blockSignatureBuffer);
+}
+
+// Point the descriptor sets at the resources of the chunks; set i uses McubesChunk::image, set
+// MCUBES_CHUNK_COUNT + i McubesChunk::rayMarchImage (for chunk i).
+static void writeChunkDescriptorSets()
+{
+  for(uint32_t setIndex = 0; setIndex < 2 * MCUBES_CHUNK_COUNT; ++setIndex)
+  {
+    McubesChunk&         chunk    = g_mcubesChunkArray[setIndex % MCUBES_CHUNK_COUNT];
+    bool                 rayMarch = setIndex >= MCUBES_CHUNK_COUNT;
+    VkWriteDescriptorSet writes[5];
+
+    // Image descriptor
+    VkDescriptorImageInfo imageRef{VK_NULL_HANDLE, rayMarch ? chunk.rayMarchImageView : chunk.imageView,
+                                   VK_IMAGE_LAYOUT_GENERAL};
+    writes[0] = s_descriptorSetContainer.makeWrite(setIndex, MCUBES_IMAGE_BINDING, &imageRef);
+
+    // McubesGeometry Buffer
+    VkDescriptorBufferInfo bufferRef{chunk.geometryArrayBuffer.buffer, 0, mcubesBufferInfo.size};
+    writes[1] = s_descriptorSetContainer.makeWrite(setIndex, MCUBES_GEOMETRY_BINDING, &bufferRef);
+
+    // Empty block mask Buffer
+    VkDescriptorBufferInfo maskRef{chunk.emptyBlockMaskBuffer.buffer, 0, emptyBlockMaskBufferInfo.size};
+    writes[2] = s_descriptorSetContainer.makeWrite(setIndex, MCUBES_BLOCK_MASK_BINDING, &maskRef);
+
+    // Block signature and stats Buffers
+    VkDescriptorBufferInfo signatureRef{chunk.blockSignatureBuffer.buffer, 0, blockSignatureBufferInfo.size};
+    writes[3] = s_descriptorSetContainer.makeWrite(setIndex, MCUBES_BLOCK_SIGNATURE_BINDING, &signatureRef);
+    VkDescriptorBufferInfo statsRef{s_blockStatsBuffer.buffer, 0, blockStatsBufferInfo.size};
+    writes[4] = s_descriptorSetContainer.makeWrite(setIndex, MCUBES_BLOCK_STATS_BINDING, &statsRef);
+
+    vkUpdateDescriptorSets(g_ctx, 5, writes, 0, nullptr);
+  }
+}
 
 void setupMcubesChunks()
 {
@@ -52,60 +297,164 @@ void setupMcubesChunks()
   s_descriptorSetContainer.addBinding(MCUBES_IMAGE_BINDING, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1, VK_SHADER_STAGE_ALL);
   s_descriptorSetContainer.addBinding(MCUBES_GEOMETRY_BINDING, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1,
                                       VK_SHADER_STAGE_ALL);
+  s_descriptorSetContainer.addBinding(MCUBES_BLOCK_MASK_BINDING, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1,
+                                      VK_SHADER_STAGE_COMPUTE_BIT);
+  s_descriptorSetContainer.addBinding(MCUBES_BLOCK_SIGNATURE_BINDING, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1,
+                                      VK_SHADER_STAGE_ALL);
+  s_descriptorSetContainer.addBinding(MCUBES_BLOCK_STATS_BINDING, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1,
+                                      VK_SHADER_STAGE_COMPUTE_BIT);
   s_descriptorSetContainer.initLayout();
   g_mcubesChunkDescriptorSetLayout = s_descriptorSetContainer.getLayout();
 
-  // Allocate images and buffers. The buffers need to be shared between graphics and compute queues.
+  // Allocate images and buffers. Most buffers need to be shared between graphics and compute queues.
   s_queueFamilies[0] = g_ctx.m_queueGCT.familyIndex;
   s_queueFamilies[1] = g_ctx.m_queueC.familyIndex;
-  for(uint32_t i = 0; i < MCUBES_CHUNK_COUNT; ++i)
-  {
-    g_mcubesChunkArray[i].image               = g_allocator.createImage(mcubesImageInfo);
-    g_mcubesChunkArray[i].geometryArrayBuffer = g_allocator.createBuffer(mcubesBufferInfo);
-  }
 
-  // Allocate image views and descriptor sets.
-  s_descriptorSetContainer.initPool(MCUBES_CHUNK_COUNT);
-  VkImageViewCreateInfo viewInfo{VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
-                                 nullptr,
-                                 0,
-                                 VK_NULL_HANDLE,
-                                 VK_IMAGE_VIEW_TYPE_3D,
-                                 mcubesImageInfo.format,
-                                 {},  // Identity rgba swizzle
-                                 VK_IMAGE_ASPECT_COLOR_BIT,
-                                 0,
-                                 1,
-                                 0,
-                                 1};
+  // Image pool. Images with the same create info have the same memory requirements, so query them once.
+  VkImage probeImage;
+  NVVK_CHECK(vkCreateImage(g_ctx, &mcubesImageInfo, nullptr, &probeImage));
+  ResourceRequirements poolRequirements = getImageRequirements(probeImage);
+  vkDestroyImage(g_ctx, probeImage, nullptr);
+  VkDeviceSize alignment       = poolRequirements.memory.alignment;
+  s_imagePoolSlotSize          = (poolRequirements.memory.size + alignment - 1) / alignment * alignment;
+  poolRequirements.memory.size = s_imagePoolSlotSize * MCUBES_IMAGE_POOL_SIZE;
+  bool didWarning              = false;
+  s_imagePoolMemory            = allocAliasedMemory(1, &poolRequirements, "chunk images", &didWarning);
+
   for(uint32_t i = 0; i < MCUBES_CHUNK_COUNT; ++i)
   {
-    VkWriteDescriptorSet writes[2];
+    McubesChunk& chunk = g_mcubesChunkArray[i];
+    VkDeviceSize slot  = i % MCUBES_IMAGE_POOL_SIZE;
+    NVVK_CHECK(vkCreateImage(g_ctx, &mcubesImageInfo, nullptr, &chunk.image));
+    if(s_imagePoolMemory)
+    {
+      bindImage(chunk.image, s_imagePoolMemory, slot * s_imagePoolSlotSize);
+    }
+    else
+    {
+      chunk.imageMemory = allocOwnMemory(getImageRequirements(chunk.image), VK_NULL_HANDLE, chunk.image);
+      bindImage(chunk.image, chunk.imageMemory, 0);
+    }
 
-    // Image View + descriptor
-    viewInfo.image = g_mcubesChunkArray[i].image.image;
-    NVVK_CHECK(vkCreateImageView(g_ctx, &viewInfo, nullptr, &g_mcubesChunkArray[i].imageView));
-    VkDescriptorImageInfo imageRef{VK_NULL_HANDLE, g_mcubesChunkArray[i].imageView, VK_IMAGE_LAYOUT_GENERAL};
-    writes[0] = s_descriptorSetContainer.makeWrite(i, MCUBES_IMAGE_BINDING, &imageRef);
+    VkImageViewCreateInfo viewInfo = mcubesImageViewInfo;
+    viewInfo.image                 = chunk.image;
+    NVVK_CHECK(vkCreateImageView(g_ctx, &viewInfo, nullptr, &chunk.imageView));
 
-    // McubesGeometry Buffer
-    VkDescriptorBufferInfo bufferRef{g_mcubesChunkArray[i].geometryArrayBuffer.buffer, 0, mcubesBufferInfo.size};
-    writes[1] = s_descriptorSetContainer.makeWrite(i, MCUBES_GEOMETRY_BINDING, &bufferRef);
+    createSharedChunkResources(chunk);
+    chunk.emptyBlockMaskBuffer = g_allocator.createBuffer(emptyBlockMaskBufferInfo);
+  }
+  s_blockStatsBuffer = g_allocator.createBuffer(blockStatsBufferInfo, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT
+                                                                          | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+  s_pMappedBlockStats = static_cast<McubesBlockStats*>(g_allocator.map(s_blockStatsBuffer));
+  memset(s_pMappedBlockStats, 0, blockStatsBufferInfo.size);
 
-    // Get descriptor set
-    vkUpdateDescriptorSets(g_ctx, 2, writes, 0, nullptr);
-    g_mcubesChunkArray[i].set = s_descriptorSetContainer.getSet(i);
-    assert(g_mcubesChunkArray[i].set);
+  // Allocate and write descriptor sets.
+  s_descriptorSetContainer.initPool(2 * MCUBES_CHUNK_COUNT);
+  for(uint32_t i = 0; i < MCUBES_CHUNK_COUNT; ++i)
+  {
+    g_mcubesChunkArray[i].set         = s_descriptorSetContainer.getSet(i);
+    g_mcubesChunkArray[i].rayMarchSet = s_descriptorSetContainer.getSet(MCUBES_CHUNK_COUNT + i);
+    assert(g_mcubesChunkArray[i].set && g_mcubesChunkArray[i].rayMarchSet);
   }
+  writeChunkDescriptorSets();
 }
 
 void shutdownMcubesChunks()
 {
   for(uint32_t i = 0; i < MCUBES_CHUNK_COUNT; ++i)
   {
+    destroySharedChunkResources(g_mcubesChunkArray[i]);
     vkDestroyImageView(g_ctx, g_mcubesChunkArray[i].imageView, nullptr);
-    g_allocator.destroy(g_mcubesChunkArray[i].image);
-    g_allocator.destroy(g_mcubesChunkArray[i].geometryArrayBuffer);
+    vkDestroyImage(g_ctx, g_mcubesChunkArray[i].image, nullptr);
+    if(g_mcubesChunkArray[i].imageMemory)
+    {
+      g_allocator.getMemoryAllocator()->freeMemory(g_mcubesChunkArray[i].imageMemory);
+      g_mcubesChunkArray[i].imageMemory = nullptr;
+    }
+    g_allocator.destroy(g_mcubesChunkArray[i].emptyBlockMaskBuffer);
   }
+  if(s_imagePoolMemory)
+  {
+    g_allocator.getMemoryAllocator()->freeMemory(s_imagePoolMemory);
+    s_imagePoolMemory = nullptr;
+  }
+  g_allocator.unmap(s_blockStatsBuffer);
+  g_allocator.destroy(s_blockStatsBuffer);
   s_descriptorSetContainer.deinit();
 }
+
+void mcubesSetExclusiveSharing(bool exclusive)
+{
+  if(exclusive == g_mcubesExclusiveSharing)
+    return;
+  for(McubesChunk& chunk : g_mcubesChunkArray)
+  {
+    destroySharedChunkResources(chunk);
+  }
+  g_mcubesExclusiveSharing = exclusive;
+  for(McubesChunk& chunk : g_mcubesChunkArray)
+  {
+    createSharedChunkResources(chunk);
+  }
+  writeChunkDescriptorSets();
+}
+
+// Ownership transfer barriers, from the compute to the graphics queue family, for the buffers of the chunks
+// that the graphics queue reads in the given render mode. Without a release back to the compute queue: it
+// takes ownership implicitly, which leaves the contents undefined. That is fine as the compute queue never reads
+// what an earlier fill left. Each fill (or upload) first clears or copies all block signatures and writes every
+// McubesGeometry's counts; the decimation and bake passes only read the cells and vertices those counts cover.
+// The bake pass also copies the origin and scale of empty McubesGeometry, which its draws never use.
+static void cmdTransferChunkBatch(VkCommandBuffer      cmdBuf,
+                                  uint32_t             count,
+                                  McubesChunk* const*  ppChunks,
+                                  bool                 rayMarch,
+                                  VkPipelineStageFlags srcStages,
+                                  VkAccessFlags        srcAccess,
+                                  VkPipelineStageFlags dstStages,
+                                  VkAccessFlags        dstAccess)
+{
+  assert(count <= MCUBES_MAX_CHUNKS_PER_BATCH);
+  if(!g_mcubesExclusiveSharing || count == 0 || s_queueFamilies[0] == s_queueFamilies[1])
+    return;
+  VkBufferMemoryBarrier barriers[MCUBES_MAX_CHUNKS_PER_BATCH];
+  for(uint32_t i = 0; i < count; ++i)
+  {
+    const McubesChunk& chunk        = *ppChunks[i];
+    barriers[i].sType               = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    barriers[i].pNext               = nullptr;
+    barriers[i].srcAccessMask       = srcAccess;
+    barriers[i].dstAccessMask       = dstAccess;
+    barriers[i].srcQueueFamilyIndex = s_queueFamilies[1];
+    barriers[i].dstQueueFamilyIndex = s_queueFamilies[0];
+    barriers[i].buffer              = rayMarch ? chunk.blockSignatureBuffer.buffer : chunk.geometryArrayBuffer.buffer;
+    barriers[i].offset              = 0;
+    barriers[i].size                = VK_WHOLE_SIZE;
+  }
+  vkCmdPipelineBarrier(cmdBuf, srcStages, dstStages, 0, 0, nullptr, count, barriers, 0, nullptr);
+}
+
+void mcubesCmdReleaseChunkBatch(VkCommandBuffer cmdBuf, uint32_t count, McubesChunk* const* ppChunks, bool rayMarch)
+{
+  // Access and destination stage masks are ignored by the release.
+  cmdTransferChunkBatch(cmdBuf, count, ppChunks, rayMarch, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                        VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0);
+}
+
+void mcubesCmdAcquireChunkBatch(VkCommandBuffer      cmdBuf,
+                                uint32_t             count,
+                                McubesChunk* const*  ppChunks,
+                                bool                 rayMarch,
+                                VkPipelineStageFlags dstStages)
+{
+  // Source stages match the semaphore wait, so that the acquire happens after the release.
+  cmdTransferChunkBatch(cmdBuf, count, ppChunks, rayMarch, dstStages, 0, dstStages,
+                        VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT);
+}
+
+void mcubesCollectBlockStats(uint32_t statsSlot)
+{
+  assert(statsSlot < 2);
+  g_mcubesBlockStats             = s_pMappedBlockStats[statsSlot];
+  s_pMappedBlockStats[statsSlot] = McubesBlockStats{};
+}
@@ -6,6 +6,8 @@
 
 #include "nvvk/resourceallocator_vk.hpp"
 
+#include "shaders/mcubes_params.h"
+
 // Maximum number of McubesChunk structs to compute or draw per command buffer.
 #define MCUBES_MAX_CHUNKS_PER_BATCH 6
 
@@ -13,13 +15,38 @@
 // Balance between avoiding synchronization stalls (if too low) and VRAM exhaustion (if too high).
 #define MCUBES_CHUNK_COUNT 12
 
+// Memory for the 3D images of McubesChunk is pooled: chunk i uses slot i % MCUBES_IMAGE_POOL_SIZE, which
+// is distinct for each chunk of a batch since batches use consecutive chunks of the ring.
+#define MCUBES_IMAGE_POOL_SIZE MCUBES_MAX_CHUNKS_PER_BATCH
+static_assert(MCUBES_CHUNK_COUNT % MCUBES_IMAGE_POOL_SIZE == 0, "Ring wraparound would break slot uniqueness");
+
 // Bundle of data passed between the marching cubes compute pipeline and the graphics pipeline.
 struct McubesChunk
 {
-  nvvk::Image     image;  // 3D 1-component float32 image
-  VkImageView     imageView;
-  nvvk::Buffer    geometryArrayBuffer;  // Array of MCUBES_GEOMETRIES_PER_IMAGE McubesGeometry
-  VkDescriptorSet set;                  // Using mcubesChunkDescriptorSetLayout
+  // 3D 1-component float32 image. It is only live during computeCmdFillChunkBatch, so its memory is
+  // aliased with the images of the other chunks using the same image pool slot.
+  VkImage      image;
+  VkImageView  imageView;
+  nvvk::Buffer geometryArrayBuffer;   // Array of MCUBES_GEOMETRIES_PER_IMAGE McubesGeometry
+  nvvk::Buffer emptyBlockMaskBuffer;  // MCUBES_BLOCK_MASK_WORDS uints, filled from emptyBlockMask
+  nvvk::Buffer blockSignatureBuffer;  // MCUBES_GEOMETRIES_PER_CHUNK uints, see MCUBES_BLOCK_SIGNATURE_BINDING
+
+  // Same image, for the ray marching render mode, which draws it instead of McubesGeometry. It must outlive
+  // the batch, so its memory is instead aliased with geometryArrayBuffer (not filled in that mode).
+  VkImage     rayMarchImage;
+  VkImageView rayMarchImageView;
+
+  // Memory of image and rayMarchImage where they cannot alias as above (the driver requires them to have
+  // dedicated memory, or no memory type suits all aliased resources); null otherwise.
+  nvvk::MemHandle imageMemory         = nullptr;
+  nvvk::MemHandle rayMarchImageMemory = nullptr;
+
+  VkDescriptorSet set;          // Using mcubesChunkDescriptorSetLayout
+  VkDescriptorSet rayMarchSet;  // Same, with rayMarchImage as MCUBES_IMAGE_BINDING
+
+  // Host copy of McubesGeometry blocks to skip filling (see cullGetEmptyBlockMask),
+  // uploaded to emptyBlockMaskBuffer by computeCmdFillChunkBatch.
+  uint32_t emptyBlockMask[MCUBES_BLOCK_MASK_WORDS] = {};
 
   // Graphics queue waits for this timeline semaphore value:
   // indicates that compute is done filling geometryArrayBuffer (resolve RAW hazard)
@@ -32,7 +59,36 @@ extern McubesChunk g_mcubesChunkArray[MCUBES_CHUNK_COUNT];
 
 // binding = MCUBES_GEOMETRY_BINDING refers to McubesChunk::geometryArrayBuffer as storage buffer
 // binding = MCUBES_IMAGE_BINDING refers to McubesChunk::image as storage image
+// binding = MCUBES_BLOCK_MASK_BINDING refers to McubesChunk::emptyBlockMaskBuffer as storage buffer
+// binding = MCUBES_BLOCK_SIGNATURE_BINDING refers to McubesChunk::blockSignatureBuffer as storage buffer
+// binding = MCUBES_BLOCK_STATS_BINDING refers to the (shared) array of 2 McubesBlockStats as storage buffer
 extern VkDescriptorSetLayout g_mcubesChunkDescriptorSetLayout;
 
 void setupMcubesChunks();
 void shutdownMcubesChunks();
+
+// Whether McubesChunk::geometryArrayBuffer and McubesChunk::blockSignatureBuffer, written by the compute queue
+// and read by the graphics queue, use VK_SHARING_MODE_EXCLUSIVE instead of VK_SHARING_MODE_CONCURRENT. Exclusive
+// sharing may let the driver keep the buffers compressed, at the cost of queue family ownership transfers.
+extern bool g_mcubesExclusiveSharing;
+
+// Recreate those buffers (and McubesChunk::rayMarchImage, aliasing the geometry buffer) if the sharing mode
+// changes. The device must be idle.
+void mcubesSetExclusiveSharing(bool exclusive);
+
+// With exclusive sharing, release the buffers of the batch that the graphics queue reads in the given render mode
+// from the compute queue family (after filling them), and acquire them on the graphics queue family (before
+// drawing them, in stages dstStages, which the graphics queue waits for the compute queue in). No-op otherwise.
+void mcubesCmdReleaseChunkBatch(VkCommandBuffer cmdBuf, uint32_t count, McubesChunk* const* ppChunks, bool rayMarch);
+void mcubesCmdAcquireChunkBatch(VkCommandBuffer      cmdBuf,
+                                uint32_t             count,
+                                McubesChunk* const*  ppChunks,
+                                bool                 rayMarch,
+                                VkPipelineStageFlags dstStages);
+
+// Counts most recently read back by mcubesCollectBlockStats.
+extern McubesBlockStats g_mcubesBlockStats;
+
+// Read back and reset the McubesBlockStats of the given frame slot (0 or 1) into g_mcubesBlockStats.
+// Ensure that no commands filling McubesChunks with that McubesParams::statsSlot are pending.
+void mcubesCollectBlockStats(uint32_t statsSlot);
@@ -0,0 +1,755 @@
+// Copyright 2021 NVIDIA CORPORATION
+// SPDX-License-Identifier: Apache-2.0
+#include "mcubes_cpu.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <math.h>
+#include <memory>
+#include <mutex>
+#include <stdio.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#endif
+#if defined(__SSE2__) || defined(_M_X64)
+#define MCUBES_CPU_SSE2 1
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#define MCUBES_CPU_NEON 1
+#include <arm_neon.h>
+#endif
+
+#include "equation_program.hpp"
+#include "shaders/autogenerated_mcubes_table.h"
+#include "shaders/mcubes_geometry.h"
+
+static const uint32_t texelsPerEdge   = MCUBES_CHUNK_EDGE_LENGTH_TEXELS;
+static const uint32_t texelsPerChunk  = texelsPerEdge * texelsPerEdge * texelsPerEdge;
+static const uint32_t blockEdgeLength = MCUBES_GEOMETRY_EDGE_LENGTH;
+static const uint32_t blocksPerEdge   = texelsPerEdge / blockEdgeLength;
+
+// Minimal work-stealing thread pool. parallelFor deals its tasks round-robin into one deque per thread; each
+// thread pops tasks from the back of its own deque and, once that is empty, steals from the front of the others.
+class WorkStealingPool
+{
+public:
+  explicit WorkStealingPool(uint32_t threadCount)
+      : m_queues(new Queue[threadCount])
+      , m_threadCount(threadCount)
+  {
+    for(uint32_t i = 1; i < threadCount; ++i)
+    {
+      m_threads.emplace_back(&WorkStealingPool::workerLoop, this, i);
+    }
+  }
+
+  ~WorkStealingPool()
+  {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_stop = true;
+    }
+    m_wake.notify_all();
+    for(std::thread& thread : m_threads)
+    {
+      thread.join();
+    }
+  }
+
+  uint32_t threadCount() const { return m_threadCount; }
+
+  // Call function(task) for each task in [0, taskCount) on the pool's threads, including the calling thread, which
+  // is thread 0. Returns once all calls have returned. Calls from several threads run one after the other.
+  void parallelFor(uint32_t taskCount, const std::function<void(uint32_t)>& function)
+  {
+    std::lock_guard<std::mutex> callLock(m_callMutex);
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      for(uint32_t task = 0; task < taskCount; ++task)
+      {
+        Queue&                      queue = m_queues[task % m_threadCount];
+        std::lock_guard<std::mutex> queueLock(queue.mutex);
+        queue.tasks.push_back(task);
+      }
+      m_pFunction = &function;
+      m_remaining = taskCount;
+      m_activeWorkers++;  // This thread.
+      m_generation++;
+    }
+    m_wake.notify_all();
+
+    while(runTask(0, function))
+    {
+    }
+
+    // Wait for the other threads' last tasks, and for them to stop looking for more, so that none of them can
+    // take a task of the next parallelFor while still holding this function.
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_activeWorkers--;
+    m_done.wait(lock, [this] { return m_remaining == 0 && m_activeWorkers == 0; });
+    m_pFunction = nullptr;
+  }
+
+private:
+  struct Queue
+  {
+    std::mutex           mutex;
+    std::deque<uint32_t> tasks;
+  };
+
+  // Run one task, from thread self's own queue if possible, else stolen from another thread's queue.
+  // Returns false if all queues are empty.
+  bool runTask(uint32_t self, const std::function<void(uint32_t)>& function)
+  {
+    uint32_t task  = 0;
+    bool     found = false;
+    for(uint32_t i = 0; i < m_threadCount && !found; ++i)
+    {
+      Queue&                      queue = m_queues[(self + i) % m_threadCount];
+      std::lock_guard<std::mutex> queueLock(queue.mutex);
+      if(!queue.tasks.empty())
+      {
+        if(i == 0)
+        {
+          task = queue.tasks.back();
+          queue.tasks.pop_back();
+        }
+        else
+        {
+          task = queue.tasks.front();
+          queue.tasks.pop_front();
+        }
+        found = true;
+      }
+    }
+    if(!found)
+      return false;
+
+    function(task);
+    if(m_remaining.fetch_sub(1) == 1)
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_done.notify_all();
+    }
+    return true;
+  }
+
+  void workerLoop(uint32_t self)
+  {
+    uint64_t seenGeneration = 0;
+    for(;;)
+    {
+      const std::function<void(uint32_t)>* pFunction;
+      {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_wake.wait(lock, [&] { return m_stop || m_generation != seenGeneration; });
+        if(m_stop)
+          return;
+        seenGeneration = m_generation;
+        pFunction      = m_pFunction;
+        if(pFunction == nullptr)
+          continue;  // Woke up after that parallelFor already finished.
+        m_activeWorkers++;
+      }
+
+      while(runTask(self, *pFunction))
+      {
+      }
+
+      std::lock_guard<std::mutex> lock(m_mutex);
+      if(--m_activeWorkers == 0 && m_remaining == 0)
+        m_done.notify_all();
+    }
+  }
+
+  std::unique_ptr<Queue[]> m_queues;
+  uint32_t                 m_threadCount;
+  std::vector<std::thread> m_threads;  // Threads 1 .. m_threadCount - 1.
+
+  std::mutex m_callMutex;  // Held for the duration of each parallelFor.
+
+  // Protected by m_mutex, except m_remaining (also written by runTask).
+  std::mutex                           m_mutex;
+  std::condition_variable              m_wake, m_done;
+  const std::function<void(uint32_t)>* m_pFunction = nullptr;
+  std::atomic<uint32_t>                m_remaining{0};
+  uint32_t                             m_activeWorkers = 0;
+  uint64_t                             m_generation    = 0;
+  bool                                 m_stop          = false;
+};
+
+static WorkStealingPool& getThreadPool()
+{
+  static WorkStealingPool pool(std::max(1u, std::thread::hardware_concurrency()));
+  return pool;
+}
+
+uint32_t mcubesCpuThreadCount()
+{
+  return getThreadPool().threadCount();
+}
+
+// Fill one slice of the image: texels at tz, with the same float coordinates as mcubes_image.comp.
+static void fillImageSlice(const EquationProgram& program, const McubesParams& params, uint32_t tz, float* pSlice)
+{
+  float x[texelsPerEdge], y[texelsPerEdge], z[texelsPerEdge];
+  for(uint32_t tx = 0; tx < texelsPerEdge; ++tx)
+  {
+    x[tx] = params.offset.x + params.size.x * (float(tx) / MCUBES_CHUNK_EDGE_LENGTH_CELLS);
+    z[tx] = params.offset.z + params.size.z * (float(tz) / MCUBES_CHUNK_EDGE_LENGTH_CELLS);
+  }
+  for(uint32_t ty = 0; ty < texelsPerEdge; ++ty)
+  {
+    std::fill(y, y + texelsPerEdge, params.offset.y + params.size.y * (float(ty) / MCUBES_CHUNK_EDGE_LENGTH_CELLS));
+    equationEvaluateProgram(program, texelsPerEdge, x, y, z, params.t, &params.userParams.x,
+                            pSlice + texelsPerEdge * ty);
+  }
+}
+
+void mcubesCpuFillImages(const Equation& equation, uint32_t count, const McubesCpuChunk* pChunks)
+{
+  EquationProgram program;
+  equationCompileProgram(equation, &program);
+
+  // One task per z slice.
+  getThreadPool().parallelFor(count * texelsPerEdge, [&](uint32_t task) {
+    const McubesCpuChunk& chunk = pChunks[task / texelsPerEdge];
+    uint32_t              tz    = task % texelsPerEdge;
+    fillImageSlice(program, chunk.params, tz, chunk.pImage + texelsPerEdge * texelsPerEdge * tz);
+  });
+}
+
+// Bitmask of which of the count (at most 32) values p[i] - iso are positive, the test that
+// autogeneratedGetCaseNumber applies to each sample. This classifies a row of samples a vector at a time.
+static uint32_t positiveMask(const float* p, uint32_t count, float iso)
+{
+  uint32_t mask = 0, i = 0;
+#if defined(__AVX__)
+  __m256 iso8  = _mm256_set1_ps(iso);
+  __m256 zero8 = _mm256_setzero_ps();
+  for(; i + 8 <= count; i += 8)
+  {
+    __m256 positive = _mm256_cmp_ps(_mm256_sub_ps(_mm256_loadu_ps(p + i), iso8), zero8, _CMP_GT_OQ);
+    mask |= uint32_t(_mm256_movemask_ps(positive)) << i;
+  }
+#endif
+#if defined(MCUBES_CPU_SSE2)
+  __m128 iso4  = _mm_set1_ps(iso);
+  __m128 zero4 = _mm_setzero_ps();
+  for(; i + 4 <= count; i += 4)
+  {
+    __m128 positive = _mm_cmpgt_ps(_mm_sub_ps(_mm_loadu_ps(p + i), iso4), zero4);
+    mask |= uint32_t(_mm_movemask_ps(positive)) << i;
+  }
+#elif defined(MCUBES_CPU_NEON)
+  static const uint32_t laneBits[4] = {1, 2, 4, 8};
+  float32x4_t           iso4        = vdupq_n_f32(iso);
+  float32x4_t           zero4       = vdupq_n_f32(0.0f);
+  uint32x4_t            bits4       = vld1q_u32(laneBits);
+  for(; i + 4 <= count; i += 4)
+  {
+    uint32x4_t positive = vcgtq_f32(vsubq_f32(vld1q_f32(p + i), iso4), zero4);
+    mask |= vaddvq_u32(vandq_u32(positive, bits4)) << i;
+  }
+#endif
+  for(; i < count; ++i)
+  {
+    mask |= (p[i] - iso > 0.0f ? 1u : 0u) << i;
+  }
+  return mask;
+}
+
+// packNormalizedVec3 of mcubes_geometry.h, for one coordinate.
+static uint32_t packNormalized(float v, uint32_t denominator)
+{
+  float scaled = v * float(denominator) + 0.5f;
+  return scaled > 0.0f ? std::min(uint32_t(std::min(scaled, float(denominator))), denominator) : 0u;
+}
+
+// packOctahedral of mcubes_geometry.h.
+static uint32_t packOctahedral(const float n[3])
+{
+  float sum = fabsf(n[0]) + fabsf(n[1]) + fabsf(n[2]);
+  float p[2] = {n[0] / sum, n[1] / sum};
+  if(n[2] < 0.0f)
+  {
+    float folded[2] = {(1.0f - fabsf(p[1])) * (p[0] >= 0.0f ? 1.0f : -1.0f),
+                       (1.0f - fabsf(p[0])) * (p[1] >= 0.0f ? 1.0f : -1.0f)};
+    p[0] = folded[0];
+    p[1] = folded[1];
+  }
+  uint32_t result = 0;
+  for(int i = 0; i < 2; ++i)
+  {
+    int16_t snorm = int16_t(roundf(std::min(std::max(p[i], -1.0f), 1.0f) * 32767.0f));
+    result |= uint32_t(uint16_t(snorm)) << (16 * i);
+  }
+  return result;
+}
+
+static float mix(float a, float b, float t)
+{
+  return a * (1.0f - t) + b * t;
+}
+
+// Marching cubes of one McubesGeometry block of a chunk; the CPU version of one mcubes_geometry.comp workgroup.
+class BlockMesher
+{
+public:
+  BlockMesher(const McubesCpuChunk& chunk, uint32_t blockIndex)
+      : m_params(chunk.params)
+      , m_pImage(chunk.pImage)
+      , m_geometry(chunk.pGeometryArray[blockIndex])
+  {
+    m_base[0] = blockIndex % blocksPerEdge * blockEdgeLength;
+    m_base[1] = blockIndex / blocksPerEdge % blocksPerEdge * blockEdgeLength;
+    m_base[2] = blockIndex / (blocksPerEdge * blocksPerEdge) * blockEdgeLength;
+    for(int axis = 0; axis < 3; ++axis)
+    {
+      // Upper boundary blocks have one cell less, as cells exist strictly between samples.
+      m_cellCounts[axis] = std::min(blockEdgeLength, MCUBES_CHUNK_EDGE_LENGTH_CELLS - m_base[axis]);
+    }
+  }
+
+  // Fill the block; returns its number of cells.
+  uint32_t run()
+  {
+    uint32_t cellCount = 0;
+    for(uint32_t level = 0; level < m_params.isoLevelCount && level < MCUBES_MAX_ISO_LEVELS; ++level)
+    {
+      meshLevel(level);
+      cellCount                       = std::min(m_cellIndex, uint32_t(MCUBES_CELLS_PER_GEOMETRY));
+      m_geometry.levelCellEnds[level] = cellCount;
+    }
+    for(uint32_t level = m_params.isoLevelCount; level < MCUBES_MAX_ISO_LEVELS; ++level)
+    {
+      m_geometry.levelCellEnds[level] = cellCount;
+    }
+
+    m_geometry.vertexCount     = 12 * cellCount;
+    m_geometry.instanceCount   = 1;
+    m_geometry.firstVertex     = 0;
+    m_geometry.firstInstance   = 0;
+    m_geometry.packedVertCount = m_packedVertCount - m_droppedVertCount;
+    for(int axis = 0; axis < 3; ++axis)
+    {
+      m_geometry.packedVertScale[axis] = m_params.size[axis] / MCUBES_CHUNK_EDGE_LENGTH_CELLS * (1.0f / 512.0f);
+      m_geometry.origin[axis] =
+          m_params.offset[axis] + m_params.size[axis] * (float(m_base[axis]) / MCUBES_CHUNK_EDGE_LENGTH_CELLS);
+    }
+    return cellCount;
+  }
+
+  // Write the block's header as mcubes_geometry.comp does for blocks it skips.
+  void clear()
+  {
+    m_geometry.vertexCount     = 0;
+    m_geometry.instanceCount   = 1;
+    m_geometry.firstVertex     = 0;
+    m_geometry.firstInstance   = 0;
+    m_geometry.packedVertCount = 0;
+    for(uint32_t level = 0; level < MCUBES_MAX_ISO_LEVELS; ++level)
+    {
+      m_geometry.levelCellEnds[level] = 0;
+    }
+  }
+
+  uint32_t packedVertCount() const { return m_geometry.packedVertCount; }
+  uint32_t droppedCellCount() const { return m_cellIndex - std::min(m_cellIndex, uint32_t(MCUBES_CELLS_PER_GEOMETRY)); }
+  uint32_t droppedVertCount() const { return m_droppedVertCount; }
+
+private:
+  float texel(uint32_t x, uint32_t y, uint32_t z) const
+  {
+    return m_pImage[x + texelsPerEdge * (y + texelsPerEdge * z)];
+  }
+
+  // Append the cells of one iso-level, in order of their coordinates (x fastest).
+  void meshLevel(uint32_t level)
+  {
+    float iso = (&m_params.isoLevels.x)[level];
+
+    // positiveMask of each row of samples along x used by the block's cells, indexed by row z, y offset.
+    uint32_t rowMasks[blockEdgeLength + 1][blockEdgeLength + 1];
+    for(uint32_t z = 0; z <= m_cellCounts[2]; ++z)
+    {
+      for(uint32_t y = 0; y <= m_cellCounts[1]; ++y)
+      {
+        const float* pRow = &m_pImage[m_base[0] + texelsPerEdge * (m_base[1] + y + texelsPerEdge * (m_base[2] + z))];
+        rowMasks[z][y]    = positiveMask(pRow, m_cellCounts[0] + 1, iso);
+      }
+    }
+
+    uint32_t rowBits = (2u << m_cellCounts[0]) - 1u;
+    for(uint32_t z = 0; z < m_cellCounts[2]; ++z)
+    {
+      for(uint32_t y = 0; y < m_cellCounts[1]; ++y)
+      {
+        // Masks of the 4 rows of corners, indexed 2dy + dz as in the case number bits.
+        uint32_t masks[4] = {rowMasks[z][y], rowMasks[z + 1][y], rowMasks[z][y + 1], rowMasks[z + 1][y + 1]};
+        bool uniformRow = (masks[0] == 0 || masks[0] == rowBits) && masks[1] == masks[0] && masks[2] == masks[0]
+                          && masks[3] == masks[0];
+        if(uniformRow)
+          continue;  // No cell of the row is crossed.
+        for(uint32_t x = 0; x < m_cellCounts[0]; ++x)
+        {
+          uint32_t caseNumber = 0;
+          for(uint32_t corner = 0; corner < 4; ++corner)
+          {
+            caseNumber |= ((masks[corner] >> x) & 1u) << corner;
+            caseNumber |= ((masks[corner] >> (x + 1)) & 1u) << (corner + 4);
+          }
+          if(caseNumber != 0 && caseNumber != 255u)
+            addCell(x, y, z, caseNumber, iso);
+        }
+      }
+    }
+  }
+
+  // autogeneratedGetCellTriangles, and the rest of analyzeCell of mcubes_geometry.comp without Newton steps.
+  void addCell(uint32_t x, uint32_t y, uint32_t z, uint32_t caseNumber, float iso)
+  {
+    uint32_t cellIndex = m_cellIndex++;
+    if(cellIndex >= MCUBES_CELLS_PER_GEOMETRY)
+      return;
+
+    uint32_t texelCoord[3] = {m_base[0] + x, m_base[1] + y, m_base[2] + z};
+    float    samples[8];  // Indexed by corner 4x + 2y + z, minus iso.
+    for(uint32_t corner = 0; corner < 8; ++corner)
+    {
+      samples[corner] = texel(texelCoord[0] + (corner >> 2), texelCoord[1] + ((corner >> 1) & 1),
+                              texelCoord[2] + (corner & 1))
+                        - iso;
+    }
+
+    // allocatePackedVerts
+    uint32_t vertexCount = autogeneratedCaseVertexCounts[caseNumber];
+    uint32_t firstVert   = m_packedVertCount;
+    m_packedVertCount += vertexCount;
+    if(firstVert + vertexCount > MCUBES_VERTS_PER_GEOMETRY)
+    {
+      m_droppedVertCount += vertexCount;
+      firstVert   = 0;
+      vertexCount = 0;
+    }
+    m_geometry.cells[cellIndex] = x | y << 4 | z << 8 | vertexCount << 12 | firstVert << 16;
+    if(vertexCount == 0)
+      return;
+
+    float gradients[8][3];
+    for(uint32_t corner = 0; corner < 8; ++corner)
+    {
+      texelGradient(texelCoord[0] + (corner >> 2), texelCoord[1] + ((corner >> 1) & 1), texelCoord[2] + (corner & 1),
+                    gradients[corner]);
+    }
+
+    for(uint32_t i = 0; i < vertexCount; ++i)
+    {
+      // Interpolate along the edge; the other coordinates are those of its corners (0 or 1).
+      const uint8_t* edgeCorners = autogeneratedEdgeCorners[autogeneratedCaseEdges[caseNumber][i]];
+      uint32_t       c0 = edgeCorners[0], c1 = edgeCorners[1];
+      float          t = samples[c0] / (samples[c0] - samples[c1]);
+      uint32_t       unpacked[3];
+      float          p[3];
+      for(int axis = 0; axis < 3; ++axis)
+      {
+        uint32_t bit   = 4u >> axis;
+        unpacked[axis] = packNormalized((c0 ^ c1) == bit ? t : (c0 & bit ? 1.0f : 0.0f), 512u);
+        p[axis]        = float(unpacked[axis]) * (1.0f / 512.0f);
+      }
+
+      // interpolateGradient and packGradientNormal.
+      const float(*g)[3] = gradients;
+      float gradient[3];
+      for(int axis = 0; axis < 3; ++axis)
+      {
+        gradient[axis] = mix(mix(mix(g[0][axis], g[1][axis], p[2]), mix(g[2][axis], g[3][axis], p[2]), p[1]),
+                             mix(mix(g[4][axis], g[5][axis], p[2]), mix(g[6][axis], g[7][axis], p[2]), p[1]), p[0]);
+        gradient[axis] /= m_params.size[axis];
+      }
+      if(gradient[0] == 0.0f && gradient[1] == 0.0f && gradient[2] == 0.0f)
+        gradient[2] = 1.0f;
+
+      m_geometry.packedVerts[firstVert + i]   = unpacked[0] | unpacked[1] << 10 | unpacked[2] << 20;
+      m_geometry.packedNormals[firstVert + i] = packOctahedral(gradient);
+    }
+  }
+
+  // texelGradient of mcubes_geometry.comp.
+  void texelGradient(uint32_t x, uint32_t y, uint32_t z, float gradient[3]) const
+  {
+    uint32_t coord[3] = {x, y, z};
+    for(int axis = 0; axis < 3; ++axis)
+    {
+      uint32_t lo[3] = {x, y, z}, hi[3] = {x, y, z};
+      lo[axis]       = coord[axis] == 0 ? 0 : coord[axis] - 1;
+      hi[axis]       = std::min(coord[axis] + 1, texelsPerEdge - 1);
+      gradient[axis] = (texel(hi[0], hi[1], hi[2]) - texel(lo[0], lo[1], lo[2])) / float(hi[axis] - lo[axis]);
+    }
+  }
+
+  const McubesParams& m_params;
+  const float*        m_pImage;
+  McubesGeometry&     m_geometry;
+  uint32_t            m_base[3];        // Texel coordinate of the block's cell 0, 0, 0.
+  uint32_t            m_cellCounts[3];  // Number of cells of the block along each axis.
+  uint32_t            m_cellIndex        = 0;  // Cells found so far, including any that did not fit.
+  uint32_t            m_packedVertCount  = 0;  // Vertices allocated so far, including any that did not fit.
+  uint32_t            m_droppedVertCount = 0;  // Those that did not fit.
+};
+
+void mcubesCpuFillGeometry(uint32_t count, const McubesCpuChunk* pChunks, McubesBlockStats* pStats)
+{
+  std::atomic<uint32_t> blockCount{0}, uniformBlockCount{0}, cellCount{0}, packedVertCount{0};
+  std::atomic<uint32_t> droppedCellCount{0}, droppedVertCount{0};
+
+  // One task per McubesGeometry block.
+  getThreadPool().parallelFor(count * MCUBES_GEOMETRIES_PER_CHUNK, [&](uint32_t task) {
+    const McubesCpuChunk& chunk      = pChunks[task / MCUBES_GEOMETRIES_PER_CHUNK];
+    uint32_t              blockIndex = task % MCUBES_GEOMETRIES_PER_CHUNK;
+    BlockMesher           mesher(chunk, blockIndex);
+    if(chunk.pEmptyBlockMask != nullptr && (chunk.pEmptyBlockMask[blockIndex / 32u] & (1u << (blockIndex % 32u))) != 0)
+    {
+      mesher.clear();
+      return;
+    }
+    blockCount++;
+
+    // A block without cells is one whose samples all have the same signs, which mcubes_geometry.comp skips.
+    uint32_t blockCellCount = mesher.run();
+    if(blockCellCount == 0)
+    {
+      mesher.clear();
+      uniformBlockCount++;
+    }
+    cellCount += blockCellCount;
+    packedVertCount += mesher.packedVertCount();
+    droppedCellCount += mesher.droppedCellCount();
+    droppedVertCount += mesher.droppedVertCount();
+  });
+
+  if(pStats != nullptr)
+  {
+    pStats->blockCount += blockCount;
+    pStats->uniformBlockCount += uniformBlockCount;
+    pStats->cellCount += cellCount;
+    pStats->packedVertCount += packedVertCount;
+    pStats->droppedCellCount += droppedCellCount;
+    pStats->droppedVertCount += droppedVertCount;
+  }
+}
+
+void mcubesCpuFillBlockSignatures(uint32_t count, const McubesCpuChunk* pChunks, uint32_t* const* ppSignatures)
+{
+  // One task per McubesGeometry block, over the texels used by its cells, as blockRange in mcubes_image.comp.
+  getThreadPool().parallelFor(count * MCUBES_GEOMETRIES_PER_CHUNK, [&](uint32_t task) {
+    const McubesCpuChunk& chunk      = pChunks[task / MCUBES_GEOMETRIES_PER_CHUNK];
+    uint32_t              blockIndex = task % MCUBES_GEOMETRIES_PER_CHUNK;
+    uint32_t              base[3], end[3];
+    base[0] = blockIndex % blocksPerEdge * blockEdgeLength;
+    base[1] = blockIndex / blocksPerEdge % blocksPerEdge * blockEdgeLength;
+    base[2] = blockIndex / (blocksPerEdge * blocksPerEdge) * blockEdgeLength;
+    for(int axis = 0; axis < 3; ++axis)
+    {
+      end[axis] = std::min(base[axis] + blockEdgeLength, texelsPerEdge - 1u);
+    }
+
+    const McubesParams& params     = chunk.params;
+    uint32_t            levelCount = std::min(params.isoLevelCount, uint32_t(MCUBES_MAX_ISO_LEVELS));
+    uint32_t            rowCount   = end[0] - base[0] + 1u;
+    uint32_t            signature  = 0;
+    for(uint32_t z = base[2]; z <= end[2]; ++z)
+    {
+      for(uint32_t y = base[1]; y <= end[1]; ++y)
+      {
+        const float* pRow = chunk.pImage + texelsPerEdge * (y + texelsPerEdge * z) + base[0];
+        for(uint32_t level = 0; level < levelCount; ++level)
+        {
+          uint32_t above = positiveMask(pRow, rowCount, (&params.isoLevels.x)[level]);
+          signature |= (above != 0 ? MCUBES_SIGNATURE_ABOVE_BIT : 0u) << (2u * level);
+          signature |= (above != (1u << rowCount) - 1u ? MCUBES_SIGNATURE_BELOW_BIT : 0u) << (2u * level);
+        }
+      }
+    }
+    ppSignatures[task / MCUBES_GEOMETRIES_PER_CHUNK][blockIndex] = signature;
+  });
+}
+
+void mcubesCpuFillChunks(const Equation&       equation,
+                         uint32_t              count,
+                         const McubesCpuChunk* pChunks,
+                         McubesBlockStats*     pStats)
+{
+  std::vector<McubesCpuChunk>           chunks(pChunks, pChunks + count);
+  std::vector<std::unique_ptr<float[]>> scratchImages;
+  for(McubesCpuChunk& chunk : chunks)
+  {
+    if(chunk.pImage == nullptr)
+    {
+      scratchImages.emplace_back(new float[texelsPerChunk]);
+      chunk.pImage = scratchImages.back().get();
+    }
+  }
+  mcubesCpuFillImages(equation, count, chunks.data());
+  mcubesCpuFillGeometry(count, chunks.data(), pStats);
+}
+
+// Returns an empty string if the block's header, cells and vertices are consistent, else a description of the
+// first inconsistency. Cells must be as the CPU mesher stores them: in order, with contiguous vertex lists.
+static std::string checkBlock(const McubesGeometry& geometry, uint32_t blockIndex, uint32_t isoLevelCount)
+{
+  char     text[160];
+  uint32_t cellCount = geometry.levelCellEnds[MCUBES_MAX_ISO_LEVELS - 1];
+  if(geometry.instanceCount != 1 || geometry.firstVertex != 0 || geometry.firstInstance != 0
+     || geometry.vertexCount != 12 * cellCount)
+  {
+    snprintf(text, sizeof text, "draw command %u %u %u %u for %u cells", geometry.vertexCount, geometry.instanceCount,
+             geometry.firstVertex, geometry.firstInstance, cellCount);
+    return text;
+  }
+  if(cellCount > MCUBES_CELLS_PER_GEOMETRY || geometry.packedVertCount > MCUBES_VERTS_PER_GEOMETRY)
+  {
+    snprintf(text, sizeof text, "%u cells, %u packed vertices", cellCount, geometry.packedVertCount);
+    return text;
+  }
+
+  const uint32_t blockCoord[3] = {blockIndex % blocksPerEdge, blockIndex / blocksPerEdge % blocksPerEdge,
+                                  blockIndex / (blocksPerEdge * blocksPerEdge)};
+  uint32_t       cellLimits[3];
+  for(int axis = 0; axis < 3; ++axis)
+  {
+    cellLimits[axis] = std::min(blockEdgeLength, MCUBES_CHUNK_EDGE_LENGTH_CELLS - blockCoord[axis] * blockEdgeLength);
+  }
+  uint32_t begin = 0, nextVert = 0;
+  for(uint32_t level = 0; level < MCUBES_MAX_ISO_LEVELS; ++level)
+  {
+    uint32_t end = geometry.levelCellEnds[level];
+    if(end < begin || (level >= isoLevelCount && end != begin))
+    {
+      snprintf(text, sizeof text, "iso-level %u ends at cell %u, after %u", level, end, begin);
+      return text;
+    }
+    uint32_t previousCoord = 0;
+    for(uint32_t i = begin; i < end; ++i)
+    {
+      uint32_t cell = geometry.cells[i], coord = cell & 0xFFF, vertexCount = (cell >> 12) & 0xF;
+      uint32_t x = cell & 0xF, y = (cell >> 4) & 0xF, z = (cell >> 8) & 0xF;
+      if(x >= cellLimits[0] || y >= cellLimits[1] || z >= cellLimits[2] || (i > begin && coord <= previousCoord)
+         || vertexCount % 3 != 0 || (cell & MCUBES_CELL_INDIRECT_BIT) != 0)
+      {
+        snprintf(text, sizeof text, "iso-level %u cell %u header 0x%08x", level, i, cell);
+        return text;
+      }
+      previousCoord = coord;
+      if(vertexCount != 0 && (cell >> 16 & 0x7FFF) != nextVert)
+      {
+        snprintf(text, sizeof text, "iso-level %u cell %u vertices start at %u, not %u", level, i, cell >> 16 & 0x7FFF,
+                 nextVert);
+        return text;
+      }
+      for(uint32_t v = nextVert; v < nextVert + vertexCount && v < MCUBES_VERTS_PER_GEOMETRY; ++v)
+      {
+        uint32_t vert = geometry.packedVerts[v];
+        if((vert & 0x3FF) > 512 || (vert >> 10 & 0x3FF) > 512 || (vert >> 20 & 0x3FF) > 512 || vert >> 30 != 0)
+        {
+          snprintf(text, sizeof text, "iso-level %u cell %u vertex 0x%08x", level, i, vert);
+          return text;
+        }
+      }
+      nextVert += vertexCount;
+    }
+    begin = end;
+  }
+  if(nextVert != geometry.packedVertCount)
+  {
+    snprintf(text, sizeof text, "cells have %u vertices, not %u", nextVert, geometry.packedVertCount);
+    return text;
+  }
+  return std::string();
+}
+
+bool mcubesCpuCheckMesher()
+{
+  // 2^3 chunks over the default bounding box, with two iso-levels.
+  const uint32_t chunksPerEdge = 2, chunkCount = chunksPerEdge * chunksPerEdge * chunksPerEdge;
+  std::unique_ptr<float[]>          image(new float[texelsPerChunk]);
+  std::unique_ptr<McubesGeometry[]> geometries(new McubesGeometry[MCUBES_GEOMETRIES_PER_CHUNK]);
+  std::vector<uint32_t>             signatures(MCUBES_GEOMETRIES_PER_CHUNK);
+  uint32_t*                         pSignatures = signatures.data();
+
+  bool ok = true;
+  printf("%-24s %8s %8s %10s %10s\n", "CPU mesher check", "blocks", "uniform", "cells", "verts");
+  for(uint32_t example = 0; example < equationExampleCount; ++example)
+  {
+    const char* pName = equationExamples[example].pName;
+    Equation    equation;
+    std::string error;
+    if(!equationParse(equationExamples[example].pText, &equation, &error))
+    {
+      printf("%-24s %s\n", pName, error.c_str());
+      ok = false;
+      continue;
+    }
+    equationOptimize(&equation);
+
+    McubesBlockStats stats{};
+    uint32_t         uniformBlockCount = 0, cellCount = 0, packedVertCount = 0;
+    std::string      report;
+    for(uint32_t c = 0; c < chunkCount; ++c)
+    {
+      const uint32_t chunkCoord[3] = {c % chunksPerEdge, c / chunksPerEdge % chunksPerEdge,
+                                      c / (chunksPerEdge * chunksPerEdge)};
+      McubesParams   params{};
+      for(int axis = 0; axis < 3; ++axis)
+      {
+        params.size[axis]   = 4.0f / chunksPerEdge;
+        params.offset[axis] = -2.0f + params.size[axis] * chunkCoord[axis];
+      }
+      params.t             = 0.5f;
+      params.userParams    = nvmath::vec4f(1.0f, 1.0f, 1.0f, 1.0f);
+      params.isoLevels     = nvmath::vec4f(0.0f, 0.1f, 0.0f, 0.0f);
+      params.isoLevelCount = 2;
+      McubesCpuChunk chunk{params, nullptr, image.get(), geometries.get()};
+      mcubesCpuFillChunks(equation, 1, &chunk, &stats);
+      mcubesCpuFillBlockSignatures(1, &chunk, &pSignatures);
+
+      for(uint32_t block = 0; block < MCUBES_GEOMETRIES_PER_CHUNK; ++block)
+      {
+        const McubesGeometry& geometry = geometries[block];
+        std::string           problem  = checkBlock(geometry, block, params.isoLevelCount);
+
+        // A block has cells exactly if its sign signature shows a surface at some iso-level.
+        uint32_t blockCells = geometry.levelCellEnds[MCUBES_MAX_ISO_LEVELS - 1];
+        uint32_t mixed      = signatures[block] & (signatures[block] >> 1) & 0x55u;
+        if(problem.empty() && (blockCells != 0) != (mixed != 0))
+          problem = "signature " + std::to_string(signatures[block]) + ", " + std::to_string(blockCells) + " cells";
+        if(!problem.empty() && report.empty())
+          report = "chunk " + std::to_string(c) + " block " + std::to_string(block) + ": " + problem;
+        uniformBlockCount += blockCells == 0;
+        cellCount += blockCells;
+        packedVertCount += geometry.packedVertCount;
+      }
+    }
+
+    // The stats count what was stored; nothing is culled.
+    if(report.empty()
+       && (stats.blockCount != chunkCount * MCUBES_GEOMETRIES_PER_CHUNK || stats.uniformBlockCount != uniformBlockCount
+           || stats.cellCount != cellCount || stats.packedVertCount != packedVertCount))
+    {
+      report = "stats " + std::to_string(stats.blockCount) + " blocks, " + std::to_string(stats.uniformBlockCount)
+               + " uniform, " + std::to_string(stats.cellCount) + " cells, " + std::to_string(stats.packedVertCount)
+               + " verts";
+    }
+    printf("%-24s %8u %8u %10u %10u%s%s\n", pName, chunkCount * MCUBES_GEOMETRIES_PER_CHUNK, uniformBlockCount,
+           cellCount, packedVertCount, report.empty() ? "" : " MISMATCH ", report.c_str());
+    ok &= report.empty();
+  }
+  return ok;
+}
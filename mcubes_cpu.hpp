@@ -0,0 +1,54 @@
+// Copyright 2021 NVIDIA CORPORATION
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <stdint.h>
+
+#include "shaders/mcubes_params.h"
+
+// CPU implementation of mcubes_image.comp and mcubes_geometry.comp, for meshing without a GPU (or checking
+// its output). Chunks are spread over a pool of worker threads (one per hardware thread) at the granularity
+// of image slices and McubesGeometry blocks; idle workers steal tasks from busy ones.
+//
+// The output is the same McubesGeometry layout, for the marching cubes mesher with vertices linearly
+// interpolated between samples (McubesParams::mesher, newtonSteps and decimateTolerance are ignored).
+// Cells are stored in order within each iso-level, whereas the GPU stores them in no particular order.
+// Calls from several threads are serialized.
+
+struct Equation;
+struct McubesGeometry;
+
+// One chunk for the CPU mesher.
+struct McubesCpuChunk
+{
+  McubesParams    params;
+  const uint32_t* pEmptyBlockMask;  // Blocks to skip as in McubesChunk::emptyBlockMask; may be null.
+  float*          pImage;           // MCUBES_CHUNK_EDGE_LENGTH_TEXELS^3 samples, x fastest, then y, then z.
+  McubesGeometry* pGeometryArray;   // MCUBES_GEOMETRIES_PER_CHUNK McubesGeometry.
+};
+
+// Number of threads (including the caller) that the functions below run on.
+uint32_t mcubesCpuThreadCount();
+
+// Fill the pImage of each chunk with samples of the equation, as mcubes_image.comp does.
+void mcubesCpuFillImages(const Equation& equation, uint32_t count, const McubesCpuChunk* pChunks);
+
+// Fill the pGeometryArray of each chunk from its pImage, as mcubes_geometry.comp does.
+// If pStats is not null, the counts are added to it.
+void mcubesCpuFillGeometry(uint32_t count, const McubesCpuChunk* pChunks, McubesBlockStats* pStats);
+
+// Fill ppSignatures[i] (MCUBES_GEOMETRIES_PER_CHUNK uints) with the sign signatures of the McubesGeometry blocks
+// of chunk i's pImage, as mcubes_image.comp accumulates them (see MCUBES_BLOCK_SIGNATURE_BINDING).
+void mcubesCpuFillBlockSignatures(uint32_t count, const McubesCpuChunk* pChunks, uint32_t* const* ppSignatures);
+
+// mcubesCpuFillImages and mcubesCpuFillGeometry; chunks with a null pImage use temporary storage.
+void mcubesCpuFillChunks(const Equation&       equation,
+                         uint32_t              count,
+                         const McubesCpuChunk* pChunks,
+                         McubesBlockStats*     pStats);
+
+// Self-check of the mesher, without a GPU: mesh chunks of each example equation and check that the blocks' draw
+// commands, iso-level ranges, cell headers and vertex lists are consistent, that blocks have cells exactly if their
+// sign signature shows a surface, and that the McubesBlockStats agree with the geometry. Prints a line per
+// equation; returns false on any inconsistency.
+bool mcubesCpuCheckMesher();
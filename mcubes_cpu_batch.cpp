@@ -0,0 +1,325 @@
+// Copyright 2021 NVIDIA CORPORATION
+// SPDX-License-Identifier: Apache-2.0
+#include "mcubes_cpu_batch.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <future>
+#include <math.h>
+#include <memory>
+#include <string.h>
+#include <utility>
+#include <vector>
+
+#include "nvvk/descriptorsets_vk.hpp"
+#include "nvvk/error_vk.hpp"
+
+#include "equation.hpp"
+#include "mcubes_cpu.hpp"
+#include "timeline_semaphore_main.hpp"
+
+#include "shaders/mcubes_geometry.h"
+#include "shaders/mcubes_upload.h"
+
+static_assert(sizeof(McubesStagedGeometry) == MCUBES_STAGED_GEOMETRY_WORDS * sizeof(uint32_t), "Layout mismatch");
+
+McubesCpuBatchStats   g_mcubesCpuBatchStats;
+VkDescriptorSetLayout g_mcubesUploadDescriptorSetLayout;
+VkDescriptorSet       g_mcubesUploadDescriptorSet;
+
+// Staging ring: mcubesCpuBatchMaxChunks regions per frame slot. The McubesStagedGeometry records come first in
+// each region, followed by the words they refer to.
+static const uint32_t stagingRegionCount = 2 * mcubesCpuBatchMaxChunks;
+static const uint32_t regionHeaderWords  = MCUBES_GEOMETRIES_PER_CHUNK * MCUBES_STAGED_GEOMETRY_WORDS;
+
+static nvvk::Buffer s_stagingBuffer;  // Host-visible, written by the CPU workers. Null until mcubesCpuBatchEnable.
+static uint32_t*    s_pMappedStaging;
+
+static nvvk::DescriptorSetContainer s_descriptorSetContainer;
+
+// Timestamps at the start and end of the first timedBatchMax GPU batches of each frame slot (queries
+// 2 * (slot * timedBatchMax + i) and the next one), the number of those batches and of their chunks. Timing each
+// batch's own command buffer leaves out the time its submission spends waiting for semaphores.
+static const uint32_t timedBatchMax = 32;
+static VkQueryPool    s_queryPool   = VK_NULL_HANDLE;  // Null until mcubesCpuBatchEnable.
+static double         s_secondsPerTick;                // 0 if the compute queue has no timestamps.
+static uint64_t       s_timestampMask;
+static uint32_t       s_timedBatchCounts[2];
+static uint32_t       s_gpuChunkCounts[2];
+
+// Inputs of the CPU workers. The McubesGeometry arrays are allocated on first use, and only the pages of the cells
+// and vertices actually found get touched.
+static uint32_t                          s_emptyBlockMasks[mcubesCpuBatchMaxChunks][MCUBES_BLOCK_MASK_WORDS];
+static std::unique_ptr<McubesGeometry[]> s_pGeometryArrays[mcubesCpuBatchMaxChunks];
+
+// Result of the CPU work started by mcubesCpuBatchLaunch.
+struct CpuWork
+{
+  uint32_t         chunkCount;
+  uint32_t         droppedBlockCount;
+  double           seconds;
+  McubesBlockStats blockStats;
+};
+static std::future<CpuWork> s_cpuWork;
+
+void setupMcubesCpuBatch()
+{
+  // Set up descriptor set layout; both bindings view the whole staging ring, read by mcubes_upload.comp.
+  s_descriptorSetContainer.init(g_ctx);
+  s_descriptorSetContainer.addBinding(MCUBES_UPLOAD_STAGED_GEOMETRY_BINDING, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1,
+                                      VK_SHADER_STAGE_COMPUTE_BIT);
+  s_descriptorSetContainer.addBinding(MCUBES_UPLOAD_STAGED_WORDS_BINDING, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1,
+                                      VK_SHADER_STAGE_COMPUTE_BIT);
+  s_descriptorSetContainer.initLayout();
+  g_mcubesUploadDescriptorSetLayout = s_descriptorSetContainer.getLayout();
+
+  // The descriptor set is written once the staging ring exists, before any CPU batch binds it.
+  s_descriptorSetContainer.initPool(1);
+  g_mcubesUploadDescriptorSet = s_descriptorSetContainer.getSet(0);
+  assert(g_mcubesUploadDescriptorSet);
+
+  // Timestamps need support by the compute queue family.
+  uint32_t familyCount = 0;
+  vkGetPhysicalDeviceQueueFamilyProperties(g_ctx.m_physicalDevice, &familyCount, nullptr);
+  std::vector<VkQueueFamilyProperties> families(familyCount);
+  vkGetPhysicalDeviceQueueFamilyProperties(g_ctx.m_physicalDevice, &familyCount, families.data());
+  uint32_t validBits = families[g_ctx.m_queueC.familyIndex].timestampValidBits;
+  if(validBits != 0)
+  {
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(g_ctx.m_physicalDevice, &properties);
+    s_secondsPerTick = properties.limits.timestampPeriod * 1e-9;
+    s_timestampMask  = validBits >= 64 ? ~uint64_t(0) : (uint64_t(1) << validBits) - 1u;
+  }
+}
+
+void mcubesCpuBatchEnable()
+{
+  if(s_stagingBuffer.buffer != VK_NULL_HANDLE || !mcubesCpuBatchSupported())
+    return;
+
+  // Allocate the staging ring, only used by the compute queue, and point the descriptor set at it.
+  VkBufferCreateInfo bufferInfo{VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+                                nullptr,
+                                0,
+                                VkDeviceSize(stagingRegionCount) * MCUBES_UPLOAD_REGION_WORDS * sizeof(uint32_t),
+                                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                VK_SHARING_MODE_EXCLUSIVE,
+                                0,
+                                nullptr};
+  s_stagingBuffer =
+      g_allocator.createBuffer(bufferInfo, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+  s_pMappedStaging = static_cast<uint32_t*>(g_allocator.map(s_stagingBuffer));
+  VkDescriptorBufferInfo stagingRef{s_stagingBuffer.buffer, 0, VK_WHOLE_SIZE};
+  VkWriteDescriptorSet   writes[2];
+  writes[0] = s_descriptorSetContainer.makeWrite(0, MCUBES_UPLOAD_STAGED_GEOMETRY_BINDING, &stagingRef);
+  writes[1] = s_descriptorSetContainer.makeWrite(0, MCUBES_UPLOAD_STAGED_WORDS_BINDING, &stagingRef);
+  vkUpdateDescriptorSets(g_ctx, 2, writes, 0, nullptr);
+
+  VkQueryPoolCreateInfo queryPoolInfo{VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO, nullptr, 0, VK_QUERY_TYPE_TIMESTAMP,
+                                      2 * 2 * timedBatchMax, 0};
+  NVVK_CHECK(vkCreateQueryPool(g_ctx, &queryPoolInfo, nullptr, &s_queryPool));
+}
+
+// Fold the result of the CPU work into the statistics once it is done; wait for it if wait is set.
+static void collectCpuWork(bool wait)
+{
+  if(!s_cpuWork.valid())
+    return;
+  if(!wait && s_cpuWork.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+    return;
+  CpuWork work = s_cpuWork.get();
+  float   seconds = float(work.seconds / work.chunkCount);
+  float&  average = g_mcubesCpuBatchStats.cpuSecondsPerChunk;
+  average         = average == 0.0f ? seconds : average + 0.125f * (seconds - average);
+  g_mcubesCpuBatchStats.droppedBlockCount = work.droppedBlockCount;
+  g_mcubesCpuBatchStats.blockStats        = work.blockStats;
+}
+
+void shutdownMcubesCpuBatch()
+{
+  collectCpuWork(true);
+  if(s_stagingBuffer.buffer != VK_NULL_HANDLE)
+  {
+    vkDestroyQueryPool(g_ctx, s_queryPool, nullptr);
+    s_queryPool = VK_NULL_HANDLE;
+    g_allocator.unmap(s_stagingBuffer);
+    g_allocator.destroy(s_stagingBuffer);
+    s_stagingBuffer = nvvk::Buffer();
+  }
+  s_descriptorSetContainer.deinit();
+  for(std::unique_ptr<McubesGeometry[]>& pGeometryArray : s_pGeometryArrays)
+  {
+    pGeometryArray.reset();
+  }
+}
+
+bool mcubesCpuBatchSupported()
+{
+  return s_secondsPerTick != 0.0;
+}
+
+uint32_t mcubesCpuBatchSplit(uint32_t jobCount)
+{
+  uint32_t count = 0;
+  if(s_queryPool != VK_NULL_HANDLE && jobCount >= 2)
+  {
+    // Until both sides are measured, give the CPU one chunk. Then, finish both at the same time:
+    // count * cpuSecondsPerChunk == (jobCount - count) * gpuSecondsPerChunk.
+    float cpu = g_mcubesCpuBatchStats.cpuSecondsPerChunk, gpu = g_mcubesCpuBatchStats.gpuSecondsPerChunk;
+    count     = cpu > 0.0f && gpu > 0.0f ? uint32_t(lroundf(float(jobCount) * gpu / (cpu + gpu))) : 1u;
+    count     = std::max(1u, std::min(count, std::min(jobCount - 1u, mcubesCpuBatchMaxChunks)));
+  }
+  g_mcubesCpuBatchStats.chunkCount = count;
+  g_mcubesCpuBatchStats.jobCount   = jobCount;
+  return count;
+}
+
+void mcubesCpuBatchCollect(uint32_t slot)
+{
+  assert(slot < 2);
+  collectCpuWork(false);
+  uint32_t batchCount      = s_timedBatchCounts[slot];
+  uint32_t chunkCount      = s_gpuChunkCounts[slot];
+  s_timedBatchCounts[slot] = 0;
+  s_gpuChunkCounts[slot]   = 0;
+  if(chunkCount == 0)
+    return;
+  uint64_t timestamps[2 * timedBatchMax];
+  VkResult result = vkGetQueryPoolResults(g_ctx, s_queryPool, 2 * slot * timedBatchMax, 2 * batchCount,
+                                          sizeof timestamps, timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+  if(result != VK_SUCCESS)
+    return;
+
+  // Add up the time covered by the batches, relative to the first one's start; successive submissions may overlap,
+  // which must not count twice.
+  std::vector<std::pair<uint64_t, uint64_t>> intervals(batchCount);
+  for(uint32_t i = 0; i < batchCount; ++i)
+  {
+    uint64_t begin = (timestamps[2 * i] - timestamps[0]) & s_timestampMask;
+    uint64_t end   = (timestamps[2 * i + 1] - timestamps[0]) & s_timestampMask;
+    intervals[i]   = {begin, std::max(begin, end)};
+  }
+  std::sort(intervals.begin(), intervals.end());
+  uint64_t ticks = 0, coveredEnd = 0;
+  for(const std::pair<uint64_t, uint64_t>& interval : intervals)
+  {
+    uint64_t begin = std::max(interval.first, coveredEnd);
+    if(interval.second > begin)
+    {
+      ticks += interval.second - begin;
+      coveredEnd = interval.second;
+    }
+  }
+
+  float  seconds = float(double(ticks) * s_secondsPerTick / chunkCount);
+  float& average = g_mcubesCpuBatchStats.gpuSecondsPerChunk;
+  average        = average == 0.0f ? seconds : average + 0.125f * (seconds - average);
+}
+
+// Compact the McubesGeometry array of a chunk into the given staging region. Returns the number of McubesGeometry
+// that did not fit, which are staged without cells.
+static uint32_t stageChunk(const McubesGeometry* pGeometryArray, uint32_t region)
+{
+  uint32_t              regionBegin  = region * MCUBES_UPLOAD_REGION_WORDS;
+  uint32_t              regionEnd    = regionBegin + MCUBES_UPLOAD_REGION_WORDS;
+  uint32_t              nextWord     = regionBegin + regionHeaderWords;
+  uint32_t              droppedCount = 0;
+  McubesStagedGeometry* pStaged      = reinterpret_cast<McubesStagedGeometry*>(s_pMappedStaging + regionBegin);
+  for(uint32_t i = 0; i < MCUBES_GEOMETRIES_PER_CHUNK; ++i)
+  {
+    const McubesGeometry& geometry  = pGeometryArray[i];
+    uint32_t              cellCount = geometry.vertexCount / 12u;
+    uint32_t              vertCount = cellCount == 0 ? 0 : geometry.packedVertCount;
+    if(nextWord + cellCount + 2 * vertCount > regionEnd)
+    {
+      droppedCount++;
+      cellCount = 0;
+      vertCount = 0;
+    }
+
+    // Assemble the record first, to write the (possibly write-combined) staging memory only once.
+    McubesStagedGeometry staged{};
+    if(cellCount != 0)
+    {
+      staged.packedVertScale = geometry.packedVertScale;
+      staged.origin          = geometry.origin;
+      for(uint32_t level = 0; level < MCUBES_MAX_ISO_LEVELS; ++level)
+      {
+        staged.levelCellEnds[level] = geometry.levelCellEnds[level];
+      }
+    }
+    staged.packedVertCount = vertCount;
+    staged.cellCount       = cellCount;
+    staged.firstWord       = nextWord;
+    pStaged[i]             = staged;
+
+    memcpy(s_pMappedStaging + nextWord, geometry.cells, cellCount * sizeof(uint32_t));
+    nextWord += cellCount;
+    memcpy(s_pMappedStaging + nextWord, geometry.packedVerts, vertCount * sizeof(uint32_t));
+    nextWord += vertCount;
+    memcpy(s_pMappedStaging + nextWord, geometry.packedNormals, vertCount * sizeof(uint32_t));
+    nextWord += vertCount;
+  }
+  return droppedCount;
+}
+
+void mcubesCpuBatchLaunch(const Equation&        equation,
+                          uint32_t               count,
+                          const McubesParams*    pJobs,
+                          const uint32_t* const* ppEmptyBlockMasks,
+                          uint32_t               slot,
+                          VkSemaphore            semaphore,
+                          uint64_t               signalValue)
+{
+  assert(count != 0 && count <= mcubesCpuBatchMaxChunks && slot < 2);
+  collectCpuWork(true);  // Its inputs are reused.
+
+  std::vector<McubesCpuChunk> chunks(count);
+  for(uint32_t i = 0; i < count; ++i)
+  {
+    memcpy(s_emptyBlockMasks[i], ppEmptyBlockMasks[i], sizeof s_emptyBlockMasks[i]);
+    if(!s_pGeometryArrays[i])
+    {
+      s_pGeometryArrays[i].reset(new McubesGeometry[MCUBES_GEOMETRIES_PER_CHUNK]);
+    }
+    chunks[i] = {pJobs[i], s_emptyBlockMasks[i], nullptr, s_pGeometryArrays[i].get()};
+  }
+
+  // The workers only touch the staging regions of this slot and the semaphore, so the caller can go on
+  // recording (and submitting commands that wait for signalValue) meanwhile.
+  s_cpuWork = std::async(std::launch::async, [equation, chunks, slot, semaphore, signalValue] {
+    auto    start = std::chrono::steady_clock::now();
+    CpuWork work{uint32_t(chunks.size()), 0, 0.0, {}};
+    mcubesCpuFillChunks(equation, work.chunkCount, chunks.data(), &work.blockStats);
+    for(uint32_t i = 0; i < work.chunkCount; ++i)
+    {
+      work.droppedBlockCount += stageChunk(chunks[i].pGeometryArray, mcubesCpuBatchRegion(slot, i));
+    }
+
+    VkSemaphoreSignalInfo signalInfo{VK_STRUCTURE_TYPE_SEMAPHORE_SIGNAL_INFO, nullptr, semaphore, signalValue};
+    NVVK_CHECK(vkSignalSemaphoreKHR(g_ctx, &signalInfo));  // or vkSignalSemaphore in Vulkan 1.2
+    work.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return work;
+  });
+}
+
+void mcubesCpuBatchCmdBeginGpuTiming(VkCommandBuffer cmdBuf, uint32_t slot)
+{
+  if(s_queryPool == VK_NULL_HANDLE || s_timedBatchCounts[slot] == timedBatchMax)
+    return;
+  uint32_t query = 2 * (slot * timedBatchMax + s_timedBatchCounts[slot]);
+  vkCmdResetQueryPool(cmdBuf, s_queryPool, query, 2);
+  vkCmdWriteTimestamp(cmdBuf, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, s_queryPool, query);
+}
+
+void mcubesCpuBatchCmdEndGpuTiming(VkCommandBuffer cmdBuf, uint32_t slot, uint32_t chunkCount)
+{
+  if(s_queryPool == VK_NULL_HANDLE || s_timedBatchCounts[slot] == timedBatchMax)
+    return;
+  uint32_t query = 2 * (slot * timedBatchMax + s_timedBatchCounts[slot]) + 1;
+  vkCmdWriteTimestamp(cmdBuf, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, s_queryPool, query);
+  s_timedBatchCounts[slot]++;
+  s_gpuChunkCounts[slot] += chunkCount;
+}
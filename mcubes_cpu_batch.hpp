@@ -0,0 +1,83 @@
+// Copyright 2021 NVIDIA CORPORATION
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <stdint.h>
+#include <vulkan/vulkan.h>
+
+#include "mcubes_chunk.hpp"
+
+#include "shaders/mcubes_params.h"
+
+// Heterogeneous meshing: computeDrawCommandsTwoQueues hands a share of each frame's chunks to the CPU mesher
+// (mcubes_cpu.hpp), which runs on worker threads while the frame's other chunks are recorded and computed.
+// The CPU writes the resulting McubesGeometry arrays, compacted, into a persistently mapped staging ring (see
+// shaders/mcubes_upload.h) and then signals a timeline semaphore from the host with vkSignalSemaphore; the
+// compute queue waits for that value before mcubes_upload.comp expands them into the McubesChunk geometry buffers.
+//
+// The share balances the measured throughputs: moving averages of the CPU's wall time per chunk and of the
+// compute queue's time per GPU-meshed chunk (from timestamp queries). The CPU always gets at least one chunk
+// (so that its throughput stays measured) and the GPU at least one.
+
+struct Equation;
+
+// Maximum number of chunks meshed on the CPU per frame; the staging ring has this many regions per frame slot.
+static const uint32_t mcubesCpuBatchMaxChunks = MCUBES_MAX_CHUNKS_PER_BATCH;
+
+// Counts for display.
+struct McubesCpuBatchStats
+{
+  uint32_t         chunkCount;          // Chunks given to the CPU by the latest mcubesCpuBatchSplit,
+  uint32_t         jobCount;            // out of this many.
+  uint32_t         droppedBlockCount;   // McubesGeometry of the latest CPU work that did not fit in the staging.
+  float            cpuSecondsPerChunk;  // Moving averages, 0 until measured.
+  float            gpuSecondsPerChunk;
+  McubesBlockStats blockStats;          // As g_mcubesBlockStats, for the chunks of the latest CPU work.
+};
+extern McubesCpuBatchStats g_mcubesCpuBatchStats;
+
+// binding = MCUBES_UPLOAD_*_BINDING refer to the staging ring (see shaders/mcubes_upload.h).
+extern VkDescriptorSetLayout g_mcubesUploadDescriptorSetLayout;
+extern VkDescriptorSet       g_mcubesUploadDescriptorSet;
+
+void setupMcubesCpuBatch();
+void shutdownMcubesCpuBatch();  // Also waits for the CPU to finish.
+
+// Whether the compute queue supports the timestamps needed to measure its throughput; if not, nothing
+// should be meshed on the CPU.
+bool mcubesCpuBatchSupported();
+
+// Allocate the staging ring and the timestamp queries, if not done yet: the first time CPU meshing is used, as it
+// is off by default. No-op if not mcubesCpuBatchSupported().
+void mcubesCpuBatchEnable();
+
+// Number of the frame's jobCount jobs to mesh on the CPU; 0 before mcubesCpuBatchEnable.
+uint32_t mcubesCpuBatchSplit(uint32_t jobCount);
+
+// Update the throughput estimates with the measurements of the given frame slot (0 or 1), and the statistics.
+// Ensure that no commands recorded for that slot are pending, as for mcubesCollectBlockStats.
+void mcubesCpuBatchCollect(uint32_t slot);
+
+// Start meshing the given jobs (at most mcubesCpuBatchMaxChunks, skipping the McubesGeometry blocks in
+// ppEmptyBlockMasks[i] as McubesChunk::emptyBlockMask) on worker threads, into the staging regions of the given
+// frame slot, then signal semaphore := signalValue from the host. Waits for the CPU work started by the previous
+// call first. Ensure that no commands uploading from the slot's regions are pending, as above.
+void mcubesCpuBatchLaunch(const Equation&        equation,
+                          uint32_t               count,
+                          const McubesParams*    pJobs,
+                          const uint32_t* const* ppEmptyBlockMasks,
+                          uint32_t               slot,
+                          VkSemaphore            semaphore,
+                          uint64_t               signalValue);
+
+// Staging region of the i-th chunk launched for the given frame slot, for computeCmdUploadChunkBatch.
+inline uint32_t mcubesCpuBatchRegion(uint32_t slot, uint32_t i)
+{
+  return slot * mcubesCpuBatchMaxChunks + i;
+}
+
+// Write the timestamps bracketing the compute commands of one batch of GPU-meshed chunks, chunkCount of them, for
+// the given frame slot: Begin at the start of the batch's compute command buffer, End after its fill commands.
+// Only the first few batches of a frame are timed. No-op before mcubesCpuBatchEnable.
+void mcubesCpuBatchCmdBeginGpuTiming(VkCommandBuffer cmdBuf, uint32_t slot);
+void mcubesCpuBatchCmdEndGpuTiming(VkCommandBuffer cmdBuf, uint32_t slot, uint32_t chunkCount);
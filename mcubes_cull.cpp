@@ -0,0 +1,161 @@
+// Copyright 2021 NVIDIA CORPORATION
+// SPDX-License-Identifier: Apache-2.0
+#include "mcubes_cull.hpp"
+
+#include <algorithm>
+#include <math.h>
+#include <string.h>
+
+#include "equation.hpp"
+
+McubesCullStats g_mcubesCullStats;
+
+// Number of McubesGeometry blocks along each axis of a chunk.
+static const uint32_t blocksPerEdge = MCUBES_CHUNK_EDGE_LENGTH_TEXELS / MCUBES_GEOMETRY_EDGE_LENGTH;
+
+// Texel range covered by the cells of a whole chunk.
+static const uint32_t chunkTexelLo[3] = {0, 0, 0};
+static const uint32_t chunkTexelHi[3] = {MCUBES_CHUNK_EDGE_LENGTH_CELLS, MCUBES_CHUNK_EDGE_LENGTH_CELLS,
+                                         MCUBES_CHUNK_EDGE_LENGTH_CELLS};
+
+// Set box to the world coordinates of the given texel range of the chunk
+// (inclusive, in units of texels, i.e. mcubes_image.comp's tx, ty, tz).
+static void getTexelBox(const McubesParams& params, const uint32_t lo[3], const uint32_t hi[3], EquationInterval box[3])
+{
+  for(int axis = 0; axis < 3; ++axis)
+  {
+    double offset = params.offset[axis], size = params.size[axis];
+    double a      = offset + size * (double(lo[axis]) / MCUBES_CHUNK_EDGE_LENGTH_CELLS);
+    double b      = offset + size * (double(hi[axis]) / MCUBES_CHUNK_EDGE_LENGTH_CELLS);
+    // Pad for float rounding of the texel coordinates computed by mcubes_image.comp.
+    double pad = 1e-5 * (fabs(offset) + fabs(size));
+    box[axis]  = {std::min(a, b) - pad, std::max(a, b) + pad};
+  }
+}
+
+// Returns whether the equation is proven to have no zero over the given texel range of the chunk.
+static bool provenEmpty(const Equation&     equation,
+                        const McubesParams& params,
+                        const uint32_t      lo[3],
+                        const uint32_t      hi[3])
+{
+  EquationInterval box[3];
+  getTexelBox(params, lo, hi, box);
+  EquationInterval value =
+      equationEvaluateInterval(equation, box[0], box[1], box[2], params.t, &params.userParams.x);
+
+  // Marching cubes only sees a surface between texels with value > level and those with value <= level.
+  // Demand some margin, as the GPU evaluates in (possibly approximate) float arithmetic.
+  double margin = 1e-4 * (1.0 + std::max(fabs(value.lo), fabs(value.hi)));
+  for(uint32_t i = 0; i < params.isoLevelCount; ++i)
+  {
+    double level = (&params.isoLevels.x)[i];
+    if(value.lo - level <= margin && value.hi - level >= -margin)
+      return false;
+  }
+  return true;
+}
+
+void cullResetStats(uint32_t jobCount)
+{
+  g_mcubesCullStats = {jobCount, 0, 0, 0, 0, 0};
+}
+
+void cullMcubesJobs(const Equation& equation, std::vector<McubesParams>* pJobs)
+{
+  size_t oldSize = pJobs->size();
+  pJobs->erase(std::remove_if(pJobs->begin(), pJobs->end(),
+                              [&](const McubesParams& params) {
+                                return provenEmpty(equation, params, chunkTexelLo, chunkTexelHi);
+                              }),
+               pJobs->end());
+  g_mcubesCullStats.culledChunkCount += uint32_t(oldSize - pJobs->size());
+}
+
+void cullSetCsgSkipMasks(const Equation& equation, std::vector<McubesParams>* pJobs)
+{
+  uint32_t csgNodeCount = equationCountCsgNodes(equation);
+  for(McubesParams& params : *pJobs)
+  {
+    EquationInterval box[3];
+    getTexelBox(params, chunkTexelLo, chunkTexelHi, box);
+    params.csgSkipMask = equationCsgSkipMask(equation, box[0], box[1], box[2], params.t, &params.userParams.x);
+    g_mcubesCullStats.csgOperandCount += 2 * csgNodeCount;
+    for(uint32_t mask = params.csgSkipMask; mask != 0; mask &= mask - 1)
+    {
+      g_mcubesCullStats.csgSkippedCount++;
+    }
+  }
+}
+
+// Recursively test the box of blocks [blockLo, blockHi) (exclusive upper bound, in units of blocks),
+// splitting in half along each axis until proven empty or down to single blocks.
+static void cullBlockRange(const Equation&     equation,
+                           const McubesParams& params,
+                           const uint32_t      blockLo[3],
+                           const uint32_t      blockHi[3],
+                           uint32_t*           pMask)
+{
+  // Texels used by the cells in these blocks; cells exist strictly between samples.
+  uint32_t texelLo[3], texelHi[3];
+  for(int axis = 0; axis < 3; ++axis)
+  {
+    texelLo[axis] = blockLo[axis] * MCUBES_GEOMETRY_EDGE_LENGTH;
+    texelHi[axis] = std::min<uint32_t>(blockHi[axis] * MCUBES_GEOMETRY_EDGE_LENGTH, MCUBES_CHUNK_EDGE_LENGTH_CELLS);
+  }
+
+  if(provenEmpty(equation, params, texelLo, texelHi))
+  {
+    for(uint32_t z = blockLo[2]; z < blockHi[2]; ++z)
+    {
+      for(uint32_t y = blockLo[1]; y < blockHi[1]; ++y)
+      {
+        for(uint32_t x = blockLo[0]; x < blockHi[0]; ++x)
+        {
+          uint32_t blockIndex = x + blocksPerEdge * (y + blocksPerEdge * z);  // Matches mcubes_geometry.comp
+          pMask[blockIndex / 32u] |= 1u << (blockIndex % 32u);
+          g_mcubesCullStats.culledBlockCount++;
+        }
+      }
+    }
+    return;
+  }
+
+  // Split into up to 8 children.
+  uint32_t mid[3];
+  bool     canSplit = false;
+  for(int axis = 0; axis < 3; ++axis)
+  {
+    mid[axis] = (blockLo[axis] + blockHi[axis]) / 2u;
+    canSplit |= mid[axis] != blockLo[axis];
+  }
+  if(!canSplit)
+    return;
+  for(uint32_t child = 0; child < 8; ++child)
+  {
+    uint32_t childLo[3], childHi[3];
+    bool     childEmpty = false;
+    for(int axis = 0; axis < 3; ++axis)
+    {
+      bool upper      = (child >> axis) & 1u;
+      childLo[axis]   = upper ? mid[axis] : blockLo[axis];
+      childHi[axis]   = upper ? blockHi[axis] : mid[axis];
+      childEmpty |= childLo[axis] == childHi[axis];  // Axis not split
+    }
+    if(!childEmpty)
+    {
+      cullBlockRange(equation, params, childLo, childHi, pMask);
+    }
+  }
+}
+
+void cullGetEmptyBlockMask(const Equation* pEquation, const McubesParams& params, uint32_t* pMask)
+{
+  memset(pMask, 0, MCUBES_BLOCK_MASK_WORDS * sizeof(uint32_t));
+  if(pEquation != nullptr)
+  {
+    const uint32_t blockLo[3] = {0, 0, 0};
+    const uint32_t blockHi[3] = {blocksPerEdge, blocksPerEdge, blocksPerEdge};
+    cullBlockRange(*pEquation, params, blockLo, blockHi, pMask);
+  }
+}
@@ -0,0 +1,41 @@
+// Copyright 2021 NVIDIA CORPORATION
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+#include "shaders/mcubes_params.h"
+
+// CPU-side culling of marching cubes work that provably contains no surface, i.e. chunks or
+// McubesGeometry blocks over whose bounding box the equation attains none of the iso-levels.
+// This is proven with interval arithmetic (see equationEvaluateInterval).
+
+struct Equation;
+
+// Counts from the most recent frame, for display.
+struct McubesCullStats
+{
+  uint32_t jobCount;            // Number of chunks requested, before culling.
+  uint32_t culledChunkCount;    // Number of those chunks removed by cullMcubesJobs.
+  uint32_t culledBlockCount;    // Number of McubesGeometry blocks marked empty by cullGetEmptyBlockMask.
+  uint32_t mirroredChunkCount;  // Number of chunks drawn as reflections of others (see mcubes_symmetry.hpp).
+  uint32_t csgOperandCount;     // Number of CSG operand evaluations in the remaining chunks, without skipping.
+  uint32_t csgSkippedCount;     // Number of those skipped by cullSetCsgSkipMasks.
+};
+extern McubesCullStats g_mcubesCullStats;
+
+// Reset g_mcubesCullStats for a new frame with the given number of (unculled) jobs.
+void cullResetStats(uint32_t jobCount);
+
+// Remove jobs whose chunk is proven to contain no surface.
+void cullMcubesJobs(const Equation& equation, std::vector<McubesParams>* pJobs);
+
+// Set McubesParams::csgSkipMask of each job to the CSG operands proven not to affect its chunk
+// (see equationCsgSkipMask); in effect, each operand is evaluated only within its own bounds.
+void cullSetCsgSkipMasks(const Equation& equation, std::vector<McubesParams>* pJobs);
+
+// Fill the MCUBES_BLOCK_MASK_WORDS-long bitmask of McubesGeometry blocks of the chunk described by params
+// that are proven to contain no surface; bit i (of word i / 32) corresponds to geometryArray[i].
+// If pEquation is null, the mask is all zeros (nothing culled).
+void cullGetEmptyBlockMask(const Equation* pEquation, const McubesParams& params, uint32_t* pMask);
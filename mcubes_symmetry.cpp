@@ -0,0 +1,165 @@
+// Copyright 2021 NVIDIA CORPORATION
+// SPDX-License-Identifier: Apache-2.0
+#include "mcubes_symmetry.hpp"
+
+#include <algorithm>
+#include <math.h>
+
+#include "equation.hpp"
+
+// Mask of axes mirrored by a group element (bit 0 = x, 1 = y, 2 = z) to MCUBES_MIRROR_* bits.
+static_assert(MCUBES_MIRROR_X_BIT == 1 && MCUBES_MIRROR_Y_BIT == 2 && MCUBES_MIRROR_Z_BIT == 4, "Masks used as-is");
+
+static uint32_t popcount3(uint32_t mask)
+{
+  return (mask & 1u) + (mask >> 1 & 1u) + (mask >> 2 & 1u);
+}
+
+static uint32_t lowestBit(uint32_t mask)
+{
+  return mask & (~mask + 1u);
+}
+
+// Set of masks (bit m set for mask m) generated by the given set of masks.
+static uint32_t groupClosure(uint32_t generators)
+{
+  uint32_t group = 1u;  // Identity
+  for(uint32_t mask = 1; mask < 8; ++mask)
+  {
+    if(generators & (1u << mask))
+    {
+      for(uint32_t element = 0; element < 8; ++element)
+      {
+        group |= (group >> element & 1u) << (element ^ mask);
+      }
+    }
+  }
+  return group;
+}
+
+// Reduced row echelon basis (over GF(2)) of a group of masks; the pivot of each basis element is its
+// lowest set bit, and no other basis element has that bit set. Returns the basis size.
+static uint32_t groupBasis(uint32_t group, uint32_t basis[3])
+{
+  uint32_t count = 0;
+  for(uint32_t mask = 1; mask < 8; ++mask)
+  {
+    if(!(group & (1u << mask)))
+      continue;
+    uint32_t reduced = mask;
+    for(uint32_t i = 0; i < count; ++i)
+    {
+      reduced ^= reduced & lowestBit(basis[i]) ? basis[i] : 0u;
+    }
+    if(reduced == 0)
+      continue;
+    for(uint32_t i = 0; i < count; ++i)
+    {
+      basis[i] ^= basis[i] & lowestBit(reduced) ? reduced : 0u;
+    }
+    basis[count++] = reduced;
+  }
+  return count;
+}
+
+uint32_t symmetryReduceMcubesJobs(const EquationSymmetry&    symmetry,
+                                  std::vector<McubesParams>* pJobs,
+                                  McubesSymmetry*            pOut)
+{
+  *pOut = McubesSymmetry{};
+  if(pJobs->empty())
+    return 0;
+
+  // An odd symmetry maps the surface at iso-level c to the one at -c, so it only holds for level 0.
+  uint32_t            oddMasks = symmetry.oddMasks;
+  const McubesParams& front    = pJobs->front();
+  for(uint32_t level = 0; level < front.isoLevelCount; ++level)
+  {
+    oddMasks = (&front.isoLevels.x)[level] != 0.0f ? 0u : oddMasks;
+  }
+  uint32_t symmetricMasks = symmetry.evenMasks | oddMasks | 1u;
+  if(symmetricMasks == 1u)
+    return 0;
+
+  // Bounding box of the job grid; which axes it is symmetric about, and which have no chunk straddling 0.
+  uint32_t symmetricAxes = 0, splitAxes = 0;
+  for(uint32_t axis = 0; axis < 3; ++axis)
+  {
+    float low = INFINITY, high = -INFINITY;
+    for(const McubesParams& params : *pJobs)
+    {
+      low  = std::min(low, params.offset[axis]);
+      high = std::max(high, params.offset[axis] + params.size[axis]);
+    }
+    float epsilon = 1e-4f * (high - low);
+    bool  split   = true;
+    for(const McubesParams& params : *pJobs)
+    {
+      split &= params.offset[axis] >= -epsilon || params.offset[axis] + params.size[axis] <= epsilon;
+    }
+    symmetricAxes |= fabsf(low + high) <= epsilon ? 1u << axis : 0u;
+    splitAxes |= split ? 1u << axis : 0u;
+  }
+
+  // Find the largest usable group: mirror only symmetric axes, and skip chunks only along split axes.
+  uint32_t bestGroup = 1u, bestBasis[3] = {}, bestBasisCount = 0;
+  for(uint32_t generators = 0; generators < 256u; generators += 2u)
+  {
+    uint32_t group = groupClosure(generators);
+    uint32_t basis[3], basisCount = groupBasis(group, basis);
+    bool     usable = (group & ~symmetricMasks) == 0;
+    for(uint32_t i = 0; i < basisCount; ++i)
+    {
+      usable &= (basis[i] & ~symmetricAxes) == 0 && (lowestBit(basis[i]) & splitAxes) != 0;
+    }
+    if(usable && basisCount > bestBasisCount)
+    {
+      bestGroup      = group;
+      bestBasisCount = basisCount;
+      std::copy(basis, basis + basisCount, bestBasis);
+    }
+  }
+  if(bestBasisCount == 0)
+    return 0;
+
+  // Keep the chunks on the positive side of each pivot axis.
+  size_t oldSize = pJobs->size();
+  pJobs->erase(std::remove_if(pJobs->begin(), pJobs->end(),
+                              [&](const McubesParams& params) {
+                                for(uint32_t i = 0; i < bestBasisCount; ++i)
+                                {
+                                  uint32_t axis = bestBasis[i] & 1u ? 0 : bestBasis[i] & 2u ? 1 : 2;
+                                  if(params.offset[axis] + 0.5f * params.size[axis] < 0.0f)
+                                    return true;
+                                }
+                                return false;
+                              }),
+               pJobs->end());
+
+  // Reflecting an odd number of axes reverses triangle winding; for an even equation that has to be
+  // undone, while for an odd equation it correctly accounts for the inside and outside being swapped.
+  pOut->mirrorCount = 0;
+  for(uint32_t mask = 0; mask < 8; ++mask)
+  {
+    if(bestGroup & (1u << mask))
+    {
+      bool oddEquation = (symmetry.evenMasks & (1u << mask)) == 0 && (oddMasks & (1u << mask)) != 0;
+      bool swap        = (popcount3(mask) & 1u) != uint32_t(oddEquation);
+      pOut->mirrorFlags[pOut->mirrorCount++] = mask | (swap ? MCUBES_MIRROR_SWAP_WINDING_BIT : 0u);
+    }
+  }
+  return uint32_t(oldSize - pJobs->size());
+}
+
+McubesParams symmetryMirrorBox(const McubesParams& params, uint32_t mirrorFlags)
+{
+  McubesParams result = params;
+  for(uint32_t axis = 0; axis < 3; ++axis)
+  {
+    if(mirrorFlags & (1u << axis))
+    {
+      result.offset[axis] = -(params.offset[axis] + params.size[axis]);
+    }
+  }
+  return result;
+}
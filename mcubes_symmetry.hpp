@@ -0,0 +1,32 @@
+// Copyright 2021 NVIDIA CORPORATION
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+#include "shaders/mcubes_params.h"
+
+// Symmetry-aware meshing: if the surface is mirror symmetric about some of the coordinate planes
+// (see equationFindSymmetry), only chunks in the fundamental region are computed, and each is drawn
+// once per element of the symmetry group, reflected in mcubes_geometry.vert.
+
+struct EquationSymmetry;
+
+// Ways to draw each computed chunk.
+struct McubesSymmetry
+{
+  uint32_t mirrorCount    = 1;   // 1, 2, 4, or 8.
+  uint32_t mirrorFlags[8] = {};  // MCUBES_MIRROR_* bits; mirrorFlags[0] is always 0 (identity).
+};
+
+// Find the largest group of mirror symmetries among those given that is compatible with the job grid
+// (bounding box symmetric about the mirror planes, no chunk straddling a plane that is skipped), remove
+// the jobs outside its fundamental region, and describe how to draw the remaining chunks in *pOut.
+// Returns the number of jobs removed.
+uint32_t symmetryReduceMcubesJobs(const EquationSymmetry&    symmetry,
+                                   std::vector<McubesParams>* pJobs,
+                                   McubesSymmetry*            pOut);
+
+// Reflect the box described by params by the given MCUBES_MIRROR_* bits.
+McubesParams symmetryMirrorBox(const McubesParams& params, uint32_t mirrorFlags);
@@ -0,0 +1,330 @@
+// Copyright 2021 NVIDIA CORPORATION
+// SPDX-License-Identifier: Apache-2.0
+#include "memory_allocator.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+static VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment)
+{
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+void SuballocatingMemAllocator::init(VkDevice device, VkPhysicalDevice physicalDevice, VkDeviceSize blockSize)
+{
+  m_device         = device;
+  m_physicalDevice = physicalDevice;
+  m_blockSize      = blockSize;
+  vkGetPhysicalDeviceMemoryProperties(physicalDevice, &m_memoryProperties);
+}
+
+void SuballocatingMemAllocator::deinit()
+{
+  assert(m_allocationCount == 0);
+  while(!m_blocks.empty())
+  {
+    freeBlock(m_blocks.back().get());
+  }
+}
+
+void SuballocatingMemAllocator::setLinear(bool linear)
+{
+  m_linear = linear;
+}
+
+void SuballocatingMemAllocator::releaseEmptyBlocks()
+{
+  for(size_t i = m_blocks.size(); i-- > 0;)
+  {
+    if(m_blocks[i]->allocationCount == 0)
+      freeBlock(m_blocks[i].get());
+  }
+}
+
+MemAllocatorStats SuballocatingMemAllocator::getStats() const
+{
+  MemAllocatorStats stats{};
+  stats.deviceMemoryCount = uint32_t(m_blocks.size());
+  stats.allocationCount   = m_allocationCount;
+  stats.usedBytes         = m_usedBytes;
+  VkDeviceSize freeBytes = 0, largestFreeRange = 0;
+  for(const std::unique_ptr<Block>& pBlock : m_blocks)
+  {
+    stats.allocatedBytes += pBlock->size;
+    for(const auto& range : pBlock->freeRanges)
+    {
+      freeBytes += range.second;
+      largestFreeRange = std::max(largestFreeRange, range.second);
+    }
+  }
+  stats.fragmentation = freeBytes == 0 ? 0.0f : 1.0f - float(double(largestFreeRange) / double(freeBytes));
+  return stats;
+}
+
+nvvk::MemHandle SuballocatingMemAllocator::allocMemory(const nvvk::MemAllocateInfo& allocInfo, VkResult* pResult)
+{
+  const VkMemoryRequirements& requirements = allocInfo.getMemoryRequirements();
+  VkMemoryPropertyFlags       properties   = allocInfo.getMemoryProperties();
+  uint32_t                    typeIndex    = findMemoryType(requirements.memoryTypeBits, properties);
+  if(typeIndex == ~0u && (properties & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT) != 0)
+  {
+    typeIndex = findMemoryType(requirements.memoryTypeBits, properties & ~VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+  }
+  if(typeIndex == ~0u)
+  {
+    if(pResult)
+      *pResult = VK_ERROR_OUT_OF_DEVICE_MEMORY;
+    return nullptr;
+  }
+  assert(!allocInfo.getExportable());
+
+  // Find room in an existing block of the pool, or allocate a new block (or dedicated allocation).
+  bool dedicated = allocInfo.getDedicatedBuffer() != VK_NULL_HANDLE || allocInfo.getDedicatedImage() != VK_NULL_HANDLE
+                   || allocInfo.getAllocationFlags() != 0 || requirements.size > m_blockSize / 2;
+  Block*       pBlock = nullptr;
+  VkDeviceSize offset = 0;
+  if(!dedicated)
+  {
+    for(const std::unique_ptr<Block>& pCandidate : m_blocks)
+    {
+      if(!pCandidate->dedicated && pCandidate->memoryTypeIndex == typeIndex && pCandidate->linear == m_linear
+         && pCandidate->tilingOptimal == allocInfo.getTilingOptimal() && suballocate(pCandidate.get(), requirements, &offset))
+      {
+        pBlock = pCandidate.get();
+        break;
+      }
+    }
+  }
+  if(pBlock == nullptr)
+  {
+    pBlock = allocBlock(allocInfo, typeIndex, dedicated ? requirements.size : m_blockSize, dedicated, pResult);
+    if(pBlock == nullptr)
+      return nullptr;
+    bool fits = suballocate(pBlock, requirements, &offset);
+    assert(fits);
+    (void)fits;
+  }
+
+  Allocation* pAllocation = new Allocation;
+  pAllocation->pBlock     = pBlock;
+  pAllocation->offset     = offset;
+  pAllocation->size       = requirements.size;
+  pBlock->allocationCount++;
+  m_allocationCount++;
+  m_usedBytes += requirements.size;
+  if(pResult)
+    *pResult = VK_SUCCESS;
+  return pAllocation;
+}
+
+void SuballocatingMemAllocator::freeMemory(nvvk::MemHandle memHandle)
+{
+  if(memHandle == nullptr)
+    return;
+  Allocation* pAllocation = static_cast<Allocation*>(memHandle);
+  Block*      pBlock      = pAllocation->pBlock;
+  assert(pBlock->allocationCount > 0);
+  pBlock->allocationCount--;
+  m_allocationCount--;
+  m_usedBytes -= pAllocation->size;
+
+  if(pBlock->dedicated)
+  {
+    freeBlock(pBlock);
+  }
+  else if(pBlock->linear)
+  {
+    if(pBlock->allocationCount == 0)
+      pBlock->linearOffset = 0;
+  }
+  else
+  {
+    // Return the range to the free list, merging it with adjacent free ranges.
+    VkDeviceSize begin = pAllocation->offset;
+    VkDeviceSize end   = pAllocation->offset + pAllocation->size;
+    auto         next  = pBlock->freeRanges.lower_bound(begin);
+    if(next != pBlock->freeRanges.end() && next->first == end)
+    {
+      end = next->first + next->second;
+      next = pBlock->freeRanges.erase(next);
+    }
+    if(next != pBlock->freeRanges.begin())
+    {
+      auto previous = std::prev(next);
+      if(previous->first + previous->second == begin)
+      {
+        begin = previous->first;
+        pBlock->freeRanges.erase(previous);
+      }
+    }
+    pBlock->freeRanges[begin] = end - begin;
+
+    // Keep one empty block per pool for reuse.
+    if(pBlock->allocationCount == 0)
+    {
+      for(const std::unique_ptr<Block>& pOther : m_blocks)
+      {
+        if(pOther.get() != pBlock && !pOther->dedicated && !pOther->linear
+           && pOther->memoryTypeIndex == pBlock->memoryTypeIndex && pOther->tilingOptimal == pBlock->tilingOptimal)
+        {
+          freeBlock(pBlock);
+          break;
+        }
+      }
+    }
+  }
+  delete pAllocation;
+}
+
+nvvk::MemAllocator::MemInfo SuballocatingMemAllocator::getMemoryInfo(nvvk::MemHandle memHandle) const
+{
+  const Allocation* pAllocation = static_cast<const Allocation*>(memHandle);
+  MemInfo           info;
+  info.memory = pAllocation->pBlock->memory;
+  info.offset = pAllocation->offset;
+  info.size   = pAllocation->size;
+  return info;
+}
+
+// The whole block is mapped once, and stays mapped while any of its allocations is.
+void* SuballocatingMemAllocator::map(nvvk::MemHandle memHandle, VkDeviceSize offset, VkDeviceSize size, VkResult* pResult)
+{
+  Allocation* pAllocation = static_cast<Allocation*>(memHandle);
+  Block*      pBlock      = pAllocation->pBlock;
+  assert(size == VK_WHOLE_SIZE || offset + size <= pAllocation->size);
+  if(pBlock->mapCount == 0)
+  {
+    VkResult result = vkMapMemory(m_device, pBlock->memory, 0, VK_WHOLE_SIZE, 0, &pBlock->pMapped);
+    if(pResult)
+      *pResult = result;
+    if(result != VK_SUCCESS)
+      return nullptr;
+  }
+  pBlock->mapCount++;
+  return static_cast<char*>(pBlock->pMapped) + pAllocation->offset + offset;
+}
+
+void SuballocatingMemAllocator::unmap(nvvk::MemHandle memHandle)
+{
+  Block* pBlock = static_cast<Allocation*>(memHandle)->pBlock;
+  assert(pBlock->mapCount > 0);
+  if(--pBlock->mapCount == 0)
+  {
+    vkUnmapMemory(m_device, pBlock->memory);
+    pBlock->pMapped = nullptr;
+  }
+}
+
+VkDevice SuballocatingMemAllocator::getDevice() const
+{
+  return m_device;
+}
+
+VkPhysicalDevice SuballocatingMemAllocator::getPhysicalDevice() const
+{
+  return m_physicalDevice;
+}
+
+// Returns ~0u if there is no such memory type.
+uint32_t SuballocatingMemAllocator::findMemoryType(uint32_t memoryTypeBits, VkMemoryPropertyFlags properties) const
+{
+  for(uint32_t i = 0; i < m_memoryProperties.memoryTypeCount; ++i)
+  {
+    if((memoryTypeBits & (1u << i)) != 0 && (m_memoryProperties.memoryTypes[i].propertyFlags & properties) == properties)
+      return i;
+  }
+  return ~0u;
+}
+
+SuballocatingMemAllocator::Block* SuballocatingMemAllocator::allocBlock(const nvvk::MemAllocateInfo& allocInfo,
+                                                                        uint32_t                     memoryTypeIndex,
+                                                                        VkDeviceSize                 size,
+                                                                        bool                         dedicated,
+                                                                        VkResult*                    pResult)
+{
+  VkMemoryAllocateInfo memoryInfo{VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO, nullptr, size, memoryTypeIndex};
+
+  // Dedicated allocations pass on what the driver asked for.
+  VkMemoryDedicatedAllocateInfo dedicatedInfo{VK_STRUCTURE_TYPE_MEMORY_DEDICATED_ALLOCATE_INFO};
+  VkMemoryAllocateFlagsInfo     flagsInfo{VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_FLAGS_INFO};
+  if(dedicated && (allocInfo.getDedicatedBuffer() != VK_NULL_HANDLE || allocInfo.getDedicatedImage() != VK_NULL_HANDLE))
+  {
+    dedicatedInfo.buffer = allocInfo.getDedicatedBuffer();
+    dedicatedInfo.image  = allocInfo.getDedicatedImage();
+    dedicatedInfo.pNext  = memoryInfo.pNext;
+    memoryInfo.pNext     = &dedicatedInfo;
+  }
+  if(dedicated && allocInfo.getAllocationFlags() != 0)
+  {
+    flagsInfo.flags  = allocInfo.getAllocationFlags();
+    flagsInfo.pNext  = memoryInfo.pNext;
+    memoryInfo.pNext = &flagsInfo;
+  }
+
+  VkDeviceMemory memory;
+  VkResult       result = vkAllocateMemory(m_device, &memoryInfo, nullptr, &memory);
+  if(pResult)
+    *pResult = result;
+  if(result != VK_SUCCESS)
+    return nullptr;
+
+  std::unique_ptr<Block> pBlock(new Block);
+  pBlock->memory          = memory;
+  pBlock->size            = size;
+  pBlock->memoryTypeIndex = memoryTypeIndex;
+  pBlock->dedicated       = dedicated;
+  pBlock->linear          = m_linear && !dedicated;
+  pBlock->tilingOptimal   = allocInfo.getTilingOptimal();
+  if(!dedicated && !pBlock->linear)
+    pBlock->freeRanges[0] = size;
+  m_blocks.push_back(std::move(pBlock));
+  return m_blocks.back().get();
+}
+
+void SuballocatingMemAllocator::freeBlock(Block* pBlock)
+{
+  assert(pBlock->allocationCount == 0);
+  if(pBlock->mapCount != 0)
+    vkUnmapMemory(m_device, pBlock->memory);
+  vkFreeMemory(m_device, pBlock->memory, nullptr);
+  auto it = std::find_if(m_blocks.begin(), m_blocks.end(),
+                         [pBlock](const std::unique_ptr<Block>& pCandidate) { return pCandidate.get() == pBlock; });
+  assert(it != m_blocks.end());
+  m_blocks.erase(it);
+}
+
+// Reserve room for the requirements in a non-dedicated block, or for the single allocation of a dedicated block.
+bool SuballocatingMemAllocator::suballocate(Block* pBlock, const VkMemoryRequirements& requirements, VkDeviceSize* pOffset)
+{
+  if(pBlock->dedicated)
+  {
+    *pOffset = 0;
+    return pBlock->allocationCount == 0;
+  }
+  if(pBlock->linear)
+  {
+    VkDeviceSize offset = alignUp(pBlock->linearOffset, requirements.alignment);
+    if(offset + requirements.size > pBlock->size)
+      return false;
+    pBlock->linearOffset = offset + requirements.size;
+    *pOffset             = offset;
+    return true;
+  }
+  for(auto it = pBlock->freeRanges.begin(); it != pBlock->freeRanges.end(); ++it)
+  {
+    VkDeviceSize rangeBegin = it->first;
+    VkDeviceSize rangeEnd   = it->first + it->second;
+    VkDeviceSize offset     = alignUp(rangeBegin, requirements.alignment);
+    if(offset + requirements.size > rangeEnd)
+      continue;
+    // Split the range into the (possibly empty) padding before and remainder after the allocation.
+    pBlock->freeRanges.erase(it);
+    if(offset > rangeBegin)
+      pBlock->freeRanges[rangeBegin] = offset - rangeBegin;
+    if(offset + requirements.size < rangeEnd)
+      pBlock->freeRanges[offset + requirements.size] = rangeEnd - (offset + requirements.size);
+    *pOffset = offset;
+    return true;
+  }
+  return false;
+}
@@ -0,0 +1,101 @@
+// Copyright 2021 NVIDIA CORPORATION
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <map>
+#include <memory>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+#include "nvvk/memallocator_vk.hpp"
+
+// Usage statistics of a SuballocatingMemAllocator.
+struct MemAllocatorStats
+{
+  uint32_t     deviceMemoryCount;  // Live VkDeviceMemory objects (blocks and dedicated allocations)
+  uint32_t     allocationCount;    // Live allocMemory allocations
+  VkDeviceSize allocatedBytes;     // Total size of the VkDeviceMemory objects
+  VkDeviceSize usedBytes;          // Total size of the allocations, excluding alignment padding
+  float        fragmentation;      // 1 - largest free range / free bytes, over free-list blocks (0 if none free)
+};
+
+// nvvk::MemAllocator that places allocations in large blocks of VkDeviceMemory, instead of making one
+// vkAllocateMemory per resource as nvvk::ResourceAllocatorDedicated does. Blocks are pooled by memory type
+// and by linear vs. optimal tiling (so bufferImageGranularity never matters), and are either
+//   * free-list blocks (default): first fit, coalescing freed ranges with their neighbours, or
+//   * linear blocks (see setLinear): bump allocation, recycled once all of their allocations are freed.
+// Allocations larger than half a block, or that the driver wants dedicated, get their own VkDeviceMemory.
+// Like nvvk::ResourceAllocatorDedicated, this is not thread-safe.
+class SuballocatingMemAllocator : public nvvk::MemAllocator
+{
+public:
+  static const VkDeviceSize defaultBlockSize = VkDeviceSize(64) << 20;
+
+  void init(VkDevice device, VkPhysicalDevice physicalDevice, VkDeviceSize blockSize = defaultBlockSize);
+  void deinit();  // All allocations must have been freed.
+
+  // While set, allocations go to linear blocks. Meant for resources that live until shutdown, which then
+  // pay for neither per-allocation bookkeeping nor fragmentation.
+  void setLinear(bool linear);
+
+  // Free-list blocks that become empty are released, except the last of their pool (avoids reallocating
+  // when e.g. the framebuffer is resized). Release those too, and recycled linear blocks.
+  void releaseEmptyBlocks();
+
+  MemAllocatorStats getStats() const;
+
+  // nvvk::MemAllocator interface. If no memory type has all of the requested properties, device-local is
+  // dropped from them (e.g. host-visible device-local memory without resizable BAR).
+  nvvk::MemHandle  allocMemory(const nvvk::MemAllocateInfo& allocInfo, VkResult* pResult = nullptr) override;
+  void             freeMemory(nvvk::MemHandle memHandle) override;
+  MemInfo          getMemoryInfo(nvvk::MemHandle memHandle) const override;
+  void*            map(nvvk::MemHandle memHandle,
+                       VkDeviceSize    offset  = 0,
+                       VkDeviceSize    size    = VK_WHOLE_SIZE,
+                       VkResult*       pResult = nullptr) override;
+  void             unmap(nvvk::MemHandle memHandle) override;
+  VkDevice         getDevice() const override;
+  VkPhysicalDevice getPhysicalDevice() const override;
+
+private:
+  struct Block
+  {
+    VkDeviceMemory memory;
+    VkDeviceSize   size;
+    uint32_t       memoryTypeIndex;
+    bool           dedicated;
+    bool           linear;
+    bool           tilingOptimal;
+    uint32_t       allocationCount = 0;
+    VkDeviceSize   linearOffset    = 0;  // Start of the unused tail, linear blocks only
+    void*          pMapped         = nullptr;
+    uint32_t       mapCount        = 0;
+
+    std::map<VkDeviceSize, VkDeviceSize> freeRanges;  // Offset to size, free-list blocks only
+  };
+
+  struct Allocation : nvvk::MemHandleBase
+  {
+    Block*       pBlock;
+    VkDeviceSize offset;
+    VkDeviceSize size;
+  };
+
+  uint32_t findMemoryType(uint32_t memoryTypeBits, VkMemoryPropertyFlags properties) const;
+  Block*   allocBlock(const nvvk::MemAllocateInfo& allocInfo,
+                      uint32_t                     memoryTypeIndex,
+                      VkDeviceSize                 size,
+                      bool                         dedicated,
+                      VkResult*                    pResult);
+  void     freeBlock(Block* pBlock);
+  bool     suballocate(Block* pBlock, const VkMemoryRequirements& requirements, VkDeviceSize* pOffset);
+
+  VkDevice                            m_device{};
+  VkPhysicalDevice                    m_physicalDevice{};
+  VkPhysicalDeviceMemoryProperties    m_memoryProperties{};
+  VkDeviceSize                        m_blockSize = defaultBlockSize;
+  bool                                m_linear    = false;
+  std::vector<std::unique_ptr<Block>> m_blocks;
+  uint32_t                            m_allocationCount = 0;
+  VkDeviceSize                        m_usedBytes       = 0;
+};
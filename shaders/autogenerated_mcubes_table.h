@@ -0,0 +1,308 @@
+// Copyright 2021 NVIDIA CORPORATION
+// SPDX-License-Identifier: Apache-2.0
+// generated by shaders/generate_autogenerated_mcubes.py --cpp-table
+// clang-format off
+#ifndef NVPRO_SAMPLES_VK_TIMELINE_SEMAPHORE_AUTOGENERATED_MCUBES_TABLE_H_
+#define NVPRO_SAMPLES_VK_TIMELINE_SEMAPHORE_AUTOGENERATED_MCUBES_TABLE_H_
+
+#include <stdint.h>
+
+// Cell edge i runs from corner autogeneratedEdgeCorners[i][0] to corner autogeneratedEdgeCorners[i][1]
+// (corner 4x + 2y + z is sample{x}{y}{z}); it is INTERSECT_{name} of autogenerated_mcubes.glsl, in order:
+// 00x 0x0 x00 01x 0x1 x01 10x 1x0 x10 11x 1x1 x11
+static const uint8_t autogeneratedEdgeCorners[12][2] = {
+  {0, 1},  // 00x
+  {0, 2},  // 0x0
+  {0, 4},  // x00
+  {2, 3},  // 01x
+  {1, 3},  // 0x1
+  {1, 5},  // x01
+  {4, 5},  // 10x
+  {4, 6},  // 1x0
+  {2, 6},  // x10
+  {6, 7},  // 11x
+  {5, 7},  // 1x1
+  {3, 7},  // x11
+};
+
+// Number of vertices (3 per triangle) that autogeneratedGetCellTriangles generates for each caseNumber.
+static const uint8_t autogeneratedCaseVertexCounts[256] = {
+   0,  3,  3,  6,  3,  6,  6,  9,  3,  6,  6,  9,  6,  9,  9,  6,
+   3,  6,  6,  9,  6,  9,  9, 12,  6,  9,  9, 12,  9, 12, 12,  9,
+   3,  6,  6,  9,  6,  9,  9, 12,  6,  9,  9, 12,  9, 12, 12,  9,
+   6,  9,  9,  6,  9, 12, 12,  9,  9, 12, 12,  9, 12,  9,  9,  6,
+   3,  6,  6,  9,  6,  9,  9, 12,  6,  9,  9, 12,  9, 12, 12,  9,
+   6,  9,  9, 12,  9,  6, 12,  9,  9, 12, 12,  9, 12,  9,  9,  6,
+   6,  9,  9, 12,  9, 12, 12,  9,  9, 12, 12,  9, 12,  9,  9,  6,
+   9, 12, 12,  9, 12,  9,  9,  6, 12,  9,  9,  6,  9,  6,  6,  3,
+   3,  6,  6,  9,  6,  9,  9, 12,  6,  9,  9, 12,  9, 12, 12,  9,
+   6,  9,  9, 12,  9, 12, 12,  9,  9, 12, 12,  9, 12,  9,  9,  6,
+   6,  9,  9, 12,  9, 12, 12,  9,  9, 12,  6,  9, 12,  9,  9,  6,
+   9, 12, 12,  9, 12,  9,  9,  6, 12,  9,  9,  6,  9,  6,  6,  3,
+   6,  9,  9, 12,  9, 12, 12,  9,  9, 12, 12,  9,  6,  9,  9,  6,
+   9, 12, 12,  9, 12,  9,  9,  6, 12,  9,  9,  6,  9,  6,  6,  3,
+   9, 12, 12,  9, 12,  9,  9,  6, 12,  9,  9,  6,  9,  6,  6,  3,
+   6,  9,  9,  6,  9,  6,  6,  3,  9,  6,  6,  3,  6,  3,  3,  0,
+};
+
+// Edge of each of those vertices, in the same order.
+static const uint8_t autogeneratedCaseEdges[256][12] = {
+  { 0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0},  // 0
+  { 1,  2,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0},  // 1
+  { 5,  4,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0},  // 2
+  { 1,  2,  5,  1,  5,  4,  0,  0,  0,  0,  0,  0},  // 3
+  { 8,  1,  3,  0,  0,  0,  0,  0,  0,  0,  0,  0},  // 4
+  { 8,  2,  0,  8,  0,  3,  0,  0,  0,  0,  0,  0},  // 5
+  { 8,  1,  3,  5,  4,  0,  0,  0,  0,  0,  0,  0},  // 6
+  { 8,  2,  5,  8,  5,  4,  8,  4,  3,  0,  0,  0},  // 7
+  { 4, 11,  3,  0,  0,  0,  0,  0,  0,  0,  0,  0},  // 8
+  { 1,  2,  0,  4, 11,  3,  0,  0,  0,  0,  0,  0},  // 9
+  { 5, 11,  3,  5,  3,  0,  0,  0,  0,  0,  0,  0},  // 10
+  { 1,  2,  5,  1,  5, 11,  1, 11,  3,  0,  0,  0},  // 11
+  { 8,  1,  4,  8,  4, 11,  0,  0,  0,  0,  0,  0},  // 12
+  { 8,  2,  0,  8,  0,  4,  8,  4, 11,  0,  0,  0},  // 13
+  { 8,  1,  0,  8,  0,  5,  8,  5, 11,  0,  0,  0},  // 14
+  { 8,  2,  5,  8,  5, 11,  0,  0,  0,  0,  0,  0},  // 15
+  { 2,  7,  6,  0,  0,  0,  0,  0,  0,  0,  0,  0},  // 16
+  { 1,  7,  6,  1,  6,  0,  0,  0,  0,  0,  0,  0},  // 17
+  { 2,  7,  6,  5,  4,  0,  0,  0,  0,  0,  0,  0},  // 18
+  { 1,  7,  6,  1,  6,  5,  1,  5,  4,  0,  0,  0},  // 19
+  { 8,  1,  3,  2,  7,  6,  0,  0,  0,  0,  0,  0},  // 20
+  { 8,  7,  6,  8,  6,  0,  8,  0,  3,  0,  0,  0},  // 21
+  { 8,  1,  3,  2,  7,  6,  5,  4,  0,  0,  0,  0},  // 22
+  { 8,  7,  6,  6,  5,  4,  4,  3,  8,  8,  6,  4},  // 23
+  { 2,  7,  6,  4, 11,  3,  0,  0,  0,  0,  0,  0},  // 24
+  { 1,  7,  6,  1,  6,  0,  4, 11,  3,  0,  0,  0},  // 25
+  { 2,  7,  6,  5, 11,  3,  5,  3,  0,  0,  0,  0},  // 26
+  { 1,  7,  6,  6,  5, 11, 11,  3,  1,  1,  6, 11},  // 27
+  { 8,  1,  4,  8,  4, 11,  2,  7,  6,  0,  0,  0},  // 28
+  { 8,  7,  6,  6,  0,  4,  4, 11,  8,  8,  6,  4},  // 29
+  { 8,  1,  0,  8,  0,  5,  8,  5, 11,  2,  7,  6},  // 30
+  { 8,  7,  6,  8,  6,  5,  8,  5, 11,  0,  0,  0},  // 31
+  {10,  5,  6,  0,  0,  0,  0,  0,  0,  0,  0,  0},  // 32
+  { 1,  2,  0, 10,  5,  6,  0,  0,  0,  0,  0,  0},  // 33
+  {10,  4,  0, 10,  0,  6,  0,  0,  0,  0,  0,  0},  // 34
+  { 1,  2,  6,  1,  6, 10,  1, 10,  4,  0,  0,  0},  // 35
+  { 8,  1,  3, 10,  5,  6,  0,  0,  0,  0,  0,  0},  // 36
+  { 8,  2,  0,  8,  0,  3, 10,  5,  6,  0,  0,  0},  // 37
+  { 8,  1,  3, 10,  4,  0, 10,  0,  6,  0,  0,  0},  // 38
+  { 8,  2,  6,  6, 10,  4,  4,  3,  8,  8,  6,  4},  // 39
+  {10,  5,  6,  4, 11,  3,  0,  0,  0,  0,  0,  0},  // 40
+  { 1,  2,  0, 10,  5,  6,  4, 11,  3,  0,  0,  0},  // 41
+  {10, 11,  3, 10,  3,  0, 10,  0,  6,  0,  0,  0},  // 42
+  { 1,  2,  6,  6, 10, 11, 11,  3,  1,  1,  6, 11},  // 43
+  { 8,  1,  4,  8,  4, 11, 10,  5,  6,  0,  0,  0},  // 44
+  { 8,  2,  0,  8,  0,  4,  8,  4, 11, 10,  5,  6},  // 45
+  { 8,  1,  0,  0,  6, 10, 10, 11,  8,  8,  0, 10},  // 46
+  { 8,  2,  6,  8,  6, 10,  8, 10, 11,  0,  0,  0},  // 47
+  { 2,  7, 10,  2, 10,  5,  0,  0,  0,  0,  0,  0},  // 48
+  { 1,  7, 10,  1, 10,  5,  1,  5,  0,  0,  0,  0},  // 49
+  { 2,  7, 10,  2, 10,  4,  2,  4,  0,  0,  0,  0},  // 50
+  { 1,  7, 10,  1, 10,  4,  0,  0,  0,  0,  0,  0},  // 51
+  { 8,  1,  3,  2,  7, 10,  2, 10,  5,  0,  0,  0},  // 52
+  { 8,  7, 10, 10,  5,  0,  0,  3,  8,  8, 10,  0},  // 53
+  { 8,  1,  3,  2,  7, 10,  2, 10,  4,  2,  4,  0},  // 54
+  { 8,  7, 10,  8, 10,  4,  8,  4,  3,  0,  0,  0},  // 55
+  { 2,  7, 10,  2, 10,  5,  4, 11,  3,  0,  0,  0},  // 56
+  { 1,  7, 10,  1, 10,  5,  1,  5,  0,  4, 11,  3},  // 57
+  { 2,  7, 10, 10, 11,  3,  3,  0,  2,  2, 10,  3},  // 58
+  { 1,  7, 10,  1, 10, 11,  1, 11,  3,  0,  0,  0},  // 59
+  { 8,  1,  4,  8,  4, 11,  2,  7, 10,  2, 10,  5},  // 60
+  { 8,  7, 10,  8, 10, 11,  4,  5,  0,  0,  0,  0},  // 61
+  { 8,  7, 10,  8, 10, 11,  2,  1,  0,  0,  0,  0},  // 62
+  { 8,  7, 10,  8, 10, 11,  0,  0,  0,  0,  0,  0},  // 63
+  { 7,  8,  9,  0,  0,  0,  0,  0,  0,  0,  0,  0},  // 64
+  { 1,  2,  0,  7,  8,  9,  0,  0,  0,  0,  0,  0},  // 65
+  { 7,  8,  9,  5,  4,  0,  0,  0,  0,  0,  0,  0},  // 66
+  { 1,  2,  5,  1,  5,  4,  7,  8,  9,  0,  0,  0},  // 67
+  { 7,  1,  3,  7,  3,  9,  0,  0,  0,  0,  0,  0},  // 68
+  { 7,  2,  0,  7,  0,  3,  7,  3,  9,  0,  0,  0},  // 69
+  { 7,  1,  3,  7,  3,  9,  5,  4,  0,  0,  0,  0},  // 70
+  { 7,  2,  5,  5,  4,  3,  3,  9,  7,  7,  5,  3},  // 71
+  { 7,  8,  9,  4, 11,  3,  0,  0,  0,  0,  0,  0},  // 72
+  { 1,  2,  0,  7,  8,  9,  4, 11,  3,  0,  0,  0},  // 73
+  { 7,  8,  9,  5, 11,  3,  5,  3,  0,  0,  0,  0},  // 74
+  { 1,  2,  5,  1,  5, 11,  1, 11,  3,  7,  8,  9},  // 75
+  { 7,  1,  4,  7,  4, 11,  7, 11,  9,  0,  0,  0},  // 76
+  { 7,  2,  0,  0,  4, 11, 11,  9,  7,  7,  0, 11},  // 77
+  { 7,  1,  0,  0,  5, 11, 11,  9,  7,  7,  0, 11},  // 78
+  { 7,  2,  5,  7,  5, 11,  7, 11,  9,  0,  0,  0},  // 79
+  { 2,  8,  9,  2,  9,  6,  0,  0,  0,  0,  0,  0},  // 80
+  { 1,  8,  9,  1,  9,  6,  1,  6,  0,  0,  0,  0},  // 81
+  { 2,  8,  9,  2,  9,  6,  5,  4,  0,  0,  0,  0},  // 82
+  { 1,  8,  9,  9,  6,  5,  5,  4,  1,  1,  9,  5},  // 83
+  { 2,  1,  3,  2,  3,  9,  2,  9,  6,  0,  0,  0},  // 84
+  { 6,  0,  3,  6,  3,  9,  0,  0,  0,  0,  0,  0},  // 85
+  { 2,  1,  3,  2,  3,  9,  2,  9,  6,  5,  4,  0},  // 86
+  { 5,  4,  3,  5,  3,  9,  5,  9,  6,  0,  0,  0},  // 87
+  { 2,  8,  9,  2,  9,  6,  4, 11,  3,  0,  0,  0},  // 88
+  { 1,  8,  9,  1,  9,  6,  1,  6,  0,  4, 11,  3},  // 89
+  { 2,  8,  9,  2,  9,  6,  5, 11,  3,  5,  3,  0},  // 90
+  { 1,  8,  3,  5, 11,  9,  5,  9,  6,  0,  0,  0},  // 91
+  { 2,  1,  4,  4, 11,  9,  9,  6,  2,  2,  4,  9},  // 92
+  { 4, 11,  9,  4,  9,  6,  4,  6,  0,  0,  0,  0},  // 93
+  { 2,  1,  0,  5, 11,  9,  5,  9,  6,  0,  0,  0},  // 94
+  { 5, 11,  9,  5,  9,  6,  0,  0,  0,  0,  0,  0},  // 95
+  { 7,  8,  9, 10,  5,  6,  0,  0,  0,  0,  0,  0},  // 96
+  { 1,  2,  0,  7,  8,  9, 10,  5,  6,  0,  0,  0},  // 97
+  { 7,  8,  9, 10,  4,  0, 10,  0,  6,  0,  0,  0},  // 98
+  { 1,  2,  6,  1,  6, 10,  1, 10,  4,  7,  8,  9},  // 99
+  { 7,  1,  3,  7,  3,  9, 10,  5,  6,  0,  0,  0},  // 100
+  { 7,  2,  0,  7,  0,  3,  7,  3,  9, 10,  5,  6},  // 101
+  { 7,  1,  3,  7,  3,  9, 10,  4,  0, 10,  0,  6},  // 102
+  { 7,  2,  6, 10,  4,  3, 10,  3,  9,  0,  0,  0},  // 103
+  { 7,  8,  9, 10,  5,  6,  4, 11,  3,  0,  0,  0},  // 104
+  { 1,  2,  0,  7,  8,  9, 10,  5,  6,  4, 11,  3},  // 105
+  { 7,  8,  9, 10, 11,  3, 10,  3,  0, 10,  0,  6},  // 106
+  { 1,  8,  3,  7,  2,  6, 10, 11,  9,  0,  0,  0},  // 107
+  { 7,  1,  4,  7,  4, 11,  7, 11,  9, 10,  5,  6},  // 108
+  { 7,  2,  6, 10, 11,  9,  4,  5,  0,  0,  0,  0},  // 109
+  { 7,  1,  0,  7,  0,  6, 10, 11,  9,  0,  0,  0},  // 110
+  { 7,  2,  6, 10, 11,  9,  0,  0,  0,  0,  0,  0},  // 111
+  { 2,  8,  9,  2,  9, 10,  2, 10,  5,  0,  0,  0},  // 112
+  { 1,  8,  9,  9, 10,  5,  5,  0,  1,  1,  9,  5},  // 113
+  { 2,  8,  9,  9, 10,  4,  4,  0,  2,  2,  9,  4},  // 114
+  { 1,  8,  9,  1,  9, 10,  1, 10,  4,  0,  0,  0},  // 115
+  { 2,  1,  3,  3,  9, 10, 10,  5,  2,  2,  3, 10},  // 116
+  {10,  5,  0, 10,  0,  3, 10,  3,  9,  0,  0,  0},  // 117
+  { 2,  1,  0, 10,  4,  3, 10,  3,  9,  0,  0,  0},  // 118
+  {10,  4,  3, 10,  3,  9,  0,  0,  0,  0,  0,  0},  // 119
+  { 2,  8,  9,  2,  9, 10,  2, 10,  5,  4, 11,  3},  // 120
+  { 1,  8,  3, 10, 11,  9,  4,  5,  0,  0,  0,  0},  // 121
+  { 2,  8,  3,  2,  3,  0, 10, 11,  9,  0,  0,  0},  // 122
+  { 1,  8,  3, 10, 11,  9,  0,  0,  0,  0,  0,  0},  // 123
+  { 2,  1,  4,  2,  4,  5, 10, 11,  9,  0,  0,  0},  // 124
+  {10, 11,  9,  4,  5,  0,  0,  0,  0,  0,  0,  0},  // 125
+  { 2,  1,  0, 10, 11,  9,  0,  0,  0,  0,  0,  0},  // 126
+  {10, 11,  9,  0,  0,  0,  0,  0,  0,  0,  0,  0},  // 127
+  {11, 10,  9,  0,  0,  0,  0,  0,  0,  0,  0,  0},  // 128
+  { 1,  2,  0, 11, 10,  9,  0,  0,  0,  0,  0,  0},  // 129
+  { 5,  4,  0, 11, 10,  9,  0,  0,  0,  0,  0,  0},  // 130
+  { 1,  2,  5,  1,  5,  4, 11, 10,  9,  0,  0,  0},  // 131
+  { 8,  1,  3, 11, 10,  9,  0,  0,  0,  0,  0,  0},  // 132
+  { 8,  2,  0,  8,  0,  3, 11, 10,  9,  0,  0,  0},  // 133
+  { 8,  1,  3,  5,  4,  0, 11, 10,  9,  0,  0,  0},  // 134
+  { 8,  2,  5,  8,  5,  4,  8,  4,  3, 11, 10,  9},  // 135
+  { 4, 10,  9,  4,  9,  3,  0,  0,  0,  0,  0,  0},  // 136
+  { 1,  2,  0,  4, 10,  9,  4,  9,  3,  0,  0,  0},  // 137
+  { 5, 10,  9,  5,  9,  3,  5,  3,  0,  0,  0,  0},  // 138
+  { 1,  2,  5,  5, 10,  9,  9,  3,  1,  1,  5,  9},  // 139
+  { 8,  1,  4,  8,  4, 10,  8, 10,  9,  0,  0,  0},  // 140
+  { 8,  2,  0,  0,  4, 10, 10,  9,  8,  8,  0, 10},  // 141
+  { 8,  1,  0,  0,  5, 10, 10,  9,  8,  8,  0, 10},  // 142
+  { 8,  2,  5,  8,  5, 10,  8, 10,  9,  0,  0,  0},  // 143
+  { 2,  7,  6, 11, 10,  9,  0,  0,  0,  0,  0,  0},  // 144
+  { 1,  7,  6,  1,  6,  0, 11, 10,  9,  0,  0,  0},  // 145
+  { 2,  7,  6,  5,  4,  0, 11, 10,  9,  0,  0,  0},  // 146
+  { 1,  7,  6,  1,  6,  5,  1,  5,  4, 11, 10,  9},  // 147
+  { 8,  1,  3,  2,  7,  6, 11, 10,  9,  0,  0,  0},  // 148
+  { 8,  7,  6,  8,  6,  0,  8,  0,  3, 11, 10,  9},  // 149
+  { 8,  1,  3,  2,  7,  6,  5,  4,  0, 11, 10,  9},  // 150
+  { 8,  7,  9,  5, 10,  6, 11,  4,  3,  0,  0,  0},  // 151
+  { 2,  7,  6,  4, 10,  9,  4,  9,  3,  0,  0,  0},  // 152
+  { 1,  7,  6,  1,  6,  0,  4, 10,  9,  4,  9,  3},  // 153
+  { 2,  7,  6,  5, 10,  9,  5,  9,  3,  5,  3,  0},  // 154
+  { 1,  7,  9,  1,  9,  3,  5, 10,  6,  0,  0,  0},  // 155
+  { 8,  1,  4,  8,  4, 10,  8, 10,  9,  2,  7,  6},  // 156
+  { 8,  7,  9,  4, 10,  6,  4,  6,  0,  0,  0,  0},  // 157
+  { 8,  7,  9,  2,  1,  0,  5, 10,  6,  0,  0,  0},  // 158
+  { 8,  7,  9,  5, 10,  6,  0,  0,  0,  0,  0,  0},  // 159
+  {11,  5,  6, 11,  6,  9,  0,  0,  0,  0,  0,  0},  // 160
+  { 1,  2,  0, 11,  5,  6, 11,  6,  9,  0,  0,  0},  // 161
+  {11,  4,  0, 11,  0,  6, 11,  6,  9,  0,  0,  0},  // 162
+  { 1,  2,  6,  6,  9, 11, 11,  4,  1,  1,  6, 11},  // 163
+  { 8,  1,  3, 11,  5,  6, 11,  6,  9,  0,  0,  0},  // 164
+  { 8,  2,  0,  8,  0,  3, 11,  5,  6, 11,  6,  9},  // 165
+  { 8,  1,  3, 11,  4,  0, 11,  0,  6, 11,  6,  9},  // 166
+  { 8,  2,  6,  8,  6,  9, 11,  4,  3,  0,  0,  0},  // 167
+  { 4,  5,  6,  4,  6,  9,  4,  9,  3,  0,  0,  0},  // 168
+  { 1,  2,  0,  4,  5,  6,  4,  6,  9,  4,  9,  3},  // 169
+  { 0,  6,  9,  0,  9,  3,  0,  0,  0,  0,  0,  0},  // 170
+  { 1,  2,  6,  1,  6,  9,  1,  9,  3,  0,  0,  0},  // 171
+  { 8,  1,  4,  4,  5,  6,  6,  9,  8,  8,  4,  6},  // 172
+  { 8,  2,  6,  8,  6,  9,  4,  5,  0,  0,  0,  0},  // 173
+  { 8,  1,  0,  8,  0,  6,  8,  6,  9,  0,  0,  0},  // 174
+  { 8,  2,  6,  8,  6,  9,  0,  0,  0,  0,  0,  0},  // 175
+  { 2,  7,  9,  2,  9, 11,  2, 11,  5,  0,  0,  0},  // 176
+  { 1,  7,  9,  9, 11,  5,  5,  0,  1,  1,  9,  5},  // 177
+  { 2,  7,  9,  9, 11,  4,  4,  0,  2,  2,  9,  4},  // 178
+  { 1,  7,  9,  1,  9, 11,  1, 11,  4,  0,  0,  0},  // 179
+  { 8,  1,  3,  2,  7,  9,  2,  9, 11,  2, 11,  5},  // 180
+  { 8,  7,  9, 11,  5,  0, 11,  0,  3,  0,  0,  0},  // 181
+  { 8,  7,  9,  2,  1,  0, 11,  4,  3,  0,  0,  0},  // 182
+  { 8,  7,  9, 11,  4,  3,  0,  0,  0,  0,  0,  0},  // 183
+  { 2,  7,  9,  9,  3,  4,  4,  5,  2,  2,  9,  4},  // 184
+  { 1,  7,  9,  1,  9,  3,  4,  5,  0,  0,  0,  0},  // 185
+  { 2,  7,  9,  2,  9,  3,  2,  3,  0,  0,  0,  0},  // 186
+  { 1,  7,  9,  1,  9,  3,  0,  0,  0,  0,  0,  0},  // 187
+  { 8,  7,  9,  2,  1,  4,  2,  4,  5,  0,  0,  0},  // 188
+  { 8,  7,  9,  4,  5,  0,  0,  0,  0,  0,  0,  0},  // 189
+  { 8,  7,  9,  2,  1,  0,  0,  0,  0,  0,  0,  0},  // 190
+  { 8,  7,  9,  0,  0,  0,  0,  0,  0,  0,  0,  0},  // 191
+  { 7,  8, 11,  7, 11, 10,  0,  0,  0,  0,  0,  0},  // 192
+  { 1,  2,  0,  7,  8, 11,  7, 11, 10,  0,  0,  0},  // 193
+  { 7,  8, 11,  7, 11, 10,  5,  4,  0,  0,  0,  0},  // 194
+  { 1,  2,  5,  1,  5,  4,  7,  8, 11,  7, 11, 10},  // 195
+  { 7,  1,  3,  7,  3, 11,  7, 11, 10,  0,  0,  0},  // 196
+  { 7,  2,  0,  0,  3, 11, 11, 10,  7,  7,  0, 11},  // 197
+  { 7,  1,  3,  7,  3, 11,  7, 11, 10,  5,  4,  0},  // 198
+  { 7,  2,  5,  7,  5, 10, 11,  4,  3,  0,  0,  0},  // 199
+  { 7,  8,  3,  7,  3,  4,  7,  4, 10,  0,  0,  0},  // 200
+  { 1,  2,  0,  7,  8,  3,  7,  3,  4,  7,  4, 10},  // 201
+  { 7,  8,  3,  3,  0,  5,  5, 10,  7,  7,  3,  5},  // 202
+  { 1,  8,  3,  7,  2,  5,  7,  5, 10,  0,  0,  0},  // 203
+  { 7,  1,  4,  7,  4, 10,  0,  0,  0,  0,  0,  0},  // 204
+  { 7,  2,  0,  7,  0,  4,  7,  4, 10,  0,  0,  0},  // 205
+  { 7,  1,  0,  7,  0,  5,  7,  5, 10,  0,  0,  0},  // 206
+  { 7,  2,  5,  7,  5, 10,  0,  0,  0,  0,  0,  0},  // 207
+  { 2,  8, 11,  2, 11, 10,  2, 10,  6,  0,  0,  0},  // 208
+  { 1,  8, 11, 11, 10,  6,  6,  0,  1,  1, 11,  6},  // 209
+  { 2,  8, 11,  2, 11, 10,  2, 10,  6,  5,  4,  0},  // 210
+  { 1,  8, 11,  1, 11,  4,  5, 10,  6,  0,  0,  0},  // 211
+  { 2,  1,  3,  3, 11, 10, 10,  6,  2,  2,  3, 10},  // 212
+  {11, 10,  6, 11,  6,  0, 11,  0,  3,  0,  0,  0},  // 213
+  { 2,  1,  0,  5, 10,  6, 11,  4,  3,  0,  0,  0},  // 214
+  { 5, 10,  6, 11,  4,  3,  0,  0,  0,  0,  0,  0},  // 215
+  { 2,  8,  3,  3,  4, 10, 10,  6,  2,  2,  3, 10},  // 216
+  { 1,  8,  3,  4, 10,  6,  4,  6,  0,  0,  0,  0},  // 217
+  { 2,  8,  3,  2,  3,  0,  5, 10,  6,  0,  0,  0},  // 218
+  { 1,  8,  3,  5, 10,  6,  0,  0,  0,  0,  0,  0},  // 219
+  { 2,  1,  4,  2,  4, 10,  2, 10,  6,  0,  0,  0},  // 220
+  { 4, 10,  6,  4,  6,  0,  0,  0,  0,  0,  0,  0},  // 221
+  { 2,  1,  0,  5, 10,  6,  0,  0,  0,  0,  0,  0},  // 222
+  { 5, 10,  6,  0,  0,  0,  0,  0,  0,  0,  0,  0},  // 223
+  { 7,  8, 11,  7, 11,  5,  7,  5,  6,  0,  0,  0},  // 224
+  { 1,  2,  0,  7,  8, 11,  7, 11,  5,  7,  5,  6},  // 225
+  { 7,  8, 11, 11,  4,  0,  0,  6,  7,  7, 11,  0},  // 226
+  { 1,  8, 11,  1, 11,  4,  7,  2,  6,  0,  0,  0},  // 227
+  { 7,  1,  3,  3, 11,  5,  5,  6,  7,  7,  3,  5},  // 228
+  { 7,  2,  6, 11,  5,  0, 11,  0,  3,  0,  0,  0},  // 229
+  { 7,  1,  0,  7,  0,  6, 11,  4,  3,  0,  0,  0},  // 230
+  { 7,  2,  6, 11,  4,  3,  0,  0,  0,  0,  0,  0},  // 231
+  { 7,  8,  3,  3,  4,  5,  5,  6,  7,  7,  3,  5},  // 232
+  { 1,  8,  3,  7,  2,  6,  4,  5,  0,  0,  0,  0},  // 233
+  { 7,  8,  3,  7,  3,  0,  7,  0,  6,  0,  0,  0},  // 234
+  { 1,  8,  3,  7,  2,  6,  0,  0,  0,  0,  0,  0},  // 235
+  { 7,  1,  4,  7,  4,  5,  7,  5,  6,  0,  0,  0},  // 236
+  { 7,  2,  6,  4,  5,  0,  0,  0,  0,  0,  0,  0},  // 237
+  { 7,  1,  0,  7,  0,  6,  0,  0,  0,  0,  0,  0},  // 238
+  { 7,  2,  6,  0,  0,  0,  0,  0,  0,  0,  0,  0},  // 239
+  { 2,  8, 11,  2, 11,  5,  0,  0,  0,  0,  0,  0},  // 240
+  { 1,  8, 11,  1, 11,  5,  1,  5,  0,  0,  0,  0},  // 241
+  { 2,  8, 11,  2, 11,  4,  2,  4,  0,  0,  0,  0},  // 242
+  { 1,  8, 11,  1, 11,  4,  0,  0,  0,  0,  0,  0},  // 243
+  { 2,  1,  3,  2,  3, 11,  2, 11,  5,  0,  0,  0},  // 244
+  {11,  5,  0, 11,  0,  3,  0,  0,  0,  0,  0,  0},  // 245
+  { 2,  1,  0, 11,  4,  3,  0,  0,  0,  0,  0,  0},  // 246
+  {11,  4,  3,  0,  0,  0,  0,  0,  0,  0,  0,  0},  // 247
+  { 2,  8,  3,  2,  3,  4,  2,  4,  5,  0,  0,  0},  // 248
+  { 1,  8,  3,  4,  5,  0,  0,  0,  0,  0,  0,  0},  // 249
+  { 2,  8,  3,  2,  3,  0,  0,  0,  0,  0,  0,  0},  // 250
+  { 1,  8,  3,  0,  0,  0,  0,  0,  0,  0,  0,  0},  // 251
+  { 2,  1,  4,  2,  4,  5,  0,  0,  0,  0,  0,  0},  // 252
+  { 4,  5,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0},  // 253
+  { 2,  1,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0},  // 254
+  { 0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0},  // 255
+};
+
+#endif
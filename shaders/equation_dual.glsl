@@ -0,0 +1,150 @@
+// Copyright 2021 NVIDIA CORPORATION
+// SPDX-License-Identifier: Apache-2.0
+#ifndef NVPRO_SAMPLES_VK_TIMELINE_SEMAPHORE_SHADERS_EQUATION_DUAL_GLSL_
+#define NVPRO_SAMPLES_VK_TIMELINE_SEMAPHORE_SHADERS_EQUATION_DUAL_GLSL_
+
+// Forward-mode automatic differentiation helpers used by equationEmitDualGlsl (see equation.hpp).
+// A dual number is vec4(value, d/dx, d/dy, d/dz); addition, subtraction, negation and scaling by a
+// float are the plain vec4 operations. Keep in sync with the functions understood by the equation parser
+// and with the csg*() functions of mcubes_image.comp.
+
+vec4 dualMul(vec4 a, vec4 b)
+{
+  return vec4(a.x * b.x, a.x * b.yzw + b.x * a.yzw);
+}
+
+vec4 dualDiv(vec4 a, vec4 b)
+{
+  return vec4(a.x / b.x, (a.yzw * b.x - a.x * b.yzw) / (b.x * b.x));
+}
+
+vec4 dualSin(vec4 a)
+{
+  return vec4(sin(a.x), cos(a.x) * a.yzw);
+}
+
+vec4 dualCos(vec4 a)
+{
+  return vec4(cos(a.x), -sin(a.x) * a.yzw);
+}
+
+vec4 dualTan(vec4 a)
+{
+  float v = tan(a.x);
+  return vec4(v, (1.0 + v * v) * a.yzw);
+}
+
+vec4 dualAtan(vec4 a)
+{
+  return vec4(atan(a.x), a.yzw / (1.0 + a.x * a.x));
+}
+
+vec4 dualAtan2(vec4 y, vec4 x)
+{
+  return vec4(atan(y.x, x.x), (x.x * y.yzw - y.x * x.yzw) / (x.x * x.x + y.x * y.x));
+}
+
+vec4 dualSqrt(vec4 a)
+{
+  float v = sqrt(a.x);
+  return vec4(v, a.yzw * (0.5 / v));
+}
+
+vec4 dualPow(vec4 a, vec4 b)
+{
+  float v = pow(a.x, b.x);
+  vec3  d = b.x * pow(a.x, b.x - 1.0) * a.yzw;
+  if(b.yzw != vec3(0))  // Usually a constant exponent; avoid log of a non-positive base then.
+    d += v * log(a.x) * b.yzw;
+  return vec4(v, d);
+}
+
+vec4 dualExp(vec4 a)
+{
+  float v = exp(a.x);
+  return vec4(v, v * a.yzw);
+}
+
+vec4 dualLog(vec4 a)
+{
+  return vec4(log(a.x), a.yzw / a.x);
+}
+
+vec4 dualAbs(vec4 a)
+{
+  return a.x < 0.0 ? -a : a;
+}
+
+vec4 dualSign(vec4 a)
+{
+  return vec4(sign(a.x), vec3(0));
+}
+
+vec4 dualFloor(vec4 a)
+{
+  return vec4(floor(a.x), vec3(0));
+}
+
+vec4 dualFract(vec4 a)
+{
+  return vec4(fract(a.x), a.yzw);
+}
+
+vec4 dualMod(vec4 a, vec4 b)
+{
+  return vec4(mod(a.x, b.x), a.yzw - floor(a.x / b.x) * b.yzw);
+}
+
+vec4 dualMin(vec4 a, vec4 b)
+{
+  return b.x < a.x ? b : a;
+}
+
+vec4 dualMax(vec4 a, vec4 b)
+{
+  return a.x < b.x ? b : a;
+}
+
+vec4 dualClamp(vec4 a, vec4 lo, vec4 hi)
+{
+  return dualMin(dualMax(a, lo), hi);
+}
+
+vec4 dualSquare(vec4 a)
+{
+  return dualMul(a, a);
+}
+
+vec4 dualCsgUnion(vec4 a, vec4 b)
+{
+  return dualMin(a, b);
+}
+
+vec4 dualCsgIntersect(vec4 a, vec4 b)
+{
+  return dualMax(a, b);
+}
+
+vec4 dualCsgSubtract(vec4 a, vec4 b)
+{
+  return dualMax(a, -b);
+}
+
+vec4 dualCsgSmoothUnion(vec4 a, vec4 b, vec4 k)
+{
+  const vec4 one = vec4(1.0, vec3(0));
+  vec4       h   = dualClamp(0.5 * one + 0.5 * dualDiv(b - a, k), vec4(0), one);
+  return b + dualMul(h, a - b) - dualMul(k, dualMul(h, one - h));
+}
+
+vec4 dualCsgSmoothIntersect(vec4 a, vec4 b, vec4 k)
+{
+  return -dualCsgSmoothUnion(-a, -b, k);
+}
+
+vec4 dualCsgSmoothSubtract(vec4 a, vec4 b, vec4 k)
+{
+  return -dualCsgSmoothUnion(-a, b, k);
+}
+
+#endif
@@ -17,11 +17,19 @@
 # The fixed point format is such that packNormalizedVec3(vec3(0), denominator) indicates the coordinate that sample000
 # is at, and packNormalizedVec3(vec3(1), denominator) indicates the coordinate that sample111 is at.
 #
-# We depend on outside code to fill in McubesCell::offset and McubesGeometry::packedVertScale correctly.
+# We depend on outside code to store the cell in McubesGeometry (see packMcubesCell) and to fill in
+# McubesGeometry::origin and McubesGeometry::packedVertScale correctly.
 #
 # This is pretty nasty code, more of an augmentation of my brain than serious software.
 # (as if I had written the autogenerated code manually and you are just looking at what would have been
 # my private thought process).
+#
+# Run with --cpp-table to instead print shaders/autogenerated_mcubes_table.h, the same triangles as C arrays
+# for the CPU mesher (see mcubes_cpu.cpp).
+
+import sys
+
+print_cpp_table = "--cpp-table" in sys.argv[1:]
 
 # Bit meanings in caseNumber
 sample000_positive_bit = 1
@@ -45,7 +53,7 @@ bit_map = {
 }
 
 # Print out autogeneratedGetCaseNumber
-print(
+if not print_cpp_table: print(
 f"""\
 // Copyright 2021 NVIDIA CORPORATION
 // SPDX-License-Identifier: Apache-2.0
@@ -67,7 +75,7 @@ uint autogeneratedGetCaseNumber(float sample000, float sample001, float sample01
 """)
 
 # Print out start of autogeneratedGetCellTriangles
-print(
+if not print_cpp_table: print(
 f"""
 // Used shared memory for some thread-private variables. This makes the GLSL compiler not take forever.
 uint sharedIntersect_00x[THREADS];
@@ -116,13 +124,16 @@ def print_intersect_assignment(variable_name):
     vec_z = interpolant_calculation if last3[2] == 'x' else last3[2]
     print(f"  {variable_name} = packNormalizedVec3(vec3({vec_x}, {vec_y}, {vec_z}), denominator);")
 
-for name in ["INTERSECT_00x", "INTERSECT_0x0", "INTERSECT_x00",
-             "INTERSECT_01x", "INTERSECT_0x1", "INTERSECT_x01",
-             "INTERSECT_10x", "INTERSECT_1x0", "INTERSECT_x10",
-             "INTERSECT_11x", "INTERSECT_1x1", "INTERSECT_x11"]:
-    print_intersect_assignment(name)
+intersect_names = ["INTERSECT_00x", "INTERSECT_0x0", "INTERSECT_x00",
+                   "INTERSECT_01x", "INTERSECT_0x1", "INTERSECT_x01",
+                   "INTERSECT_10x", "INTERSECT_1x0", "INTERSECT_x10",
+                   "INTERSECT_11x", "INTERSECT_1x1", "INTERSECT_x11"]
+
+if not print_cpp_table:
+    for name in intersect_names:
+        print_intersect_assignment(name)
 
-print("  switch(caseNumber)\n{")
+    print("  switch(caseNumber)\n{")
 
 # Analyze the square of 4 samples (one face of the 8-sample cube) and add any edges found to the edge_dictionary.
 # The samples shall be passed as 4 sampleXXX variable names, in anticlocwise order (viewed from outside).
@@ -248,9 +259,8 @@ def tesselate_contours(contours):
             assert 0
     return triangles
 
-# Print the code for a given case number.
-def print_case(case_bits):
-    print(f"  case {case_bits}:")
+# Triangles for a given case number, as a list of 3-tuples of INTERSECT_xxx variable names.
+def get_case_triangles(case_bits):
     max_point_list_length = 1000
     for hack in range(4):
         face_contours = collect_face_contours(case_bits, hack)
@@ -262,8 +272,12 @@ def print_case(case_bits):
             best_face_contours = face_contours
         del face_contours
 
-    face_contours = best_face_contours
-    triangles = tesselate_contours(face_contours)
+    return tesselate_contours(best_face_contours)
+
+# Print the code for a given case number.
+def print_case(case_bits):
+    print(f"  case {case_bits}:")
+    triangles = get_case_triangles(case_bits)
     print(f"    cell.vertexCount    = {len(triangles) * 3};")
     index = 0
     for t in triangles:
@@ -273,10 +287,56 @@ def print_case(case_bits):
         index += 3
     print(f"    break;")
 
+# Print the C table version: edges are numbered in intersect_names order, corners 4x + 2y + z as in the
+# caseNumber bits.
+def print_cpp_table_header():
+    print(
+"""\
+// Copyright 2021 NVIDIA CORPORATION
+// SPDX-License-Identifier: Apache-2.0
+// generated by shaders/generate_autogenerated_mcubes.py --cpp-table
+// clang-format off
+#ifndef NVPRO_SAMPLES_VK_TIMELINE_SEMAPHORE_AUTOGENERATED_MCUBES_TABLE_H_
+#define NVPRO_SAMPLES_VK_TIMELINE_SEMAPHORE_AUTOGENERATED_MCUBES_TABLE_H_
+
+#include <stdint.h>
+
+// Cell edge i runs from corner autogeneratedEdgeCorners[i][0] to corner autogeneratedEdgeCorners[i][1]
+// (corner 4x + 2y + z is sample{x}{y}{z}); it is INTERSECT_{name} of autogenerated_mcubes.glsl, in order:
+// """ + " ".join(name[-3:] for name in intersect_names) + """
+static const uint8_t autogeneratedEdgeCorners[12][2] = {""")
+    for name in intersect_names:
+        last3 = name[-3:]
+        corner0 = int(last3.replace('x', '0'), 2)
+        corner1 = int(last3.replace('x', '1'), 2)
+        print(f"  {{{corner0}, {corner1}}},  // {last3}")
+    print("""};
+
+// Number of vertices (3 per triangle) that autogeneratedGetCellTriangles generates for each caseNumber.
+static const uint8_t autogeneratedCaseVertexCounts[256] = {""")
+    for row in range(16):
+        counts = [len(get_case_triangles(row * 16 + i)) * 3 for i in range(16)]
+        print("  " + ", ".join(f"{c:2}" for c in counts) + ",")
+    print("""};
+
+// Edge of each of those vertices, in the same order.
+static const uint8_t autogeneratedCaseEdges[256][12] = {""")
+    for case_bits in range(256):
+        edges = [intersect_names.index(name) for t in get_case_triangles(case_bits) for name in t]
+        edges += [0] * (12 - len(edges))
+        print("  {" + ", ".join(f"{e:2}" for e in edges) + f"}},  // {case_bits}")
+    print("""};
+
+#endif""")
+
+if print_cpp_table:
+    print_cpp_table_header()
+    sys.exit(0)
+
 for case_bits in range(256):
     print_case(case_bits)
 
 # Print function end
 print(
 """  }
-}""")
+}""")
\ No newline at end of file
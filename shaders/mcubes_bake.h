@@ -0,0 +1,72 @@
+// Copyright 2021 NVIDIA CORPORATION
+// SPDX-License-Identifier: Apache-2.0
+#ifndef NVPRO_SAMPLES_VK_TIMELINE_SEMAPHORE_MCUBES_BAKE_H_
+#define NVPRO_SAMPLES_VK_TIMELINE_SEMAPHORE_MCUBES_BAKE_H_
+
+// Data structures of the animation keyframe cache (see mcubes_bake.hpp). mcubes_bake.comp compacts
+// each McubesGeometry of a computed chunk into one McubesBakedDraw plus ranges of shared arrays of cell headers
+// and packed vertices, which mcubes_geometry.vert (with MCUBES_BAKED defined) draws instead of the McubesGeometry.
+
+#include "mcubes_params.h"
+
+#ifdef __cplusplus
+#include <nvmath/nvmath_glsltypes.h>  // emulate glsl types in C++
+#include <stdint.h>
+#define VEC3 nvmath::vec3f
+#else
+#define VEC3 vec3
+#endif
+
+// Bindings of g_mcubesBakeDescriptorSetLayout.
+#define MCUBES_BAKE_HEADER_BINDING 0   // McubesBakeHeader
+#define MCUBES_BAKE_DRAWS_BINDING 1    // Array of McubesBakedDraw
+#define MCUBES_BAKE_CELLS_BINDING 2    // Array of cell headers, as McubesGeometry::cells
+#define MCUBES_BAKE_VERTS_BINDING 3    // Array of packed vertices, as McubesGeometry::packedVerts
+#define MCUBES_BAKE_NORMALS_BINDING 4  // Array of packed normals, parallel to the packed vertex array
+
+struct McubesBakeHeader
+{
+#ifdef __cplusplus
+  using uint = uint32_t;
+#endif
+  uint cellCount;         // Cells allocated so far (atomic); may exceed cellCapacity on overflow.
+  uint cellCapacity;      // Length of the cell header array.
+  uint vertCount;         // Same, for the packed vertex array.
+  uint vertCapacity;
+  uint overflowCount[2];  // Per McubesBakeParams::statsSlot, number of McubesGeometry that did not fit.
+};
+
+struct McubesBakedDraw
+{
+#ifdef __cplusplus
+  using uint = uint32_t;
+#endif
+  // VkDrawIndirectCommand, keep at offset 0. firstVertex is 12 times the index of the first cell in the
+  // cell header array, so gl_VertexIndex / 12 indexes that array directly.
+  uint vertexCount;
+  uint instanceCount;
+  uint firstVertex;
+  uint firstInstance;
+
+  VEC3 packedVertScale;  // As McubesGeometry::packedVertScale
+  uint firstPackedVert;  // Index in the packed vertex (and normal) array of McubesGeometry::packedVerts[0].
+
+  VEC3  origin;  // As McubesGeometry::origin
+  float _originPadding[1];
+
+  // As McubesGeometry::levelCellEnds, but indices into the cell header array.
+  uint levelCellEnds[MCUBES_MAX_ISO_LEVELS];
+};
+
+// Push constant of mcubes_bake.comp.
+struct McubesBakeParams
+{
+#ifdef __cplusplus
+  using uint = uint32_t;
+#endif
+  uint firstDraw;  // McubesBakedDraw index of the bound chunk's first McubesGeometry.
+  uint statsSlot;  // As McubesParams::statsSlot; selects McubesBakeHeader::overflowCount.
+};
+
+#undef VEC3
+#endif
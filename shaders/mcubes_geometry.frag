@@ -3,7 +3,6 @@
 #version 460
 #include "camera_transforms.h"
 #include "mcubes_debug_view_push_constant.h"
-#include "skybox.glsl"
 
 layout(push_constant) uniform PushConstantBlock
 {
@@ -15,8 +14,11 @@ layout(set = 0, binding = 0) uniform CameraTransformsBuffer
   CameraTransforms cameraTransforms;
 };
 
+#include "mcubes_shading.glsl"
+
 layout(location = 0) in vec3 worldPosition;
 layout(location = 1) in vec3 worldNormal;
+layout(location = 2) flat in uint isoLevel;
 
 layout(location = 0) out vec4 fragColor;
 
@@ -24,12 +26,7 @@ void main()
 {
   if(debugViewPushConstant.enabled == 0.0)
   {
-    vec3 normalizedNormal = normalize(worldNormal);  // Natural language "operator oveloading"
-    vec3 cameraOrigin     = (cameraTransforms.viewInverse * vec4(0, 0, 0, 1)).xyz;
-    vec3 reflected        = normalize(reflect(worldPosition - cameraOrigin, normalizedNormal));
-    vec3 reflectColor     = 0.5 * sampleSkyboxNormalized(reflected);
-    vec3 normalColor      = vec3(0.125) + 0.125 * normalizedNormal;  // Any way to present 3D color to dichromats?
-    fragColor             = vec4(mix(reflectColor, normalColor, cameraTransforms.colorByNormalAmount), 1.0);
+    fragColor = vec4(shadeMcubesSurface(worldPosition, worldNormal, isoLevel), 1.0);
   }
   else
   {
@@ -13,12 +13,17 @@
 #define VEC3 vec3
 #endif
 
+// Number of packed vertices stored per McubesGeometry, shared by its cells. Generous (half of the worst case of
+// 4 triangles in every cell); vertices that do not fit are dropped, and counted in McubesBlockStats.
+#define MCUBES_VERTS_PER_GEOMETRY (MCUBES_CELLS_PER_GEOMETRY * 6)
+
+// Triangles of one cell, as generated by autogeneratedGetCellTriangles. Only a temporary: McubesGeometry
+// stores each cell as a packed header word (see packMcubesCell) and a variable-length vertex list.
 struct McubesCell
 {
 #ifdef __cplusplus
   using uint = uint32_t;
 #endif
-  VEC3 offset;
   uint vertexCount;      // 3 times number of triangles generated in cell.
   uint packedVerts[12];  // bitfield, 10 bits for x, y, z -- see unpackMcubesVertex
 };
@@ -36,12 +41,70 @@ struct McubesGeometry
 
   // Scale factor for packedVerts data -- see unpackMcubesVertex
   VEC3 packedVertScale;
+  uint packedVertCount;  // Number of packedVerts used.
+
+  // World coordinate of local cell coordinate 0,0,0 -- see unpackMcubesCellCoord
+  VEC3  origin;
+  float _originPadding[1];
+
+  // Cells are grouped by iso-level: those of McubesParams::isoLevels[i] start at levelCellEnds[i - 1]
+  // (0 for i = 0) and end before levelCellEnds[i]. Entries past McubesParams::isoLevelCount repeat the last.
+  uint levelCellEnds[MCUBES_MAX_ISO_LEVELS];
 
-  float      _cellsPadding[1];
-  McubesCell cells[MCUBES_CELLS_PER_GEOMETRY];  // Aligned to 16 bytes
+  uint cells[MCUBES_CELLS_PER_GEOMETRY];          // bitfield, see packMcubesCell
+  uint packedVerts[MCUBES_VERTS_PER_GEOMETRY];    // Vertex lists of cells, in no particular order.
+  uint packedNormals[MCUBES_VERTS_PER_GEOMETRY];  // Smooth normal of each packedVerts entry -- see packOctahedral
 };
 
+// Cell header word: 4 bits each for the x, y, z cell coordinate within the McubesGeometry block, 4 bits for
+// the vertex count, 15 bits for the index of the cell's first vertex in McubesGeometry::packedVerts, and
+// MCUBES_CELL_INDIRECT_BIT.
+#if MCUBES_GEOMETRY_EDGE_LENGTH > 16 || MCUBES_VERTS_PER_GEOMETRY > 32768
+#error "Cell header bitfields too narrow"
+#endif
+
+// Set for cells made by mcubes_decimate.comp: their packedVerts entries are not vertices but references to
+// vertices (and normals) of cells nearby -- see packMcubesVertexRef.
+#define MCUBES_CELL_INDIRECT_BIT 0x80000000u
+
 #ifdef VULKAN
+uint packMcubesCell(uvec3 cellCoord, uint vertexCount, uint firstVert)
+{
+  return cellCoord.x | cellCoord.y << 4 | cellCoord.z << 8 | vertexCount << 12 | firstVert << 16;
+}
+
+uvec3 unpackMcubesCellCoord(uint cell)
+{
+  return uvec3(cell & 0xF, (cell >> 4) & 0xF, (cell >> 8) & 0xF);
+}
+
+uint unpackMcubesCellVertexCount(uint cell)
+{
+  return (cell >> 12) & 0xF;
+}
+
+uint unpackMcubesCellFirstVert(uint cell)
+{
+  return (cell >> 16) & 0x7FFF;
+}
+
+// Reference to McubesGeometry::packedVerts[vertIndex], a vertex of the cell at cellOffset (each coordinate
+// 0 or 1) from the referring cell.
+uint packMcubesVertexRef(uvec3 cellOffset, uint vertIndex)
+{
+  return vertIndex | cellOffset.x << 15 | cellOffset.y << 16 | cellOffset.z << 17;
+}
+
+uvec3 unpackMcubesVertexRefCellOffset(uint ref)
+{
+  return uvec3(ref >> 15, ref >> 16, ref >> 17) & 1u;
+}
+
+uint unpackMcubesVertexRefIndex(uint ref)
+{
+  return ref & 0x7FFF;
+}
+
 vec3 unpackMcubesVertex(vec3 packedVertScale, vec3 offset, uint packedVert)
 {
   uvec3 unpacked;
@@ -51,6 +114,27 @@ vec3 unpackMcubesVertex(vec3 packedVertScale, vec3 offset, uint packedVert)
   return offset + packedVertScale * vec3(unpacked);
 }
 
+// Pack the given nonzero direction (need not be normalized) in octahedral encoding, 16 bits per coordinate.
+uint packOctahedral(vec3 n)
+{
+  vec2 p = n.xy / (abs(n.x) + abs(n.y) + abs(n.z));
+  if(n.z < 0.0)
+  {
+    p = (1.0 - abs(p.yx)) * vec2(p.x >= 0.0 ? 1.0 : -1.0, p.y >= 0.0 ? 1.0 : -1.0);
+  }
+  return packSnorm2x16(p);
+}
+
+// Inverse of packOctahedral, returns a unit vector.
+vec3 unpackOctahedral(uint packed)
+{
+  vec2  p = unpackSnorm2x16(packed);
+  vec3  n = vec3(p, 1.0 - abs(p.x) - abs(p.y));
+  float t = max(-n.z, 0.0);
+  n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+  return normalize(n);
+}
+
 // Pack the given 3-vector, with the scale being such that 0 indicates 0.0 and denominator indicates 1.0
 uint packNormalizedVec3(vec3 v, uint denominator)
 {
@@ -4,55 +4,120 @@
 // Vertex shader for unpacking geometry described in a McubesGeometry instance.
 // Meant to be used with multi draw indirect (vertex count embedded in McubesGeometry),
 // each draw handles one element of the McubesGeometry array (passed as storage buffer).
+// With MCUBES_BAKED defined, each draw instead handles one McubesBakedDraw of the animation keyframe cache.
 
 #version 460
 #include "mcubes_geometry.h"
 
 #include "camera_transforms.h"
+#include "mcubes_debug_view_push_constant.h"
 #include "mcubes_params.h"
 
+layout(push_constant) uniform PushConstantBlock
+{
+  McubesDebugViewPushConstant debugViewPushConstant;  // Used by fragment shader
+  uint                        mirrorFlags;            // MCUBES_MIRROR_* bits
+#ifdef MCUBES_BAKED
+  uint                        firstDraw;              // McubesBakedDraw index of gl_DrawID 0
+#endif
+};
+
 layout(set = 0, binding = 0) uniform CameraTransformsBuffer
 {
   CameraTransforms cameraTransforms;
 };
 
 // Somewhat unusually, we are reading what usually would be vertex attributes directly in the vertex shader.
-// This is because the compression scheme in McubesCell can't be supported by fixed-function vertex fetch hardware.
+// This is because the compression scheme in McubesGeometry can't be supported by fixed-function vertex fetch hardware.
 // * Be sure to take this into account for synchronization purposes. *
 // This sort of "decompress then draw" work is something mesh shaders excel at, but we are using the
 // more familiar vertex shader here.
+#ifdef MCUBES_BAKED
+#include "mcubes_bake.h"
+layout(set = 1, binding = MCUBES_BAKE_DRAWS_BINDING) readonly buffer BakedDrawBuffer
+{
+  McubesBakedDraw bakedDraws[];
+};
+layout(set = 1, binding = MCUBES_BAKE_CELLS_BINDING) readonly buffer BakedCellBuffer
+{
+  uint bakedCells[];
+};
+layout(set = 1, binding = MCUBES_BAKE_VERTS_BINDING) readonly buffer BakedVertBuffer
+{
+  uint bakedVerts[];
+};
+layout(set = 1, binding = MCUBES_BAKE_NORMALS_BINDING) readonly buffer BakedNormalBuffer
+{
+  uint bakedNormals[];
+};
+#define DRAW bakedDraws[firstDraw + gl_DrawID]
+#define CELL bakedCells[cellIndex]  // cellIndex includes firstVertex / 12
+#define VERT(i) bakedVerts[DRAW.firstPackedVert + (i)]
+#define NORMAL(i) bakedNormals[DRAW.firstPackedVert + (i)]
+#else
 layout(set = 1, binding = MCUBES_GEOMETRY_BINDING) buffer GeometryBuffer
 {
   McubesGeometry geometryArray[];
 };
+#define DRAW geometryArray[gl_DrawID]
+#define CELL DRAW.cells[cellIndex]
+#define VERT(i) DRAW.packedVerts[i]
+#define NORMAL(i) DRAW.packedNormals[i]
+#endif
 
 layout(location = 0) out vec3 worldPosition;
 layout(location = 1) out vec3 worldNormal;
+layout(location = 2) flat out uint isoLevel;  // Index into McubesParams::isoLevels
 
 
 void main()
 {
   uint cellIndex = gl_VertexIndex / 12u;
-#define CELL geometryArray[gl_DrawID].cells[cellIndex]
+
+  // Geometry may be drawn reflected about coordinate planes (symmetry-aware meshing). If requested,
+  // swap the 2nd and 3rd vertex of each triangle to restore the intended winding order.
+  vec3 mirrorScale = vec3((mirrorFlags & MCUBES_MIRROR_X_BIT) != 0 ? -1.0 : 1.0,
+                          (mirrorFlags & MCUBES_MIRROR_Y_BIT) != 0 ? -1.0 : 1.0,
+                          (mirrorFlags & MCUBES_MIRROR_Z_BIT) != 0 ? -1.0 : 1.0);
+  bool swapWinding = (mirrorFlags & MCUBES_MIRROR_SWAP_WINDING_BIT) != 0;
 
   uint vertIndexInCell = gl_VertexIndex % 12u;
-  uint packedVert      = CELL.packedVerts[vertIndexInCell];
-  vec3 packedVertScale = geometryArray[gl_DrawID].packedVertScale;
-  vec3 offset          = CELL.offset;
-  bool degenerateVert  = vertIndexInCell >= CELL.vertexCount;
-  vec3 worldVert       = degenerateVert ? vec3(0) : unpackMcubesVertex(packedVertScale, offset, packedVert);
-  gl_Position          = cameraTransforms.viewProj * vec4(worldVert, 1.0);
-
-  // The McubesCell specifies anywhere from 0 to 4 triangles (0 to 12 vertices) to draw.
+  uint baseVert        = (vertIndexInCell / 3u) * 3u;
+  if(swapWinding && vertIndexInCell != baseVert)
+    vertIndexInCell = baseVert + 3u - (vertIndexInCell - baseVert);
+  // Only the 4-byte cell header and the cell's valid vertices and normals are read.
+  uint cell            = CELL;
+  uint firstVert       = unpackMcubesCellFirstVert(cell);
+  vec3 packedVertScale = DRAW.packedVertScale;
+  vec3 offset          = DRAW.origin + packedVertScale * vec3(unpackMcubesCellCoord(cell) * 512u);
+  bool degenerateVert  = vertIndexInCell >= unpackMcubesCellVertexCount(cell);
+  uint vertIndex       = firstVert + vertIndexInCell;
+  if((cell & MCUBES_CELL_INDIRECT_BIT) != 0 && !degenerateVert)
+  {
+    // Decimated cell (see mcubes_decimate.comp): the entry refers to a vertex of a cell nearby.
+    uint ref  = VERT(vertIndex);
+    vertIndex = unpackMcubesVertexRefIndex(ref);
+    offset += packedVertScale * vec3(unpackMcubesVertexRefCellOffset(ref) * 512u);
+  }
+  vec3 worldVert       = degenerateVert ? vec3(0) : unpackMcubesVertex(packedVertScale, offset, VERT(vertIndex));
+  worldVert *= mirrorScale;
+  gl_Position = cameraTransforms.viewProj * vec4(worldVert, 1.0);
+
+  isoLevel = 0;
+  for(uint level = 0; level + 1u < MCUBES_MAX_ISO_LEVELS; ++level)
+  {
+    isoLevel += cellIndex >= DRAW.levelCellEnds[level] ? 1u : 0u;
+  }
+
+  // The cell header specifies anywhere from 0 to 4 triangles (0 to 12 vertices) to draw.
   // Since we are using a vertex shader, we use the degenerate triangle trick to cull the extra triangles.
   // If we were using mesh shaders, we could express this more directly.
   if(!degenerateVert)
   {
-    // Deduce normal.
-    uint baseVert = (vertIndexInCell / 3u) * 3u;
-    vec3 tri0     = unpackMcubesVertex(packedVertScale, vec3(0), CELL.packedVerts[baseVert]);
-    vec3 tri1     = unpackMcubesVertex(packedVertScale, vec3(0), CELL.packedVerts[baseVert + 1]);
-    vec3 tri2     = unpackMcubesVertex(packedVertScale, vec3(0), CELL.packedVerts[baseVert + 2]);
-    worldNormal   = normalize(cross(tri1 - tri0, tri2 - tri1));
+    // Smooth normal computed by mcubes_geometry.comp.
+    // For an odd equation (whose winding is swapped iff an even number of axes is reflected), f(Mp) = -f(p), so
+    // the reflected normal is negated as well.
+    bool oddEquation = (bitCount(mirrorFlags & 7u) & 1) != int(swapWinding);
+    worldNormal      = (oddEquation ? -mirrorScale : mirrorScale) * unpackOctahedral(NORMAL(vertIndex));
   }
 }
@@ -30,15 +30,64 @@
  * (MCUBES_CHUNK_EDGE_LENGTH_TEXELS / MCUBES_GEOMETRY_EDGE_LENGTH) \
  * (MCUBES_CHUNK_EDGE_LENGTH_TEXELS / MCUBES_GEOMETRY_EDGE_LENGTH))
 
+// When the equation has separable terms (see equationEmitSeparableGlsl), each mcubes_image.comp
+// workgroup fills this many rows of texels, sharing per-axis tables of those terms.
+#define MCUBES_IMAGE_ROWS_PER_WORKGROUP 16  // Keep as power of 2, at most MCUBES_CHUNK_EDGE_LENGTH_TEXELS
+
+// Bitmask, one bit per McubesGeometry in a chunk, of blocks proven empty by CPU-side culling
+// (see mcubes_cull.hpp); mcubes_geometry.comp skips these.
+#define MCUBES_BLOCK_MASK_WORDS (MCUBES_GEOMETRIES_PER_CHUNK / 32)
+
+// Maximum number of iso-levels (values of the equation at which to extract a surface) extracted from one image
+// by mcubes_geometry.comp; see McubesParams::isoLevels and McubesGeometry::levelCellEnds.
+#define MCUBES_MAX_ISO_LEVELS 4
+
+// Bits of the push constant used to draw a chunk's McubesGeometry reflected about coordinate planes
+// (see mcubes_symmetry.hpp). Reflected triangles have their 2nd and 3rd vertex swapped if requested.
+#define MCUBES_MIRROR_X_BIT 1
+#define MCUBES_MIRROR_Y_BIT 2
+#define MCUBES_MIRROR_Z_BIT 4
+#define MCUBES_MIRROR_SWAP_WINDING_BIT 8
+
+// Values for McubesParams::mesher: how mcubes_geometry.comp turns the image into triangles.
+#define MCUBES_MESHER_MARCHING_CUBES 0
+#define MCUBES_MESHER_SURFACE_NETS 1  // One vertex per cell, quads across crossed edges
+
 #ifdef __cplusplus
 #include <nvmath/nvmath_glsltypes.h>  // emulate glsl types in C++
 #define VEC3 nvmath::vec3f
+#define VEC4 nvmath::vec4f
+#define UINT uint32_t
 #else
 #define VEC3 vec3
+#define VEC4 vec4
+#define UINT uint
 #endif
 
 #define MCUBES_GEOMETRY_BINDING 0
 #define MCUBES_IMAGE_BINDING 1
+#define MCUBES_BLOCK_MASK_BINDING 2
+#define MCUBES_BLOCK_SIGNATURE_BINDING 3
+#define MCUBES_BLOCK_STATS_BINDING 4
+
+// Sign signature of each McubesGeometry block, one uint per block, accumulated by mcubes_image.comp over the
+// texels used by the block's cells: bit 2i (2i + 1) is set if some texel is above (not above) isoLevels[i].
+// A block without both bits for any level has no surface, so mcubes_geometry.comp skips it.
+#define MCUBES_SIGNATURE_ABOVE_BIT 1
+#define MCUBES_SIGNATURE_BELOW_BIT 2
+
+// Counts from mcubes_geometry.comp (and mcubes_decimate.comp); one per frame slot (see McubesParams::statsSlot),
+// read back by the host.
+struct McubesBlockStats
+{
+  UINT blockCount;              // Blocks not culled by the CPU.
+  UINT uniformBlockCount;       // Those skipped for their sign signature.
+  UINT cellCount;               // Non-empty cells stored in McubesGeometry::cells, after decimation.
+  UINT packedVertCount;         // Vertices stored in McubesGeometry::packedVerts, before decimation.
+  UINT decimatedTriangleCount;  // Triangles removed by mcubes_decimate.comp.
+  UINT droppedCellCount;        // Cell headers (of 1 to 4 triangles) not stored, as McubesGeometry::cells was full.
+  UINT droppedVertCount;        // Vertices of stored cells not stored, as packedVerts was full (the cell is empty).
+};
 
 struct McubesParams
 {
@@ -46,9 +95,19 @@ struct McubesParams
   float t;
   VEC3  size;  // length/height/width of the cuboid to be filled by this compute dispatch.
                // texel [MCUBES_CHUNK_EDGE_LENGTH_CELLS, "", ""] is at world coordinate offset + size
-  float _pad[1];
+  UINT  csgSkipMask;  // CSG operands not affecting this chunk, see equationCsgSkipMask.
+  VEC4  userParams;   // Values of the equation's user parameters a, b, c, d.
+  VEC4  isoLevels;    // Extract the surfaces where the equation equals isoLevels[0 .. isoLevelCount - 1].
+  UINT  isoLevelCount;
+  UINT  statsSlot;          // Index of the McubesBlockStats to count into.
+  UINT  newtonSteps;        // Newton steps refining each vertex on the equation itself, see mcubes_geometry.comp.
+  UINT  mesher;             // MCUBES_MESHER_MARCHING_CUBES or MCUBES_MESHER_SURFACE_NETS
+  float decimateTolerance;  // In texels; if positive, mcubes_decimate.comp runs with this error bound.
+  UINT  _pad[3];
 };
 
+#undef UINT
+#undef VEC4
 #undef VEC3
 
 #endif
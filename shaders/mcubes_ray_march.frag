@@ -0,0 +1,215 @@
+// Copyright 2021 NVIDIA CORPORATION
+// SPDX-License-Identifier: Apache-2.0
+//
+// Fragment shader for the ray marching render mode: instead of drawing the McubesGeometry extracted from the
+// chunk's 3D image, march the view ray through the image itself and shade the first iso-level crossing.
+// The image is trilinearly interpolated, so this finds the same surface that marching cubes approximates
+// with linear interpolation along cell edges. McubesGeometry blocks whose block signature shows no crossing
+// (see MCUBES_BLOCK_SIGNATURE_BINDING) are skipped in one step.
+#version 460
+#include "camera_transforms.h"
+#include "mcubes_debug_view_push_constant.h"
+#include "mcubes_params.h"
+
+layout(push_constant) uniform PushConstantBlock
+{
+  McubesParams                pushConstant;           // Of the chunk as filled, not reflected
+  McubesDebugViewPushConstant debugViewPushConstant;  // Overrides the shading if enabled
+  uint                        mirrorFlags;            // MCUBES_MIRROR_* bits
+};
+
+layout(set = 0, binding = 0) uniform CameraTransformsBuffer
+{
+  CameraTransforms cameraTransforms;
+};
+
+#include "mcubes_shading.glsl"
+
+layout(set = 1, binding = MCUBES_IMAGE_BINDING, r32f) uniform readonly image3D inputImage;
+layout(set = 1, binding = MCUBES_BLOCK_SIGNATURE_BINDING) readonly buffer BlockSignatureBuffer
+{
+  uint blockSignatures[MCUBES_GEOMETRIES_PER_CHUNK];
+};
+
+layout(location = 0) in vec3 worldPosition;  // On the (reflected) chunk bounding box
+
+layout(location = 0) out vec4 fragColor;
+
+const float maxTexel       = float(MCUBES_CHUNK_EDGE_LENGTH_TEXELS - 1);
+const uint  blocksPerEdge  = MCUBES_CHUNK_EDGE_LENGTH_TEXELS / MCUBES_GEOMETRY_EDGE_LENGTH;
+const float stepTexels     = 0.5;    // Ray marching step, in texels
+const uint  maxSteps       = 1024u;  // Enough to cross the chunk diagonally, with room for block skips
+const uint  bisectionSteps = 6u;
+
+// Trilinear interpolation of the image at the given texel-space position.
+float sampleImage(vec3 texelPos)
+{
+  texelPos = clamp(texelPos, vec3(0), vec3(maxTexel));
+  ivec3 lo = min(ivec3(texelPos), ivec3(MCUBES_CHUNK_EDGE_LENGTH_TEXELS - 2));
+  vec3  f  = texelPos - vec3(lo);
+
+  float v000 = imageLoad(inputImage, lo).x;
+  float v001 = imageLoad(inputImage, lo + ivec3(0, 0, 1)).x;
+  float v010 = imageLoad(inputImage, lo + ivec3(0, 1, 0)).x;
+  float v011 = imageLoad(inputImage, lo + ivec3(0, 1, 1)).x;
+  float v100 = imageLoad(inputImage, lo + ivec3(1, 0, 0)).x;
+  float v101 = imageLoad(inputImage, lo + ivec3(1, 0, 1)).x;
+  float v110 = imageLoad(inputImage, lo + ivec3(1, 1, 0)).x;
+  float v111 = imageLoad(inputImage, lo + ivec3(1, 1, 1)).x;
+  return mix(mix(mix(v000, v001, f.z), mix(v010, v011, f.z), f.y),
+             mix(mix(v100, v101, f.z), mix(v110, v111, f.z), f.y), f.x);
+}
+
+// Bit i set if the value is above isoLevels[i].
+uint aboveMask(float value)
+{
+  uint result = 0;
+  for(uint level = 0; level < pushConstant.isoLevelCount; ++level)
+  {
+    result |= value > pushConstant.isoLevels[level] ? 1u << level : 0u;
+  }
+  return result;
+}
+
+// Same as in mcubes_geometry.comp: true if the block has no surface.
+bool uniformSigns(uint signature)
+{
+  const uint bothBits = MCUBES_SIGNATURE_ABOVE_BIT | MCUBES_SIGNATURE_BELOW_BIT;
+  for(uint level = 0; level < pushConstant.isoLevelCount; ++level)
+  {
+    if(((signature >> (2u * level)) & bothBits) == bothBits)
+      return false;
+  }
+  return true;
+}
+
+void main()
+{
+  // Set up the ray in the texel space of the chunk as filled; t is the world-space distance from the camera.
+  vec3 mirrorScale  = vec3((mirrorFlags & MCUBES_MIRROR_X_BIT) != 0 ? -1.0 : 1.0,
+                           (mirrorFlags & MCUBES_MIRROR_Y_BIT) != 0 ? -1.0 : 1.0,
+                           (mirrorFlags & MCUBES_MIRROR_Z_BIT) != 0 ? -1.0 : 1.0);
+  vec3 cameraOrigin = (cameraTransforms.viewInverse * vec4(0, 0, 0, 1)).xyz;
+  vec3 rayDirection = normalize(worldPosition - cameraOrigin);
+  vec3 texelScale   = maxTexel / pushConstant.size;
+  vec3 origin       = (mirrorScale * cameraOrigin - pushConstant.offset) * texelScale;
+  vec3 direction    = mirrorScale * rayDirection * texelScale;
+  vec3 invDirection = 1.0 / direction;
+
+  // Both the front and back faces of the box cover the ray; march only once, for the fragment nearer the
+  // far end (the only one if the camera is inside the box).
+  vec3  tLow      = -origin * invDirection;
+  vec3  tHigh     = (vec3(maxTexel) - origin) * invDirection;
+  vec3  tMin      = min(tLow, tHigh);
+  vec3  tMax      = max(tLow, tHigh);
+  float tNear     = max(max(tMin.x, tMin.y), max(tMin.z, 0.0));
+  float tFar      = min(min(tMax.x, tMax.y), tMax.z);
+  float tFragment = distance(worldPosition, cameraOrigin);
+  if(tNear >= tFar || tFragment < 0.5 * (tNear + tFar))
+    discard;
+
+  float stepT     = stepTexels / length(direction);
+  float t         = tNear;
+  float prevT     = 0.0;
+  float prevValue = 0.0;
+  uint  prevAbove = 0;
+  bool  havePrev  = false;
+  uint  hitLevel  = ~0u;
+  for(uint i = 0; i < maxSteps; ++i)
+  {
+    bool last = t >= tFar;
+    t         = min(t, tFar);
+    vec3 p    = origin + t * direction;
+
+    // Skip the rest of the McubesGeometry block if the surface does not pass through it. The previous sample
+    // is kept, so a crossing just before the block is still found.
+    uvec3 block      = min(uvec3(max(p, vec3(0))) / MCUBES_GEOMETRY_EDGE_LENGTH, uvec3(blocksPerEdge - 1u));
+    uint  blockIndex = block.x + blocksPerEdge * (block.y + blocksPerEdge * block.z);
+    if(uniformSigns(blockSignatures[blockIndex]))
+    {
+      if(last)
+        break;
+      vec3  blockLow = vec3(block * MCUBES_GEOMETRY_EDGE_LENGTH);
+      vec3  tExits   = max((blockLow - origin) * invDirection,
+                           (blockLow + float(MCUBES_GEOMETRY_EDGE_LENGTH) - origin) * invDirection);
+      float tExit    = min(min(tExits.x, tExits.y), tExits.z);
+      t              = max(t, tExit) + 0.01 * stepT;
+      continue;
+    }
+
+    float value = sampleImage(p);
+    uint  above = aboveMask(value);
+    if(havePrev && above != prevAbove)
+    {
+      // Of the iso-levels crossed since the previous sample, pick the one crossed first (linear estimate).
+      float firstFraction = 2.0;
+      for(uint crossed = above ^ prevAbove; crossed != 0; crossed &= crossed - 1u)
+      {
+        uint  level    = findLSB(crossed);
+        float fraction = (pushConstant.isoLevels[level] - prevValue) / (value - prevValue);
+        if(fraction < firstFraction)
+        {
+          firstFraction = fraction;
+          hitLevel      = level;
+        }
+      }
+      break;
+    }
+    prevT     = t;
+    prevValue = value;
+    prevAbove = above;
+    havePrev  = true;
+    if(last)
+      break;
+    t += stepT;
+  }
+  if(hitLevel == ~0u)
+    discard;
+
+  // Refine the crossing by bisection, then linear interpolation.
+  float isoLevel   = pushConstant.isoLevels[hitLevel];
+  float lowT       = prevT;
+  float highT      = t;
+  float lowValue   = prevValue;
+  float highValue  = sampleImage(origin + t * direction);
+  bool  lowIsAbove = lowValue > isoLevel;
+  for(uint i = 0; i < bisectionSteps; ++i)
+  {
+    float midT     = 0.5 * (lowT + highT);
+    float midValue = sampleImage(origin + midT * direction);
+    if((midValue > isoLevel) == lowIsAbove)
+    {
+      lowT     = midT;
+      lowValue = midValue;
+    }
+    else
+    {
+      highT     = midT;
+      highValue = midValue;
+    }
+  }
+  float hitT = mix(lowT, highT, clamp((isoLevel - lowValue) / (highValue - lowValue), 0.0, 1.0));
+
+  // Normal from the gradient of the interpolated image, pointing toward the positive side as for the mesh.
+  vec3 hitTexel = origin + hitT * direction;
+  vec3 gradient;
+  gradient.x = sampleImage(hitTexel + vec3(0.5, 0, 0)) - sampleImage(hitTexel - vec3(0.5, 0, 0));
+  gradient.y = sampleImage(hitTexel + vec3(0, 0.5, 0)) - sampleImage(hitTexel - vec3(0, 0.5, 0));
+  gradient.z = sampleImage(hitTexel + vec3(0, 0, 0.5)) - sampleImage(hitTexel - vec3(0, 0, 0.5));
+  vec3 hitWorld    = cameraOrigin + hitT * rayDirection;
+  // As in mcubes_geometry.vert, an odd equation (f(Mp) = -f(p)) also negates the reflected gradient.
+  bool oddEquation = (bitCount(mirrorFlags & 7u) & 1) != int((mirrorFlags & MCUBES_MIRROR_SWAP_WINDING_BIT) != 0);
+  vec3 worldNormal = (oddEquation ? -mirrorScale : mirrorScale) * gradient * texelScale;
+
+  vec4 hitClip = cameraTransforms.viewProj * vec4(hitWorld, 1.0);
+  gl_FragDepth = hitClip.z / hitClip.w;
+
+  if(debugViewPushConstant.enabled == 0.0)
+  {
+    fragColor = vec4(shadeMcubesSurface(hitWorld, worldNormal, hitLevel), 1.0);
+  }
+  else
+  {
+    fragColor = vec4(debugViewPushConstant.red, debugViewPushConstant.green, debugViewPushConstant.blue, 1.0);
+  }
+}
@@ -0,0 +1,46 @@
+// Copyright 2021 NVIDIA CORPORATION
+// SPDX-License-Identifier: Apache-2.0
+//
+// Vertex shader for the ray marching render mode: rasterize the (reflected) bounding box of a chunk, so that
+// mcubes_ray_march.frag runs for every pixel the chunk may cover. Draw with 36 vertices, without culling.
+#version 460
+#include "camera_transforms.h"
+#include "mcubes_debug_view_push_constant.h"
+#include "mcubes_params.h"
+
+layout(push_constant) uniform PushConstantBlock
+{
+  McubesParams                pushConstant;           // Of the chunk as filled, not reflected
+  McubesDebugViewPushConstant debugViewPushConstant;  // Used by fragment shader
+  uint                        mirrorFlags;            // MCUBES_MIRROR_* bits
+};
+
+layout(set = 0, binding = 0) uniform CameraTransformsBuffer
+{
+  CameraTransforms cameraTransforms;
+};
+
+layout(location = 0) out vec3 worldPosition;
+
+// Corners of the 2 triangles of a face, in the face's own 2D coordinates.
+// clang-format off
+const vec2 faceTable[6] = vec2[](vec2(0,0), vec2(1,0), vec2(1,1), vec2(0,0), vec2(1,1), vec2(0,1));
+// clang-format on
+
+void main()
+{
+  uint face = uint(gl_VertexIndex) / 6u;  // 0-2: low x, y, z faces; 3-5: high x, y, z faces
+  uint axis = face % 3u;
+  vec2 uv   = faceTable[uint(gl_VertexIndex) % 6u];
+
+  vec3 cube              = vec3(0);
+  cube[axis]             = float(face / 3u);
+  cube[(axis + 1u) % 3u] = uv.x;
+  cube[(axis + 2u) % 3u] = uv.y;
+
+  vec3 mirrorScale = vec3((mirrorFlags & MCUBES_MIRROR_X_BIT) != 0 ? -1.0 : 1.0,
+                          (mirrorFlags & MCUBES_MIRROR_Y_BIT) != 0 ? -1.0 : 1.0,
+                          (mirrorFlags & MCUBES_MIRROR_Z_BIT) != 0 ? -1.0 : 1.0);
+  worldPosition    = mirrorScale * (pushConstant.offset + pushConstant.size * cube);
+  gl_Position      = cameraTransforms.viewProj * vec4(worldPosition, 1.0);
+}
@@ -0,0 +1,28 @@
+// Copyright 2021 NVIDIA CORPORATION
+// SPDX-License-Identifier: Apache-2.0
+#ifndef NVPRO_SAMPLES_VK_TIMELINE_SEMAPHORE_SHADERS_MCUBES_SHADING_GLSL_
+#define NVPRO_SAMPLES_VK_TIMELINE_SEMAPHORE_SHADERS_MCUBES_SHADING_GLSL_
+
+// Surface shading shared by the mesh (mcubes_geometry.frag) and ray marching (mcubes_ray_march.frag) render
+// modes, so that the two can be compared side by side. Include after declaring cameraTransforms.
+#include "mcubes_params.h"
+#include "skybox.glsl"
+
+// Tell nested iso-level shells apart; the first level keeps the untinted look.
+const vec3 isoLevelTints[MCUBES_MAX_ISO_LEVELS] =
+    vec3[](vec3(1.0), vec3(1.0, 0.6, 0.4), vec3(0.5, 1.0, 0.5), vec3(0.5, 0.7, 1.0));
+
+// Color of the surface for isoLevels[isoLevel] at the given world position, with the given (not necessarily
+// normalized) world-space normal.
+vec3 shadeMcubesSurface(vec3 worldPosition, vec3 worldNormal, uint isoLevel)
+{
+  vec3 normalizedNormal = normalize(worldNormal);  // Natural language "operator oveloading"
+  vec3 cameraOrigin     = (cameraTransforms.viewInverse * vec4(0, 0, 0, 1)).xyz;
+  vec3 reflected        = normalize(reflect(worldPosition - cameraOrigin, normalizedNormal));
+  vec3 reflectColor     = 0.5 * sampleSkyboxNormalized(reflected);
+  vec3 normalColor      = vec3(0.125) + 0.125 * normalizedNormal;  // Any way to present 3D color to dichromats?
+  vec3 tint             = isoLevelTints[min(isoLevel, MCUBES_MAX_ISO_LEVELS - 1u)];
+  return tint * mix(reflectColor, normalColor, cameraTransforms.colorByNormalAmount);
+}
+
+#endif
@@ -0,0 +1,61 @@
+// Copyright 2021 NVIDIA CORPORATION
+// SPDX-License-Identifier: Apache-2.0
+#ifndef NVPRO_SAMPLES_VK_TIMELINE_SEMAPHORE_MCUBES_UPLOAD_H_
+#define NVPRO_SAMPLES_VK_TIMELINE_SEMAPHORE_MCUBES_UPLOAD_H_
+
+// Layout of the staging ring through which McubesGeometry arrays meshed on the CPU (see mcubes_cpu_batch.hpp)
+// reach the McubesChunk geometry buffers. The ring is divided into regions of MCUBES_UPLOAD_REGION_WORDS uints,
+// one per CPU-meshed chunk: MCUBES_GEOMETRIES_PER_CHUNK McubesStagedGeometry records, then the valid cells,
+// packed vertices and normals of those McubesGeometry. mcubes_upload.comp expands a region back into the
+// McubesGeometry array of a chunk.
+
+#include "mcubes_params.h"
+
+#ifdef __cplusplus
+#include <nvmath/nvmath_glsltypes.h>  // emulate glsl types in C++
+#include <stdint.h>
+#define VEC3 nvmath::vec3f
+#else
+#define VEC3 vec3
+#endif
+
+// Bindings of g_mcubesUploadDescriptorSetLayout; both refer to the whole staging ring.
+#define MCUBES_UPLOAD_STAGED_GEOMETRY_BINDING 0  // Array of McubesStagedGeometry
+#define MCUBES_UPLOAD_STAGED_WORDS_BINDING 1     // Array of uint
+
+// 8 MiB per region; McubesGeometry that do not fit are dropped (stored without cells).
+#define MCUBES_UPLOAD_REGION_WORDS (2u << 20)
+
+// Size of McubesStagedGeometry, in uints.
+#define MCUBES_STAGED_GEOMETRY_WORDS 16
+
+struct McubesStagedGeometry
+{
+#ifdef __cplusplus
+  using uint = uint32_t;
+#endif
+  VEC3 packedVertScale;  // As McubesGeometry::packedVertScale
+  uint packedVertCount;
+
+  VEC3 origin;  // As McubesGeometry::origin
+  uint cellCount;
+
+  // Index in the staging ring, as an array of uint, of the cellCount cells; packedVertCount packed vertices,
+  // then as many packed normals, follow them.
+  uint firstWord;
+  uint _pad[3];
+
+  uint levelCellEnds[MCUBES_MAX_ISO_LEVELS];  // As McubesGeometry::levelCellEnds
+};
+
+// Push constant of mcubes_upload.comp.
+struct McubesUploadParams
+{
+#ifdef __cplusplus
+  using uint = uint32_t;
+#endif
+  uint region;  // Staging region holding the bound chunk's McubesGeometry.
+};
+
+#undef VEC3
+#endif
@@ -6,6 +6,8 @@
 #include <math.h>
 #include <future>
 #include <stdexcept>
+#include <stdlib.h>
+#include <string.h>
 #include <utility>
 #include <vector>
 
@@ -15,24 +17,34 @@
 
 // Header files for this project
 #include "compute.hpp"
+#include "equation.hpp"
+#include "equation_program.hpp"
 #include "graphics.hpp"
 #include "gui.hpp"
+#include "mcubes_bake.hpp"
+#include "mcubes_brick.hpp"
 #include "mcubes_chunk.hpp"
+#include "mcubes_cpu.hpp"
+#include "mcubes_cpu_batch.hpp"
+#include "mcubes_cull.hpp"
+#include "mcubes_symmetry.hpp"
 #include "search_paths.hpp"
+#include "volume_file.hpp"
 
 // GLSL/C++ shared header files
 #include "shaders/mcubes_debug_view_push_constant.h"
 #include "shaders/mcubes_geometry.h"
 
-GLFWwindow*                      g_window;
-nvvk::Context                    g_ctx;
-nvvk::ResourceAllocatorDedicated g_allocator;
-VkSurfaceKHR                     g_surface;
-nvvk::SwapChain                  g_swapChain;
-VkQueue                          g_gctQueue, g_computeQueue;
-VkCommandPool                    g_gctPool, g_computePool;
-nvvk::ShaderModuleManager*       g_pShaderCompiler;
-uint64_t                         g_frameNumber = 0;  // First frame is number 1.
+GLFWwindow*                g_window;
+nvvk::Context              g_ctx;
+SuballocatingMemAllocator  g_memAllocator;
+nvvk::ResourceAllocator    g_allocator;
+VkSurfaceKHR               g_surface;
+nvvk::SwapChain            g_swapChain;
+VkQueue                    g_gctQueue, g_computeQueue;
+VkCommandPool              g_gctPool, g_computePool;
+nvvk::ShaderModuleManager* g_pShaderCompiler;
+uint64_t                   g_frameNumber = 0;  // First frame is number 1.
 
 static VkFence         s_submitFrameFences[2];
 static VkCommandBuffer s_submitFrameCommandBuffers[2];
@@ -62,12 +74,33 @@ static VkSemaphore s_graphicsDoneTimelineSemaphore;
 // This is incremented upon each submit that signals (increments) the above semaphores, and indicates the
 // value that the semaphore will have upon the submitted work being COMPLETED.
 static uint64_t s_upcomingTimelineValue = 1;
+// Set to g_frameNumber when the submitFrame commands of that frame, the last ones of the frame to use the
+// offscreen framebuffer, complete (see graphicsResizeFramebufferIfNeeded).
+static VkSemaphore s_frameDoneTimelineSemaphore;
+// Signaled from the host (vkSignalSemaphore), := g_frameNumber once the CPU has staged the chunks of that frame
+// that it meshes; the compute queue waits on it before uploading them (see mcubes_cpu_batch.hpp).
+static VkSemaphore s_cpuDoneTimelineSemaphore;
+// Signaled from the host too, by the brick thread (or by its uploads on the transfer queue), := the value of a batch
+// of bricks once they are staged; the compute queue waits on it before copying them into the chunk images (see
+// mcubes_brick.hpp).
+static VkSemaphore s_bricksReadyTimelineSemaphore;
+static uint64_t    s_bricksReadyTimelineValue = 0;  // Of the latest batch of bricks launched.
 // We are using the array of McubesChunk (g_mcubesChunkArray) as a ring buffer for communication between
 // compute and graphics queues; this is the cycling index into that array.
 static uint32_t s_mcubesChunkIndex = 0;
 
 static bool s_useComputeQueue;
 
+// CPU-side parse of the current equation, for culling. Empty if the parser did not understand it.
+static Equation         s_equation;
+static EquationSymmetry s_equationSymmetry;  // Of s_equation, if not empty.
+
+// How to draw each chunk of this frame (reflected about coordinate planes), see mcubes_symmetry.hpp.
+static McubesSymmetry s_mcubesSymmetry;
+
+// Volume file given on the command line, if any (pMapped is null otherwise).
+static VolumeFile s_volume;
+
 
 
 static void setupGlobals()
@@ -117,8 +150,9 @@ static void setupGlobals()
   // NOTE For Vulkan 1.2, you must instead enable this feature in VkPhysicalDeviceVulkan12Features::timelineSemaphore.
   // https://www.khronos.org/registry/vulkan/specs/1.2-extensions/man/html/VkPhysicalDeviceVulkan12Features.html
 
-  // * Init memory allocator helper.
-  g_allocator.init(g_ctx, g_ctx.m_physicalDevice);
+  // * Init memory allocator helper, suballocating from large VkDeviceMemory blocks.
+  g_memAllocator.init(g_ctx, g_ctx.m_physicalDevice);
+  g_allocator.init(g_ctx, g_ctx.m_physicalDevice, &g_memAllocator);
 
   // * Init swap chain.
   g_surface = VK_NULL_HANDLE;
@@ -177,6 +211,7 @@ static void shutdownGlobals()
 
   // * Shut down memory allocator.
   g_allocator.deinit();
+  g_memAllocator.deinit();
 
   // * Shut down Vulkan device
   g_ctx.deinit();
@@ -218,6 +253,9 @@ static void setupStatics()
   VkSemaphoreCreateInfo     semaphoreInfo         = {VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO, &timelineSemaphoreInfo};
   NVVK_CHECK(vkCreateSemaphore(g_ctx, &semaphoreInfo, nullptr, &s_computeDoneTimelineSemaphore));
   NVVK_CHECK(vkCreateSemaphore(g_ctx, &semaphoreInfo, nullptr, &s_graphicsDoneTimelineSemaphore));
+  NVVK_CHECK(vkCreateSemaphore(g_ctx, &semaphoreInfo, nullptr, &s_frameDoneTimelineSemaphore));
+  NVVK_CHECK(vkCreateSemaphore(g_ctx, &semaphoreInfo, nullptr, &s_cpuDoneTimelineSemaphore));
+  NVVK_CHECK(vkCreateSemaphore(g_ctx, &semaphoreInfo, nullptr, &s_bricksReadyTimelineSemaphore));
 }
 
 static void shutdownStatics()
@@ -230,6 +268,9 @@ static void shutdownStatics()
   vkDestroyFence(g_ctx, s_frameComputePoolFences[1], nullptr);
   vkDestroySemaphore(g_ctx, s_computeDoneTimelineSemaphore, nullptr);
   vkDestroySemaphore(g_ctx, s_graphicsDoneTimelineSemaphore, nullptr);
+  vkDestroySemaphore(g_ctx, s_frameDoneTimelineSemaphore, nullptr);
+  vkDestroySemaphore(g_ctx, s_cpuDoneTimelineSemaphore, nullptr);
+  vkDestroySemaphore(g_ctx, s_bricksReadyTimelineSemaphore, nullptr);
   vkDestroyCommandPool(g_ctx, s_frameGraphicsPools[0], nullptr);
   vkDestroyCommandPool(g_ctx, s_frameGraphicsPools[1], nullptr);
   vkDestroyCommandPool(g_ctx, s_frameComputePools[0], nullptr);
@@ -268,6 +309,175 @@ static std::vector<McubesParams> getMcubesParamsList(float t)
   return result;
 }
 
+// Parse and optimize the gui's equation for CPU-side use; on failure, CPU-side features (culling) are disabled.
+static void parseEquation(const Gui* pGui)
+{
+  std::string error;
+  s_equationSymmetry = {0, 0};
+  if(equationParse(pGui->m_equationInput.data(), &s_equation, &error))
+  {
+    equationOptimize(&s_equation);
+    s_equationSymmetry = equationFindSymmetry(s_equation);
+  }
+  else
+  {
+    fprintf(stderr, "\x1b[35m\x1b[1mWARNING:\x1b[0m Culling disabled, %s\n", error.c_str());
+  }
+}
+
+// Mirror symmetries of the surface to exploit, per the gui's settings.
+static EquationSymmetry getSymmetry(const Gui* pGui)
+{
+  EquationSymmetry result = {0, 0};
+  if(pGui->m_symmetryMode == symmetryModeAuto)
+  {
+    result = s_equationSymmetry;
+  }
+  else if(pGui->m_symmetryMode == symmetryModeDeclared)
+  {
+    // Declared symmetries are even, and so is any combination of them.
+    uint32_t axes = uint32_t(pGui->m_declaredMirror[0]) | uint32_t(pGui->m_declaredMirror[1]) << 1
+                    | uint32_t(pGui->m_declaredMirror[2]) << 2;
+    for(uint32_t mask = 1; mask < 8; ++mask)
+    {
+      result.evenMasks |= (mask & ~axes) == 0 ? 1u << mask : 0u;
+    }
+  }
+  return result;
+}
+
+// Whether to mesh the volume file instead of the equation; its bricks need the compute queue.
+static bool useVolume(const Gui* pGui)
+{
+  return s_volume.pMapped != nullptr && pGui->m_meshVolume && s_useComputeQueue;
+}
+
+// Get list of marching cubes jobs to run, minus chunks proven to contain no surface, and minus
+// chunks that are drawn as reflections of others (as described by s_mcubesSymmetry).
+static std::vector<McubesParams> getCulledMcubesJobs(const Gui* pGui)
+{
+  std::vector<McubesParams> jobs = pGui->getMcubesJobs();
+  if(useVolume(pGui))
+  {
+    // One job per brick of the volume, which is stretched over the bounding box; nothing to cull it with.
+    nvmath::vec3f low, high;
+    McubesParams  settings = jobs[0];
+    pGui->getBoundingBox(&low, &high);
+    volumeFileGetJobs(s_volume, low, high, settings, &jobs);
+    cullResetStats(uint32_t(jobs.size()));
+    symmetryReduceMcubesJobs({0, 0}, &jobs, &s_mcubesSymmetry);
+    for(McubesParams& job : jobs)
+    {
+      job.statsSlot = uint32_t(g_frameNumber & 1u);
+    }
+    return jobs;
+  }
+  cullResetStats(uint32_t(jobs.size()));
+  g_mcubesCullStats.mirroredChunkCount = symmetryReduceMcubesJobs(getSymmetry(pGui), &jobs, &s_mcubesSymmetry);
+  if(pGui->m_cullChunks && !s_equation.empty())
+  {
+    cullMcubesJobs(s_equation, &jobs);
+  }
+  if(pGui->m_skipCsgOperands && !s_equation.empty())
+  {
+    cullSetCsgSkipMasks(s_equation, &jobs);
+  }
+  for(McubesParams& job : jobs)
+  {
+    job.statsSlot = uint32_t(g_frameNumber & 1u);
+  }
+  return jobs;
+}
+
+// Decide whether to draw this frame from the animation keyframe cache (then clearing the list of jobs),
+// or to compute it and possibly bake it into the cache; see mcubes_bake.hpp.
+static McubesBakeFrame getBakeFrame(const Gui* pGui, std::vector<McubesParams>* pJobs)
+{
+  McubesBakeKey key;
+  uint32_t      keyframe = ~0u;
+  if(useVolume(pGui) || !pGui->getBakeKeyframe(&key, &keyframe))  // The volume does not animate.
+  {
+    keyframe = ~0u;
+  }
+  McubesBakeFrame result =
+      mcubesBakeUpdate(key, keyframe, uint32_t(pJobs->size()), s_mcubesSymmetry, uint32_t(g_frameNumber & 1u));
+  if(result.pReplay != nullptr)
+  {
+    pJobs->clear();
+  }
+  return result;
+}
+
+// Fill McubesChunk::emptyBlockMask for each chunk in the batch, for the corresponding job.
+static void setEmptyBlockMasks(const Gui*          pGui,
+                               uint32_t            count,
+                               McubesChunk* const* chunkPointerArray,
+                               const McubesParams* pParams)
+{
+  nvmath::vec3f low, high;
+  pGui->getBoundingBox(&low, &high);
+  const Equation* pEquation = pGui->m_cullBlocks && !s_equation.empty() ? &s_equation : nullptr;
+  for(uint32_t i = 0; i < count; ++i)
+  {
+    if(useVolume(pGui))
+      volumeFileGetEmptyBlockMask(s_volume, low, high, pParams[i], chunkPointerArray[i]->emptyBlockMask);
+    else
+      cullGetEmptyBlockMask(pEquation, pParams[i], chunkPointerArray[i]->emptyBlockMask);
+  }
+}
+
+// Whether to give a share of this frame's jobs to the CPU mesher: it needs the CPU-side parse of the equation,
+// and only implements linearly interpolated marching cubes (see mcubes_cpu.hpp).
+static bool useCpuMeshing(const Gui* pGui, bool rayMarch, const std::vector<McubesParams>& jobs)
+{
+  if(!pGui->m_cpuMeshing || rayMarch || s_equation.empty() || jobs.empty() || useVolume(pGui))
+    return false;
+  const McubesParams& params = jobs[0];  // Same settings for all jobs
+  return params.mesher == MCUBES_MESHER_MARCHING_CUBES && params.newtonSteps == 0 && params.decimateTolerance <= 0.0f;
+}
+
+// Start meshing the given jobs on the CPU; s_cpuDoneTimelineSemaphore := g_frameNumber once they are staged.
+static void launchCpuMeshing(const Gui* pGui, uint32_t count, const McubesParams* pParams)
+{
+  const Equation* pCullEquation = pGui->m_cullBlocks ? &s_equation : nullptr;
+  uint32_t        emptyBlockMasks[mcubesCpuBatchMaxChunks][MCUBES_BLOCK_MASK_WORDS];
+  const uint32_t* maskPointers[mcubesCpuBatchMaxChunks];
+  for(uint32_t i = 0; i < count; ++i)
+  {
+    cullGetEmptyBlockMask(pCullEquation, pParams[i], emptyBlockMasks[i]);
+    maskPointers[i] = emptyBlockMasks[i];
+  }
+  mcubesCpuBatchLaunch(s_equation, count, pParams, maskPointers, uint32_t(g_frameNumber & 1u),
+                       s_cpuDoneTimelineSemaphore, g_frameNumber);
+}
+
+// Source of bricks: the volume file, paged in as the brick thread converts it, or the equation sampled on the
+// CPU, standing in for simulation output. Null if bricks are off, or if there is no equation to sample.
+static McubesBrickSource getBrickSource(const Gui* pGui)
+{
+  if(useVolume(pGui))
+  {
+    nvmath::vec3f low, high;
+    pGui->getBoundingBox(&low, &high);
+    return [low, high](uint32_t count, const McubesParams* pJobs, float* const* ppImages) {
+      for(uint32_t i = 0; i < count; ++i)
+      {
+        volumeFileReadBrick(s_volume, low, high, pJobs[i], ppImages[i]);
+      }
+    };
+  }
+  if(!pGui->m_cpuBricks || s_equation.empty())
+    return nullptr;
+  return [equation = s_equation](uint32_t count, const McubesParams* pJobs, float* const* ppImages) {
+    McubesCpuChunk chunks[MCUBES_MAX_CHUNKS_PER_BATCH];
+    for(uint32_t i = 0; i < count; ++i)
+    {
+      chunks[i] = {pJobs[i], nullptr, ppImages[i], nullptr};
+    }
+    mcubesCpuFillImages(equation, count, chunks);
+  };
+}
+
 // Helper for getting the list of colors to draw each chunk when using debug visualization modes.
 // Returns empty vector if no such mode is enabled.
 static std::vector<McubesDebugViewPushConstant> makeDebugColors(int                 chunkDebugViewMode,
@@ -316,6 +526,15 @@ static std::vector<McubesDebugViewPushConstant> makeDebugColors(int
   }
 }
 
+// Write this frame's camera UBO. It is persistently mapped and not referenced by the recorded commands, so this
+// is done just before the first graphics submit of the frame: the camera is sampled as late as possible (late
+// latching), and not before recording any batch. The UBO of the frame before last, which used the same slot, has
+// retired, as the command pools of that frame were reset.
+static void setCameraTransforms(const Gui* pGui)
+{
+  graphicsSetCameraTransforms(pGui->getTransforms(s_windowWidth, s_windowHeight));
+}
+
 // clang-format off
 
 // Submit compute and graphics commands for generating marching cubes geometry
@@ -334,6 +553,12 @@ static void computeDrawCommandsTwoQueues(const Gui* pGui)
   vkWaitSemaphoresKHR(g_ctx, &waitInfo, ~uint64_t(0));  // or vkWaitSemaphores in Vulkan 1.2
   // clang-format on
 
+  // The compute work that used this frame's McubesBlockStats slot has now retired.
+  mcubesCollectBlockStats(uint32_t(g_frameNumber & 1u));
+  mcubesBakeCollect(uint32_t(g_frameNumber & 1u));
+  mcubesCpuBatchCollect(uint32_t(g_frameNumber & 1u));
+  mcubesBrickCollectStats();
+
   // Reset command pools.
   VkCommandPool ourComputePool  = s_frameComputePools[g_frameNumber & 1u];
   VkCommandPool ourGraphicsPool = s_frameGraphicsPools[g_frameNumber & 1u];
@@ -343,7 +568,26 @@ static void computeDrawCommandsTwoQueues(const Gui* pGui)
   std::vector<VkCommandBuffer>& ourGraphicsCmdBufs = s_frameGraphicsCmdBufs[g_frameNumber & 1u];
 
   // List of compute and graphics jobs to run.
-  std::vector<McubesParams> paramsList = pGui->getMcubesJobs();
+  std::vector<McubesParams> paramsList = getCulledMcubesJobs(pGui);
+  McubesBakeFrame           bake       = getBakeFrame(pGui, &paramsList);
+  const bool                rayMarch   = pGui->m_renderMode == renderModeRayMarch;  // Fill images only
+
+  // Give a share of the jobs, those at the end of the list, to the CPU; they get batches of their own, submitted
+  // last, that upload the CPU's results instead of filling the chunks (see mcubes_cpu_batch.hpp).
+  uint32_t cpuJobCount = 0;
+  if(useCpuMeshing(pGui, rayMarch, paramsList))
+  {
+    mcubesCpuBatchEnable();
+    cpuJobCount = mcubesCpuBatchSplit(uint32_t(paramsList.size()));
+  }
+  uint32_t gpuJobCount = uint32_t(paramsList.size()) - cpuJobCount;
+  if(cpuJobCount != 0)
+  {
+    launchCpuMeshing(pGui, cpuJobCount, paramsList.data() + gpuJobCount);
+  }
+  // The other jobs may fill their images from bricks that the brick thread produces, each batch's as its commands
+  // are recorded and submitted.
+  McubesBrickSource brickSource = getBrickSource(pGui);
 
   // Structs for allocating or recycling command buffers.
   // Note that we need to recycle command buffers, because command pool resets only reset the command buffers,
@@ -360,13 +604,14 @@ static void computeDrawCommandsTwoQueues(const Gui* pGui)
   // Set up queue submission structs ahead-of-time.
   // Because timeline semaphores are a later addition to Vulkan, WHICH semaphore to wait/signal on
   // is in a separate struct from WHAT value to wait/set the timeline semaphore to.
-  uint64_t                      computeWaitTimelineValue = 0, computeSignalTimelineValue = 0;
+  uint64_t                      computeWaitTimelineValues[2] = {0, 0}, computeSignalTimelineValue = 0;
+  uint64_t&                     computeWaitTimelineValue     = computeWaitTimelineValues[0];
   uint64_t                      graphicsWaitTimelineValue = 0, graphicsSignalTimelineValue = 0;
   VkTimelineSemaphoreSubmitInfo computeTimelineInfo = {
       VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO,
       nullptr,
-      1,
-      &computeWaitTimelineValue,  // Compute queue waits for /at least/ this timeline semaphore value of
+      1,                          // 2 for CPU and brick batches, which also wait for a host signal (see below)
+      computeWaitTimelineValues,  // Compute queue waits for /at least/ this timeline semaphore value of
       1,                          // s_graphicsDoneTimelineSemaphore (semaphore set below).
       &computeSignalTimelineValue};
   VkTimelineSemaphoreSubmitInfo graphicsTimelineInfo = {
@@ -379,14 +624,17 @@ static void computeDrawCommandsTwoQueues(const Gui* pGui)
 
   VkPipelineStageFlags computeStage = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
   VkPipelineStageFlags readGeometryArrayStage =
-      VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT;
+      VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
   // See NOTE -- readGeometryArrayStage
 
+  VkSemaphore          computeWaitSemaphores[2] = {s_graphicsDoneTimelineSemaphore, VK_NULL_HANDLE};  // See below
+  VkPipelineStageFlags computeWaitStages[2]     = {computeStage, computeStage};
+
   VkSubmitInfo computeSubmitInfo  = {VK_STRUCTURE_TYPE_SUBMIT_INFO,
                                     &computeTimelineInfo,  // Extension struct
-                                    1,
-                                    &s_graphicsDoneTimelineSemaphore,  // Compute waits for graphics queue
-                                    &computeStage,                     // Waits for semaphore before starting compute
+                                    1,                      // 2 for CPU and brick batches, as above
+                                    computeWaitSemaphores,  // Compute waits for graphics queue (and host)
+                                    computeWaitStages,      // Waits for semaphore before starting compute
                                     1,
                                     &batchComputeCmdBuf,
                                     1,
@@ -403,7 +651,9 @@ static void computeDrawCommandsTwoQueues(const Gui* pGui)
 
   // Split the list of jobs into batches of up to batchSize McubesChunk jobs.
   uint32_t batchSize  = nvmath::nv_clamp<uint32_t>(pGui->m_batchSize, 1u, MCUBES_MAX_CHUNKS_PER_BATCH);
-  uint32_t batchCount = uint32_t(paramsList.size() + batchSize - 1u) / batchSize;
+  uint32_t gpuBatchCount = (gpuJobCount + batchSize - 1u) / batchSize;
+  uint32_t batchCount    = gpuBatchCount + (cpuJobCount + batchSize - 1u) / batchSize;
+  batchCount             = std::max(batchCount, 1u);  // Even if all chunks were culled, for start-of-frame and ImGui.
   uint32_t firstChunkUsed;
 
   // Record and submit fill and draw McubesChunk commands.
@@ -435,12 +685,17 @@ static void computeDrawCommandsTwoQueues(const Gui* pGui)
     // Start-of-frame commands (clear depth buffer, etc.)
     if(batch == 0)
     {
-      CameraTransforms cameraTransforms = pGui->getTransforms(s_windowWidth, s_windowHeight);
-      graphicsCmdPrepareFrame(batchGraphicsCmdBuf, &cameraTransforms);
+      graphicsCmdPrepareFrame(batchGraphicsCmdBuf);
+      if(bake.pReplay != nullptr)
+        graphicsCmdDrawMcubesBakedKeyframe(batchGraphicsCmdBuf, *bake.pReplay);
     }
 
-    // Record compute and draw commands for batch.
-    uint32_t batchStart = batch * batchSize, batchEnd = std::min(batchStart + batchSize, uint32_t(paramsList.size()));
+    // Record compute and draw commands for batch; the batches of GPU-meshed jobs come first.
+    const bool          cpuBatch    = batch >= gpuBatchCount && cpuJobCount != 0;
+    uint32_t            batchStart  = cpuBatch ? gpuJobCount + (batch - gpuBatchCount) * batchSize : batch * batchSize;
+    uint32_t            batchLimit  = cpuBatch ? uint32_t(paramsList.size()) : gpuJobCount;
+    uint32_t            batchEnd    = std::min(batchStart + batchSize, batchLimit);
+    const McubesParams* batchParams = paramsList.data() + batchStart;
     // List of McubesChunk objects to use for compute->graphics communication in this batch.
     McubesChunk* chunkPointerArray[MCUBES_MAX_CHUNKS_PER_BATCH];
     for(uint32_t localIndex = 0, paramIndex = batchStart; paramIndex < batchEnd; ++paramIndex, ++localIndex)
@@ -463,16 +718,59 @@ static void computeDrawCommandsTwoQueues(const Gui* pGui)
     {
       computeWaitTimelineValue = std::max(computeWaitTimelineValue, chunkPointerArray[localIndex]->timelineValue);
     }
-    computeCmdFillChunkBatch(batchComputeCmdBuf, batchEnd - batchStart, chunkPointerArray, &paramsList[batchStart]);
+    const bool timedBatch = batch < gpuBatchCount;
+    if(timedBatch)
+      mcubesCpuBatchCmdBeginGpuTiming(batchComputeCmdBuf, uint32_t(g_frameNumber & 1u));
+    const bool brickBatch = !cpuBatch && brickSource && batchEnd > batchStart;
+    uint32_t   brickRegions[MCUBES_MAX_CHUNKS_PER_BATCH];
+    if(brickBatch)
+    {
+      // The brick thread (or its upload, on the transfer queue) waits for the compute queue to be done copying
+      // the bricks of the batch before last.
+      if(useVolume(pGui))
+      {
+        nvmath::vec3f low, high;
+        pGui->getBoundingBox(&low, &high);
+        for(uint32_t i = 0; i < batchEnd - batchStart; ++i)
+        {
+          volumeFilePrefetchBrick(s_volume, low, high, batchParams[i]);
+        }
+      }
+      mcubesBrickLaunch(brickSource, batchEnd - batchStart, batchParams, s_bricksReadyTimelineSemaphore,
+                        ++s_bricksReadyTimelineValue, s_computeDoneTimelineSemaphore, s_upcomingTimelineValue,
+                        brickRegions);
+    }
+    if(cpuBatch)
+    {
+      computeCmdUploadChunkBatch(batchComputeCmdBuf, batchEnd - batchStart, chunkPointerArray,
+                                 mcubesCpuBatchRegion(uint32_t(g_frameNumber & 1u), batchStart - gpuJobCount));
+    }
+    else
+    {
+      setEmptyBlockMasks(pGui, batchEnd - batchStart, chunkPointerArray, batchParams);
+      computeCmdFillChunkBatch(batchComputeCmdBuf, batchEnd - batchStart, chunkPointerArray, batchParams, !rayMarch,
+                               brickBatch ? brickRegions : nullptr);
+    }
+    if(timedBatch)
+      mcubesCpuBatchCmdEndGpuTiming(batchComputeCmdBuf, uint32_t(g_frameNumber & 1u), batchEnd - batchStart);
+    if(bake.bake)
+    {
+      computeCmdBakeChunkBatch(batchComputeCmdBuf, batchEnd - batchStart, chunkPointerArray,
+                               bake.firstDraw + batchStart * MCUBES_GEOMETRIES_PER_CHUNK, uint32_t(g_frameNumber & 1u));
+    }
 
     // Ensure memory dependency resolved between upcoming compute command and upcoming graphics commands.
     // This is separate from (and an additional requirement on top of) the execution dependency
     // handled by the timeline semaphore.
-    // No queue ownership transfer -- using VK_SHARING_MODE_CONCURRENT.
+    // No queue ownership transfer with VK_SHARING_MODE_CONCURRENT (the default); with VK_SHARING_MODE_EXCLUSIVE,
+    // the buffers are also released by the compute queue and acquired by the graphics queue.
+    mcubesCmdReleaseChunkBatch(batchComputeCmdBuf, batchEnd - batchStart, chunkPointerArray, rayMarch);
     VkMemoryBarrier computeToGraphicsBarrier = {VK_STRUCTURE_TYPE_MEMORY_BARRIER, nullptr, VK_ACCESS_SHADER_WRITE_BIT,
                                                 VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT};
     vkCmdPipelineBarrier(batchGraphicsCmdBuf, computeStage, readGeometryArrayStage, 0, 1, &computeToGraphicsBarrier, 0,
                          0, 0, 0);
+    mcubesCmdAcquireChunkBatch(batchGraphicsCmdBuf, batchEnd - batchStart, chunkPointerArray, rayMarch,
+                               readGeometryArrayStage);
 
     // Graphics commands.
     for(uint32_t localIndex = 0, paramIndex = batchStart; paramIndex < batchEnd; ++paramIndex, ++localIndex)
@@ -483,9 +781,18 @@ static void computeDrawCommandsTwoQueues(const Gui* pGui)
     std::vector<McubesDebugViewPushConstant> debugColors =
         makeDebugColors(pGui->m_chunkDebugViewMode, batch, firstChunkUsed, batchEnd - batchStart, chunkPointerArray);
     const bool          drawChunkBounds = pGui->m_chunkDebugViewMode != chunkDebugViewOff;
-    const McubesParams* pDebugBoxes     = drawChunkBounds ? &paramsList[batchStart] : nullptr;
-    graphicsCmdDrawMcubesGeometryBatch(batchGraphicsCmdBuf, batchEnd - batchStart, chunkPointerArray, pDebugBoxes,
-                                       debugColors.empty() ? nullptr : debugColors.data());
+    const McubesParams* pDebugBoxes     = drawChunkBounds ? batchParams : nullptr;
+    if(rayMarch)
+    {
+      graphicsCmdRayMarchMcubesImageBatch(batchGraphicsCmdBuf, batchEnd - batchStart, chunkPointerArray, batchParams,
+                                          s_mcubesSymmetry, debugColors.empty() ? nullptr : debugColors.data());
+    }
+    else
+    {
+      graphicsCmdDrawMcubesGeometryBatch(batchGraphicsCmdBuf, batchEnd - batchStart, chunkPointerArray,
+                                         s_mcubesSymmetry, pDebugBoxes,
+                                         debugColors.empty() ? nullptr : debugColors.data());
+    }
 
     if(batch == batchCount - 1u)
     {
@@ -500,6 +807,16 @@ static void computeDrawCommandsTwoQueues(const Gui* pGui)
     NVVK_CHECK(vkEndCommandBuffer(batchComputeCmdBuf));
     // computeWaitTimelineValue will be deduced concurrent with command recording.
     computeSignalTimelineValue = s_upcomingTimelineValue;
+    // CPU batches also wait for s_cpuDoneTimelineSemaphore's value == g_frameNumber, and brick batches for
+    // s_bricksReadyTimelineSemaphore's value == s_bricksReadyTimelineValue (before their copies), which the host (or
+    // the transfer queue) has likely not signaled yet: unlike binary semaphores, timeline semaphores allow
+    // submitting the wait before the signal.
+    computeWaitSemaphores[1]     = cpuBatch ? s_cpuDoneTimelineSemaphore : s_bricksReadyTimelineSemaphore;
+    computeWaitTimelineValues[1] = cpuBatch ? g_frameNumber : s_bricksReadyTimelineValue;
+    computeWaitStages[1]         = cpuBatch ? computeStage : VK_PIPELINE_STAGE_TRANSFER_BIT;
+
+    computeSubmitInfo.waitSemaphoreCount        = cpuBatch || brickBatch ? 2u : 1u;
+    computeTimelineInfo.waitSemaphoreValueCount = computeSubmitInfo.waitSemaphoreCount;
     NVVK_CHECK(vkQueueSubmit(g_computeQueue, 1, &computeSubmitInfo, VkFence{}));
 
     // Graphics submit -- wait for the above just-submitted command to finish by waiting for
@@ -508,6 +825,8 @@ static void computeDrawCommandsTwoQueues(const Gui* pGui)
     NVVK_CHECK(vkEndCommandBuffer(batchGraphicsCmdBuf));
     graphicsWaitTimelineValue   = s_upcomingTimelineValue;
     graphicsSignalTimelineValue = s_upcomingTimelineValue;
+    if(batch == 0)
+      setCameraTransforms(pGui);
     NVVK_CHECK(vkQueueSubmit(g_gctQueue, 1, &graphicsSubmitInfo, VkFence{}));
     // We could have just set the VkTimelineSemaphoreSubmitInfo pointers directly, but we do it this way for teaching.
 
@@ -530,6 +849,9 @@ static void computeDrawCommandsTwoQueues(const Gui* pGui)
 // itself, so we are using VK_PIPELINE_STAGE_VERTEX_SHADER_BIT instead.
 //
 // We also need the draw indirect bit, since indirect commands are read from the buffer.
+//
+// In the ray marching render mode, mcubes_ray_march.frag reads the McubesChunk image and block signatures
+// instead, so the fragment shader stage is included too.
 
 
 // For comparison purposes, submit the compute and draw McubesChunk commands using only the GCT queue.
@@ -539,12 +861,16 @@ static void computeDrawCommandsGctOnly(const Gui* pGui)
   VkFence ourGraphicsFence = s_frameGraphicsPoolFences[g_frameNumber & 1u];
   NVVK_CHECK(vkWaitForFences(g_ctx, 1, &ourGraphicsFence, VK_TRUE, ~uint64_t(0)));
   NVVK_CHECK(vkResetFences(g_ctx, 1, &ourGraphicsFence));
+  mcubesCollectBlockStats(uint32_t(g_frameNumber & 1u));
+  mcubesBakeCollect(uint32_t(g_frameNumber & 1u));
   VkCommandPool ourGraphicsPool = s_frameGraphicsPools[g_frameNumber & 1u];
   NVVK_CHECK(vkResetCommandPool(g_ctx, ourGraphicsPool, 0));
   std::vector<VkCommandBuffer>& ourGraphicsCmdBufs = s_frameGraphicsCmdBufs[g_frameNumber & 1u];
 
   // List of compute and graphics jobs to run.
-  std::vector<McubesParams> paramsList = pGui->getMcubesJobs();
+  std::vector<McubesParams> paramsList = getCulledMcubesJobs(pGui);
+  McubesBakeFrame           bake       = getBakeFrame(pGui, &paramsList);
+  const bool                rayMarch   = pGui->m_renderMode == renderModeRayMarch;  // Fill images only
 
   // Structs for allocating or recycling command buffers.
   uint32_t                 nextCmdBufIndex       = 0;
@@ -555,7 +881,7 @@ static void computeDrawCommandsGctOnly(const Gui* pGui)
 
   VkPipelineStageFlags computeStage = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
   VkPipelineStageFlags readGeometryArrayStage =
-      VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT;
+      VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
   // See NOTE -- readGeometryArrayStage
 
   // Set up queue submission struct ahead-of-time.
@@ -566,6 +892,7 @@ static void computeDrawCommandsGctOnly(const Gui* pGui)
   // Split the list of jobs into batches of up to batchSize McubesChunk jobs.
   uint32_t batchSize  = nvmath::nv_clamp<uint32_t>(pGui->m_batchSize, 1u, MCUBES_MAX_CHUNKS_PER_BATCH);
   uint32_t batchCount = uint32_t(paramsList.size() + batchSize - 1u) / batchSize;
+  batchCount          = std::max(batchCount, 1u);  // Even if all chunks were culled, for start-of-frame and ImGui.
   uint32_t firstChunkUsed;
 
   // Record and submit fill and draw McubesChunk commands.
@@ -587,12 +914,15 @@ static void computeDrawCommandsGctOnly(const Gui* pGui)
     if(batch == 0)
     {
       // Start-of-frame commands (clear depth buffer, etc.)
-      CameraTransforms cameraTransforms = pGui->getTransforms(s_windowWidth, s_windowHeight);
-      graphicsCmdPrepareFrame(gctBatchCmdBuf, &cameraTransforms);
+      graphicsCmdPrepareFrame(gctBatchCmdBuf);
+      if(bake.pReplay != nullptr)
+        graphicsCmdDrawMcubesBakedKeyframe(gctBatchCmdBuf, *bake.pReplay);
     }
 
     // Record compute and draw commands for batch.
-    uint32_t batchStart = batch * batchSize, batchEnd = std::min(batchStart + batchSize, uint32_t(paramsList.size()));
+    uint32_t            batchStart  = batch * batchSize;
+    uint32_t            batchEnd    = std::min(batchStart + batchSize, uint32_t(paramsList.size()));
+    const McubesParams* batchParams = paramsList.data() + batchStart;
     // List of McubesChunk objects to use for compute->graphics communication in this batch.
     McubesChunk* chunkPointerArray[MCUBES_MAX_CHUNKS_PER_BATCH];
     for(uint32_t localIndex = 0, paramIndex = batchStart; paramIndex < batchEnd; ++paramIndex, ++localIndex)
@@ -609,7 +939,14 @@ static void computeDrawCommandsGctOnly(const Gui* pGui)
     }
 
     // Record compute commands.
-    computeCmdFillChunkBatch(gctBatchCmdBuf, batchEnd - batchStart, chunkPointerArray, &paramsList[batchStart]);
+    setEmptyBlockMasks(pGui, batchEnd - batchStart, chunkPointerArray, batchParams);
+    computeCmdFillChunkBatch(gctBatchCmdBuf, batchEnd - batchStart, chunkPointerArray, batchParams, !rayMarch,
+                             nullptr);
+    if(bake.bake)
+    {
+      computeCmdBakeChunkBatch(gctBatchCmdBuf, batchEnd - batchStart, chunkPointerArray,
+                               bake.firstDraw + batchStart * MCUBES_GEOMETRIES_PER_CHUNK, uint32_t(g_frameNumber & 1u));
+    }
 
     // Barrier. Handles both execution and memory dependency as we are using only one queue.
     // It may seem odd that we are specifying both graphics and compute in src and dst, but this
@@ -625,9 +962,17 @@ static void computeDrawCommandsGctOnly(const Gui* pGui)
     std::vector<McubesDebugViewPushConstant> debugColors =
         makeDebugColors(pGui->m_chunkDebugViewMode, batch, firstChunkUsed, batchEnd - batchStart, chunkPointerArray);
     const bool          drawChunkBounds = pGui->m_chunkDebugViewMode != chunkDebugViewOff;
-    const McubesParams* pDebugBoxes     = drawChunkBounds ? &paramsList[batchStart] : nullptr;
-    graphicsCmdDrawMcubesGeometryBatch(gctBatchCmdBuf, batchEnd - batchStart, chunkPointerArray, pDebugBoxes,
-                                       debugColors.empty() ? nullptr : debugColors.data());
+    const McubesParams* pDebugBoxes     = drawChunkBounds ? batchParams : nullptr;
+    if(rayMarch)
+    {
+      graphicsCmdRayMarchMcubesImageBatch(gctBatchCmdBuf, batchEnd - batchStart, chunkPointerArray, batchParams,
+                                          s_mcubesSymmetry, debugColors.empty() ? nullptr : debugColors.data());
+    }
+    else
+    {
+      graphicsCmdDrawMcubesGeometryBatch(gctBatchCmdBuf, batchEnd - batchStart, chunkPointerArray, s_mcubesSymmetry,
+                                         pDebugBoxes, debugColors.empty() ? nullptr : debugColors.data());
+    }
 
     // NOTE: There is no barrier between this graphics command, and the next iteration's compute commands.
     // This is why we need to ensure any McubesChunk filled in this batch is not recycled for the next batch
@@ -650,6 +995,8 @@ static void computeDrawCommandsGctOnly(const Gui* pGui)
 
     // Submit command buffer.
     NVVK_CHECK(vkEndCommandBuffer(gctBatchCmdBuf));
+    if(batch == 0)
+      setCameraTransforms(pGui);
     NVVK_CHECK(vkQueueSubmit(g_gctQueue, 1, &submitInfo, gctSignalFence));
   }  // End for each batch
 }
@@ -692,22 +1039,80 @@ static void submitFrame()
   nvvk::cmdBarrierImageLayout(cmdBuf, acquired.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
                               VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, VK_IMAGE_ASPECT_COLOR_BIT);
   NVVK_CHECK(vkEndCommandBuffer(cmdBuf));
-  VkPipelineStageFlags allCommands = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
-  VkSubmitInfo         submitInfo{
-      VK_STRUCTURE_TYPE_SUBMIT_INFO, nullptr, 1, &acquired.waitSem, &allCommands, 1, &cmdBuf, 1, &acquired.signalSem};
+  // Also signal s_frameDoneTimelineSemaphore := g_frameNumber (the value for the binary semaphore is ignored).
+  VkPipelineStageFlags          allCommands         = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+  VkSemaphore                   signalSemaphores[2] = {acquired.signalSem, s_frameDoneTimelineSemaphore};
+  uint64_t                      signalValues[2]     = {0, g_frameNumber};
+  VkTimelineSemaphoreSubmitInfo timelineInfo{
+      VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO, nullptr, 0, nullptr, 2, signalValues};
+  VkSubmitInfo                  submitInfo{
+      VK_STRUCTURE_TYPE_SUBMIT_INFO, &timelineInfo, 1, &acquired.waitSem, &allCommands, 1, &cmdBuf, 2, signalSemaphores};
   NVVK_CHECK(vkQueueSubmit(g_gctQueue, 1, &submitInfo, frameFence));
   g_swapChain.present();
 }
 
-int main()
+int main(int argc, char** argv)
 {
+  // Headless benchmark of the CPU-side equation evaluators, see equation_program.hpp.
+  if(argc > 1 && strcmp(argv[1], "--benchmark-equations") == 0)
+  {
+    equationBenchmarkPrograms();
+    return 0;
+  }
+  if(argc > 1 && strcmp(argv[1], "--check-equations") == 0)
+  {
+    bool ok = equationCheckCsgSkipMasks();
+    ok &= equationCheckGlslFloatLiterals();
+    ok &= equationCheckSeparableGlsl();
+    return ok ? 0 : 1;
+  }
+  if(argc > 1 && strcmp(argv[1], "--check-cpu-mesher") == 0)
+  {
+    return mcubesCpuCheckMesher() ? 0 : 1;
+  }
+
+  // Volume file to mesh instead of the equation, see volume_file.hpp. The surface is extracted where the volume
+  // equals the given value, by default half the range of integer samples (0 for float32).
+  float volumeIsoLevel = 0.0f;
+  if(argc > 1 && (strcmp(argv[1], "--volume") == 0 || strcmp(argv[1], "--bricked-volume") == 0))
+  {
+    if(argc < 5 || argc > 6)
+    {
+      fprintf(stderr, "Usage: %s %s <file> <W>x<H>x<D> <uint8|uint16|float32> [value]\n", argv[0], argv[1]);
+      return 1;
+    }
+    std::string error;
+    if(!volumeFileOpen(argv[2], argv[3], argv[4], strcmp(argv[1], "--bricked-volume") == 0, &s_volume, &error))
+    {
+      fprintf(stderr, "%s\n", error.c_str());
+      return 1;
+    }
+    float value = 0.0f;
+    if(s_volume.sampleType == volumeSampleUint8)
+      value = 128.0f;
+    else if(s_volume.sampleType == volumeSampleUint16)
+      value = 32768.0f;
+    if(argc == 6)
+      value = float(atof(argv[5]));
+    volumeIsoLevel = -value;  // Samples are negated.
+  }
+
   setupGlobals();
   setupStatics();
+  // Chunk, bake and staging resources live until shutdown: no need for free-list bookkeeping.
+  g_memAllocator.setLinear(true);
   setupMcubesChunks();
+  setupMcubesBake();
+  setupMcubesCpuBatch();
+  setupMcubesBricks();
+  g_memAllocator.setLinear(false);
   setupGraphics();
   Gui* pGui = new Gui;
+  if(s_volume.pMapped != nullptr)
+    pGui->setVolume(volumeIsoLevel);
 
-  setupCompute(pGui->m_equationInput.data());
+  setupCompute(pGui->m_equationInput.data(), pGui->m_separableTables);
+  parseEquation(pGui);
   s_useComputeQueue = pGui->m_wantComputeQueue;
 
   VkCommandBuffer             initGuiCmdBuf;
@@ -728,7 +1133,9 @@ int main()
     glfwPollEvents();
     ++g_frameNumber;
     waitNonzeroFramebufferSize();
-    graphicsWaitResizeFramebufferIfNeeded(s_windowWidth, s_windowHeight);
+    uint64_t completedFrameNumber;
+    NVVK_CHECK(vkGetSemaphoreCounterValueKHR(g_ctx, s_frameDoneTimelineSemaphore, &completedFrameNumber));
+    graphicsResizeFramebufferIfNeeded(s_windowWidth, s_windowHeight, completedFrameNumber);
     pGui->doFrame();
 
     // Respond to GUI events
@@ -738,14 +1145,24 @@ int main()
     }
     if(pGui->m_wantComputeQueue != s_useComputeQueue)
     {
+      mcubesBrickWaitIdle();
       vkDeviceWaitIdle(g_ctx);
       s_useComputeQueue = pGui->m_wantComputeQueue;
     }
+    if(pGui->m_exclusiveSharing != g_mcubesExclusiveSharing)
+    {
+      mcubesBrickWaitIdle();
+      vkDeviceWaitIdle(g_ctx);
+      mcubesSetExclusiveSharing(pGui->m_exclusiveSharing);
+    }
     if(pGui->m_wantSetEquation)
     {
+      mcubesBrickWaitIdle();
       vkDeviceWaitIdle(g_ctx);
-      pGui->m_compileFailure  = !computeReplaceEquation(pGui->m_equationInput.data());
+      pGui->m_compileFailure  = !computeReplaceEquation(pGui->m_equationInput.data(), pGui->m_separableTables);
       pGui->m_wantSetEquation = false;
+      parseEquation(pGui);
+      mcubesBakeReset();
     }
 
     if(s_useComputeQueue)
@@ -755,10 +1172,15 @@ int main()
 
     submitFrame();
   }
+  mcubesBrickWaitIdle();  // Its uploads must not be submitted during the device idle.
   vkDeviceWaitIdle(g_ctx);
   delete pGui;
   shutdownCompute();
   shutdownGraphics();
+  shutdownMcubesBricks();  // Before unmapping the volume that the brick thread reads.
+  volumeFileClose(&s_volume);
+  shutdownMcubesCpuBatch();
+  shutdownMcubesBake();
   shutdownMcubesChunks();
   shutdownStatics();
   shutdownGlobals();
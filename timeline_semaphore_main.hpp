@@ -11,13 +11,16 @@
 #include "nvvk/swapchain_vk.hpp"
 #include "nvvk/resourceallocator_vk.hpp"
 
+#include "memory_allocator.hpp"
+
 // Foundational Vulkan items used throughout the program.
-extern GLFWwindow*                      g_window;
-extern nvvk::Context                    g_ctx;
-extern nvvk::ResourceAllocatorDedicated g_allocator;
-extern VkSurfaceKHR                     g_surface;
-extern nvvk::SwapChain                  g_swapChain;
-extern VkQueue                          g_gctQueue, g_computeQueue;
-extern VkCommandPool                    g_gctPool, g_computePool;
-extern nvvk::ShaderModuleManager*       g_pShaderCompiler;
-extern uint64_t                         g_frameNumber;
+extern GLFWwindow*                g_window;
+extern nvvk::Context              g_ctx;
+extern SuballocatingMemAllocator  g_memAllocator;  // Backs g_allocator
+extern nvvk::ResourceAllocator    g_allocator;
+extern VkSurfaceKHR               g_surface;
+extern nvvk::SwapChain            g_swapChain;
+extern VkQueue                    g_gctQueue, g_computeQueue;
+extern VkCommandPool              g_gctPool, g_computePool;
+extern nvvk::ShaderModuleManager* g_pShaderCompiler;
+extern uint64_t                   g_frameNumber;
@@ -0,0 +1,374 @@
+// Copyright 2021 NVIDIA CORPORATION
+// SPDX-License-Identifier: Apache-2.0
+#include "volume_file.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static const uint32_t texelsPerEdge = MCUBES_CHUNK_EDGE_LENGTH_TEXELS;
+static const uint32_t cellsPerEdge  = MCUBES_CHUNK_EDGE_LENGTH_CELLS;
+static const uint32_t blocksPerEdge = MCUBES_CHUNK_EDGE_LENGTH_TEXELS / MCUBES_GEOMETRY_EDGE_LENGTH;
+
+static size_t sampleBytes(VolumeSampleType type)
+{
+  return type == volumeSampleUint8 ? 1 : type == volumeSampleUint16 ? 2 : 4;
+}
+
+// Size along one axis of the given brick, in samples (smaller at the end of the volume).
+static uint32_t brickEdge(uint32_t dim, uint32_t brick)
+{
+  return std::min(texelsPerEdge, dim - cellsPerEdge * brick);
+}
+
+// Samples along one axis in all bricks, which overlap by one.
+static size_t bricksEdgeSum(const VolumeFile& volume, int axis)
+{
+  return size_t(texelsPerEdge) * (volume.brickCounts[axis] - 1)
+         + brickEdge(volume.dims[axis], volume.brickCounts[axis] - 1);
+}
+
+// Map the whole file read-only; on failure, returns false and leaves *pVolume unchanged.
+static bool mapFile(const char* pPath, VolumeFile* pVolume, std::string* pError)
+{
+#ifdef _WIN32
+  HANDLE file =
+      CreateFileA(pPath, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if(file == INVALID_HANDLE_VALUE)
+  {
+    *pError = std::string("Could not open ") + pPath;
+    return false;
+  }
+  LARGE_INTEGER size;
+  HANDLE        mapping = nullptr;
+  const void*   pView   = nullptr;
+  if(GetFileSizeEx(file, &size) && size.QuadPart != 0)
+  {
+    mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if(mapping != nullptr)
+      pView = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  }
+  CloseHandle(file);  // The mapping keeps the file open.
+  if(pView == nullptr)
+  {
+    if(mapping != nullptr)
+      CloseHandle(mapping);
+    *pError = std::string("Could not map ") + pPath;
+    return false;
+  }
+  pVolume->pMapped       = static_cast<const unsigned char*>(pView);
+  pVolume->size          = size_t(size.QuadPart);
+  pVolume->mappingHandle = mapping;
+#else
+  int fd = open(pPath, O_RDONLY);
+  if(fd < 0)
+  {
+    *pError = std::string("Could not open ") + pPath + ": " + strerror(errno);
+    return false;
+  }
+  struct stat status;
+  void*       pView = MAP_FAILED;
+  if(fstat(fd, &status) == 0 && status.st_size != 0)
+    pView = mmap(nullptr, size_t(status.st_size), PROT_READ, MAP_SHARED, fd, 0);
+  int mapErrno = errno;
+  close(fd);  // The mapping keeps the file open.
+  if(pView == MAP_FAILED)
+  {
+    *pError = std::string("Could not map ") + pPath + ": " + strerror(mapErrno);
+    return false;
+  }
+  pVolume->pMapped = static_cast<const unsigned char*>(pView);
+  pVolume->size    = size_t(status.st_size);
+#endif
+  return true;
+}
+
+bool volumeFileOpen(const char*  pPath,
+                    const char*  pDims,
+                    const char*  pSampleType,
+                    bool         bricked,
+                    VolumeFile*  pOut,
+                    std::string* pError)
+{
+  VolumeFile volume;
+  char       trailing;
+  if(sscanf(pDims, "%ux%ux%u%c", &volume.dims[0], &volume.dims[1], &volume.dims[2], &trailing) != 3
+     || volume.dims[0] < 2 || volume.dims[1] < 2 || volume.dims[2] < 2)
+  {
+    *pError = std::string("Expected dimensions as WxHxD, each at least 2, not ") + pDims;
+    return false;
+  }
+
+  if(strcmp(pSampleType, "uint8") == 0)
+    volume.sampleType = volumeSampleUint8;
+  else if(strcmp(pSampleType, "uint16") == 0)
+    volume.sampleType = volumeSampleUint16;
+  else if(strcmp(pSampleType, "float32") == 0)
+    volume.sampleType = volumeSampleFloat32;
+  else
+  {
+    *pError = std::string("Expected sample type uint8, uint16 or float32, not ") + pSampleType;
+    return false;
+  }
+
+  volume.bricked = bricked;
+  for(int axis = 0; axis < 3; ++axis)
+  {
+    volume.brickCounts[axis] = (volume.dims[axis] - 2) / cellsPerEdge + 1;  // Bricks with at least one cell.
+  }
+
+  // Bricks repeat the samples of the faces they share.
+  size_t expectedSize = sampleBytes(volume.sampleType);
+  for(int axis = 0; axis < 3; ++axis)
+  {
+    expectedSize *= bricked ? bricksEdgeSum(volume, axis) : volume.dims[axis];
+  }
+
+  if(!mapFile(pPath, &volume, pError))
+    return false;
+  if(volume.size != expectedSize)
+  {
+    *pError = std::string(pPath) + " holds " + std::to_string(volume.size) + " bytes, not the "
+              + std::to_string(expectedSize) + " expected for its dimensions and sample type";
+    volumeFileClose(&volume);
+    return false;
+  }
+  *pOut = volume;
+  return true;
+}
+
+void volumeFileClose(VolumeFile* pVolume)
+{
+  if(pVolume->pMapped != nullptr)
+  {
+#ifdef _WIN32
+    UnmapViewOfFile(pVolume->pMapped);
+    CloseHandle(pVolume->mappingHandle);
+#else
+    munmap(const_cast<unsigned char*>(pVolume->pMapped), pVolume->size);
+#endif
+  }
+  *pVolume = VolumeFile();
+}
+
+// Size of a voxel (the distance between neighboring samples), with the volume spanning low to high.
+static nvmath::vec3f voxelSize(const VolumeFile& volume, nvmath::vec3f low, nvmath::vec3f high)
+{
+  return (high - low) / nvmath::vec3f(float(volume.dims[0] - 1), float(volume.dims[1] - 1), float(volume.dims[2] - 1));
+}
+
+void volumeFileGetJobs(const VolumeFile&          volume,
+                       nvmath::vec3f              low,
+                       nvmath::vec3f              high,
+                       const McubesParams&        settings,
+                       std::vector<McubesParams>* pJobs)
+{
+  nvmath::vec3f voxel     = voxelSize(volume, low, high);
+  nvmath::vec3f brickSize = voxel * float(cellsPerEdge);
+  pJobs->clear();
+  for(uint32_t z = 0; z < volume.brickCounts[2]; ++z)
+  {
+    for(uint32_t y = 0; y < volume.brickCounts[1]; ++y)
+    {
+      for(uint32_t x = 0; x < volume.brickCounts[0]; ++x)
+      {
+        McubesParams params = settings;
+        params.offset       = low + brickSize * nvmath::vec3f(float(x), float(y), float(z));
+        params.size         = brickSize;
+        params.csgSkipMask  = 0;
+        params.newtonSteps  = 0;
+        pJobs->push_back(params);
+      }
+    }
+  }
+}
+
+// Brick coordinates of a job placed by volumeFileGetJobs.
+static void getBrick(const VolumeFile& volume, nvmath::vec3f low, nvmath::vec3f high, const McubesParams& job,
+                     uint32_t brick[3])
+{
+  nvmath::vec3f voxel = voxelSize(volume, low, high);
+  for(int axis = 0; axis < 3; ++axis)
+  {
+    long b      = lroundf((job.offset[axis] - low[axis]) / (voxel[axis] * float(cellsPerEdge)));
+    brick[axis] = uint32_t(std::min(std::max(b, 0L), long(volume.brickCounts[axis]) - 1L));
+  }
+}
+
+// Byte offset in the file of the brick's first sample, and the strides of its rows and slices in samples.
+static size_t getBrickLayout(const VolumeFile& volume,
+                             const uint32_t    brick[3],
+                             size_t*           pRowStride,
+                             size_t*           pSliceStride)
+{
+  size_t sampleOffset;
+  if(volume.bricked)
+  {
+    // Only the last brick along an axis may be partial, so texelsPerEdge * brick[axis] samples precede it.
+    uint32_t edgeX = brickEdge(volume.dims[0], brick[0]);
+    uint32_t edgeY = brickEdge(volume.dims[1], brick[1]);
+    uint32_t edgeZ = brickEdge(volume.dims[2], brick[2]);
+    sampleOffset   = bricksEdgeSum(volume, 0) * bricksEdgeSum(volume, 1) * texelsPerEdge * brick[2]  // Slabs of z
+                     + bricksEdgeSum(volume, 0) * texelsPerEdge * brick[1] * edgeZ                   // Rows of y
+                     + size_t(texelsPerEdge) * brick[0] * edgeY * edgeZ;
+    *pRowStride    = edgeX;
+    *pSliceStride  = size_t(edgeX) * edgeY;
+  }
+  else
+  {
+    *pRowStride   = volume.dims[0];
+    *pSliceStride = size_t(volume.dims[0]) * volume.dims[1];
+    sampleOffset  = cellsPerEdge * brick[0] + *pRowStride * cellsPerEdge * brick[1]
+                    + *pSliceStride * cellsPerEdge * brick[2];
+  }
+  return sampleOffset * sampleBytes(volume.sampleType);
+}
+
+// Negated sample i of the row at pRow.
+static float readSample(const VolumeFile& volume, const unsigned char* pRow, uint32_t i)
+{
+  switch(volume.sampleType)
+  {
+    case volumeSampleUint8:
+      return -float(pRow[i]);
+    case volumeSampleUint16: {
+      uint16_t value;
+      memcpy(&value, pRow + 2 * i, sizeof value);
+      return -float(value);
+    }
+    default: {
+      float value;
+      memcpy(&value, pRow + 4 * i, sizeof value);
+      return -value;
+    }
+  }
+}
+
+void volumeFileReadBrick(const VolumeFile& volume, nvmath::vec3f low, nvmath::vec3f high, const McubesParams& job,
+                         float* pImage)
+{
+  uint32_t brick[3];
+  getBrick(volume, low, high, job, brick);
+  size_t               rowStride, sliceStride;
+  const unsigned char* pBrick = volume.pMapped + getBrickLayout(volume, brick, &rowStride, &sliceStride);
+  size_t               bytes  = sampleBytes(volume.sampleType);
+
+  uint32_t edges[3];
+  for(int axis = 0; axis < 3; ++axis)
+  {
+    edges[axis] = brickEdge(volume.dims[axis], brick[axis]);
+  }
+
+  // Read each row in order, repeating the last sample, row and slice past the end of the volume.
+  for(uint32_t z = 0; z < texelsPerEdge; ++z)
+  {
+    for(uint32_t y = 0; y < texelsPerEdge; ++y)
+    {
+      const unsigned char* pRow =
+          pBrick + bytes * (sliceStride * std::min(z, edges[2] - 1) + rowStride * std::min(y, edges[1] - 1));
+      float* pOut = pImage + texelsPerEdge * (y + texelsPerEdge * z);
+      for(uint32_t x = 0; x < edges[0]; ++x)
+      {
+        pOut[x] = readSample(volume, pRow, x);
+      }
+      std::fill(pOut + edges[0], pOut + texelsPerEdge, pOut[edges[0] - 1]);
+    }
+  }
+}
+
+void volumeFilePrefetchBrick(const VolumeFile& volume, nvmath::vec3f low, nvmath::vec3f high, const McubesParams& job)
+{
+#ifndef _WIN32
+  uint32_t brick[3];
+  getBrick(volume, low, high, job, brick);
+  size_t rowStride, sliceStride;
+  size_t begin = getBrickLayout(volume, brick, &rowStride, &sliceStride);
+  size_t bytes = sampleBytes(volume.sampleType);
+
+  uint32_t edgeX = brickEdge(volume.dims[0], brick[0]);
+  uint32_t edgeY = brickEdge(volume.dims[1], brick[1]);
+  uint32_t edgeZ = brickEdge(volume.dims[2], brick[2]);
+  size_t   page  = size_t(sysconf(_SC_PAGESIZE));
+
+  auto advise = [&volume](size_t adviseBegin, size_t adviseEnd) {
+    madvise(const_cast<unsigned char*>(volume.pMapped) + adviseBegin, adviseEnd - adviseBegin, MADV_WILLNEED);
+  };
+
+  // A bricked brick is contiguous. A raw one is edgeY * edgeZ rows, with the rest of the volume's rows in between:
+  // advise only the pages of those rows, merging runs of adjacent ones into one call.
+  if(volume.bricked)
+  {
+    advise(begin - begin % page, begin + bytes * sliceStride * edgeZ);
+    return;
+  }
+  size_t runBegin = 0, runEnd = 0;
+  for(uint32_t z = 0; z < edgeZ; ++z)
+  {
+    for(uint32_t y = 0; y < edgeY; ++y)
+    {
+      size_t rowBegin = begin + bytes * (sliceStride * z + rowStride * y);
+      size_t rowEnd   = rowBegin + bytes * edgeX;
+      rowBegin -= rowBegin % page;
+      if(runEnd != 0 && rowBegin <= runEnd)
+      {
+        runEnd = std::max(runEnd, rowEnd);
+        continue;
+      }
+      if(runEnd != 0)
+        advise(runBegin, runEnd);
+      runBegin = rowBegin;
+      runEnd   = rowEnd;
+    }
+  }
+  advise(runBegin, runEnd);
+#else
+  (void)volume, (void)low, (void)high, (void)job;  // Windows pages the mapping in on demand only.
+#endif
+}
+
+void volumeFileGetEmptyBlockMask(const VolumeFile&   volume,
+                                 nvmath::vec3f       low,
+                                 nvmath::vec3f       high,
+                                 const McubesParams& job,
+                                 uint32_t*           pMask)
+{
+  uint32_t brick[3];
+  getBrick(volume, low, high, job, brick);
+
+  // Blocks of the last brick along an axis may start at or past the volume's last sample, so have no cell in it.
+  uint32_t usedBlocks[3];
+  for(int axis = 0; axis < 3; ++axis)
+  {
+    uint32_t cells   = brickEdge(volume.dims[axis], brick[axis]) - 1;
+    usedBlocks[axis] = (cells + MCUBES_GEOMETRY_EDGE_LENGTH - 1) / MCUBES_GEOMETRY_EDGE_LENGTH;
+  }
+
+  memset(pMask, 0, MCUBES_BLOCK_MASK_WORDS * sizeof(uint32_t));
+  for(uint32_t z = 0; z < blocksPerEdge; ++z)
+  {
+    for(uint32_t y = 0; y < blocksPerEdge; ++y)
+    {
+      for(uint32_t x = 0; x < blocksPerEdge; ++x)
+      {
+        if(x >= usedBlocks[0] || y >= usedBlocks[1] || z >= usedBlocks[2])
+        {
+          uint32_t blockIndex = x + blocksPerEdge * (y + blocksPerEdge * z);  // Matches mcubes_geometry.comp
+          pMask[blockIndex / 32u] |= 1u << (blockIndex % 32u);
+        }
+      }
+    }
+  }
+}
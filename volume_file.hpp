@@ -0,0 +1,77 @@
+// Copyright 2021 NVIDIA CORPORATION
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "shaders/mcubes_params.h"
+
+// Sampled scalar volumes (CT scans, simulation dumps), meshed instead of the equation. The file is memory-mapped,
+// so it may be far larger than memory, let alone VRAM: it is paged in one brick at a time as volumeFileReadBrick
+// converts the chunk images from it (on the brick thread, see mcubes_brick.hpp).
+//
+// The volume is cut into bricks of MCUBES_CHUNK_EDGE_LENGTH_TEXELS^3 samples, one per McubesChunk: brick b covers
+// samples MCUBES_CHUNK_EDGE_LENGTH_CELLS * b .. MCUBES_CHUNK_EDGE_LENGTH_CELLS * (b + 1) along each axis, so that
+// neighboring bricks share a face, as the chunks of the equation do. Samples past the end of the volume repeat
+// the last one. Two file layouts are supported, little-endian without header:
+//   raw:     all samples, x fastest, then y, then z;
+//   bricked: the bricks, x fastest, then y, then z, each laid out as a raw volume of the brick's size (so that
+//            reading one is sequential).
+// Samples are negated, so that dense (high) regions are inside, as negative values of the equation are:
+// extract the surface where the volume equals v with the iso-level -v.
+
+enum VolumeSampleType
+{
+  volumeSampleUint8,
+  volumeSampleUint16,
+  volumeSampleFloat32,
+};
+
+struct VolumeFile
+{
+  uint32_t         dims[3]        = {};  // Samples along x, y, z; at least 2 each.
+  uint32_t         brickCounts[3] = {};  // Bricks along x, y, z.
+  VolumeSampleType sampleType     = volumeSampleUint8;
+  bool             bricked        = false;
+
+  const unsigned char* pMapped       = nullptr;
+  size_t               size          = 0;
+  void*                mappingHandle = nullptr;  // Windows file mapping object; unused elsewhere.
+};
+
+// Map the file at pPath, with dimensions given as "WxHxD" and the sample type as "uint8", "uint16" or "float32".
+// On failure, returns false and describes the error in *pError.
+bool volumeFileOpen(const char*  pPath,
+                    const char*  pDims,
+                    const char*  pSampleType,
+                    bool         bricked,
+                    VolumeFile*  pOut,
+                    std::string* pError);
+void volumeFileClose(VolumeFile* pVolume);
+
+// Get one job per brick, with the volume spanning the box from low to high, and the other parameters (iso-levels,
+// mesher, ...) from settings; Newton steps, which refine vertices on the equation, are disabled.
+void volumeFileGetJobs(const VolumeFile&          volume,
+                       nvmath::vec3f              low,
+                       nvmath::vec3f              high,
+                       const McubesParams&        settings,
+                       std::vector<McubesParams>* pJobs);
+
+// Fill pImage (MCUBES_CHUNK_EDGE_LENGTH_TEXELS^3 samples, x fastest, then y, then z) with the brick of a job
+// placed by volumeFileGetJobs with the same low and high. Thread safe.
+void volumeFileReadBrick(const VolumeFile& volume, nvmath::vec3f low, nvmath::vec3f high, const McubesParams& job,
+                         float* pImage);
+
+// Hint that the brick of the job will be read soon, so that the OS can start paging it in.
+void volumeFilePrefetchBrick(const VolumeFile& volume, nvmath::vec3f low, nvmath::vec3f high, const McubesParams& job);
+
+// Fill the MCUBES_BLOCK_MASK_WORDS-long bitmask (as McubesChunk::emptyBlockMask) of the McubesGeometry blocks of
+// the job's chunk that lie wholly past the end of the volume.
+void volumeFileGetEmptyBlockMask(const VolumeFile&   volume,
+                                 nvmath::vec3f       low,
+                                 nvmath::vec3f       high,
+                                 const McubesParams& job,
+                                 uint32_t*           pMask);